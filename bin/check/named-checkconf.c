@@ -22,10 +22,12 @@
 #include <isc/hash.h>
 #include <isc/log.h>
 #include <isc/mem.h>
+#include <isc/os.h>
 #include <isc/print.h>
 #include <isc/result.h>
 #include <isc/string.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/db.h>
 #include <dns/fixedname.h>
@@ -575,6 +577,7 @@ int
 main(int argc, char **argv) {
 	int c;
 	cfg_parser_t *parser = NULL;
+	isc_workpool_t *pool = NULL;
 	cfg_obj_t *config = NULL;
 	const char *conffile = NULL;
 	isc_mem_t *mctx = NULL;
@@ -720,6 +723,11 @@ main(int argc, char **argv) {
 
 	RUNTIME_CHECK(cfg_parser_create(mctx, logc, &parser) == ISC_R_SUCCESS);
 
+	/*
+	 * The configuration is only destroyed at exit, right before
+	 * the parser, so its objects can come from the parser arena.
+	 */
+	cfg_parser_setflags(parser, CFG_PCTX_ARENA, true);
 	if (nodeprecate) {
 		cfg_parser_setflags(parser, CFG_PCTX_NODEPRECATED, true);
 	}
@@ -731,10 +739,12 @@ main(int argc, char **argv) {
 		exit(1);
 	}
 
-	result = bind9_check_namedconf(config, loadplugins, logc, mctx);
+	isc_workpool_create(mctx, isc_os_ncpus() - 1, &pool);
+	result = bind9_check_namedconf(config, loadplugins, pool, logc, mctx);
 	if (result != ISC_R_SUCCESS) {
 		exit_status = 1;
 	}
+	isc_workpool_detach(&pool);
 
 	if (result == ISC_R_SUCCESS && (load_zones || list_zones)) {
 		result = load_zones_fromconfig(config, mctx, list_zones);
@@ -40,6 +40,7 @@
 #include <isc/file.h>
 #include <isc/hash.h>
 #include <isc/hex.h>
+#include <isc/iterated_hash.h>
 #include <isc/md.h>
 #include <isc/mem.h>
 #include <isc/mutex.h>
@@ -54,6 +55,7 @@
 #include <isc/task.h>
 #include <isc/time.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/db.h>
 #include <dns/dbiterator.h>
@@ -157,6 +159,7 @@ static unsigned char *gsalt = saltbuf;
 static size_t salt_length = 0;
 static isc_task_t *master = NULL;
 static unsigned int ntasks = 0;
+static isc_workpool_t *workpool = NULL;
 static atomic_bool shuttingdown;
 static atomic_bool finished;
 static bool nokeys = false;
@@ -774,27 +777,87 @@ hashlist_add(hashlist_t *l, const unsigned char *hash, size_t len) {
 	l->entries++;
 }
 
+/*%
+ * Names are hashed in batches, spread over the worker pool.  A name
+ * is queued with its node (if any) and a flag, and the batch is
+ * processed in queue order once the hashes have been calculated.
+ */
+#define HASHQUEUE_SIZE 1024
+
+typedef struct hashqueue_entry {
+	dns_fixedname_t fname;
+	dns_dbnode_t *node;
+	bool speculative;
+} hashqueue_entry_t;
+
+static hashqueue_entry_t hashqueue[HASHQUEUE_SIZE];
+static isc_iterated_hash_item_t hashitems[HASHQUEUE_SIZE];
+static unsigned int hashqueue_count = 0;
+
+static void
+hashqueue_add(const dns_name_t *name, dns_dbnode_t *node, bool speculative) {
+	hashqueue_entry_t *entry;
+	dns_name_t *qname;
+
+	INSIST(hashqueue_count < HASHQUEUE_SIZE);
+
+	entry = &hashqueue[hashqueue_count];
+	qname = dns_fixedname_initname(&entry->fname);
+	dns_name_downcase(name, qname, NULL);
+	entry->node = NULL;
+	if (node != NULL) {
+		dns_db_attachnode(gdb, node, &entry->node);
+	}
+	entry->speculative = speculative;
+
+	hashitems[hashqueue_count].in = qname->ndata;
+	hashitems[hashqueue_count].inlength = qname->length;
+	hashqueue_count++;
+}
+
+static void
+hashqueue_hash(unsigned int hashalg, unsigned int iterations,
+	       const unsigned char *salt, size_t salt_len) {
+	isc_iterated_hash_batch(workpool, hashalg, iterations, salt,
+				(int)salt_len, hashitems, hashqueue_count);
+}
+
+static void
+hashlist_flush(hashlist_t *l, unsigned int hashalg, unsigned int iterations,
+	       const unsigned char *salt, size_t salt_len) {
+	char nametext[DNS_NAME_FORMATSIZE];
+	unsigned char hash[NSEC3_MAX_HASH_LENGTH + 1];
+	unsigned int i, len;
+	int j;
+
+	hashqueue_hash(hashalg, iterations, salt, salt_len);
+
+	for (i = 0; i < hashqueue_count; i++) {
+		len = hashitems[i].outlength;
+		memmove(hash, hashitems[i].out, len);
+		if (verbose) {
+			dns_name_format(dns_fixedname_name(&hashqueue[i].fname),
+					nametext, sizeof nametext);
+			for (j = 0; j < (int)len; j++) {
+				fprintf(stderr, "%02x", hash[j]);
+			}
+			fprintf(stderr, " %s\n", nametext);
+		}
+		hash[len++] = hashqueue[i].speculative ? 1 : 0;
+		hashlist_add(l, hash, len);
+	}
+	hashqueue_count = 0;
+}
+
 static void
 hashlist_add_dns_name(hashlist_t *l,
 		      /*const*/ dns_name_t *name, unsigned int hashalg,
 		      unsigned int iterations, const unsigned char *salt,
 		      size_t salt_len, bool speculative) {
-	char nametext[DNS_NAME_FORMATSIZE];
-	unsigned char hash[NSEC3_MAX_HASH_LENGTH + 1];
-	unsigned int len;
-	size_t i;
-
-	len = isc_iterated_hash(hash, hashalg, iterations, salt, (int)salt_len,
-				name->ndata, name->length);
-	if (verbose) {
-		dns_name_format(name, nametext, sizeof nametext);
-		for (i = 0; i < len; i++) {
-			fprintf(stderr, "%02x", hash[i]);
-		}
-		fprintf(stderr, " %s\n", nametext);
+	if (hashqueue_count == HASHQUEUE_SIZE) {
+		hashlist_flush(l, hashalg, iterations, salt, salt_len);
 	}
-	hash[len++] = speculative ? 1 : 0;
-	hashlist_add(l, hash, len);
+	hashqueue_add(name, NULL, speculative);
 }
 
 static int
@@ -2006,30 +2069,44 @@ addnsec3param(const unsigned char *salt, size_t salt_len,
 }
 
 static void
-addnsec3(dns_name_t *name, dns_dbnode_t *node, const unsigned char *salt,
-	 size_t salt_len, unsigned int iterations, hashlist_t *hashlist,
-	 dns_ttl_t ttl) {
+addnsec3(dns_dbnode_t *node, const isc_iterated_hash_item_t *item,
+	 const unsigned char *salt, size_t salt_len, unsigned int iterations,
+	 hashlist_t *hashlist, dns_ttl_t ttl) {
 	unsigned char hash[NSEC3_MAX_HASH_LENGTH];
 	const unsigned char *nexthash;
 	unsigned char nsec3buffer[DNS_NSEC3_BUFFERSIZE];
+	unsigned char nametext[DNS_NAME_FORMATSIZE];
 	dns_fixedname_t hashname;
 	dns_rdatalist_t rdatalist;
 	dns_rdataset_t rdataset;
 	dns_rdata_t rdata = DNS_RDATA_INIT;
+	isc_buffer_t namebuffer;
+	isc_region_t region;
 	isc_result_t result;
 	dns_dbnode_t *nsec3node = NULL;
-	char namebuf[DNS_NAME_FORMATSIZE];
-	size_t hash_len;
 
-	dns_name_format(name, namebuf, sizeof(namebuf));
+	dns_rdataset_init(&rdataset);
 
+	if (item->outlength == 0) {
+		fatal("addnsec3: isc_iterated_hash_batch() failed");
+	}
+	memset(hash, 0, sizeof(hash));
+	memmove(hash, item->out, item->outlength);
+
+	/*
+	 * Convert the hash to base32hex non-padded and then to the
+	 * owner name of the NSEC3 record.
+	 */
+	region.base = hash;
+	region.length = (unsigned int)item->outlength;
+	isc_buffer_init(&namebuffer, nametext, sizeof(nametext));
+	result = isc_base32hexnp_totext(&region, 1, "", &namebuffer);
+	check_result(result, "addnsec3: isc_base32hexnp_totext()");
 	dns_fixedname_init(&hashname);
-	dns_rdataset_init(&rdataset);
+	result = dns_name_fromtext(dns_fixedname_name(&hashname), &namebuffer,
+				   gorigin, 0, NULL);
+	check_result(result, "addnsec3: dns_name_fromtext()");
 
-	dns_name_downcase(name, name, NULL);
-	result = dns_nsec3_hashname(&hashname, hash, &hash_len, name, gorigin,
-				    dns_hash_sha1, iterations, salt, salt_len);
-	check_result(result, "addnsec3: dns_nsec3_hashname()");
 	nexthash = hashlist_findnext(hashlist, hash);
 	result = dns_nsec3_buildrdata(
 		gdb, gversion, node,
@@ -2056,6 +2133,36 @@ addnsec3(dns_name_t *name, dns_dbnode_t *node, const unsigned char *salt,
 	dns_db_detachnode(gdb, &nsec3node);
 }
 
+/*%
+ * Add the NSEC3 records for the queued names.
+ */
+static void
+addnsec3_flush(const unsigned char *salt, size_t salt_len,
+	       unsigned int iterations, hashlist_t *hashlist, dns_ttl_t ttl) {
+	unsigned int i;
+
+	hashqueue_hash(dns_hash_sha1, iterations, salt, salt_len);
+
+	for (i = 0; i < hashqueue_count; i++) {
+		addnsec3(hashqueue[i].node, &hashitems[i], salt, salt_len,
+			 iterations, hashlist, ttl);
+		if (hashqueue[i].node != NULL) {
+			dns_db_detachnode(gdb, &hashqueue[i].node);
+		}
+	}
+	hashqueue_count = 0;
+}
+
+static void
+addnsec3_queue(dns_name_t *name, dns_dbnode_t *node,
+	       const unsigned char *salt, size_t salt_len,
+	       unsigned int iterations, hashlist_t *hashlist, dns_ttl_t ttl) {
+	if (hashqueue_count == HASHQUEUE_SIZE) {
+		addnsec3_flush(salt, salt_len, iterations, hashlist, ttl);
+	}
+	hashqueue_add(name, node, false);
+}
+
 /*%
  * Clean out NSEC3 record and RRSIG(NSEC3) that are not in the hash list.
  *
@@ -2312,6 +2419,8 @@ nsec3ify(unsigned int hashalg, dns_iterations_t iterations,
 	nextname = dns_fixedname_initname(&fnextname);
 	zonecut = NULL;
 
+	isc_workpool_create(mctx, ntasks - 1, &workpool);
+
 	/*
 	 * Walk the zone generating the hash names.
 	 */
@@ -2421,6 +2530,7 @@ nsec3ify(unsigned int hashalg, dns_iterations_t iterations,
 		}
 	}
 	dns_dbiterator_destroy(&dbiter);
+	hashlist_flush(hashlist, hashalg, iterations, salt, salt_len);
 
 	/*
 	 * We have all the hashes now so we can sort them.
@@ -2536,8 +2646,8 @@ nsec3ify(unsigned int hashalg, dns_iterations_t iterations,
 		 * We need to pause here to release the lock on the database.
 		 */
 		dns_dbiterator_pause(dbiter);
-		addnsec3(name, node, salt, salt_len, iterations, hashlist,
-			 zone_soa_min_ttl);
+		addnsec3_queue(name, node, salt, salt_len, iterations,
+			       hashlist, zone_soa_min_ttl);
 		dns_db_detachnode(gdb, &node);
 		/*
 		 * Add NSEC3's for empty nodes.  Use closest encloser logic.
@@ -2547,11 +2657,14 @@ nsec3ify(unsigned int hashalg, dns_iterations_t iterations,
 		while (count > nlabels + 1) {
 			count--;
 			dns_name_split(nextname, count, NULL, nextname);
-			addnsec3(nextname, NULL, salt, salt_len, iterations,
-				 hashlist, zone_soa_min_ttl);
+			addnsec3_queue(nextname, NULL, salt, salt_len,
+				       iterations, hashlist, zone_soa_min_ttl);
 		}
 	}
 	dns_dbiterator_destroy(&dbiter);
+	addnsec3_flush(salt, salt_len, iterations, hashlist, zone_soa_min_ttl);
+
+	isc_workpool_detach(&workpool);
 }
 
 /*%
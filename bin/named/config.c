@@ -129,6 +129,7 @@ options {\n\
 	transfers-per-ns 2;\n\
 #	treat-cr-as-space <obsolete>;\n\
 	trust-anchor-telemetry yes;\n\
+	udp-steering hash;\n\
 #	use-id-pool <obsolete>;\n\
 #	use-ixfr <obsolete>;\n\
 \n\
@@ -149,6 +150,7 @@ options {\n\
 	check-names slave warn;\n\
 	check-spf warn;\n\
 	clients-per-query 10;\n\
+	coalesce-fetches no;\n\
 	dnssec-accept-expired no;\n\
 	dnssec-validation " VALIDATION_DEFAULT "; \n"
 #ifdef HAVE_DNSTAP
@@ -188,6 +190,8 @@ options {\n\
 	request-expire true;\n\
 	request-ixfr true;\n\
 	require-server-cookie no;\n\
+	resolver-hedge-budget 0;\n\
+	resolver-hedge-percentile 95;\n\
 	resolver-nonbackoff-tries 3;\n\
 	resolver-retry-interval 800; /* in milliseconds */\n\
 #	rfc2308-type1 <obsolete>;\n\
@@ -219,10 +223,12 @@ options {\n\
 	dnssec-loadkeys-interval 60;\n\
 	dnssec-secure-to-insecure no;\n\
 	dnssec-update-mode maintain;\n\
+	dump-delta-ratio 0%;\n\
 #	forward <none>\n\
 #	forwarders <none>\n\
 	inline-signing no;\n\
 	ixfr-from-differences false;\n\
+	journal-compact-idle 0;\n\
 #	maintain-ixfr-base <obsolete>;\n\
 #	max-ixfr-log-size <obsolete>\n\
 	max-journal-size default;\n\
@@ -249,6 +255,7 @@ options {\n\
 	transfer-source-v6 *;\n\
 	try-tcp-refresh yes; /* BIND 8 compat */\n\
 	update-check-ksk yes;\n\
+	update-group-commit 0;\n\
 	zero-no-soa-ttl yes;\n\
 	zone-statistics terse;\n\
 };\n\
@@ -42,6 +42,17 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
  * \li	'zone' to be initialized.
  */
 
+void
+named_zone_reuseconfig(dns_zone_t *zone);
+/*%<
+ * Keep the existing configuration of a reused zone whose configuration
+ * data has not changed, instead of calling named_zone_configure().
+ *
+ * Require:
+ * \li	'zone' to be a zone previously configured by
+ *	named_zone_configure().
+ */
+
 bool
 named_zone_reusable(dns_zone_t *zone, const cfg_obj_t *zconfig);
 /*%<
@@ -34,8 +34,10 @@
 #include <isc/stdio.h>
 #include <isc/string.h>
 #include <isc/task.h>
+#include <isc/thread.h>
 #include <isc/timer.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/dispatch.h>
 #include <dns/dyndb.h>
@@ -126,6 +128,7 @@ static char saved_command_line[4096] = { 0 };
 static char ellipsis[5] = { 0 };
 static char version[512];
 static unsigned int maxsocks = 0;
+static isc_threadaffinity_t affinity = isc_threadaffinity_cpu;
 static int maxudp = 0;
 
 /*
@@ -325,8 +328,9 @@ static void
 usage(void) {
 	fprintf(stderr, "usage: named [-4|-6] [-c conffile] [-d debuglevel] "
 			"[-E engine] [-f|-g]\n"
-			"             [-n number_of_cpus] [-p port] [-s] "
-			"[-S sockets] [-t chrootdir]\n"
+			"             [-n number_of_cpus] [-a {none|cpu|node}] "
+			"[-p port] [-s]\n"
+			"             [-S sockets] [-t chrootdir]\n"
 			"             [-u username] [-U listeners] "
 			"[-m {usage|trace|record|size|mctx}]\n"
 			"usage: named [-v|-V]\n");
@@ -737,6 +741,21 @@ parse_command_line(int argc, char *argv[]) {
 			isc_net_disableipv4();
 			disable4 = true;
 			break;
+		case 'a':
+			if (strcasecmp(isc_commandline_argument, "none") == 0) {
+				affinity = isc_threadaffinity_none;
+			} else if (strcasecmp(isc_commandline_argument,
+					      "cpu") == 0) {
+				affinity = isc_threadaffinity_cpu;
+			} else if (strcasecmp(isc_commandline_argument,
+					      "node") == 0) {
+				affinity = isc_threadaffinity_node;
+			} else {
+				named_main_earlyfatal("unknown thread affinity "
+						      "'%s'",
+						      isc_commandline_argument);
+			}
+			break;
 		case 'A':
 			parse_fuzz_arg();
 			break;
@@ -900,6 +919,12 @@ create_managers(void) {
 	 * impact is negligible.
 	 */
 	isc_hp_init(4 * named_g_cpus);
+
+	/*
+	 * Network thread N and task manager thread N are bound to the
+	 * same CPU or NUMA node, so that a client is handled on one node.
+	 */
+	isc_thread_setaffinitypolicy(affinity);
 	named_g_nm = isc_nm_start(named_g_mctx, named_g_cpus);
 	if (named_g_nm == NULL) {
 		UNEXPECTED_ERROR(__FILE__, __LINE__, "isc_nm_start() failed");
@@ -931,6 +956,12 @@ create_managers(void) {
 				 isc_result_totext(result));
 		return (ISC_R_UNEXPECTED);
 	}
+	/*
+	 * CPU-bound batches such as zone signing are spread over the
+	 * worker pool; the thread submitting a batch works on it too.
+	 */
+	isc_workpool_create(named_g_mctx, named_g_cpus - 1, &named_g_workpool);
+
 	isc_socketmgr_maxudp(named_g_socketmgr, maxudp);
 	isc_nm_maxudp(named_g_nm, maxudp);
 	result = isc_socketmgr_getmaxsockets(named_g_socketmgr, &socks);
@@ -959,6 +990,7 @@ destroy_managers(void) {
 	isc_taskmgr_destroy(&named_g_taskmgr);
 	isc_timermgr_destroy(&named_g_timermgr);
 	isc_socketmgr_destroy(&named_g_socketmgr);
+	isc_workpool_detach(&named_g_workpool);
 
 	/*
 	 * At this point is safe to destroy the netmgr.
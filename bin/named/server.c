@@ -32,6 +32,7 @@
 #include <isc/hmac.h>
 #include <isc/httpd.h>
 #include <isc/lex.h>
+#include <isc/md.h>
 #include <isc/meminfo.h>
 #include <isc/nonce.h>
 #include <isc/parseint.h>
@@ -49,6 +50,7 @@
 #include <isc/task.h>
 #include <isc/timer.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/adb.h>
 #include <dns/badcache.h>
@@ -230,6 +232,7 @@ struct named_cache {
 	dns_view_t *primaryview;
 	bool needflush;
 	bool adbsizeadjusted;
+	bool coalesce;
 	dns_rdataclass_t rdclass;
 	ISC_LINK(named_cache_t) link;
 };
@@ -298,14 +301,23 @@ typedef struct {
 	named_server_t *server;
 } catz_cb_data_t;
 
-typedef struct catz_chgzone_event {
-	ISC_EVENT_COMMON(struct catz_chgzone_event);
+typedef struct catz_chgzone {
+	dns_catz_op_t op;
 	dns_catz_entry_t *entry;
+	isc_result_t result;
+	cfg_obj_t *zoneconf;
+	dns_zone_t *zone;
+	bool recheck; /* zone exists, but may be deleted first */
+} catz_chgzone_t;
+
+typedef struct catz_chgzones_event {
+	ISC_EVENT_COMMON(struct catz_chgzones_event);
 	dns_catz_zone_t *origin;
 	dns_view_t *view;
 	catz_cb_data_t *cbd;
-	bool mod;
-} catz_chgzone_event_t;
+	catz_chgzone_t *changes;
+	unsigned int nchanges;
+} catz_chgzones_event_t;
 
 typedef struct {
 	unsigned int magic;
@@ -411,7 +423,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	       const cfg_obj_t *vconfig, isc_mem_t *mctx, dns_view_t *view,
 	       dns_viewlist_t *viewlist, dns_kasplist_t *kasplist,
 	       cfg_aclconfctx_t *aclconf, bool added, bool old_rpz_ok,
-	       bool modify);
+	       bool modify, uint64_t confighash);
 
 static isc_result_t
 configure_newzones(dns_view_t *view, cfg_obj_t *config, cfg_obj_t *vconfig,
@@ -2642,37 +2654,34 @@ configure_rpz(dns_view_t *view, const cfg_obj_t **maps,
 	return (ISC_R_SUCCESS);
 }
 
-static void
-catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
-	catz_chgzone_event_t *ev = (catz_chgzone_event_t *)event0;
+/*
+ * Check that the member zone 'chg->entry' of the catalog zone can be
+ * added or modified, and parse its configuration.
+ */
+static isc_result_t
+catz_addmodzone_prepare(catz_chgzones_event_t *ev, ns_cfgctx_t *cfg,
+			catz_chgzone_t *chg) {
 	isc_result_t result;
 	isc_buffer_t namebuf;
 	isc_buffer_t *confbuf;
 	char nameb[DNS_NAME_FORMATSIZE];
-	const cfg_obj_t *zlist = NULL;
-	cfg_obj_t *zoneconf = NULL;
-	cfg_obj_t *zoneobj = NULL;
-	ns_cfgctx_t *cfg;
 	dns_zone_t *zone = NULL;
+	bool mod = (chg->op == dns_catz_op_mod);
 
-	cfg = (ns_cfgctx_t *)ev->view->new_zone_config;
 	if (cfg == NULL) {
-		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
-			      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
-			      "catz: allow-new-zones statement missing from "
-			      "config; cannot add zone from the catalog");
-		goto cleanup;
+		return (ISC_R_FAILURE);
 	}
 
 	isc_buffer_init(&namebuf, nameb, DNS_NAME_FORMATSIZE);
-	dns_name_totext(dns_catz_entry_getname(ev->entry), true, &namebuf);
+	dns_name_totext(dns_catz_entry_getname(chg->entry), true, &namebuf);
 	isc_buffer_putuint8(&namebuf, 0);
 
 	/* Zone shouldn't already exist */
 	result = dns_zt_find(ev->view->zonetable,
-			     dns_catz_entry_getname(ev->entry), 0, NULL, &zone);
+			     dns_catz_entry_getname(chg->entry), 0, NULL,
+			     &zone);
 
-	if (ev->mod) {
+	if (mod) {
 		if (result != ISC_R_SUCCESS) {
 			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 				      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
@@ -2690,6 +2699,7 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 					"zone '%s' is not a dynamically "
 					"added zone",
 					nameb);
+				result = ISC_R_FAILURE;
 				goto cleanup;
 			}
 			if (dns_zone_get_parentcatz(zone) != ev->origin) {
@@ -2700,17 +2710,29 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 					"zone '%s' exists in multiple "
 					"catalog zones",
 					nameb);
+				result = ISC_R_FAILURE;
 				goto cleanup;
 			}
 			dns_zone_detach(&zone);
 		}
 	} else {
-		if (result == ISC_R_SUCCESS) {
+		if (result == ISC_R_SUCCESS && dns_zone_getadded(zone) &&
+		    dns_zone_get_parentcatz(zone) == ev->origin)
+		{
+			/*
+			 * A member of this catalog, which the same update
+			 * may delete first (e.g. when it moves to a new
+			 * label); check again once the deletions are done.
+			 */
+			chg->recheck = true;
+			dns_zone_detach(&zone);
+		} else if (result == ISC_R_SUCCESS) {
 			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 				      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
 				      "catz: zone \"%s\" is overridden "
 				      "by explicitly configured zone",
 				      nameb);
+			result = ISC_R_EXISTS;
 			goto cleanup;
 		} else if (result != ISC_R_NOTFOUND &&
 			   result != DNS_R_PARTIALMATCH) {
@@ -2729,11 +2751,12 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	RUNTIME_CHECK(zone == NULL);
 	/* Create a config for new zone */
 	confbuf = NULL;
-	result = dns_catz_generate_zonecfg(ev->origin, ev->entry, &confbuf);
+	result = dns_catz_generate_zonecfg(ev->origin, chg->entry, &confbuf);
 	if (result == ISC_R_SUCCESS) {
 		cfg_parser_reset(cfg->add_parser);
 		result = cfg_parse_buffer(cfg->add_parser, confbuf, "catz", 0,
-					  &cfg_type_addzoneconf, 0, &zoneconf);
+					  &cfg_type_addzoneconf, 0,
+					  &chg->zoneconf);
 		isc_buffer_free(&confbuf);
 	}
 	/*
@@ -2746,9 +2769,48 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 			      "catz: error \"%s\" while trying to generate "
 			      "config for zone \"%s\"",
 			      isc_result_totext(result), nameb);
-		goto cleanup;
 	}
-	CHECK(cfg_map_get(zoneconf, "zone", &zlist));
+
+cleanup:
+	if (zone != NULL) {
+		dns_zone_detach(&zone);
+	}
+	return (result);
+}
+
+/*
+ * Add or modify the member zone 'chg->entry' from its parsed
+ * configuration.  Must be called in exclusive mode, with the view thawed.
+ */
+static isc_result_t
+catz_addmodzone_configure(catz_chgzones_event_t *ev, ns_cfgctx_t *cfg,
+			  catz_chgzone_t *chg) {
+	isc_result_t result;
+	const cfg_obj_t *zlist = NULL;
+	const cfg_obj_t *zoneobj = NULL;
+	dns_zone_t *zone = NULL;
+	char cname[DNS_NAME_FORMATSIZE];
+
+	if (chg->recheck) {
+		result = dns_zt_find(ev->view->zonetable,
+				     dns_catz_entry_getname(chg->entry), 0,
+				     NULL, &zone);
+		if (result == ISC_R_SUCCESS) {
+			dns_zone_detach(&zone);
+			dns_name_format(dns_catz_entry_getname(chg->entry),
+					cname, DNS_NAME_FORMATSIZE);
+			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+				      "catz: zone \"%s\" already exists",
+				      cname);
+			return (ISC_R_EXISTS);
+		}
+		if (zone != NULL) {
+			dns_zone_detach(&zone);
+		}
+	}
+
+	CHECK(cfg_map_get(chg->zoneconf, "zone", &zlist));
 	if (!cfg_obj_islist(zlist)) {
 		CHECK(ISC_R_FAILURE);
 	}
@@ -2756,29 +2818,36 @@ catz_addmodzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	/* For now we only support adding one zone at a time */
 	zoneobj = cfg_listelt_value(cfg_list_first(zlist));
 
-	/* Mark view unfrozen so that zone can be added */
-
-	result = isc_task_beginexclusive(task);
-	RUNTIME_CHECK(result == ISC_R_SUCCESS);
-	dns_view_thaw(ev->view);
 	result = configure_zone(
 		cfg->config, zoneobj, cfg->vconfig, ev->cbd->server->mctx,
 		ev->view, &ev->cbd->server->viewlist,
-		&ev->cbd->server->kasplist, cfg->actx, true, false, ev->mod);
-	dns_view_freeze(ev->view);
-	isc_task_endexclusive(task);
+		&ev->cbd->server->kasplist, cfg->actx, true, false,
+		chg->op == dns_catz_op_mod, 0);
 
+cleanup:
 	if (result != ISC_R_SUCCESS) {
+		dns_name_format(dns_catz_entry_getname(chg->entry), cname,
+				DNS_NAME_FORMATSIZE);
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
 			      "catz: failed to configure zone \"%s\" - %d",
-			      nameb, result);
-		goto cleanup;
+			      cname, result);
 	}
+	return (result);
+}
+
+/*
+ * Load the added or modified member zone 'chg->entry', and remove it
+ * again if that fails.
+ */
+static void
+catz_addmodzone_load(catz_chgzones_event_t *ev, catz_chgzone_t *chg) {
+	isc_result_t result;
+	dns_zone_t *zone = NULL;
 
 	/* Is it there yet? */
 	CHECK(dns_zt_find(ev->view->zonetable,
-			  dns_catz_entry_getname(ev->entry), 0, NULL, &zone));
+			  dns_catz_entry_getname(chg->entry), 0, NULL, &zone));
 
 	/*
 	 * Load the zone from the master file.	If this fails, we'll
@@ -2812,31 +2881,25 @@ cleanup:
 	if (zone != NULL) {
 		dns_zone_detach(&zone);
 	}
-	if (zoneconf != NULL) {
-		cfg_obj_destroy(cfg->add_parser, &zoneconf);
-	}
-	dns_catz_entry_detach(ev->origin, &ev->entry);
-	dns_catz_zone_detach(&ev->origin);
-	dns_view_detach(&ev->view);
-	isc_event_free(ISC_EVENT_PTR(&ev));
 }
 
-static void
-catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
-	catz_chgzone_event_t *ev = (catz_chgzone_event_t *)event0;
+/*
+ * Stop answering for the member zone 'chg->entry' and remove it from the
+ * zone table, keeping it in 'chg->zone' so that its file can be removed
+ * later.  Must be called in exclusive mode.
+ */
+static isc_result_t
+catz_delzone(catz_chgzones_event_t *ev, catz_chgzone_t *chg) {
 	isc_result_t result;
 	dns_zone_t *zone = NULL;
 	dns_db_t *dbp = NULL;
 	char cname[DNS_NAME_FORMATSIZE];
-	const char *file;
-
-	result = isc_task_beginexclusive(task);
-	RUNTIME_CHECK(result == ISC_R_SUCCESS);
 
-	dns_name_format(dns_catz_entry_getname(ev->entry), cname,
+	dns_name_format(dns_catz_entry_getname(chg->entry), cname,
 			DNS_NAME_FORMATSIZE);
 	result = dns_zt_find(ev->view->zonetable,
-			     dns_catz_entry_getname(ev->entry), 0, NULL, &zone);
+			     dns_catz_entry_getname(chg->entry), 0, NULL,
+			     &zone);
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
 			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
@@ -2852,6 +2915,7 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 			      "catz: catz_delzone_taskaction: "
 			      "zone '%s' is not a dynamically added zone",
 			      cname);
+		result = ISC_R_FAILURE;
 		goto cleanup;
 	}
 
@@ -2861,6 +2925,7 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 			      "catz: catz_delzone_taskaction: zone "
 			      "'%s' exists in multiple catalog zones",
 			      cname);
+		result = ISC_R_FAILURE;
 		goto cleanup;
 	}
 
@@ -2871,57 +2936,162 @@ catz_delzone_taskaction(isc_task_t *task, isc_event_t *event0) {
 	}
 
 	CHECK(dns_zt_unmount(ev->view->zonetable, zone));
-	file = dns_zone_getfile(zone);
-	if (file != NULL) {
-		isc_file_remove(file);
-	}
+	chg->zone = zone;
+	zone = NULL;
 
-	isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
-		      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
-		      "catz: catz_delzone_taskaction: "
-		      "zone '%s' deleted",
-		      cname);
 cleanup:
-	isc_task_endexclusive(task);
 	if (zone != NULL) {
 		dns_zone_detach(&zone);
 	}
-	dns_catz_entry_detach(ev->origin, &ev->entry);
+	return (result);
+}
+
+/*
+ * Apply all the member zone changes made by one update of a catalog
+ * zone.  The configurations of the zones are parsed first, so that the
+ * zone table is only changed in a single exclusive section, deletions
+ * first; the added zones are loaded after it.
+ */
+static void
+catz_chgzones_taskaction(isc_task_t *task, isc_event_t *event0) {
+	catz_chgzones_event_t *ev = (catz_chgzones_event_t *)event0;
+	isc_result_t result;
+	ns_cfgctx_t *cfg;
+	const char *file;
+	char cname[DNS_NAME_FORMATSIZE];
+	bool warned = false;
+	unsigned int i;
+
+	cfg = (ns_cfgctx_t *)ev->view->new_zone_config;
+
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->op == dns_catz_op_del) {
+			continue;
+		}
+		if (cfg == NULL && !warned) {
+			isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+				      "catz: allow-new-zones statement "
+				      "missing from config; cannot add zone "
+				      "from the catalog");
+			warned = true;
+		}
+		chg->result = catz_addmodzone_prepare(ev, cfg, chg);
+	}
+
+	result = isc_task_beginexclusive(task);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	/* Mark view unfrozen so that zones can be added */
+	dns_view_thaw(ev->view);
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->op == dns_catz_op_del) {
+			chg->result = catz_delzone(ev, chg);
+		}
+	}
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->op != dns_catz_op_del &&
+		    chg->result == ISC_R_SUCCESS) {
+			chg->result = catz_addmodzone_configure(ev, cfg, chg);
+		}
+	}
+	dns_view_freeze(ev->view);
+	isc_task_endexclusive(task);
+
+	/*
+	 * Remove the files of the deleted zones before loading the added
+	 * ones, which may reuse them.
+	 */
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->result != ISC_R_SUCCESS ||
+		    chg->op != dns_catz_op_del) {
+			continue;
+		}
+
+		file = dns_zone_getfile(chg->zone);
+		if (file != NULL) {
+			isc_file_remove(file);
+		}
+		dns_name_format(dns_catz_entry_getname(chg->entry), cname,
+				DNS_NAME_FORMATSIZE);
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_WARNING,
+			      "catz: catz_delzone_taskaction: "
+			      "zone '%s' deleted",
+			      cname);
+	}
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->result == ISC_R_SUCCESS &&
+		    chg->op != dns_catz_op_del) {
+			catz_addmodzone_load(ev, chg);
+		}
+	}
+
+	for (i = 0; i < ev->nchanges; i++) {
+		catz_chgzone_t *chg = &ev->changes[i];
+
+		if (chg->zone != NULL) {
+			dns_zone_detach(&chg->zone);
+		}
+		if (chg->zoneconf != NULL) {
+			cfg_obj_destroy(cfg->add_parser, &chg->zoneconf);
+		}
+		dns_catz_entry_detach(ev->origin, &chg->entry);
+	}
+	isc_mem_put(ev->view->mctx, ev->changes,
+		    ev->nchanges * sizeof(ev->changes[0]));
 	dns_catz_zone_detach(&ev->origin);
 	dns_view_detach(&ev->view);
 	isc_event_free(ISC_EVENT_PTR(&ev));
 }
 
 static isc_result_t
-catz_create_chg_task(dns_catz_entry_t *entry, dns_catz_zone_t *origin,
-		     dns_view_t *view, isc_taskmgr_t *taskmgr, void *udata,
-		     isc_eventtype_t type) {
-	catz_chgzone_event_t *event;
+catz_chgzones(dns_catz_changedlist_t *changes, dns_catz_zone_t *origin,
+	      dns_view_t *view, isc_taskmgr_t *taskmgr, void *udata) {
+	catz_chgzones_event_t *event;
+	dns_catz_changed_t *changed;
 	isc_task_t *task;
 	isc_result_t result;
-	isc_taskaction_t action = NULL;
+	unsigned int n = 0;
 
-	switch (type) {
-	case DNS_EVENT_CATZADDZONE:
-	case DNS_EVENT_CATZMODZONE:
-		action = catz_addmodzone_taskaction;
-		break;
-	case DNS_EVENT_CATZDELZONE:
-		action = catz_delzone_taskaction;
-		break;
-	default:
-		REQUIRE(0);
+	for (changed = ISC_LIST_HEAD(*changes); changed != NULL;
+	     changed = ISC_LIST_NEXT(changed, link))
+	{
+		n++;
 	}
 
-	event = (catz_chgzone_event_t *)isc_event_allocate(
-		view->mctx, origin, type, action, NULL, sizeof(*event));
+	event = (catz_chgzones_event_t *)isc_event_allocate(
+		view->mctx, origin, DNS_EVENT_CATZCHGZONES,
+		catz_chgzones_taskaction, NULL, sizeof(*event));
 
 	event->cbd = (catz_cb_data_t *)udata;
-	event->entry = NULL;
 	event->origin = NULL;
 	event->view = NULL;
-	event->mod = (type == DNS_EVENT_CATZMODZONE);
-	dns_catz_entry_attach(entry, &event->entry);
+	event->changes = isc_mem_get(view->mctx, n * sizeof(catz_chgzone_t));
+	event->nchanges = n;
+	n = 0;
+	for (changed = ISC_LIST_HEAD(*changes); changed != NULL;
+	     changed = ISC_LIST_NEXT(changed, link))
+	{
+		catz_chgzone_t *chg = &event->changes[n++];
+
+		chg->op = changed->op;
+		chg->entry = NULL;
+		dns_catz_entry_attach(changed->entry, &chg->entry);
+		chg->result = ISC_R_SUCCESS;
+		chg->zoneconf = NULL;
+		chg->zone = NULL;
+		chg->recheck = false;
+	}
 	dns_catz_zone_attach(origin, &event->origin);
 	dns_view_attach(view, &event->view);
 
@@ -2934,27 +3104,6 @@ catz_create_chg_task(dns_catz_entry_t *entry, dns_catz_zone_t *origin,
 	return (ISC_R_SUCCESS);
 }
 
-static isc_result_t
-catz_addzone(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
-	     isc_taskmgr_t *taskmgr, void *udata) {
-	return (catz_create_chg_task(entry, origin, view, taskmgr, udata,
-				     DNS_EVENT_CATZADDZONE));
-}
-
-static isc_result_t
-catz_delzone(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
-	     isc_taskmgr_t *taskmgr, void *udata) {
-	return (catz_create_chg_task(entry, origin, view, taskmgr, udata,
-				     DNS_EVENT_CATZDELZONE));
-}
-
-static isc_result_t
-catz_modzone(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
-	     isc_taskmgr_t *taskmgr, void *udata) {
-	return (catz_create_chg_task(entry, origin, view, taskmgr, udata,
-				     DNS_EVENT_CATZMODZONE));
-}
-
 static isc_result_t
 configure_catz_zone(dns_view_t *view, const cfg_obj_t *config,
 		    const cfg_listelt_t *element) {
@@ -3093,7 +3242,7 @@ cleanup:
 
 static catz_cb_data_t ns_catz_cbdata;
 static dns_catz_zonemodmethods_t ns_catz_zonemodmethods = {
-	catz_addzone, catz_modzone, catz_delzone, &ns_catz_cbdata
+	NULL, NULL, NULL, catz_chgzones, &ns_catz_cbdata
 };
 
 static isc_result_t
@@ -3857,6 +4006,130 @@ register_one_plugin(const cfg_obj_t *config, const cfg_obj_t *obj,
 	return (result);
 }
 
+/*
+ * Zone configuration hashes let a reconfiguration skip the zones whose
+ * configuration has not changed.  The hash of a zone covers its own
+ * zone statement and, through the view digest, every statement outside
+ * zone statements from which it could inherit settings.
+ */
+typedef struct {
+	unsigned char	  digest[ISC_MAX_MD_SIZE];
+	unsigned int	  digestlen;
+	const cfg_obj_t **zconfigs;
+	uint64_t *	  hashes;
+} zonehash_ctx_t;
+
+static void
+hash_print(void *closure, const char *text, int textlen) {
+	(void)isc_md_update(closure, (const unsigned char *)text, textlen);
+}
+
+static void
+hash_nonzone_statements(isc_md_t *md, const cfg_obj_t *map) {
+	const void *clauses = NULL;
+	const char *name;
+	unsigned int idx;
+
+	for (name = cfg_map_firstclause(map->type, &clauses, &idx);
+	     name != NULL;
+	     name = cfg_map_nextclause(map->type, &clauses, &idx))
+	{
+		const cfg_obj_t *obj = NULL;
+
+		if (strcasecmp(name, "zone") == 0 ||
+		    strcasecmp(name, "view") == 0 ||
+		    cfg_map_get(map, name, &obj) != ISC_R_SUCCESS)
+		{
+			continue;
+		}
+		hash_print(md, name, strlen(name));
+		cfg_printx(obj, 0, hash_print, md);
+	}
+}
+
+static void
+hash_zone(void *arg, size_t i) {
+	zonehash_ctx_t *zctx = arg;
+	unsigned char digest[ISC_MAX_MD_SIZE];
+	unsigned int digestlen;
+	isc_md_t *md = NULL;
+	uint64_t hash = 0;
+
+	md = isc_md_new();
+	if (md != NULL && isc_md_init(md, ISC_MD_SHA256) == ISC_R_SUCCESS &&
+	    isc_md_update(md, zctx->digest, zctx->digestlen) == ISC_R_SUCCESS)
+	{
+		cfg_printx(zctx->zconfigs[i], 0, hash_print, md);
+		if (isc_md_final(md, digest, &digestlen) == ISC_R_SUCCESS) {
+			memmove(&hash, digest, sizeof(hash));
+			if (hash == 0) {
+				hash = 1;
+			}
+		}
+	}
+	if (md != NULL) {
+		isc_md_free(md);
+	}
+
+	zctx->hashes[i] = hash;
+}
+
+/*%
+ * Return an array with the configuration hash of each zone in
+ * 'zonelist', calculated in parallel on the worker pool, or NULL if
+ * the list is empty.  A hash of 0 means that it could not be
+ * calculated.
+ */
+static uint64_t *
+hash_zones(const cfg_obj_t *config, const cfg_obj_t *vconfig,
+	   const cfg_obj_t *zonelist, isc_mem_t *mctx, unsigned int *countp) {
+	zonehash_ctx_t zctx;
+	const cfg_listelt_t *element;
+	isc_md_t *md = NULL;
+	unsigned int count, i;
+
+	count = cfg_list_length(zonelist, false);
+	*countp = count;
+	if (count == 0) {
+		return (NULL);
+	}
+
+	memset(&zctx, 0, sizeof(zctx));
+	zctx.hashes = isc_mem_get(mctx, count * sizeof(zctx.hashes[0]));
+	memset(zctx.hashes, 0, count * sizeof(zctx.hashes[0]));
+
+	md = isc_md_new();
+	if (md == NULL || isc_md_init(md, ISC_MD_SHA256) != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+	hash_nonzone_statements(md, config);
+	if (vconfig != NULL) {
+		cfg_printx(cfg_tuple_get(vconfig, "name"), 0, hash_print, md);
+		cfg_printx(cfg_tuple_get(vconfig, "class"), 0, hash_print, md);
+		hash_nonzone_statements(md, cfg_tuple_get(vconfig, "options"));
+	}
+	if (isc_md_final(md, zctx.digest, &zctx.digestlen) != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	zctx.zconfigs = isc_mem_get(mctx, count * sizeof(zctx.zconfigs[0]));
+	for (element = cfg_list_first(zonelist), i = 0; element != NULL;
+	     element = cfg_list_next(element), i++)
+	{
+		zctx.zconfigs[i] = cfg_listelt_value(element);
+	}
+
+	isc_workpool_run(named_g_workpool, count, hash_zone, &zctx);
+
+	isc_mem_put(mctx, zctx.zconfigs, count * sizeof(zctx.zconfigs[0]));
+
+cleanup:
+	if (md != NULL) {
+		isc_md_free(md);
+	}
+	return (zctx.hashes);
+}
+
 /*
  * Configure 'view' according to 'vconfig', taking defaults from
  * 'config' where values are missing in 'vconfig'.
@@ -3901,6 +4174,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_dispatch_t *dispatch6 = NULL;
 	bool reused_cache = false;
 	bool shared_cache = false;
+	bool coalesce_fetches;
 	int i = 0, j = 0, k = 0;
 	const char *str;
 	const char *cachename = NULL;
@@ -3925,6 +4199,8 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	unsigned int resolver_param;
 	dns_ntatable_t *ntatable = NULL;
 	const char *qminmode = NULL;
+	uint64_t *zonehashes = NULL;
+	unsigned int nzones = 0;
 
 	REQUIRE(DNS_VIEW_VALID(view));
 
@@ -3993,13 +4269,14 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	/*
 	 * Load zone configuration
 	 */
-	for (element = cfg_list_first(zonelist); element != NULL;
-	     element = cfg_list_next(element))
+	zonehashes = hash_zones(config, vconfig, zonelist, mctx, &nzones);
+	for (element = cfg_list_first(zonelist), i = 0; element != NULL;
+	     element = cfg_list_next(element), i++)
 	{
 		const cfg_obj_t *zconfig = cfg_listelt_value(element);
 		CHECK(configure_zone(config, zconfig, vconfig, mctx, view,
 				     viewlist, kasplist, actx, false,
-				     old_rpz_ok, false));
+				     old_rpz_ok, false, zonehashes[i]));
 	}
 
 	/*
@@ -4396,7 +4673,14 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	 * forwarder, changes in the forwarder configuration may invalidate
 	 * the cache.  At the moment, it's the administrator's responsibility to
 	 * ensure these configuration options don't invalidate reusing/sharing.
+	 * The same goes for "coalesce-fetches", which lets views sharing a
+	 * cache also share their fetches.
 	 */
+	obj = NULL;
+	result = named_config_get(maps, "coalesce-fetches", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	coalesce_fetches = cfg_obj_asboolean(obj);
+
 	obj = NULL;
 	result = named_config_get(maps, "attach-cache", &obj);
 	if (result == ISC_R_SUCCESS) {
@@ -4487,6 +4771,7 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		nsc->primaryview = view;
 		nsc->needflush = false;
 		nsc->adbsizeadjusted = false;
+		nsc->coalesce = coalesce_fetches;
 		nsc->rdclass = view->rdclass;
 		ISC_LINK_INIT(nsc, link);
 		ISC_LIST_APPEND(*cachelist, nsc, link);
@@ -4502,8 +4787,14 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	if (result == ISC_R_SUCCESS && strcmp(view->name, "_bind") != 0) {
 		CHECK(dns_cache_setfilename(cache, cfg_obj_asstring(obj)));
 		if (!reused_cache && !shared_cache) {
-			CHECK(dns_cache_load(cache));
+			CHECK(dns_cache_asyncload(cache));
 		}
+
+		obj = NULL;
+		result = named_config_get(maps, "cache-file-interval", &obj);
+		(void)dns_cache_setdumpinterval(
+			cache, result == ISC_R_SUCCESS ? cfg_obj_asduration(obj)
+						       : 0);
 	}
 
 	dns_cache_setcachesize(cache, max_cache_size);
@@ -4551,6 +4842,20 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		ndisp, named_g_socketmgr, named_g_timermgr, resopts,
 		named_g_dispatchmgr, dispatch4, dispatch6));
 
+	/*
+	 * Coalesce fetches with the first view using the shared cache,
+	 * if both views allow it.
+	 */
+	if (shared_cache && coalesce_fetches && nsc->coalesce &&
+	    nsc->primaryview->resolver != NULL)
+	{
+		dns_resolver_setcoalesce(view->resolver, nsc->primaryview);
+		isc_log_write(named_g_lctx, NAMED_LOGCATEGORY_GENERAL,
+			      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+			      "view %s: coalescing fetches with view %s",
+			      view->name, nsc->primaryview->name);
+	}
+
 	if (dscp4 == -1) {
 		dscp4 = named_g_dscp;
 	}
@@ -4736,6 +5041,14 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		dns_resolver_setnonbackofftries(view->resolver, resolver_param);
 	}
 
+	obj = NULL;
+	CHECK(named_config_get(maps, "resolver-hedge-budget", &obj));
+	dns_resolver_sethedgebudget(view->resolver, cfg_obj_asuint32(obj));
+
+	obj = NULL;
+	CHECK(named_config_get(maps, "resolver-hedge-percentile", &obj));
+	dns_resolver_sethedgepercentile(view->resolver, cfg_obj_asuint32(obj));
+
 	/*
 	 * Set supported DNSSEC algorithms.
 	 */
@@ -5709,6 +6022,9 @@ cleanup:
 	if (dctx != NULL) {
 		dns_dyndb_destroyctx(&dctx);
 	}
+	if (zonehashes != NULL) {
+		isc_mem_put(mctx, zonehashes, nzones * sizeof(zonehashes[0]));
+	}
 
 	return (result);
 }
@@ -6043,7 +6359,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	       const cfg_obj_t *vconfig, isc_mem_t *mctx, dns_view_t *view,
 	       dns_viewlist_t *viewlist, dns_kasplist_t *kasplist,
 	       cfg_aclconfctx_t *aclconf, bool added, bool old_rpz_ok,
-	       bool modify) {
+	       bool modify, uint64_t confighash) {
 	dns_view_t *pview = NULL; /* Production view */
 	dns_zone_t *zone = NULL;  /* New or reused zone */
 	dns_zone_t *raw = NULL;	  /* New or reused raw zone */
@@ -6070,6 +6386,7 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 	bool zone_is_catz = false;
 	bool zone_maybe_inline = false;
 	bool inline_signing = false;
+	bool unchanged = false;
 
 	options = NULL;
 	(void)cfg_map_get(config, "options", &options);
@@ -6494,11 +6811,31 @@ configure_zone(const cfg_obj_t *config, const cfg_obj_t *zconfig,
 		}
 	}
 
+	/*
+	 * A reused zone whose configuration has not changed since it
+	 * was last configured keeps its settings.  Zones which refer to
+	 * objects that are rebuilt on every reconfiguration (policy,
+	 * catalog and signing state) are always reconfigured.
+	 */
+	if (confighash != 0 && !modify &&
+	    dns_zone_getconfighash(zone) == confighash &&
+	    rpz_num == DNS_RPZ_INVALID_NUM && !zone_is_catz && raw == NULL &&
+	    dns_zone_getkasp(zone) == NULL)
+	{
+		unchanged = true;
+	}
+
 	/*
 	 * Configure the zone.
 	 */
-	CHECK(named_zone_configure(config, vconfig, zconfig, aclconf, kasplist,
-				   zone, raw));
+	if (unchanged) {
+		named_zone_reuseconfig(zone);
+	} else {
+		dns_zone_setconfighash(zone, 0);
+		CHECK(named_zone_configure(config, vconfig, zconfig, aclconf,
+					   kasplist, zone, raw));
+		dns_zone_setconfighash(zone, confighash);
+	}
 
 	/*
 	 * Add the zone to its view in the new view list.
@@ -7797,6 +8134,8 @@ configure_newzones(dns_view_t *view, cfg_obj_t *config, cfg_obj_t *vconfig,
 	ns_cfgctx_t *nzctx;
 	const cfg_obj_t *zonelist;
 	const cfg_listelt_t *element;
+	uint64_t *zonehashes = NULL;
+	unsigned int i, nzones = 0;
 
 	nzctx = view->new_zone_config;
 	if (nzctx == NULL || nzctx->nzf_config == NULL) {
@@ -7810,14 +8149,15 @@ configure_newzones(dns_view_t *view, cfg_obj_t *config, cfg_obj_t *vconfig,
 	zonelist = NULL;
 	cfg_map_get(nzctx->nzf_config, "zone", &zonelist);
 
-	for (element = cfg_list_first(zonelist); element != NULL;
-	     element = cfg_list_next(element))
+	zonehashes = hash_zones(config, vconfig, zonelist, mctx, &nzones);
+	for (element = cfg_list_first(zonelist), i = 0; element != NULL;
+	     element = cfg_list_next(element), i++)
 	{
 		const cfg_obj_t *zconfig = cfg_listelt_value(element);
 		CHECK(configure_zone(config, zconfig, vconfig, mctx, view,
 				     &named_g_server->viewlist,
 				     &named_g_server->kasplist, actx, true,
-				     false, false));
+				     false, false, zonehashes[i]));
 	}
 
 	result = ISC_R_SUCCESS;
@@ -7830,6 +8170,10 @@ cleanup:
 		configure_zone_setviewcommit(result, zconfig, view);
 	}
 
+	if (zonehashes != NULL) {
+		isc_mem_put(mctx, zonehashes, nzones * sizeof(zonehashes[0]));
+	}
+
 	return (result);
 }
 
@@ -7999,7 +8343,7 @@ configure_newzone(const cfg_obj_t *zconfig, cfg_obj_t *config,
 		  cfg_aclconfctx_t *actx) {
 	return (configure_zone(
 		config, zconfig, vconfig, mctx, view, &named_g_server->viewlist,
-		&named_g_server->kasplist, actx, true, false, false));
+		&named_g_server->kasplist, actx, true, false, false, 0));
 }
 
 /*%
@@ -8322,7 +8666,8 @@ load_configuration(const char *filename, named_server_t *server,
 	 * checked later when the modules are actually loaded and
 	 * registered.)
 	 */
-	CHECK(bind9_check_namedconf(config, false, named_g_lctx, named_g_mctx));
+	CHECK(bind9_check_namedconf(config, false, named_g_workpool,
+				    named_g_lctx, named_g_mctx));
 
 	/*
 	 * Fill in the maps array, used for resolving defaults.
@@ -8576,6 +8921,21 @@ load_configuration(const char *filename, named_server_t *server,
 	isc_nm_tcp_settimeouts(named_g_nm, initial, idle, keepalive,
 			       advertised);
 
+	/*
+	 * Set how UDP queries are spread over the worker threads; this
+	 * applies to interfaces that are listened on from now on.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "udp-steering", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	if (strcasecmp(cfg_obj_asstring(obj), "cpu") == 0) {
+		isc_nm_setudpsteering(named_g_nm, isc_nm_udpsteer_cpu);
+	} else if (strcasecmp(cfg_obj_asstring(obj), "prefix") == 0) {
+		isc_nm_setudpsteering(named_g_nm, isc_nm_udpsteer_prefix);
+	} else {
+		isc_nm_setudpsteering(named_g_nm, isc_nm_udpsteer_hash);
+	}
+
 	/*
 	 * Configure sets of UDP query source ports.
 	 */
@@ -9969,6 +10329,7 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 		   "dns_zonemgr_create");
 	CHECKFATAL(dns_zonemgr_setsize(server->zonemgr, 1000), "dns_zonemgr_"
 							       "setsize");
+	dns_zonemgr_setworkpool(server->zonemgr, named_g_workpool);
 
 	server->statsfile = isc_mem_strdup(server->mctx, "named.stats");
 	CHECKFATAL(server->statsfile == NULL ? ISC_R_NOMEMORY : ISC_R_SUCCESS,
@@ -10010,6 +10371,7 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 	CHECKFATAL(isc_stats_create(named_g_mctx, &server->zonestats,
 				    dns_zonestatscounter_max),
 		   "dns_stats_create (zone)");
+	dns_zonemgr_setstats(server->zonemgr, server->zonestats);
 
 	CHECKFATAL(isc_stats_create(named_g_mctx, &server->resolverstats,
 				    dns_resstatscounter_max),
@@ -10986,7 +11348,8 @@ resume:
 				dns_cache_getname(dctx->view->view->cache));
 			result = dns_master_dumptostreaminc(
 				dctx->mctx, dctx->cache, NULL, style, dctx->fp,
-				dctx->task, dumpdone, dctx, &dctx->mdctx);
+				named_g_workpool, dctx->task, dumpdone, dctx,
+				&dctx->mdctx);
 			if (result == DNS_R_CONTINUE) {
 				return;
 			}
@@ -11046,8 +11409,8 @@ resume:
 			dns_db_currentversion(dctx->db, &dctx->version);
 			result = dns_master_dumptostreaminc(
 				dctx->mctx, dctx->db, dctx->version, style,
-				dctx->fp, dctx->task, dumpdone, dctx,
-				&dctx->mdctx);
+				dctx->fp, named_g_workpool, dctx->task,
+				dumpdone, dctx, &dctx->mdctx);
 			if (result == DNS_R_CONTINUE) {
 				return;
 			}
@@ -11720,6 +12083,8 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 	char boottime[ISC_FORMATHTTPTIMESTAMP_SIZE];
 	char configtime[ISC_FORMATHTTPTIMESTAMP_SIZE];
 	char line[1024], hostname[256];
+	uint64_t *pktcounts = NULL;
+	size_t nworkers, i;
 
 	if (named_g_server->version_set) {
 		ob = " (";
@@ -11783,6 +12148,22 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 		 named_g_udpdisp);
 	CHECK(putstr(text, line));
 
+	CHECK(putstr(text, "UDP packets per worker thread:"));
+	pktcounts = isc_mem_get(server->mctx,
+				named_g_cpus * sizeof(pktcounts[0]));
+	nworkers = isc_nm_pktcounts(named_g_nm, pktcounts, named_g_cpus);
+	for (i = 0; i < ISC_MIN(nworkers, named_g_cpus); i++) {
+		snprintf(line, sizeof(line), " %" PRIu64, pktcounts[i]);
+		result = putstr(text, line);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+	isc_mem_put(server->mctx, pktcounts,
+		    named_g_cpus * sizeof(pktcounts[0]));
+	CHECK(result);
+	CHECK(putstr(text, "\n"));
+
 	snprintf(line, sizeof(line), "number of zones: %u (%u automatic)\n",
 		 zonecount, automatic);
 	CHECK(putstr(text, line));
@@ -13281,7 +13662,7 @@ do_addzone(named_server_t *server, ns_cfgctx_t *cfg, dns_view_t *view,
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig,
 				server->mctx, view, &server->viewlist,
 				&server->kasplist, cfg->actx, true, false,
-				false);
+				false, 0);
 	dns_view_freeze(view);
 
 	isc_task_endexclusive(server->task);
@@ -13463,7 +13844,7 @@ do_modzone(named_server_t *server, ns_cfgctx_t *cfg, dns_view_t *view,
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig,
 				server->mctx, view, &server->viewlist,
 				&server->kasplist, cfg->actx, true, false,
-				true);
+				true, 0);
 	dns_view_freeze(view);
 
 	exclusive = false;
@@ -426,6 +426,14 @@ init_desc(void) {
 			"ServerQuota");
 	SET_RESSTATDESC(nextitem, "waited for next item", "NextItem");
 	SET_RESSTATDESC(priming, "priming queries", "Priming");
+	SET_RESSTATDESC(tcpconnect, "TCP connections opened", "TCPConnect");
+	SET_RESSTATDESC(tcpreuse, "queries sent over pooled TCP connections",
+			"TCPReuse");
+	SET_RESSTATDESC(hedge, "queries hedged to another server", "Hedge");
+	SET_RESSTATDESC(hedgewin, "hedged queries answered first",
+			"HedgeWin");
+	SET_RESSTATDESC(coalesced, "fetches joined from another view",
+			"FetchCoalesced");
 
 	INSIST(i == dns_resstatscounter_max);
 
@@ -486,6 +494,23 @@ init_desc(void) {
 	SET_ZONESTATDESC(xfrsuccess, "transfer requests succeeded",
 			 "XfrSuccess");
 	SET_ZONESTATDESC(xfrfail, "transfer requests failed", "XfrFail");
+	SET_ZONESTATDESC(xfrinbytesrate,
+			 "bytes/sec received by the last transfer",
+			 "XfrInBytesRate");
+	SET_ZONESTATDESC(xfrinrecsrate,
+			 "records/sec received by the last transfer",
+			 "XfrInRecsRate");
+	SET_ZONESTATDESC(notifyqueued, "notifies waiting to be sent",
+			 "NotifyQueued");
+	SET_ZONESTATDESC(soaqueued, "SOA queries waiting to be sent",
+			 "SOAQueued");
+	SET_ZONESTATDESC(notifyrate, "notifies/sec currently allowed",
+			 "NotifyRate");
+	SET_ZONESTATDESC(startupnotifyrate,
+			 "startup notifies/sec currently allowed",
+			 "StartupNotifyRate");
+	SET_ZONESTATDESC(soarate, "SOA queries/sec currently allowed",
+			 "SOARate");
 	INSIST(i == dns_zonestatscounter_max);
 
 	/* Initialize socket statistics */
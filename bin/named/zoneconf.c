@@ -1384,6 +1384,24 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 		}
 		dns_zone_setjournalsize(zone, journal_size);
 
+		obj = NULL;
+		result = named_config_get(maps, "journal-compact-idle", &obj);
+		INSIST(result == ISC_R_SUCCESS && obj != NULL);
+		if (raw != NULL) {
+			dns_zone_setjournalcompactidle(raw,
+						       cfg_obj_asduration(obj));
+		}
+		dns_zone_setjournalcompactidle(zone, cfg_obj_asduration(obj));
+
+		obj = NULL;
+		result = named_config_get(maps, "dump-delta-ratio", &obj);
+		INSIST(result == ISC_R_SUCCESS && obj != NULL);
+		if (raw != NULL) {
+			dns_zone_setdumpdeltaratio(raw,
+						   cfg_obj_aspercentage(obj));
+		}
+		dns_zone_setdumpdeltaratio(zone, cfg_obj_aspercentage(obj));
+
 		obj = NULL;
 		result = named_config_get(maps, "ixfr-from-differences", &obj);
 		INSIST(result == ISC_R_SUCCESS && obj != NULL);
@@ -1836,6 +1854,11 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 			dns_zone_setserialupdatemethod(
 				zone, dns_updatemethod_increment);
 		}
+
+		obj = NULL;
+		result = named_config_get(maps, "update-group-commit", &obj);
+		INSIST(result == ISC_R_SUCCESS && obj != NULL);
+		dns_zone_setupdategroup(zone, cfg_obj_asuint32(obj));
 	}
 
 	/*
@@ -2036,6 +2059,22 @@ named_zone_configure_writeable_dlz(dns_dlzdb_t *dlzdatabase, dns_zone_t *zone,
 	return (result);
 }
 
+void
+named_zone_reuseconfig(dns_zone_t *zone) {
+	/*
+	 * Reserve the dispatches named_zone_configure() would have
+	 * reserved for the zone's notify and transfer sources.
+	 */
+	named_add_reserved_dispatch(named_g_server,
+				    dns_zone_getnotifysrc4(zone));
+	named_add_reserved_dispatch(named_g_server,
+				    dns_zone_getnotifysrc6(zone));
+	named_add_reserved_dispatch(named_g_server,
+				    dns_zone_getxfrsource4(zone));
+	named_add_reserved_dispatch(named_g_server,
+				    dns_zone_getxfrsource6(zone));
+}
+
 bool
 named_zone_reusable(dns_zone_t *zone, const cfg_obj_t *zconfig) {
 	const cfg_obj_t *zoptions = NULL;
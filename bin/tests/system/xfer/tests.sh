@@ -500,6 +500,39 @@ wait_for_log 10 "$msg" ns6/named.run || tmp=1
 if test $tmp != 0 ; then echo_i "failed"; fi
 status=$((status+tmp))
 
+n=$((n+1))
+echo_i "test that an AXFR loaded in many batches is complete ($n)"
+tmp=0
+check_batches() {
+	$DIG $DIGOPTS axfr-batches. @10.53.0.6 axfr > dig.out.ns6.test$n || return 1
+	grep "^;" dig.out.ns6.test$n > /dev/null && return 1
+	return 0
+}
+retry_quiet 10 check_batches || tmp=1
+$DIG $DIGOPTS axfr-batches. @10.53.0.1 axfr > dig.out.ns1.test$n || tmp=1
+digcomp dig.out.ns1.test$n dig.out.ns6.test$n || tmp=1
+lines=`grep -c "^host" dig.out.ns6.test$n`
+[ "$lines" -eq 20000 ] || tmp=1
+if test $tmp != 0 ; then echo_i "failed"; fi
+status=$((status+tmp))
+
+n=$((n+1))
+echo_i "test that an AXFR aborted with batches still loading is cleaned up ($n)"
+tmp=0
+msg="'axfr-batches-too-big/IN' from 10.53.0.1#${PORT}: Transfer status: too many records"
+check_aborted() {
+	grep -F "$msg" ns6/named.run > /dev/null
+}
+retry_quiet 10 check_aborted || tmp=1
+nextpart ns6/named.run > /dev/null
+$RNDCCMD 10.53.0.6 retransfer axfr-batches-too-big 2>&1 | sed 's/^/ns6 /' | cat_i
+wait_for_log 10 "$msg" ns6/named.run || tmp=1
+$DIG $DIGOPTS +comm axfr-batches-too-big. @10.53.0.6 soa > dig.out.ns6.test$n || tmp=1
+grep "status: SERVFAIL" dig.out.ns6.test$n > /dev/null || tmp=1
+test -f ns6/axfr-batches-too-big.bk && tmp=1
+if test $tmp != 0 ; then echo_i "failed"; fi
+status=$((status+tmp))
+
 n=$((n+1))
 echo_i "checking whether dig calculates AXFR statistics correctly ($n)"
 tmp=0
@@ -34,6 +34,7 @@
 #include <isc/string.h>
 #include <isc/symtab.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <pk11/site.h>
 
@@ -63,10 +64,6 @@
 
 #include <bind9/check.h>
 
-static isc_result_t
-fileexist(const cfg_obj_t *obj, isc_symtab_t *symtab, bool writeable,
-	  isc_log_t *logctxlogc);
-
 static void
 freekey(char *key, unsigned int type, isc_symvalue_t value, void *userarg) {
 	UNUSED(type);
@@ -1557,6 +1554,29 @@ check_options(const cfg_obj_t *options, isc_log_t *logctx, isc_mem_t *mctx,
 		}
 	}
 
+	obj = NULL;
+	(void)cfg_map_get(options, "resolver-hedge-budget", &obj);
+	if (obj != NULL && cfg_obj_asuint32(obj) > 100U) {
+		cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
+			    "'resolver-hedge-budget' must be <= 100");
+		if (result == ISC_R_SUCCESS) {
+			result = ISC_R_RANGE;
+		}
+	}
+
+	obj = NULL;
+	(void)cfg_map_get(options, "resolver-hedge-percentile", &obj);
+	if (obj != NULL &&
+	    (cfg_obj_asuint32(obj) == 0U || cfg_obj_asuint32(obj) > 99U))
+	{
+		cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
+			    "'resolver-hedge-percentile' must be between "
+			    "1 and 99");
+		if (result == ISC_R_SUCCESS) {
+			result = ISC_R_RANGE;
+		}
+	}
+
 	obj = NULL;
 	(void)cfg_map_get(options, "geoip-use-ecs", &obj);
 	if (obj != NULL && cfg_obj_asboolean(obj)) {
@@ -2024,10 +2044,38 @@ cleanup:
 	return (retval);
 }
 
+/*%
+ * The names and files used by a zone.  Zones are checked in parallel,
+ * so these are recorded by check_zoneconf() and checked for conflicts
+ * with other zones once all zones have been checked.
+ */
+typedef struct zonecheck {
+	const cfg_obj_t *zconfig;
+	size_t		 seq; /* position in the configuration */
+	isc_result_t	 result;
+	/*
+	 * Canonical zone name, or NULL if it is not valid, and whether
+	 * it is a hint (1), redirect (2) or other (3) zone.
+	 */
+	char *	     name;
+	unsigned int nametype;
+	/*
+	 * "name/class/view" key of a zone that can be the target of an
+	 * "in-view" zone, or that such a zone refers to.
+	 */
+	char *		 viewkey;
+	const cfg_obj_t *inviewobj;
+	/* Zone file, and whether named writes to it. */
+	const cfg_obj_t *file;
+	bool		 writeable;
+	/* Earlier zone whose name or file conflicts with this one. */
+	const struct zonecheck *dupname;
+	const struct zonecheck *dupfile;
+} zonecheck_t;
+
 static isc_result_t
 check_zoneconf(const cfg_obj_t *zconfig, const cfg_obj_t *voptions,
-	       const cfg_obj_t *config, isc_symtab_t *symtab,
-	       isc_symtab_t *files, isc_symtab_t *inview, const char *viewname,
+	       const cfg_obj_t *config, zonecheck_t *zc, const char *viewname,
 	       dns_rdataclass_t defclass, cfg_aclconfctx_t *actx,
 	       isc_log_t *logctx, isc_mem_t *mctx) {
 	const char *znamestr;
@@ -2171,18 +2219,10 @@ check_zoneconf(const cfg_obj_t *zconfig, const cfg_obj_t *voptions,
 
 		zname = dns_fixedname_name(&fixedname);
 		dns_name_format(zname, namebuf, sizeof(namebuf));
-		tresult = nameexist(zconfig, namebuf,
-				    ztype == CFG_ZONE_HINT
-					    ? 1
-					    : ztype == CFG_ZONE_REDIRECT ? 2
-									 : 3,
-				    symtab,
-				    "zone '%s': already exists "
-				    "previous definition: %s:%u",
-				    logctx, mctx);
-		if (tresult != ISC_R_SUCCESS) {
-			result = tresult;
-		}
+		zc->name = isc_mem_strdup(mctx, namebuf);
+		zc->nametype = ztype == CFG_ZONE_HINT
+				       ? 1
+				       : ztype == CFG_ZONE_REDIRECT ? 2 : 3;
 		if (dns_name_equal(zname, dns_rootname)) {
 			root = true;
 		} else if (dns_name_isrfc1918(zname)) {
@@ -2199,17 +2239,8 @@ check_zoneconf(const cfg_obj_t *zconfig, const cfg_obj_t *voptions,
 							    : "_default");
 		switch (ztype) {
 		case CFG_ZONE_INVIEW:
-			tresult = isc_symtab_lookup(inview, namebuf, 0, NULL);
-			if (tresult != ISC_R_SUCCESS) {
-				cfg_obj_log(inviewobj, logctx, ISC_LOG_ERROR,
-					    "'in-view' zone '%s' "
-					    "does not exist in view '%s', "
-					    "or view '%s' is not yet defined",
-					    znamestr, target, target);
-				if (result == ISC_R_SUCCESS) {
-					result = tresult;
-				}
-			}
+			zc->viewkey = isc_mem_strdup(mctx, namebuf);
+			zc->inviewobj = inviewobj;
 			break;
 
 		case CFG_ZONE_FORWARD:
@@ -2223,21 +2254,7 @@ check_zoneconf(const cfg_obj_t *zconfig, const cfg_obj_t *voptions,
 		case CFG_ZONE_HINT:
 		case CFG_ZONE_STUB:
 		case CFG_ZONE_STATICSTUB:
-			tmp = isc_mem_strdup(mctx, namebuf);
-			{
-				isc_symvalue_t symvalue;
-				symvalue.as_cpointer = NULL;
-				tresult = isc_symtab_define(
-					inview, tmp, 1, symvalue,
-					isc_symexists_replace);
-				if (tresult == ISC_R_NOMEMORY) {
-					isc_mem_free(mctx, tmp);
-				}
-				if (result == ISC_R_SUCCESS &&
-				    tresult != ISC_R_SUCCESS) {
-					result = tresult;
-				}
-			}
+			zc->viewkey = isc_mem_strdup(mctx, namebuf);
 			break;
 
 		default:
@@ -2893,17 +2910,13 @@ check_zoneconf(const cfg_obj_t *zconfig, const cfg_obj_t *voptions,
 			   (ztype == CFG_ZONE_SLAVE ||
 			    ztype == CFG_ZONE_MIRROR || ddns))
 		{
-			tresult = fileexist(fileobj, files, true, logctx);
-			if (tresult != ISC_R_SUCCESS) {
-				result = tresult;
-			}
+			zc->file = fileobj;
+			zc->writeable = true;
 		} else if (tresult == ISC_R_SUCCESS &&
 			   (ztype == CFG_ZONE_MASTER || ztype == CFG_ZONE_HINT))
 		{
-			tresult = fileexist(fileobj, files, false, logctx);
-			if (tresult != ISC_R_SUCCESS) {
-				result = tresult;
-			}
+			zc->file = fileobj;
+			zc->writeable = false;
 		}
 	}
 
@@ -3011,46 +3024,6 @@ bind9_check_key(const cfg_obj_t *key, isc_log_t *logctx) {
 	return (ISC_R_SUCCESS);
 }
 
-static isc_result_t
-fileexist(const cfg_obj_t *obj, isc_symtab_t *symtab, bool writeable,
-	  isc_log_t *logctx) {
-	isc_result_t result;
-	isc_symvalue_t symvalue;
-	unsigned int line;
-	const char *file;
-
-	result = isc_symtab_lookup(symtab, cfg_obj_asstring(obj), 0, &symvalue);
-	if (result == ISC_R_SUCCESS) {
-		if (writeable) {
-			file = cfg_obj_file(symvalue.as_cpointer);
-			line = cfg_obj_line(symvalue.as_cpointer);
-			cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
-				    "writeable file '%s': already in use: "
-				    "%s:%u",
-				    cfg_obj_asstring(obj), file, line);
-			return (ISC_R_EXISTS);
-		}
-		result = isc_symtab_lookup(symtab, cfg_obj_asstring(obj), 2,
-					   &symvalue);
-		if (result == ISC_R_SUCCESS) {
-			file = cfg_obj_file(symvalue.as_cpointer);
-			line = cfg_obj_line(symvalue.as_cpointer);
-			cfg_obj_log(obj, logctx, ISC_LOG_ERROR,
-				    "writeable file '%s': already in use: "
-				    "%s:%u",
-				    cfg_obj_asstring(obj), file, line);
-			return (ISC_R_EXISTS);
-		}
-		return (ISC_R_SUCCESS);
-	}
-
-	symvalue.as_cpointer = obj;
-	result = isc_symtab_define(symtab, cfg_obj_asstring(obj),
-				   writeable ? 2 : 1, symvalue,
-				   isc_symexists_reject);
-	return (result);
-}
-
 /*
  * Check key list for duplicates key names and that the key names
  * are valid domain names as these keys are used for TSIG.
@@ -3838,15 +3811,369 @@ cleanup:
 
 typedef enum { special_zonetype_rpz, special_zonetype_catz } special_zonetype_t;
 
+/*%
+ * The zones of all views, for the checks that span views.  The
+ * zones are stored in configuration order; 'seq' is the index
+ * into 'zones'.
+ */
+typedef struct zonechecks {
+	isc_workpool_t *pool;
+	zonecheck_t *	zones;
+	size_t		count;
+	size_t		size;
+} zonechecks_t;
+
+/*%
+ * The zones of a view, checked in 'nchunks' chunks of consecutive
+ * zones.  Each chunk has its own ACL context.
+ */
+typedef struct zonebatch {
+	zonecheck_t *	 zones;
+	size_t		 count;
+	size_t		 nchunks;
+	const cfg_obj_t *voptions;
+	const cfg_obj_t *config;
+	const char *	 viewname;
+	dns_rdataclass_t vclass;
+	isc_log_t *	 logctx;
+	isc_mem_t *	 mctx;
+} zonebatch_t;
+
+static void
+check_zonechunk(void *arg, size_t chunk) {
+	zonebatch_t *batch = arg;
+	cfg_aclconfctx_t *actx = NULL;
+	size_t i, first, last;
+
+	first = chunk * batch->count / batch->nchunks;
+	last = (chunk + 1) * batch->count / batch->nchunks;
+
+	cfg_aclconfctx_create(batch->mctx, &actx);
+	for (i = first; i < last; i++) {
+		zonecheck_t *zc = &batch->zones[i];
+
+		zc->result = check_zoneconf(zc->zconfig, batch->voptions,
+					    batch->config, zc, batch->viewname,
+					    batch->vclass, actx, batch->logctx,
+					    batch->mctx);
+	}
+	cfg_aclconfctx_detach(&actx);
+}
+
+static int
+zonename_cmp(const void *a, const void *b) {
+	const zonecheck_t *za = *(const zonecheck_t *const *)a;
+	const zonecheck_t *zb = *(const zonecheck_t *const *)b;
+	int order;
+
+	order = strcasecmp(za->name, zb->name);
+	if (order != 0) {
+		return (order);
+	}
+	if (za->nametype != zb->nametype) {
+		return (za->nametype < zb->nametype ? -1 : 1);
+	}
+	return (za->seq < zb->seq ? -1 : za->seq > zb->seq ? 1 : 0);
+}
+
+/*%
+ * Return the first zone called 'name' with name type 'nametype'
+ * in 'zones', which is sorted with zonename_cmp(), or NULL.
+ */
+static const zonecheck_t *
+findzone(zonecheck_t *const *zones, size_t count, const char *name,
+	 unsigned int nametype) {
+	size_t lo = 0, hi = count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		int order = strcasecmp(zones[mid]->name, name);
+
+		if (order < 0 || (order == 0 && zones[mid]->nametype < nametype))
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo < count && strcasecmp(zones[lo]->name, name) == 0 &&
+	    zones[lo]->nametype == nametype)
+	{
+		return (zones[lo]);
+	}
+	return (NULL);
+}
+
+/*%
+ * Check the zones of a view: the checks of individual zones run in
+ * parallel, and zones with the same name are looked for afterwards.
+ * On return, '*bynamep' is an array of the zones with a valid name,
+ * sorted with zonename_cmp(), which the caller must free with
+ * isc_mem_free().
+ */
+static isc_result_t
+check_viewzones(zonechecks_t *checks, const cfg_obj_t *zones,
+		const cfg_obj_t *voptions, const cfg_obj_t *config,
+		const char *viewname, dns_rdataclass_t vclass,
+		isc_log_t *logctx, isc_mem_t *mctx, zonecheck_t ***bynamep,
+		size_t *nbynamep) {
+	const cfg_listelt_t *element;
+	isc_result_t result = ISC_R_SUCCESS;
+	zonecheck_t **byname = NULL;
+	zonecheck_t *vzones;
+	const zonecheck_t *first;
+	zonebatch_t batch;
+	size_t count, nbyname = 0, i;
+	unsigned int workers;
+
+	count = cfg_list_length(zones, false);
+	if (count == 0) {
+		*bynamep = NULL;
+		*nbynamep = 0;
+		return (ISC_R_SUCCESS);
+	}
+
+	if (checks->count + count > checks->size) {
+		size_t newsize = ISC_MAX(checks->size * 2,
+					 checks->count + count);
+		zonecheck_t *newzones;
+
+		newzones = isc_mem_get(mctx, newsize * sizeof(*newzones));
+		if (checks->zones != NULL) {
+			memmove(newzones, checks->zones,
+				checks->count * sizeof(*newzones));
+			isc_mem_put(mctx, checks->zones,
+				    checks->size * sizeof(*newzones));
+		}
+		checks->zones = newzones;
+		checks->size = newsize;
+	}
+
+	vzones = &checks->zones[checks->count];
+	memset(vzones, 0, count * sizeof(*vzones));
+	for (element = cfg_list_first(zones), i = 0; element != NULL;
+	     element = cfg_list_next(element), i++)
+	{
+		vzones[i].zconfig = cfg_listelt_value(element);
+		vzones[i].seq = checks->count + i;
+		vzones[i].result = ISC_R_SUCCESS;
+	}
+	checks->count += count;
+
+	workers = isc_workpool_size(checks->pool);
+	batch.zones = vzones;
+	batch.count = count;
+	batch.nchunks = ISC_MIN(count, (workers > 1) ? workers * 4 : 1);
+	batch.voptions = voptions;
+	batch.config = config;
+	batch.viewname = viewname;
+	batch.vclass = vclass;
+	batch.logctx = logctx;
+	batch.mctx = mctx;
+	isc_workpool_run(checks->pool, batch.nchunks, check_zonechunk, &batch);
+
+	byname = isc_mem_allocate(mctx, count * sizeof(*byname));
+	for (i = 0; i < count; i++) {
+		if (vzones[i].result != ISC_R_SUCCESS) {
+			result = ISC_R_FAILURE;
+		}
+		if (vzones[i].name != NULL) {
+			byname[nbyname++] = &vzones[i];
+		}
+	}
+
+	/*
+	 * Look for zones with the same name, and report them in
+	 * configuration order.
+	 */
+	qsort(byname, nbyname, sizeof(*byname), zonename_cmp);
+	for (i = 0, first = NULL; i < nbyname; i++) {
+		if (first == NULL ||
+		    strcasecmp(first->name, byname[i]->name) != 0 ||
+		    first->nametype != byname[i]->nametype)
+		{
+			first = byname[i];
+		} else {
+			byname[i]->dupname = first;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		const zonecheck_t *dup = vzones[i].dupname;
+		const char *file;
+
+		if (dup == NULL) {
+			continue;
+		}
+		file = cfg_obj_file(dup->zconfig);
+		if (file == NULL) {
+			file = "<unknown file>";
+		}
+		cfg_obj_log(vzones[i].zconfig, logctx, ISC_LOG_ERROR,
+			    "zone '%s': already exists "
+			    "previous definition: %s:%u",
+			    vzones[i].name, file, cfg_obj_line(dup->zconfig));
+		result = ISC_R_FAILURE;
+	}
+
+	*bynamep = byname;
+	*nbynamep = nbyname;
+	return (result);
+}
+
+static int
+zonefile_cmp(const void *a, const void *b) {
+	const zonecheck_t *za = *(const zonecheck_t *const *)a;
+	const zonecheck_t *zb = *(const zonecheck_t *const *)b;
+	int order;
+
+	/*
+	 * Use case insensitive comparison as not all file systems are
+	 * case sensitive.
+	 */
+	order = strcasecmp(cfg_obj_asstring(za->file),
+			   cfg_obj_asstring(zb->file));
+	if (order != 0) {
+		return (order);
+	}
+	return (za->seq < zb->seq ? -1 : za->seq > zb->seq ? 1 : 0);
+}
+
+static int
+zoneviewkey_cmp(const void *a, const void *b) {
+	const zonecheck_t *za = *(const zonecheck_t *const *)a;
+	const zonecheck_t *zb = *(const zonecheck_t *const *)b;
+	int order;
+
+	order = strcmp(za->viewkey, zb->viewkey);
+	if (order != 0) {
+		return (order);
+	}
+	return (za->seq < zb->seq ? -1 : za->seq > zb->seq ? 1 : 0);
+}
+
+/*%
+ * Check that zone files are not shared with zones that write to
+ * them, and that "in-view" zones refer to zones defined earlier,
+ * across all views.
+ */
+static isc_result_t
+check_allzones(zonechecks_t *checks, isc_log_t *logctx, isc_mem_t *mctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	zonecheck_t **sorted;
+	const zonecheck_t *first;
+	size_t nsorted, i;
+
+	if (checks->count == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	sorted = isc_mem_get(mctx, checks->count * sizeof(*sorted));
+
+	nsorted = 0;
+	for (i = 0; i < checks->count; i++) {
+		if (checks->zones[i].file != NULL) {
+			sorted[nsorted++] = &checks->zones[i];
+		}
+	}
+	qsort(sorted, nsorted, sizeof(*sorted), zonefile_cmp);
+	for (i = 0, first = NULL; i < nsorted; i++) {
+		if (first == NULL ||
+		    strcasecmp(cfg_obj_asstring(first->file),
+			       cfg_obj_asstring(sorted[i]->file)) != 0)
+		{
+			first = sorted[i];
+		} else if (first->writeable || sorted[i]->writeable) {
+			sorted[i]->dupfile = first;
+		}
+	}
+	for (i = 0; i < checks->count; i++) {
+		const zonecheck_t *zc = &checks->zones[i];
+
+		if (zc->dupfile == NULL) {
+			continue;
+		}
+		cfg_obj_log(zc->file, logctx, ISC_LOG_ERROR,
+			    "writeable file '%s': already in use: %s:%u",
+			    cfg_obj_asstring(zc->file),
+			    cfg_obj_file(zc->dupfile->file),
+			    cfg_obj_line(zc->dupfile->file));
+		result = ISC_R_FAILURE;
+	}
+
+	nsorted = 0;
+	for (i = 0; i < checks->count; i++) {
+		if (checks->zones[i].viewkey != NULL &&
+		    checks->zones[i].inviewobj == NULL) {
+			sorted[nsorted++] = &checks->zones[i];
+		}
+	}
+	qsort(sorted, nsorted, sizeof(*sorted), zoneviewkey_cmp);
+	for (i = 0; i < checks->count; i++) {
+		const zonecheck_t *zc = &checks->zones[i];
+		const char *znamestr, *target;
+		size_t lo = 0, hi = nsorted;
+
+		if (zc->inviewobj == NULL) {
+			continue;
+		}
+
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (strcmp(sorted[mid]->viewkey, zc->viewkey) < 0) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < nsorted && strcmp(sorted[lo]->viewkey, zc->viewkey) == 0 &&
+		    sorted[lo]->seq < zc->seq)
+		{
+			continue;
+		}
+
+		znamestr = cfg_obj_asstring(cfg_tuple_get(zc->zconfig, "name"));
+		target = cfg_obj_asstring(zc->inviewobj);
+		cfg_obj_log(zc->inviewobj, logctx, ISC_LOG_ERROR,
+			    "'in-view' zone '%s' "
+			    "does not exist in view '%s', "
+			    "or view '%s' is not yet defined",
+			    znamestr, target, target);
+		result = ISC_R_FAILURE;
+	}
+
+	isc_mem_put(mctx, sorted, checks->count * sizeof(*sorted));
+	return (result);
+}
+
+static void
+free_zonechecks(zonechecks_t *checks, isc_mem_t *mctx) {
+	size_t i;
+
+	for (i = 0; i < checks->count; i++) {
+		if (checks->zones[i].name != NULL) {
+			isc_mem_free(mctx, checks->zones[i].name);
+		}
+		if (checks->zones[i].viewkey != NULL) {
+			isc_mem_free(mctx, checks->zones[i].viewkey);
+		}
+	}
+	if (checks->zones != NULL) {
+		isc_mem_put(mctx, checks->zones,
+			    checks->size * sizeof(checks->zones[0]));
+	}
+}
+
 static isc_result_t
 check_rpz_catz(const char *rpz_catz, const cfg_obj_t *rpz_obj,
-	       const char *viewname, isc_symtab_t *symtab, isc_log_t *logctx,
-	       special_zonetype_t specialzonetype) {
+	       const char *viewname, zonecheck_t *const *zones, size_t nzones,
+	       isc_log_t *logctx, special_zonetype_t specialzonetype) {
 	const cfg_listelt_t *element;
 	const cfg_obj_t *obj, *nameobj, *zoneobj;
 	const char *zonename, *zonetype;
 	const char *forview = " for view ";
-	isc_symvalue_t value;
+	const zonecheck_t *zc;
 	isc_result_t result, tresult;
 	dns_fixedname_t fixed;
 	dns_name_t *name;
@@ -3890,10 +4217,10 @@ check_rpz_catz(const char *rpz_catz, const cfg_obj_t *rpz_obj,
 			continue;
 		}
 		dns_name_format(name, namebuf, sizeof(namebuf));
-		tresult = isc_symtab_lookup(symtab, namebuf, 3, &value);
-		if (tresult == ISC_R_SUCCESS) {
+		zc = findzone(zones, nzones, namebuf, 3);
+		if (zc != NULL) {
 			obj = NULL;
-			zoneobj = value.as_cpointer;
+			zoneobj = zc->zconfig;
 			if (zoneobj != NULL && cfg_obj_istuple(zoneobj)) {
 				zoneobj = cfg_tuple_get(zoneobj, "options");
 			}
@@ -4008,8 +4335,8 @@ check_dnstap(const cfg_obj_t *voptions, const cfg_obj_t *config,
 static isc_result_t
 check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 	       const char *viewname, dns_rdataclass_t vclass,
-	       isc_symtab_t *files, bool check_plugins, isc_symtab_t *inview,
-	       isc_log_t *logctx, isc_mem_t *mctx) {
+	       zonechecks_t *checks, bool check_plugins, isc_log_t *logctx,
+	       isc_mem_t *mctx) {
 	const cfg_obj_t *zones = NULL;
 	const cfg_obj_t *view_tkeys = NULL, *global_tkeys = NULL;
 	const cfg_obj_t *view_mkeys = NULL, *global_mkeys = NULL;
@@ -4018,6 +4345,8 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 	const cfg_obj_t *keys = NULL;
 	const cfg_listelt_t *element, *element2;
 	isc_symtab_t *symtab = NULL;
+	zonecheck_t **zonesbyname = NULL;
+	size_t nzones = 0;
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_result_t tresult = ISC_R_SUCCESS;
 	cfg_aclconfctx_t *actx = NULL;
@@ -4047,11 +4376,6 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 	 * Check that all zone statements are syntactically correct and
 	 * there are no duplicate zones.
 	 */
-	tresult = isc_symtab_create(mctx, 1000, freekey, mctx, false, &symtab);
-	if (tresult != ISC_R_SUCCESS) {
-		return (ISC_R_NOMEMORY);
-	}
-
 	cfg_aclconfctx_create(mctx, &actx);
 
 	if (voptions != NULL) {
@@ -4060,17 +4384,10 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 		(void)cfg_map_get(config, "zone", &zones);
 	}
 
-	for (element = cfg_list_first(zones); element != NULL;
-	     element = cfg_list_next(element))
-	{
-		const cfg_obj_t *zone = cfg_listelt_value(element);
-
-		tresult = check_zoneconf(zone, voptions, config, symtab, files,
-					 inview, viewname, vclass, actx, logctx,
-					 mctx);
-		if (tresult != ISC_R_SUCCESS) {
-			result = ISC_R_FAILURE;
-		}
+	tresult = check_viewzones(checks, zones, voptions, config, viewname,
+				  vclass, logctx, mctx, &zonesbyname, &nzones);
+	if (tresult != ISC_R_SUCCESS) {
+		result = ISC_R_FAILURE;
 	}
 
 	/*
@@ -4082,7 +4399,7 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 		if ((cfg_map_get(opts, "response-policy", &obj) ==
 		     ISC_R_SUCCESS) &&
 		    (check_rpz_catz("response-policy zone", obj, viewname,
-				    symtab, logctx,
+				    zonesbyname, nzones, logctx,
 				    special_zonetype_rpz) != ISC_R_SUCCESS))
 		{
 			result = ISC_R_FAILURE;
@@ -4091,15 +4408,17 @@ check_viewconf(const cfg_obj_t *config, const cfg_obj_t *voptions,
 		obj = NULL;
 		if ((cfg_map_get(opts, "catalog-zones", &obj) ==
 		     ISC_R_SUCCESS) &&
-		    (check_rpz_catz("catalog zone", obj, viewname, symtab,
-				    logctx,
+		    (check_rpz_catz("catalog zone", obj, viewname,
+				    zonesbyname, nzones, logctx,
 				    special_zonetype_catz) != ISC_R_SUCCESS))
 		{
 			result = ISC_R_FAILURE;
 		}
 	}
 
-	isc_symtab_destroy(&symtab);
+	if (zonesbyname != NULL) {
+		isc_mem_free(mctx, zonesbyname);
+	}
 
 	/*
 	 * Check that forwarding is reasonable.
@@ -4651,7 +4970,8 @@ bind9_check_controls(const cfg_obj_t *config, isc_log_t *logctx,
 
 isc_result_t
 bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
-		      isc_log_t *logctx, isc_mem_t *mctx) {
+		      isc_workpool_t *pool, isc_log_t *logctx,
+		      isc_mem_t *mctx) {
 	const cfg_obj_t *options = NULL;
 	const cfg_obj_t *views = NULL;
 	const cfg_obj_t *acls = NULL;
@@ -4661,12 +4981,14 @@ bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
 	isc_result_t result = ISC_R_SUCCESS;
 	isc_result_t tresult;
 	isc_symtab_t *symtab = NULL;
-	isc_symtab_t *files = NULL;
-	isc_symtab_t *inview = NULL;
+	zonechecks_t checks;
 
 	static const char *builtin[] = { "localhost", "localnets", "any",
 					 "none" };
 
+	memset(&checks, 0, sizeof(checks));
+	checks.pool = pool;
+
 	(void)cfg_map_get(config, "options", &options);
 
 	if (options != NULL && check_options(options, logctx, mctx,
@@ -4698,27 +5020,9 @@ bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
 		}
 	}
 
-	/*
-	 * Use case insensitive comparison as not all file systems are
-	 * case sensitive. This will prevent people using FOO.DB and foo.db
-	 * on case sensitive file systems but that shouldn't be a major issue.
-	 */
-	tresult = isc_symtab_create(mctx, 100, NULL, NULL, false, &files);
-	if (tresult != ISC_R_SUCCESS) {
-		result = tresult;
-		goto cleanup;
-	}
-
-	tresult = isc_symtab_create(mctx, 100, freekey, mctx, true, &inview);
-	if (tresult != ISC_R_SUCCESS) {
-		result = tresult;
-		goto cleanup;
-	}
-
 	if (views == NULL) {
 		tresult = check_viewconf(config, NULL, NULL, dns_rdataclass_in,
-					 files, check_plugins, inview, logctx,
-					 mctx);
+					 &checks, check_plugins, logctx, mctx);
 		if (result == ISC_R_SUCCESS && tresult != ISC_R_SUCCESS) {
 			result = ISC_R_FAILURE;
 		}
@@ -4809,7 +5113,7 @@ bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
 		}
 		if (tresult == ISC_R_SUCCESS) {
 			tresult = check_viewconf(config, voptions, key, vclass,
-						 files, check_plugins, inview,
+						 &checks, check_plugins,
 						 logctx, mctx);
 		}
 		if (tresult != ISC_R_SUCCESS) {
@@ -4817,6 +5121,10 @@ bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
 		}
 	}
 
+	if (check_allzones(&checks, logctx, mctx) != ISC_R_SUCCESS) {
+		result = ISC_R_FAILURE;
+	}
+
 	if (views != NULL && options != NULL) {
 		obj = NULL;
 		tresult = cfg_map_get(options, "cache-file", &obj);
@@ -4923,12 +5231,7 @@ cleanup:
 	if (symtab != NULL) {
 		isc_symtab_destroy(&symtab);
 	}
-	if (inview != NULL) {
-		isc_symtab_destroy(&inview);
-	}
-	if (files != NULL) {
-		isc_symtab_destroy(&files);
-	}
+	free_zonechecks(&checks, mctx);
 
 	return (result);
 }
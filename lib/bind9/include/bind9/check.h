@@ -35,7 +35,8 @@ ISC_LANG_BEGINDECLS
 
 isc_result_t
 bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
-		      isc_log_t *logctx, isc_mem_t *mctx);
+		      isc_workpool_t *pool, isc_log_t *logctx,
+		      isc_mem_t *mctx);
 /*%<
  * Check the syntactic validity of a configuration parse tree generated from
  * a named.conf file.
@@ -43,6 +44,9 @@ bind9_check_namedconf(const cfg_obj_t *config, bool check_plugins,
  * If 'check_plugins' is true, load plugins and check the validity of their
  * parameters as well.
  *
+ * The zones of each view are checked in parallel on 'pool', if it is not
+ * NULL.  Errors about individual zones may then be logged in any order.
+ *
  * Requires:
  *\li	config is a valid parse tree
  *
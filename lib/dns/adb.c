@@ -68,6 +68,17 @@
 #define ADB_CACHE_MAXIMUM 86400 /*%< seconds (86400 = 24 hours) */
 #define ADB_ENTRY_WINDOW  1800	/*%< seconds */
 
+/*%
+ * Each entry keeps a histogram of measured round trip times, in
+ * power-of-two millisecond buckets, from which RTT percentiles are
+ * estimated.  Once ADB_RTTHIST_MAX samples have been recorded all the
+ * buckets are halved, so that recent samples carry the most weight.
+ * No percentile is reported until ADB_RTTHIST_MIN samples are present.
+ */
+#define ADB_RTTHIST_BUCKETS 14
+#define ADB_RTTHIST_MAX	    256
+#define ADB_RTTHIST_MIN	    8
+
 /*%
  * The period in seconds after which an ADB name entry is regarded as stale
  * and forced to be cleaned up.
@@ -243,6 +254,8 @@ struct dns_adbentry {
 
 	unsigned int flags;
 	unsigned int srtt;
+	uint16_t rtthist[ADB_RTTHIST_BUCKETS];
+	uint16_t rttsamples;
 	uint16_t udpsize;
 	unsigned int completed;
 	unsigned int timeouts;
@@ -1903,6 +1916,8 @@ new_adbentry(dns_adb_t *adb) {
 	e->cookie = NULL;
 	e->cookielen = 0;
 	e->srtt = (isc_random_uniform(0x1f)) + 1;
+	memset(e->rtthist, 0, sizeof(e->rtthist));
+	e->rttsamples = 0;
 	e->lastage = 0;
 	e->expires = 0;
 	atomic_init(&e->active, 0);
@@ -4300,11 +4315,48 @@ dns_adb_agesrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, isc_stdtime_t now) {
 	UNLOCK(&adb->entrylocks[bucket]);
 }
 
+/*
+ * Bounds, in microseconds, of the RTT histogram bucket 'b'.
+ */
+static inline unsigned int
+rtthist_low(unsigned int b) {
+	return (b == 0 ? 0 : (1000U << (b - 1)));
+}
+
+static inline unsigned int
+rtthist_high(unsigned int b) {
+	return (1000U << b);
+}
+
+static void
+rtthist_add(dns_adbentry_t *entry, unsigned int rtt) {
+	unsigned int b, ms = rtt / 1000;
+
+	for (b = 0; b < ADB_RTTHIST_BUCKETS - 1 && ms != 0; b++) {
+		ms >>= 1;
+	}
+
+	entry->rtthist[b]++;
+	if (++entry->rttsamples < ADB_RTTHIST_MAX) {
+		return;
+	}
+
+	entry->rttsamples = 0;
+	for (b = 0; b < ADB_RTTHIST_BUCKETS; b++) {
+		entry->rtthist[b] >>= 1;
+		entry->rttsamples += entry->rtthist[b];
+	}
+}
+
 static void
 adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
 	   isc_stdtime_t now) {
 	uint64_t new_srtt;
 
+	if (factor == DNS_ADB_RTTADJDEFAULT) {
+		rtthist_add(addr->entry, rtt);
+	}
+
 	if (factor == DNS_ADB_RTTADJAGE) {
 		if (addr->entry->lastage != now) {
 			new_srtt = addr->entry->srtt;
@@ -4328,6 +4380,48 @@ adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
 	}
 }
 
+unsigned int
+dns_adb_getrttpercentile(dns_adb_t *adb, dns_adbaddrinfo_t *addr,
+			 unsigned int percentile) {
+	dns_adbentry_t *entry;
+	unsigned int b, target, seen = 0, rtt = 0;
+	int bucket;
+
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(DNS_ADBADDRINFO_VALID(addr));
+	REQUIRE(percentile > 0 && percentile < 100);
+
+	entry = addr->entry;
+	bucket = entry->lock_bucket;
+	LOCK(&adb->entrylocks[bucket]);
+
+	if (entry->rttsamples < ADB_RTTHIST_MIN) {
+		goto unlock;
+	}
+
+	/*
+	 * Find the bucket holding the requested sample, and interpolate
+	 * linearly within it.
+	 */
+	target = (entry->rttsamples * percentile + 99) / 100;
+	for (b = 0; b < ADB_RTTHIST_BUCKETS; b++) {
+		unsigned int count = entry->rtthist[b];
+		if (seen + count >= target) {
+			unsigned int low = rtthist_low(b);
+			unsigned int high = rtthist_high(b);
+			rtt = low + (uint64_t)(high - low) * (target - seen) /
+					    count;
+			break;
+		}
+		seen += count;
+	}
+
+unlock:
+	UNLOCK(&adb->entrylocks[bucket]);
+
+	return (rtt);
+}
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask) {
@@ -12,12 +12,16 @@
 /*! \file */
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 
+#include <isc/buffer.h>
+#include <isc/file.h>
 #include <isc/mem.h>
 #include <isc/print.h>
 #include <isc/refcount.h>
 #include <isc/stats.h>
+#include <isc/stdio.h>
 #include <isc/string.h>
 #include <isc/task.h>
 #include <isc/time.h>
@@ -28,10 +32,12 @@
 #include <dns/db.h>
 #include <dns/dbiterator.h>
 #include <dns/events.h>
+#include <dns/fixedname.h>
 #include <dns/lib.h>
 #include <dns/log.h>
 #include <dns/masterdump.h>
 #include <dns/rdata.h>
+#include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatasetiter.h>
 #include <dns/result.h>
@@ -64,6 +70,47 @@
  */
 #define DNS_CACHE_CLEANERINCREMENT 1000U /*%< Number of nodes. */
 
+/*!
+ * Control the expiry sweep of RBT-type cache databases.
+ * SWEEPBUDGET is how many entries may be removed per SWEEPINTERVAL.
+ */
+#define DNS_CACHE_SWEEPINTERVAL 1     /*%< Seconds. */
+#define DNS_CACHE_SWEEPBUDGET	1000U /*%< Number of entries. */
+
+/*!
+ * Control the incremental loading and dumping of cache snapshots.
+ * SNAPSHOTINCREMENT is how many names are dumped, or rdatasets loaded,
+ * in one pass.
+ */
+#define DNS_CACHE_SNAPSHOTINCREMENT 1000U
+
+/*
+ * A cache snapshot starts with a header of SNAPSHOT_HEADERLEN octets:
+ * the magic number, the version, the time of the dump and the class.
+ * Each rdataset follows as its owner name in uncompressed wire format
+ * preceded by its length, then its type, covered type, trust, flags,
+ * absolute expiry time and number of records, then each record
+ * preceded by its length.  All integers are in network byte order.
+ * A negative rdataset has type 0 and its records are in the negative
+ * cache format of ncache.c.  A snapshot is checked in full before any
+ * of it is loaded, so a malformed record rejects the whole file.
+ */
+#define SNAPSHOT_MAGIC	   0x42394353U /* "B9CS" */
+#define SNAPSHOT_VERSION   1U
+#define SNAPSHOT_HEADERLEN 16
+
+#define SNAPSHOT_NEGATIVE 0x01
+#define SNAPSHOT_NXDOMAIN 0x02
+#define SNAPSHOT_OPTOUT	  0x04
+#define SNAPSHOT_PREFETCH 0x08
+
+#define CHECK(op)                            \
+	do {                                 \
+		result = (op);               \
+		if (result != ISC_R_SUCCESS) \
+			goto cleanup;        \
+	} while (0)
+
 /***
  ***	Types
  ***/
@@ -74,6 +121,7 @@
  */
 
 typedef struct cache_cleaner cache_cleaner_t;
+typedef struct cache_snapshot cache_snapshot_t;
 
 typedef enum {
 	cleaner_s_idle, /*%< Waiting for cleaning-interval to expire. */
@@ -116,6 +164,39 @@ struct cache_cleaner {
 	bool overmem;		/*% The cache is in an overmem state.
 				 * */
 	bool replaceiterator;
+	isc_timer_t *sweep_timer; /*% Drives the expiry sweep of
+				   * RBT-type cache databases */
+	isc_timermgr_t *timermgr;
+	isc_timer_t *dump_timer;     /*% Drives periodic dumps */
+	cache_snapshot_t *snapshot; /*% Load or dump in progress */
+};
+
+/*%
+ * The state of a cache snapshot being loaded or dumped.
+ */
+struct cache_snapshot {
+	dns_cache_t *cache;
+	dns_db_t *db;
+	bool loading;
+	FILE *fp;
+	char *filename;
+	char *tmpname; /*% Dumps are renamed into place when done */
+	isc_stdtime_t now;
+	unsigned int count; /*% Rdatasets loaded or dumped */
+
+	/* Dumping. */
+	dns_dbiterator_t *dbiter;
+	isc_result_t result;
+
+	/* Loading. */
+	dns_fixedname_t fname;
+	dns_fixedname_t flast;
+	dns_dbnode_t *node; /*% Node of 'flast' */
+	bool skipnode;
+	bool checked;	      /*% The whole file has been validated */
+	isc_buffer_t *wire;   /*% A record as read from the file */
+	isc_buffer_t *buffer; /*% The checked records of an rdataset */
+	unsigned char namebuf[DNS_NAME_MAXWIRE];
 };
 
 /*%
@@ -146,6 +227,7 @@ struct dns_cache {
 
 	/* Locked by 'filelock'. */
 	char *filename;
+	bool loading;
 	/* Access to the on-disk cache file is also locked by 'filelock'. */
 };
 
@@ -166,6 +248,15 @@ cleaner_shutdown_action(isc_task_t *task, isc_event_t *event);
 static void
 overmem_cleaning_action(isc_task_t *task, isc_event_t *event);
 
+static void
+expiry_sweep_action(isc_task_t *task, isc_event_t *event);
+
+static void
+snapshot_cancel(cache_cleaner_t *cleaner);
+
+static isc_result_t
+snapshot_destroy(cache_snapshot_t **snapp, isc_result_t result);
+
 static inline isc_result_t
 cache_create_db(dns_cache_t *cache, dns_db_t **db) {
 	isc_result_t result;
@@ -270,19 +361,11 @@ dns_cache_create(isc_mem_t *cmctx, isc_mem_t *hmctx, isc_taskmgr_t *taskmgr,
 	}
 
 	cache->filename = NULL;
+	cache->loading = false;
 
 	cache->magic = CACHE_MAGIC;
 
-	/*
-	 * RBT-type cache DB has its own mechanism of cache cleaning and doesn't
-	 * need the control of the generic cleaner.
-	 */
-	if (strcmp(db_type, "rbt") == 0) {
-		result = cache_cleaner_init(cache, NULL, NULL, &cache->cleaner);
-	} else {
-		result = cache_cleaner_init(cache, taskmgr, timermgr,
-					    &cache->cleaner);
-	}
+	result = cache_cleaner_init(cache, taskmgr, timermgr, &cache->cleaner);
 	if (result != ISC_R_SUCCESS) {
 		goto cleanup_db;
 	}
@@ -329,6 +412,14 @@ cache_free(dns_cache_t *cache) {
 
 	isc_mem_setwater(cache->mctx, NULL, NULL, 0, 0);
 
+	if (cache->cleaner.sweep_timer != NULL) {
+		isc_timer_detach(&cache->cleaner.sweep_timer);
+	}
+
+	if (cache->cleaner.dump_timer != NULL) {
+		isc_timer_detach(&cache->cleaner.dump_timer);
+	}
+
 	if (cache->cleaner.task != NULL) {
 		isc_task_detach(&cache->cleaner.task);
 	}
@@ -407,6 +498,7 @@ dns_cache_attach(dns_cache_t *cache, dns_cache_t **targetp) {
 void
 dns_cache_detach(dns_cache_t **cachep) {
 	dns_cache_t *cache;
+	isc_task_t *task = NULL;
 
 	REQUIRE(cachep != NULL);
 	cache = *cachep;
@@ -428,13 +520,21 @@ dns_cache_detach(dns_cache_t **cachep) {
 		}
 
 		/*
-		 * If the cleaner task exists, let it free the cache.
+		 * If the cleaner task exists, let it free the cache.  Hold
+		 * a reference to the task, as it may be freeing the cache
+		 * already if it was shut down by the task manager.
 		 */
+		if (cache->cleaner.task != NULL) {
+			isc_task_attach(cache->cleaner.task, &task);
+		}
 		if (isc_refcount_decrement(&cache->live_tasks) > 1) {
-			isc_task_shutdown(cache->cleaner.task);
+			isc_task_shutdown(task);
 		} else {
 			cache_free(cache);
 		}
+		if (task != NULL) {
+			isc_task_detach(&task);
+		}
 	}
 }
 
@@ -468,39 +568,916 @@ dns_cache_setfilename(dns_cache_t *cache, const char *filename) {
 	return (ISC_R_SUCCESS);
 }
 
-isc_result_t
-dns_cache_load(dns_cache_t *cache) {
+/*
+ * Cache snapshots.
+ */
+
+static isc_result_t
+snapshot_read(FILE *fp, void *data, size_t len) {
 	isc_result_t result;
 
-	REQUIRE(VALID_CACHE(cache));
+	result = isc_stdio_read(data, 1, len, fp, NULL);
+	if (result == ISC_R_EOF) {
+		result = ISC_R_UNEXPECTEDEND;
+	}
+	return (result);
+}
 
-	if (cache->filename == NULL) {
+static isc_result_t
+snapshot_writeheader(FILE *fp, dns_rdataclass_t rdclass, isc_stdtime_t now) {
+	unsigned char data[SNAPSHOT_HEADERLEN];
+	isc_buffer_t b;
+
+	isc_buffer_init(&b, data, sizeof(data));
+	isc_buffer_putuint32(&b, SNAPSHOT_MAGIC);
+	isc_buffer_putuint32(&b, SNAPSHOT_VERSION);
+	isc_buffer_putuint32(&b, now);
+	isc_buffer_putuint16(&b, rdclass);
+	isc_buffer_putuint16(&b, 0);
+
+	return (isc_stdio_write(data, 1, sizeof(data), fp, NULL));
+}
+
+/*
+ * Returns DNS_R_FORMERR if 'fp' is not a cache snapshot at all.
+ */
+static isc_result_t
+snapshot_readheader(FILE *fp, dns_rdataclass_t rdclass) {
+	unsigned char data[SNAPSHOT_HEADERLEN];
+	isc_buffer_t b;
+	isc_result_t result;
+
+	result = isc_stdio_read(data, 1, sizeof(data), fp, NULL);
+	if (result == ISC_R_EOF) {
+		return (DNS_R_FORMERR);
+	} else if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	isc_buffer_init(&b, data, sizeof(data));
+	isc_buffer_add(&b, sizeof(data));
+	if (isc_buffer_getuint32(&b) != SNAPSHOT_MAGIC) {
+		return (DNS_R_FORMERR);
+	}
+	if (isc_buffer_getuint32(&b) != SNAPSHOT_VERSION) {
+		return (DNS_R_BADDB);
+	}
+	(void)isc_buffer_getuint32(&b); /* time of the dump */
+	if (isc_buffer_getuint16(&b) != rdclass) {
+		return (DNS_R_BADDB);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+static isc_result_t
+snapshot_writerdataset(FILE *fp, const dns_name_t *name,
+		       dns_rdataset_t *rdataset, isc_stdtime_t now) {
+	unsigned char data[2 + DNS_NAME_MAXWIRE + 14];
+	unsigned char len[2];
+	unsigned int flags = 0;
+	isc_buffer_t b;
+	isc_region_t r;
+	isc_result_t result;
+
+	/*
+	 * Stale data is not worth keeping, and data with a TTL of zero
+	 * must not be kept at all.
+	 */
+	if (rdataset->ttl == 0 ||
+	    (rdataset->attributes & DNS_RDATASETATTR_STALE) != 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	if ((rdataset->attributes & DNS_RDATASETATTR_NEGATIVE) != 0) {
+		flags |= SNAPSHOT_NEGATIVE;
+	}
+	if ((rdataset->attributes & DNS_RDATASETATTR_NXDOMAIN) != 0) {
+		flags |= SNAPSHOT_NXDOMAIN;
+	}
+	if ((rdataset->attributes & DNS_RDATASETATTR_OPTOUT) != 0) {
+		flags |= SNAPSHOT_OPTOUT;
+	}
+	if ((rdataset->attributes & DNS_RDATASETATTR_PREFETCH) != 0) {
+		flags |= SNAPSHOT_PREFETCH;
+	}
+
+	isc_buffer_init(&b, data, sizeof(data));
+	dns_name_toregion(name, &r);
+	isc_buffer_putuint16(&b, r.length);
+	isc_buffer_putmem(&b, r.base, r.length);
+	isc_buffer_putuint16(&b, rdataset->type);
+	isc_buffer_putuint16(&b, rdataset->covers);
+	isc_buffer_putuint8(&b, rdataset->trust);
+	isc_buffer_putuint8(&b, flags);
+	isc_buffer_putuint32(&b, now + rdataset->ttl);
+	isc_buffer_putuint16(&b, dns_rdataset_count(rdataset));
+
+	result = isc_stdio_write(data, 1, isc_buffer_usedlength(&b), fp, NULL);
+
+	for (result = (result == ISC_R_SUCCESS) ? dns_rdataset_first(rdataset)
+						 : result;
+	     result == ISC_R_SUCCESS; result = dns_rdataset_next(rdataset))
+	{
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+
+		dns_rdataset_current(rdataset, &rdata);
+		dns_rdata_toregion(&rdata, &r);
+		len[0] = (r.length >> 8) & 0xff;
+		len[1] = r.length & 0xff;
+		result = isc_stdio_write(len, 1, sizeof(len), fp, NULL);
+		if (result == ISC_R_SUCCESS) {
+			result = isc_stdio_write(r.base, 1, r.length, fp,
+						 NULL);
+		}
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+
+	return (result);
+}
+
+static isc_result_t
+snapshot_writenode(cache_snapshot_t *snap, dns_dbnode_t *node,
+		   const dns_name_t *name) {
+	dns_rdatasetiter_t *rdsiter = NULL;
+	dns_rdataset_t rdataset;
+	isc_result_t result;
+
+	result = dns_db_allrdatasets(snap->db, node, NULL, snap->now,
+				     &rdsiter);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	dns_rdataset_init(&rdataset);
+	for (result = dns_rdatasetiter_first(rdsiter); result == ISC_R_SUCCESS;
+	     result = dns_rdatasetiter_next(rdsiter))
+	{
+		dns_rdatasetiter_current(rdsiter, &rdataset);
+		result = snapshot_writerdataset(snap->fp, name, &rdataset,
+						snap->now);
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		snap->count++;
+	}
+	dns_rdatasetiter_destroy(&rdsiter);
+
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+	return (result);
+}
+
+/*
+ * Write up to 'increment' nodes of the cache to the snapshot.  Returns
+ * DNS_R_CONTINUE if there are more to write.
+ */
+static isc_result_t
+snapshot_dump(cache_snapshot_t *snap, unsigned int increment) {
+	dns_name_t *name = dns_fixedname_name(&snap->fname);
+	isc_result_t result = snap->result;
+
+	while (result == ISC_R_SUCCESS && increment-- > 0) {
+		dns_dbnode_t *node = NULL;
+
+		result = dns_dbiterator_current(snap->dbiter, &node, name);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		result = snapshot_writenode(snap, node, name);
+		dns_db_detachnode(snap->db, &node);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		result = dns_dbiterator_next(snap->dbiter);
+	}
+
+	snap->result = result;
+	if (result == ISC_R_NOMORE) {
+		return (ISC_R_SUCCESS);
+	} else if (result == ISC_R_SUCCESS) {
+		RUNTIME_CHECK(dns_dbiterator_pause(snap->dbiter) ==
+			      ISC_R_SUCCESS);
+		return (DNS_R_CONTINUE);
+	}
+	return (result);
+}
+
+/*
+ * Returns true if 'node' already has data that was cached after the
+ * snapshot was taken, which must not be overwritten with older data.
+ */
+static bool
+snapshot_nodeinuse(cache_snapshot_t *snap) {
+	dns_rdatasetiter_t *rdsiter = NULL;
+	isc_result_t result;
+
+	result = dns_db_allrdatasets(snap->db, snap->node, NULL, snap->now,
+				     &rdsiter);
+	if (result != ISC_R_SUCCESS) {
+		return (false);
+	}
+	result = dns_rdatasetiter_first(rdsiter);
+	dns_rdatasetiter_destroy(&rdsiter);
+
+	return (result == ISC_R_SUCCESS);
+}
+
+/*
+ * Check the record in 'source' of an rdataset of 'type', copying it
+ * to 'target'.  The names may not be compressed.
+ */
+static isc_result_t
+snapshot_fromwire(dns_rdataclass_t rdclass, dns_rdatatype_t type,
+		  isc_buffer_t *source, isc_buffer_t *target) {
+	dns_decompress_t dctx;
+	isc_result_t result;
+
+	dns_decompress_init(&dctx, -1, DNS_DECOMPRESS_NONE);
+	result = dns_rdata_fromwire(NULL, rdclass, type, source, &dctx, 0,
+				    target);
+	dns_decompress_invalidate(&dctx);
+	return (result);
+}
+
+/*
+ * Check the negative cache record in 'source', made of an owner name,
+ * type, trust and records as written by ncache.c, copying it to
+ * 'target'.
+ */
+static isc_result_t
+snapshot_ncachefromwire(dns_rdataclass_t rdclass, isc_buffer_t *source,
+			isc_buffer_t *target) {
+	dns_fixedname_t fixed;
+	dns_decompress_t dctx;
+	dns_rdatatype_t type;
+	isc_buffer_t rdata;
+	unsigned int count, length, trust;
+	unsigned char *lenp;
+	isc_result_t result;
+
+	dns_decompress_init(&dctx, -1, DNS_DECOMPRESS_NONE);
+	result = dns_name_fromwire(dns_fixedname_initname(&fixed), source,
+				   &dctx, 0, target);
+	dns_decompress_invalidate(&dctx);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	if (isc_buffer_remaininglength(source) < 5 ||
+	    isc_buffer_availablelength(target) < 5) {
+		return (DNS_R_FORMERR);
+	}
+	type = isc_buffer_getuint16(source);
+	trust = isc_buffer_getuint8(source);
+	count = isc_buffer_getuint16(source);
+	if (type == 0 || dns_rdatatype_ismeta(type) ||
+	    trust > dns_trust_ultimate || count == 0) {
+		return (DNS_R_FORMERR);
+	}
+	isc_buffer_putuint16(target, type);
+	isc_buffer_putuint8(target, trust);
+	isc_buffer_putuint16(target, count);
+
+	while (count-- > 0) {
+		if (isc_buffer_remaininglength(source) < 2 ||
+		    isc_buffer_availablelength(target) < 2) {
+			return (DNS_R_FORMERR);
+		}
+		length = isc_buffer_getuint16(source);
+		if (isc_buffer_remaininglength(source) < length) {
+			return (DNS_R_FORMERR);
+		}
+		isc_buffer_init(&rdata, isc_buffer_current(source), length);
+		isc_buffer_add(&rdata, length);
+		isc_buffer_setactive(&rdata, length);
+		isc_buffer_forward(source, length);
+
+		/* The length is filled in once the record is copied. */
+		lenp = isc_buffer_used(target);
+		isc_buffer_putuint16(target, 0);
+		result = snapshot_fromwire(rdclass, type, &rdata, target);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		length = (unsigned char *)isc_buffer_used(target) - lenp - 2;
+		lenp[0] = (length >> 8) & 0xff;
+		lenp[1] = length & 0xff;
+	}
+
+	if (isc_buffer_remaininglength(source) != 0) {
+		return (DNS_R_FORMERR);
+	}
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Read one rdataset from the snapshot and check it.  Once the whole
+ * file has been checked, add it to the cache as well.  Returns
+ * ISC_R_NOMORE at the end of the snapshot.
+ */
+static isc_result_t
+snapshot_readrdataset(cache_snapshot_t *snap) {
+	unsigned char data[DNS_NAME_MAXWIRE];
+	dns_name_t *name = dns_fixedname_name(&snap->fname);
+	dns_decompress_t dctx;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_rdata_t *rdatas = NULL;
+	dns_rdatatype_t type, covers;
+	dns_trust_t trust;
+	isc_buffer_t b, target;
+	isc_stdtime_t expire;
+	unsigned int i, count, flags, length, used;
+	unsigned char *base;
+	size_t n = 0;
+	isc_result_t result;
+
+	result = isc_stdio_read(data, 1, 2, snap->fp, &n);
+	if (result == ISC_R_EOF && n == 0) {
+		return (ISC_R_NOMORE);
+	} else if (result == ISC_R_EOF) {
+		return (ISC_R_UNEXPECTEDEND);
+	} else if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	length = (data[0] << 8) | data[1];
+	if (length == 0 || length > sizeof(data)) {
+		return (DNS_R_FORMERR);
+	}
+
+	result = snapshot_read(snap->fp, data, length);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	isc_buffer_init(&b, data, length);
+	isc_buffer_add(&b, length);
+	isc_buffer_setactive(&b, length);
+	dns_decompress_init(&dctx, -1, DNS_DECOMPRESS_NONE);
+	isc_buffer_init(&target, snap->namebuf, sizeof(snap->namebuf));
+	result = dns_name_fromwire(name, &b, &dctx, 0, &target);
+	dns_decompress_invalidate(&dctx);
+	if (result != ISC_R_SUCCESS || isc_buffer_remaininglength(&b) != 0) {
+		return (DNS_R_FORMERR);
+	}
+
+	result = snapshot_read(snap->fp, data, 12);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	isc_buffer_init(&b, data, 12);
+	isc_buffer_add(&b, 12);
+	type = isc_buffer_getuint16(&b);
+	covers = isc_buffer_getuint16(&b);
+	trust = isc_buffer_getuint8(&b);
+	flags = isc_buffer_getuint8(&b);
+	expire = isc_buffer_getuint32(&b);
+	count = isc_buffer_getuint16(&b);
+	if (count == 0 || trust > dns_trust_ultimate) {
+		return (DNS_R_FORMERR);
+	}
+	if ((flags & SNAPSHOT_NEGATIVE) != 0) {
+		if (type != 0 || covers == 0) {
+			return (DNS_R_FORMERR);
+		}
+	} else if (type == 0 || dns_rdatatype_ismeta(type) ||
+		   (covers != 0 && type != dns_rdatatype_rrsig) ||
+		   (flags & (SNAPSHOT_NXDOMAIN | SNAPSHOT_OPTOUT)) != 0)
+	{
+		return (DNS_R_FORMERR);
+	}
+
+	/*
+	 * Read and check the records; the lengths are kept in 'rdatas'
+	 * until all of the data is in the buffer, as it may be
+	 * reallocated.
+	 */
+	rdatas = isc_mem_get(snap->cache->mctx, count * sizeof(*rdatas));
+	isc_buffer_clear(snap->buffer);
+	for (i = 0; i < count; i++) {
+		CHECK(snapshot_read(snap->fp, data, 2));
+		length = (data[0] << 8) | data[1];
+		isc_buffer_clear(snap->wire);
+		CHECK(isc_buffer_reserve(&snap->wire, length));
+		CHECK(snapshot_read(snap->fp, isc_buffer_base(snap->wire),
+				    length));
+		isc_buffer_add(snap->wire, length);
+		isc_buffer_setactive(snap->wire, length);
+
+		CHECK(isc_buffer_reserve(&snap->buffer, length));
+		used = isc_buffer_usedlength(snap->buffer);
+		if (type == 0) {
+			result = snapshot_ncachefromwire(
+				dns_db_class(snap->db), snap->wire,
+				snap->buffer);
+		} else {
+			result = snapshot_fromwire(dns_db_class(snap->db), type,
+						   snap->wire, snap->buffer);
+		}
+		if (result != ISC_R_SUCCESS) {
+			result = DNS_R_FORMERR;
+			goto cleanup;
+		}
+		dns_rdata_init(&rdatas[i]);
+		rdatas[i].length = isc_buffer_usedlength(snap->buffer) - used;
+	}
+	if (!snap->checked) {
+		goto cleanup;
+	}
+
+	/*
+	 * Expired data is dropped, as is any data for a name that was
+	 * cached afresh since the snapshot was loaded.
+	 */
+	if (snap->node == NULL ||
+	    !dns_name_equal(name, dns_fixedname_name(&snap->flast))) {
+		dns_name_copynf(name, dns_fixedname_name(&snap->flast));
+		if (snap->node != NULL) {
+			dns_db_detachnode(snap->db, &snap->node);
+		}
+		CHECK(dns_db_findnode(snap->db, name, true, &snap->node));
+		snap->skipnode = snapshot_nodeinuse(snap);
+	}
+	if (snap->skipnode || expire <= snap->now) {
+		goto cleanup;
+	}
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_db_class(snap->db);
+	rdatalist.type = type;
+	rdatalist.covers = covers;
+	rdatalist.ttl = expire - snap->now;
+	base = isc_buffer_base(snap->buffer);
+	for (i = 0; i < count; i++) {
+		rdatas[i].data = base;
+		rdatas[i].rdclass = rdatalist.rdclass;
+		rdatas[i].type = type;
+		base += rdatas[i].length;
+		ISC_LIST_APPEND(rdatalist.rdata, &rdatas[i], link);
+	}
+
+	dns_rdataset_init(&rdataset);
+	RUNTIME_CHECK(dns_rdatalist_tordataset(&rdatalist, &rdataset) ==
+		      ISC_R_SUCCESS);
+	rdataset.trust = trust;
+	if ((flags & SNAPSHOT_NEGATIVE) != 0) {
+		rdataset.attributes |= DNS_RDATASETATTR_NEGATIVE;
+	}
+	if ((flags & SNAPSHOT_NXDOMAIN) != 0) {
+		rdataset.attributes |= DNS_RDATASETATTR_NXDOMAIN;
+	}
+	if ((flags & SNAPSHOT_OPTOUT) != 0) {
+		rdataset.attributes |= DNS_RDATASETATTR_OPTOUT;
+	}
+	if ((flags & SNAPSHOT_PREFETCH) != 0) {
+		rdataset.attributes |= DNS_RDATASETATTR_PREFETCH;
+	}
+
+	result = dns_db_addrdataset(snap->db, snap->node, NULL, snap->now,
+				    &rdataset, 0, NULL);
+	dns_rdataset_disassociate(&rdataset);
+	if (result == ISC_R_SUCCESS) {
+		snap->count++;
+	} else if (result == DNS_R_UNCHANGED) {
+		result = ISC_R_SUCCESS;
+	}
+
+cleanup:
+	isc_mem_put(snap->cache->mctx, rdatas, count * sizeof(*rdatas));
+	return (result);
+}
+
+/*
+ * Load up to 'increment' rdatasets from the snapshot into the cache.
+ * Returns DNS_R_CONTINUE if there are more to load.
+ */
+static isc_result_t
+snapshot_load(cache_snapshot_t *snap, unsigned int increment) {
+	isc_result_t result = ISC_R_SUCCESS;
+	bool flushed;
+
+	/*
+	 * Stop if the cache has been flushed in the meantime.
+	 */
+	LOCK(&snap->cache->lock);
+	flushed = (snap->cache->db != snap->db);
+	UNLOCK(&snap->cache->lock);
+	if (flushed) {
+		return (ISC_R_CANCELED);
+	}
+
+	while (result == ISC_R_SUCCESS && increment-- > 0) {
+		result = snapshot_readrdataset(snap);
+		if (result == ISC_R_NOMORE && !snap->checked) {
+			/*
+			 * Every rdataset is well formed; go back to the
+			 * first one and load them.
+			 */
+			snap->checked = true;
+			result = isc_stdio_seek(snap->fp, SNAPSHOT_HEADERLEN,
+						SEEK_SET);
+		}
+	}
+
+	if (result == ISC_R_NOMORE) {
 		return (ISC_R_SUCCESS);
+	} else if (result == ISC_R_SUCCESS) {
+		return (DNS_R_CONTINUE);
+	}
+	return (result);
+}
+
+/*
+ * Open the snapshot file for a dump or a load of 'cache'.  For a load,
+ * DNS_R_FORMERR is returned if the file is not a cache snapshot.
+ */
+static isc_result_t
+snapshot_create(dns_cache_t *cache, const char *filename, bool loading,
+		cache_snapshot_t **snapp) {
+	cache_snapshot_t *snap;
+	isc_result_t result;
+	size_t len;
+
+	snap = isc_mem_get(cache->mctx, sizeof(*snap));
+	*snap = (cache_snapshot_t){
+		.cache = cache,
+		.loading = loading,
+	};
+	snap->filename = isc_mem_strdup(cache->mctx, filename);
+	dns_fixedname_init(&snap->fname);
+	dns_fixedname_init(&snap->flast);
+	dns_cache_attachdb(cache, &snap->db);
+	isc_stdtime_get(&snap->now);
+
+	if (loading) {
+		CHECK(isc_stdio_open(filename, "rb", &snap->fp));
+		CHECK(snapshot_readheader(snap->fp, cache->rdclass));
+		isc_buffer_allocate(cache->mctx, &snap->wire, 512);
+		isc_buffer_allocate(cache->mctx, &snap->buffer, 512);
+	} else {
+		len = strlen(filename) + 20;
+		snap->tmpname = isc_mem_allocate(cache->mctx, len);
+		CHECK(isc_file_mktemplate(filename, snap->tmpname, len));
+		CHECK(isc_file_openunique(snap->tmpname, &snap->fp));
+		CHECK(snapshot_writeheader(snap->fp, cache->rdclass,
+					   snap->now));
+		CHECK(dns_db_createiterator(snap->db, 0, &snap->dbiter));
+		snap->result = dns_dbiterator_first(snap->dbiter);
+		if (snap->result == ISC_R_SUCCESS) {
+			/*
+			 * Don't hold the tree lock until the first
+			 * increment is dumped.
+			 */
+			RUNTIME_CHECK(dns_dbiterator_pause(snap->dbiter) ==
+				      ISC_R_SUCCESS);
+		}
+	}
+
+	*snapp = snap;
+	return (ISC_R_SUCCESS);
+
+cleanup:
+	snapshot_destroy(&snap, result);
+	return (result);
+}
+
+/*
+ * Close the snapshot.  A dump is renamed into place if 'result' is
+ * ISC_R_SUCCESS, and removed otherwise.
+ */
+static isc_result_t
+snapshot_destroy(cache_snapshot_t **snapp, isc_result_t result) {
+	cache_snapshot_t *snap = *snapp;
+	isc_mem_t *mctx = snap->cache->mctx;
+	isc_result_t tresult;
+
+	*snapp = NULL;
+
+	if (snap->dbiter != NULL) {
+		dns_dbiterator_destroy(&snap->dbiter);
+	}
+	if (snap->node != NULL) {
+		dns_db_detachnode(snap->db, &snap->node);
+	}
+	if (snap->fp != NULL) {
+		if (!snap->loading && result == ISC_R_SUCCESS) {
+			result = isc_stdio_flush(snap->fp);
+		}
+		if (!snap->loading && result == ISC_R_SUCCESS) {
+			result = isc_stdio_sync(snap->fp);
+		}
+		tresult = isc_stdio_close(snap->fp);
+		if (result == ISC_R_SUCCESS) {
+			result = tresult;
+		}
+	}
+	if (snap->tmpname != NULL) {
+		if (snap->fp != NULL && result == ISC_R_SUCCESS) {
+			result = isc_file_rename(snap->tmpname, snap->filename);
+		}
+		if (result != ISC_R_SUCCESS) {
+			(void)isc_file_remove(snap->tmpname);
+		}
+		isc_mem_free(mctx, snap->tmpname);
+	}
+	if (snap->wire != NULL) {
+		isc_buffer_free(&snap->wire);
+	}
+	if (snap->buffer != NULL) {
+		isc_buffer_free(&snap->buffer);
+	}
+	isc_mem_free(mctx, snap->filename);
+	dns_db_detach(&snap->db);
+	isc_mem_put(mctx, snap, sizeof(*snap));
+
+	return (result);
+}
+
+static void
+snapshot_log(dns_cache_t *cache, cache_snapshot_t *snap,
+	     isc_result_t result) {
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE, DNS_LOGMODULE_CACHE,
+		      result == ISC_R_SUCCESS ? ISC_LOG_INFO : ISC_LOG_WARNING,
+		      "cache '%s': %s %u rdatasets %s '%s': %s", cache->name,
+		      snap->loading ? "loaded" : "dumped", snap->count,
+		      snap->loading ? "from" : "to", snap->filename,
+		      isc_result_totext(result));
+}
+
+/*
+ * Load or dump the next increment of a cache snapshot.
+ */
+static void
+snapshot_action(isc_task_t *task, isc_event_t *event) {
+	cache_cleaner_t *cleaner = event->ev_sender;
+	cache_snapshot_t *snap = event->ev_arg;
+	dns_cache_t *cache = cleaner->cache;
+	isc_result_t result;
+
+	INSIST(task == cleaner->task);
+	INSIST(event->ev_type == DNS_EVENT_CACHESNAPSHOT);
+	INSIST(snap == cleaner->snapshot);
+
+	if (snap->loading) {
+		result = snapshot_load(snap, DNS_CACHE_SNAPSHOTINCREMENT);
+	} else {
+		result = snapshot_dump(snap, DNS_CACHE_SNAPSHOTINCREMENT);
+	}
+	if (result == DNS_R_CONTINUE) {
+		isc_task_send(task, &event);
+		return;
+	}
+
+	isc_event_free(&event);
+	cleaner->snapshot = NULL;
+
+	/*
+	 * Once the cache is being shut down, its final dump supersedes
+	 * this one.
+	 */
+	LOCK(&cache->filelock);
+	if (snap->loading) {
+		cache->loading = false;
+	} else if (result == ISC_R_SUCCESS &&
+		   isc_refcount_current(&cache->references) == 0) {
+		result = ISC_R_SHUTTINGDOWN;
+	}
+	snapshot_log(cache, snap, result);
+	result = snapshot_destroy(&snap, result);
+	UNLOCK(&cache->filelock);
+}
+
+/*
+ * Start a background dump of the cache on the cleaner task.
+ */
+static void
+snapshot_dump_action(isc_task_t *task, isc_event_t *event) {
+	cache_cleaner_t *cleaner = event->ev_arg;
+	dns_cache_t *cache = cleaner->cache;
+	isc_result_t result = ISC_R_SUCCESS;
+
+	INSIST(task == cleaner->task);
+	INSIST(event->ev_type == ISC_TIMEREVENT_TICK);
+
+	isc_event_free(&event);
+
+	if (cleaner->snapshot != NULL) {
+		/* Still loading or dumping. */
+		return;
+	}
+
+	LOCK(&cache->filelock);
+	if (cache->filename != NULL) {
+		result = snapshot_create(cache, cache->filename, false,
+					 &cleaner->snapshot);
+	}
+	UNLOCK(&cache->filelock);
+
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE,
+			      DNS_LOGMODULE_CACHE, ISC_LOG_WARNING,
+			      "cache '%s': unable to start dump: %s",
+			      cache->name, isc_result_totext(result));
+	} else if (cleaner->snapshot != NULL) {
+		event = isc_event_allocate(cache->mctx, cleaner,
+					   DNS_EVENT_CACHESNAPSHOT,
+					   snapshot_action, cleaner->snapshot,
+					   sizeof(isc_event_t));
+		isc_task_send(task, &event);
+	}
+}
+
+/*
+ * Abandon any load or dump in progress.  Called from the cleaner task.
+ */
+static void
+snapshot_cancel(cache_cleaner_t *cleaner) {
+	dns_cache_t *cache = cleaner->cache;
+
+	(void)isc_task_purge(cleaner->task, cleaner, DNS_EVENT_CACHESNAPSHOT,
+			     NULL);
+
+	LOCK(&cache->filelock);
+	if (cleaner->dump_timer != NULL) {
+		isc_timer_detach(&cleaner->dump_timer);
+	}
+	if (cleaner->snapshot != NULL) {
+		if (cleaner->snapshot->loading) {
+			cache->loading = false;
+		}
+		(void)snapshot_destroy(&cleaner->snapshot, ISC_R_CANCELED);
+	}
+	UNLOCK(&cache->filelock);
+}
+
+static isc_result_t
+cache_load(dns_cache_t *cache, const char *filename) {
+	cache_snapshot_t *snap = NULL;
+	isc_result_t result;
+
+	result = snapshot_create(cache, filename, true, &snap);
+	if (result == DNS_R_FORMERR) {
+		/*
+		 * Not a snapshot; this may be a cache file written
+		 * in master file format by an older version.
+		 */
+		return (dns_db_load(cache->db, filename, dns_masterformat_text,
+				    0));
+	} else if (result != ISC_R_SUCCESS) {
+		return (result);
 	}
 
+	do {
+		result = snapshot_load(snap, UINT_MAX);
+	} while (result == DNS_R_CONTINUE);
+	snapshot_log(cache, snap, result);
+
+	return (snapshot_destroy(&snap, result));
+}
+
+isc_result_t
+dns_cache_load(dns_cache_t *cache) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	REQUIRE(VALID_CACHE(cache));
+
 	LOCK(&cache->filelock);
-	result = dns_db_load(cache->db, cache->filename, dns_masterformat_text,
-			     0);
+	if (cache->filename != NULL) {
+		result = cache_load(cache, cache->filename);
+	}
 	UNLOCK(&cache->filelock);
 
 	return (result);
 }
 
+isc_result_t
+dns_cache_asyncload(dns_cache_t *cache) {
+	cache_cleaner_t *cleaner;
+	isc_event_t *event;
+	isc_result_t result = ISC_R_SUCCESS;
+
+	REQUIRE(VALID_CACHE(cache));
+
+	cleaner = &cache->cleaner;
+	if (cleaner->task == NULL) {
+		result = dns_cache_load(cache);
+		if (result == ISC_R_FILENOTFOUND) {
+			result = ISC_R_SUCCESS;
+		}
+		return (result);
+	}
+
+	LOCK(&cache->filelock);
+	if (cache->filename == NULL || cache->loading) {
+		goto unlock;
+	}
+
+	/*
+	 * The cleaner task owns cleaner->snapshot; it can't be used
+	 * before the task has been given something to do.
+	 */
+	INSIST(cleaner->snapshot == NULL);
+
+	result = snapshot_create(cache, cache->filename, true,
+				 &cleaner->snapshot);
+	if (result == ISC_R_FILENOTFOUND) {
+		result = ISC_R_SUCCESS;
+	} else if (result == DNS_R_FORMERR) {
+		result = dns_db_load(cache->db, cache->filename,
+				     dns_masterformat_text, 0);
+	} else if (result == ISC_R_SUCCESS) {
+		cache->loading = true;
+		event = isc_event_allocate(cache->mctx, cleaner,
+					   DNS_EVENT_CACHESNAPSHOT,
+					   snapshot_action, cleaner->snapshot,
+					   sizeof(isc_event_t));
+		isc_task_send(cleaner->task, &event);
+	}
+
+unlock:
+	UNLOCK(&cache->filelock);
+	return (result);
+}
+
 isc_result_t
 dns_cache_dump(dns_cache_t *cache) {
+	cache_snapshot_t *snap = NULL;
 	isc_result_t result;
 
 	REQUIRE(VALID_CACHE(cache));
 
+	LOCK(&cache->filelock);
 	if (cache->filename == NULL) {
-		return (ISC_R_SUCCESS);
+		result = ISC_R_SUCCESS;
+		goto unlock;
+	}
+
+	/*
+	 * Don't replace a snapshot that hasn't been fully loaded yet
+	 * with what has been loaded so far.
+	 */
+	if (cache->loading) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE,
+			      DNS_LOGMODULE_CACHE, ISC_LOG_INFO,
+			      "cache '%s': not dumped to '%s', which is "
+			      "still being loaded",
+			      cache->name, cache->filename);
+		result = ISC_R_SUCCESS;
+		goto unlock;
 	}
 
+	result = snapshot_create(cache, cache->filename, false, &snap);
+	if (result != ISC_R_SUCCESS) {
+		goto unlock;
+	}
+	do {
+		result = snapshot_dump(snap, UINT_MAX);
+	} while (result == DNS_R_CONTINUE);
+	snapshot_log(cache, snap, result);
+	result = snapshot_destroy(&snap, result);
+
+unlock:
+	UNLOCK(&cache->filelock);
+	return (result);
+}
+
+isc_result_t
+dns_cache_setdumpinterval(dns_cache_t *cache, uint32_t interval) {
+	cache_cleaner_t *cleaner;
+	isc_interval_t i;
+	isc_result_t result;
+
+	REQUIRE(VALID_CACHE(cache));
+
+	cleaner = &cache->cleaner;
+	if (cleaner->task == NULL) {
+		return (ISC_R_NOTIMPLEMENTED);
+	}
+
+	isc_interval_set(&i, interval, 0);
 	LOCK(&cache->filelock);
-	result = dns_master_dump(cache->mctx, cache->db, NULL,
-				 &dns_master_style_cache, cache->filename,
-				 dns_masterformat_text, NULL);
+	if (cleaner->dump_timer == NULL && interval != 0) {
+		result = isc_timer_create(cleaner->timermgr,
+					  isc_timertype_ticker, NULL, &i,
+					  cleaner->task, snapshot_dump_action,
+					  cleaner, &cleaner->dump_timer);
+	} else if (cleaner->dump_timer != NULL) {
+		result = isc_timer_reset(cleaner->dump_timer,
+					 interval != 0 ? isc_timertype_ticker
+						       : isc_timertype_inactive,
+					 NULL, &i, true);
+	} else {
+		result = ISC_R_SUCCESS;
+	}
 	UNLOCK(&cache->filelock);
+
 	return (result);
 }
 
@@ -533,6 +1510,10 @@ cache_cleaner_init(dns_cache_t *cache, isc_taskmgr_t *taskmgr,
 	cleaner->task = NULL;
 	cleaner->resched_event = NULL;
 	cleaner->overmem_event = NULL;
+	cleaner->sweep_timer = NULL;
+	cleaner->timermgr = timermgr;
+	cleaner->dump_timer = NULL;
+	cleaner->snapshot = NULL;
 
 	result = dns_db_createiterator(cleaner->cache->db, false,
 				       &cleaner->iterator);
@@ -563,6 +1544,30 @@ cache_cleaner_init(dns_cache_t *cache, isc_taskmgr_t *taskmgr,
 			goto cleanup;
 		}
 
+		/*
+		 * RBT-type cache DB has its own mechanism of cache cleaning
+		 * and doesn't need the control of the generic cleaner; it
+		 * only needs to be swept for expired data periodically.
+		 */
+		if (strcmp(cache->db_type, "rbt") == 0) {
+			isc_interval_t interval;
+
+			isc_interval_set(&interval, DNS_CACHE_SWEEPINTERVAL,
+					 0);
+			result = isc_timer_create(
+				timermgr, isc_timertype_ticker, NULL, &interval,
+				cleaner->task, expiry_sweep_action, cleaner,
+				&cleaner->sweep_timer);
+			if (result != ISC_R_SUCCESS) {
+				UNEXPECTED_ERROR(__FILE__, __LINE__,
+						 "cache cleaner: "
+						 "isc_timer_create() failed: %s",
+						 dns_result_totext(result));
+				goto cleanup;
+			}
+			return (ISC_R_SUCCESS);
+		}
+
 		cleaner->resched_event = isc_event_allocate(
 			cache->mctx, cleaner, DNS_EVENT_CACHECLEAN,
 			incremental_cleaning_action, cleaner,
@@ -838,6 +1843,45 @@ incremental_cleaning_action(isc_task_t *task, isc_event_t *event) {
 	return;
 }
 
+/*
+ * Remove a bounded amount of expired data from an RBT-type cache.
+ */
+static void
+expiry_sweep_action(isc_task_t *task, isc_event_t *event) {
+	cache_cleaner_t *cleaner = event->ev_arg;
+	dns_cache_t *cache = cleaner->cache;
+	dns_db_t *db = NULL;
+	unsigned int reclaimable = 0;
+	isc_result_t result;
+
+	UNUSED(task);
+
+	INSIST(task == cleaner->task);
+	INSIST(event->ev_type == ISC_TIMEREVENT_TICK);
+
+	isc_event_free(&event);
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_expiredata(db, 0, DNS_CACHE_SWEEPBUDGET, &reclaimable);
+	dns_db_detach(&db);
+	if (result != ISC_R_SUCCESS) {
+		return;
+	}
+
+	isc_stats_increment(cache->stats, dns_cachestatscounter_sweeps);
+	isc_stats_set(cache->stats, reclaimable,
+		      dns_cachestatscounter_reclaimable);
+
+	if (reclaimable != 0) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_DATABASE,
+			      DNS_LOGMODULE_CACHE, ISC_LOG_DEBUG(1),
+			      "cache cleaner: %u expired entries left, "
+			      "mem inuse %lu",
+			      reclaimable,
+			      (unsigned long)isc_mem_inuse(cache->mctx));
+	}
+}
+
 /*
  * Do immediate cleaning.
  */
@@ -1018,10 +2062,18 @@ cleaner_shutdown_action(isc_task_t *task, isc_event_t *event) {
 
 	/* Make sure we don't reschedule anymore. */
 	(void)isc_task_purge(task, NULL, DNS_EVENT_CACHECLEAN, NULL);
+	if (cache->cleaner.sweep_timer != NULL) {
+		isc_timer_detach(&cache->cleaner.sweep_timer);
+	}
+	snapshot_cancel(&cache->cleaner);
 
-	INSIST(isc_refcount_decrement(&cache->live_tasks) == 1);
-
-	cache_free(cache);
+	/*
+	 * The task manager may shut the task down while the cache is
+	 * still in use; dns_cache_detach() frees it in that case.
+	 */
+	if (isc_refcount_decrement(&cache->live_tasks) == 1) {
+		cache_free(cache);
+	}
 }
 
 isc_result_t
@@ -1315,6 +2367,11 @@ dns_cache_dumpstats(dns_cache_t *cache, FILE *fp) {
 	fprintf(fp, "%20" PRIu64 " %s\n",
 		values[dns_cachestatscounter_deletettl],
 		"cache records deleted due to TTL expiration");
+	fprintf(fp, "%20" PRIu64 " %s\n", values[dns_cachestatscounter_sweeps],
+		"cache expiry sweeps");
+	fprintf(fp, "%20" PRIu64 " %s\n",
+		values[dns_cachestatscounter_reclaimable],
+		"cache records expired but not yet deleted");
 	fprintf(fp, "%20u %s\n", dns_db_nodecount(cache->db),
 		"cache database nodes");
 	fprintf(fp, "%20" PRIu64 " %s\n", (uint64_t)dns_db_hashsize(cache->db),
@@ -1381,6 +2438,10 @@ dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 			writer));
 	TRY0(renderstat("DeleteTTL", values[dns_cachestatscounter_deletettl],
 			writer));
+	TRY0(renderstat("ExpirySweeps", values[dns_cachestatscounter_sweeps],
+			writer));
+	TRY0(renderstat("Reclaimable",
+			values[dns_cachestatscounter_reclaimable], writer));
 
 	TRY0(renderstat("CacheNodes", dns_db_nodecount(cache->db), writer));
 	TRY0(renderstat("CacheBuckets", dns_db_hashsize(cache->db), writer));
@@ -1443,6 +2504,14 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "DeleteTTL", obj);
 
+	obj = json_object_new_int64(values[dns_cachestatscounter_sweeps]);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "ExpirySweeps", obj);
+
+	obj = json_object_new_int64(values[dns_cachestatscounter_reclaimable]);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "Reclaimable", obj);
+
 	obj = json_object_new_int64(dns_db_nodecount(cache->db));
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "CacheNodes", obj);
@@ -26,6 +26,7 @@
 #include <dns/catz.h>
 #include <dns/dbiterator.h>
 #include <dns/events.h>
+#include <dns/journal.h>
 #include <dns/rdatasetiter.h>
 #include <dns/view.h>
 #include <dns/zone.h>
@@ -45,6 +46,12 @@ struct dns_catz_entry {
 	unsigned int magic;
 	dns_name_t name;
 	dns_catz_options_t opts;
+	/*
+	 * Owner names of the suboption records of this member, relative
+	 * to its 'mhash' label; an incremental update re-reads them.
+	 */
+	dns_name_t *optnames;
+	unsigned int noptnames;
 	isc_refcount_t refs;
 };
 
@@ -77,6 +84,15 @@ struct dns_catz_zone {
 	bool active;
 	bool db_registered;
 
+	/*
+	 * Journal of the catalog zone's database and the serial of the
+	 * last version processed; when 'fullupdate' is false, only the
+	 * members changed in the journal since then are looked at.
+	 */
+	char *journal;
+	uint32_t serial;
+	bool fullupdate;
+
 	isc_refcount_t refs;
 };
 
@@ -218,12 +234,44 @@ dns_catz_entry_new(isc_mem_t *mctx, const dns_name_t *domain,
 	}
 
 	dns_catz_options_init(&nentry->opts);
+	nentry->optnames = NULL;
+	nentry->noptnames = 0;
 	isc_refcount_init(&nentry->refs, 1);
 	nentry->magic = DNS_CATZ_ENTRY_MAGIC;
 	*nentryp = nentry;
 	return (ISC_R_SUCCESS);
 }
 
+/*
+ * Remember that the suboption records at 'name' (relative to the
+ * member's mhash label) belong to 'entry'.
+ */
+static void
+catz_entry_addoptname(dns_catz_zone_t *zone, dns_catz_entry_t *entry,
+		      const dns_name_t *name) {
+	isc_mem_t *mctx = zone->catzs->mctx;
+	dns_name_t *optnames;
+
+	for (unsigned int i = 0; i < entry->noptnames; i++) {
+		if (dns_name_equal(&entry->optnames[i], name)) {
+			return;
+		}
+	}
+
+	optnames = isc_mem_get(mctx,
+			       (entry->noptnames + 1) * sizeof(dns_name_t));
+	if (entry->optnames != NULL) {
+		memmove(optnames, entry->optnames,
+			entry->noptnames * sizeof(dns_name_t));
+		isc_mem_put(mctx, entry->optnames,
+			    entry->noptnames * sizeof(dns_name_t));
+	}
+	dns_name_init(&optnames[entry->noptnames], NULL);
+	dns_name_dup(name, mctx, &optnames[entry->noptnames]);
+	entry->optnames = optnames;
+	entry->noptnames++;
+}
+
 dns_name_t *
 dns_catz_entry_getname(dns_catz_entry_t *entry) {
 	REQUIRE(DNS_CATZ_ENTRY_VALID(entry));
@@ -249,6 +297,12 @@ dns_catz_entry_copy(dns_catz_zone_t *zone, const dns_catz_entry_t *entry,
 				       &nentry->opts);
 	if (result != ISC_R_SUCCESS) {
 		dns_catz_entry_detach(zone, &nentry);
+		*nentryp = nentry;
+		return (result);
+	}
+
+	for (unsigned int i = 0; i < entry->noptnames; i++) {
+		catz_entry_addoptname(zone, nentry, &entry->optnames[i]);
 	}
 
 	*nentryp = nentry;
@@ -282,6 +336,13 @@ dns_catz_entry_detach(dns_catz_zone_t *zone, dns_catz_entry_t **entryp) {
 		if (dns_name_dynamic(&entry->name)) {
 			dns_name_free(&entry->name, mctx);
 		}
+		if (entry->optnames != NULL) {
+			for (unsigned int i = 0; i < entry->noptnames; i++) {
+				dns_name_free(&entry->optnames[i], mctx);
+			}
+			isc_mem_put(mctx, entry->optnames,
+				    entry->noptnames * sizeof(dns_name_t));
+		}
 		isc_mem_put(mctx, entry, sizeof(dns_catz_entry_t));
 	}
 }
@@ -367,27 +428,102 @@ dns_catz_zone_resetdefoptions(dns_catz_zone_t *zone) {
 
 	dns_catz_options_free(&zone->defoptions, zone->catzs->mctx);
 	dns_catz_options_init(&zone->defoptions);
+	/* The members have to be rebuilt with the new defaults. */
+	zone->fullupdate = true;
+}
+
+static void
+catz_changed_add(dns_catz_zone_t *zone, dns_catz_changedlist_t *changes,
+		 dns_catz_op_t op, dns_catz_entry_t *entry) {
+	dns_catz_changed_t *changed;
+
+	changed = isc_mem_get(zone->catzs->mctx, sizeof(*changed));
+	changed->op = op;
+	changed->entry = NULL;
+	dns_catz_entry_attach(entry, &changed->entry);
+	ISC_LINK_INIT(changed, link);
+	ISC_LIST_APPEND(*changes, changed, link);
+}
+
+/*
+ * Hand the member zone changes made by one update of catalog 'zone' to
+ * named, in a single batch if it accepts one, and free them.
+ */
+static void
+catz_apply_changes(dns_catz_zone_t *zone, dns_catz_changedlist_t *changes) {
+	dns_catz_zones_t *catzs = zone->catzs;
+	dns_catz_zonemodmethods_t *zmm = catzs->zmm;
+	dns_catz_changed_t *changed;
+	isc_result_t result = ISC_R_SUCCESS;
+	char czname[DNS_NAME_FORMATSIZE];
+	char zname[DNS_NAME_FORMATSIZE];
+
+	if (ISC_LIST_EMPTY(*changes)) {
+		return;
+	}
+
+	dns_name_format(&zone->name, czname, DNS_NAME_FORMATSIZE);
+
+	if (zmm->chgzones != NULL) {
+		result = zmm->chgzones(changes, zone, catzs->view,
+				       catzs->taskmgr, zmm->udata);
+	}
+
+	while ((changed = ISC_LIST_HEAD(*changes)) != NULL) {
+		dns_catz_zoneop_fn_t zoneop = NULL;
+		const char *what = NULL;
+
+		ISC_LIST_UNLINK(*changes, changed, link);
+		switch (changed->op) {
+		case dns_catz_op_add:
+			zoneop = zmm->addzone;
+			what = "adding";
+			break;
+		case dns_catz_op_mod:
+			zoneop = zmm->modzone;
+			what = "modifying";
+			break;
+		case dns_catz_op_del:
+			zoneop = zmm->delzone;
+			what = "deleting";
+			break;
+		default:
+			INSIST(0);
+			ISC_UNREACHABLE();
+		}
+		if (zmm->chgzones == NULL) {
+			result = zoneop(changed->entry, zone, catzs->view,
+					catzs->taskmgr, zmm->udata);
+		}
+
+		dns_name_format(&changed->entry->name, zname,
+				DNS_NAME_FORMATSIZE);
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "catz: %s zone '%s' from catalog '%s' - %s", what,
+			      zname, czname, isc_result_totext(result));
+
+		dns_catz_entry_detach(zone, &changed->entry);
+		isc_mem_put(catzs->mctx, changed, sizeof(*changed));
+	}
 }
 
 isc_result_t
 dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 	isc_result_t result;
 	isc_ht_iter_t *iter1 = NULL, *iter2 = NULL;
-	isc_ht_iter_t *iteradd = NULL, *itermod = NULL;
-	isc_ht_t *toadd = NULL, *tomod = NULL;
+	dns_catz_changedlist_t changes, dels;
 	bool delcur = false;
 	char czname[DNS_NAME_FORMATSIZE];
 	char zname[DNS_NAME_FORMATSIZE];
-	dns_catz_zoneop_fn_t addzone, modzone, delzone;
 
 	REQUIRE(DNS_CATZ_ZONE_VALID(newzone));
 	REQUIRE(DNS_CATZ_ZONE_VALID(target));
 
 	/* TODO verify the new zone first! */
 
-	addzone = target->catzs->zmm->addzone;
-	modzone = target->catzs->zmm->modzone;
-	delzone = target->catzs->zmm->delzone;
+	ISC_LIST_INIT(changes);
+	ISC_LIST_INIT(dels);
 
 	/* Copy zoneoptions from newzone into target. */
 
@@ -399,16 +535,6 @@ dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 
 	dns_name_format(&target->name, czname, DNS_NAME_FORMATSIZE);
 
-	result = isc_ht_init(&toadd, target->catzs->mctx, 16);
-	if (result != ISC_R_SUCCESS) {
-		goto cleanup;
-	}
-
-	result = isc_ht_init(&tomod, target->catzs->mctx, 16);
-	if (result != ISC_R_SUCCESS) {
-		goto cleanup;
-	}
-
 	result = isc_ht_iter_create(newzone->entries, &iter1);
 	if (result != ISC_R_SUCCESS) {
 		goto cleanup;
@@ -419,20 +545,6 @@ dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 		goto cleanup;
 	}
 
-	/*
-	 * We can create those iterators now, even though toadd and tomod are
-	 * empty
-	 */
-	result = isc_ht_iter_create(toadd, &iteradd);
-	if (result != ISC_R_SUCCESS) {
-		goto cleanup;
-	}
-
-	result = isc_ht_iter_create(tomod, &itermod);
-	if (result != ISC_R_SUCCESS) {
-		goto cleanup;
-	}
-
 	/*
 	 * First - walk the new zone and find all nodes that are not in the
 	 * old zone, or are in both zones and are modified.
@@ -474,32 +586,14 @@ dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 		result = isc_ht_find(target->entries, key, (uint32_t)keysize,
 				     (void **)&oentry);
 		if (result != ISC_R_SUCCESS) {
-			result = isc_ht_add(toadd, key, (uint32_t)keysize,
-					    nentry);
-			if (result != ISC_R_SUCCESS) {
-				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-					      DNS_LOGMODULE_MASTER,
-					      ISC_LOG_ERROR,
-					      "catz: error adding zone '%s' "
-					      "from catalog '%s' - %s",
-					      zname, czname,
-					      isc_result_totext(result));
-			}
+			catz_changed_add(target, &changes, dns_catz_op_add,
+					 nentry);
 			continue;
 		}
 
 		if (dns_catz_entry_cmp(oentry, nentry) != true) {
-			result = isc_ht_add(tomod, key, (uint32_t)keysize,
-					    nentry);
-			if (result != ISC_R_SUCCESS) {
-				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-					      DNS_LOGMODULE_MASTER,
-					      ISC_LOG_ERROR,
-					      "catz: error modifying zone '%s' "
-					      "from catalog '%s' - %s",
-					      zname, czname,
-					      isc_result_totext(result));
-			}
+			catz_changed_add(target, &changes, dns_catz_op_mod,
+					 nentry);
 		}
 		dns_catz_entry_detach(target, &oentry);
 		result = isc_ht_delete(target->entries, key, (uint32_t)keysize);
@@ -517,14 +611,7 @@ dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 		dns_catz_entry_t *entry = NULL;
 		isc_ht_iter_current(iter2, (void **)&entry);
 
-		dns_name_format(&entry->name, zname, DNS_NAME_FORMATSIZE);
-		result = delzone(entry, target, target->catzs->view,
-				 target->catzs->taskmgr,
-				 target->catzs->zmm->udata);
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-			      "catz: deleting zone '%s' from catalog '%s' - %s",
-			      zname, czname, isc_result_totext(result));
+		catz_changed_add(target, &dels, dns_catz_op_del, entry);
 		dns_catz_entry_detach(target, &entry);
 	}
 	RUNTIME_CHECK(result == ISC_R_NOMORE);
@@ -533,43 +620,13 @@ dns_catz_zones_merge(dns_catz_zone_t *target, dns_catz_zone_t *newzone) {
 	INSIST(isc_ht_count(target->entries) == 0);
 	isc_ht_destroy(&target->entries);
 
-	for (result = isc_ht_iter_first(iteradd); result == ISC_R_SUCCESS;
-	     result = isc_ht_iter_delcurrent_next(iteradd))
-	{
-		dns_catz_entry_t *entry = NULL;
-		isc_ht_iter_current(iteradd, (void **)&entry);
-
-		dns_name_format(&entry->name, zname, DNS_NAME_FORMATSIZE);
-		result = addzone(entry, target, target->catzs->view,
-				 target->catzs->taskmgr,
-				 target->catzs->zmm->udata);
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-			      "catz: adding zone '%s' from catalog "
-			      "'%s' - %s",
-			      zname, czname, isc_result_totext(result));
-	}
-
-	for (result = isc_ht_iter_first(itermod); result == ISC_R_SUCCESS;
-	     result = isc_ht_iter_delcurrent_next(itermod))
-	{
-		dns_catz_entry_t *entry = NULL;
-		isc_ht_iter_current(itermod, (void **)&entry);
-
-		dns_name_format(&entry->name, zname, DNS_NAME_FORMATSIZE);
-		result = modzone(entry, target, target->catzs->view,
-				 target->catzs->taskmgr,
-				 target->catzs->zmm->udata);
-		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
-			      "catz: modifying zone '%s' from catalog "
-			      "'%s' - %s",
-			      zname, czname, isc_result_totext(result));
-	}
-
 	target->entries = newzone->entries;
 	newzone->entries = NULL;
 
+	/* Deletions go first, a deleted zone may be added back. */
+	ISC_LIST_APPENDLIST(dels, changes, link);
+	catz_apply_changes(target, &dels);
+
 	result = ISC_R_SUCCESS;
 
 cleanup:
@@ -579,21 +636,89 @@ cleanup:
 	if (iter2 != NULL) {
 		isc_ht_iter_destroy(&iter2);
 	}
-	if (iteradd != NULL) {
-		isc_ht_iter_destroy(&iteradd);
-	}
-	if (itermod != NULL) {
-		isc_ht_iter_destroy(&itermod);
-	}
-	if (toadd != NULL) {
-		isc_ht_destroy(&toadd);
-	}
-	if (tomod != NULL) {
-		isc_ht_destroy(&tomod);
-	}
 	return (result);
 }
 
+/*
+ * Merge the members of 'newzone', re-read for the mhash labels that are
+ * the keys of 'changed', into 'target'; all the other members of
+ * 'target' stay as they are.
+ */
+static void
+catz_merge_changed(dns_catz_zone_t *target, dns_catz_zone_t *newzone,
+		   isc_ht_t *changed) {
+	isc_result_t result;
+	isc_ht_iter_t *iter = NULL;
+	dns_catz_changedlist_t changes, dels;
+
+	ISC_LIST_INIT(changes);
+	ISC_LIST_INIT(dels);
+
+	result = isc_ht_iter_create(changed, &iter);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	for (result = isc_ht_iter_first(iter); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(iter))
+	{
+		dns_catz_entry_t *nentry = NULL;
+		dns_catz_entry_t *oentry = NULL;
+		unsigned char *key = NULL;
+		size_t keysize;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+
+		(void)isc_ht_find(newzone->entries, key, (uint32_t)keysize,
+				  (void **)&nentry);
+		(void)isc_ht_find(target->entries, key, (uint32_t)keysize,
+				  (void **)&oentry);
+
+		/* Spurious record that came from suboption without main. */
+		if (nentry != NULL && dns_name_countlabels(&nentry->name) == 0)
+		{
+			nentry = NULL;
+		}
+
+		if (oentry != NULL) {
+			if (nentry == NULL) {
+				catz_changed_add(target, &dels,
+						 dns_catz_op_del, oentry);
+			}
+			result = isc_ht_delete(target->entries, key,
+					       (uint32_t)keysize);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		}
+
+		if (nentry != NULL) {
+			dns_catz_options_setdefault(target->catzs->mctx,
+						    &target->zoneoptions,
+						    &nentry->opts);
+			if (oentry == NULL) {
+				catz_changed_add(target, &changes,
+						 dns_catz_op_add, nentry);
+			} else if (!dns_catz_entry_cmp(oentry, nentry)) {
+				catz_changed_add(target, &changes,
+						 dns_catz_op_mod, nentry);
+			}
+
+			/* Move the new entry over to 'target'. */
+			result = isc_ht_delete(newzone->entries, key,
+					       (uint32_t)keysize);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+			result = isc_ht_add(target->entries, key,
+					    (uint32_t)keysize, nentry);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		}
+
+		if (oentry != NULL) {
+			dns_catz_entry_detach(target, &oentry);
+		}
+	}
+	RUNTIME_CHECK(result == ISC_R_NOMORE);
+	isc_ht_iter_destroy(&iter);
+
+	ISC_LIST_APPENDLIST(dels, changes, link);
+	catz_apply_changes(target, &dels);
+}
+
 isc_result_t
 dns_catz_new_zones(dns_catz_zones_t **catzsp, dns_catz_zonemodmethods_t *zmm,
 		   isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
@@ -691,6 +816,9 @@ dns_catz_new_zone(dns_catz_zones_t *catzs, dns_catz_zone_t **zonep,
 	new_zone->active = true;
 	new_zone->db_registered = false;
 	new_zone->version = (uint32_t)(-1);
+	new_zone->journal = NULL;
+	new_zone->serial = 0;
+	new_zone->fullupdate = true;
 	isc_refcount_init(&new_zone->refs, 1);
 	new_zone->magic = DNS_CATZ_ZONE_MAGIC;
 
@@ -831,6 +959,9 @@ dns_catz_zone_detach(dns_catz_zone_t **zonep) {
 			dns_db_detach(&zone->db);
 		}
 
+		if (zone->journal != NULL) {
+			isc_mem_free(mctx, zone->journal);
+		}
 		dns_name_free(&zone->name, mctx);
 		dns_catz_options_free(&zone->defoptions, mctx);
 		dns_catz_options_free(&zone->zoneoptions, mctx);
@@ -917,6 +1048,8 @@ catz_process_zones(dns_catz_zone_t *zone, dns_rdataset_t *value,
 		   dns_name_t *name) {
 	dns_label_t mhash;
 	dns_name_t opt;
+	dns_fixedname_t fixed;
+	dns_name_t *lname;
 
 	REQUIRE(DNS_CATZ_ZONE_VALID(zone));
 	REQUIRE(DNS_RDATASET_VALID(value));
@@ -930,6 +1063,14 @@ catz_process_zones(dns_catz_zone_t *zone, dns_rdataset_t *value,
 		return (ISC_R_FAILURE);
 	}
 
+	/*
+	 * The members are keyed by the lower-cased mhash label, so that
+	 * names read from the journal find the same entries.
+	 */
+	lname = dns_fixedname_initname(&fixed);
+	dns_name_downcase(name, lname, NULL);
+	name = lname;
+
 	dns_name_getlabel(name, name->labels - 1, &mhash);
 
 	if (name->labels == 1) {
@@ -1360,6 +1501,7 @@ catz_process_zones_suboption(dns_catz_zone_t *zone, dns_rdataset_t *value,
 			return (result);
 		}
 	}
+	catz_entry_addoptname(zone, entry, name);
 
 	dns_name_init(&prefix, NULL);
 	dns_name_split(name, 1, &prefix, NULL);
@@ -1699,6 +1841,30 @@ cleanup:
 	return (result);
 }
 
+void
+dns_catz_setjournal(dns_catz_zones_t *catzs, const dns_name_t *name,
+		    const char *journal) {
+	isc_result_t result;
+	dns_catz_zone_t *zone = NULL;
+
+	REQUIRE(DNS_CATZ_ZONES_VALID(catzs));
+	REQUIRE(ISC_MAGIC_VALID(name, DNS_NAME_MAGIC));
+
+	LOCK(&catzs->lock);
+	result = isc_ht_find(catzs->zones, name->ndata, name->length,
+			     (void **)&zone);
+	if (result == ISC_R_SUCCESS) {
+		if (zone->journal != NULL) {
+			isc_mem_free(catzs->mctx, zone->journal);
+			zone->journal = NULL;
+		}
+		if (journal != NULL) {
+			zone->journal = isc_mem_strdup(catzs->mctx, journal);
+		}
+	}
+	UNLOCK(&catzs->lock);
+}
+
 void
 dns_catz_update_taskaction(isc_task_t *task, isc_event_t *event) {
 	isc_result_t result;
@@ -1753,6 +1919,8 @@ dns_catz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 		 * registered at the end of update_from_db
 		 */
 		zone->db_registered = false;
+		/* The journal does not describe the new DB. */
+		zone->fullupdate = true;
 	}
 	if (zone->db == NULL) {
 		dns_db_attach(db, &zone->db);
@@ -1807,6 +1975,299 @@ cleanup:
 	return (result);
 }
 
+/*
+ * Process all the rdatasets of 'node', named 'name', in version 'version'
+ * of 'db' into 'zone'.
+ */
+static isc_result_t
+catz_process_node(dns_catz_zones_t *catzs, dns_catz_zone_t *zone, dns_db_t *db,
+		  dns_dbversion_t *version, dns_dbnode_t *node,
+		  dns_name_t *name) {
+	isc_result_t result;
+	dns_rdatasetiter_t *rdsiter = NULL;
+	dns_rdataset_t rdataset;
+
+	result = dns_db_allrdatasets(db, node, version, 0, &rdsiter);
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+			      "catz: failed to fetch rrdatasets - %s",
+			      isc_result_totext(result));
+		return (result);
+	}
+
+	dns_rdataset_init(&rdataset);
+	result = dns_rdatasetiter_first(rdsiter);
+	while (result == ISC_R_SUCCESS) {
+		dns_rdatasetiter_current(rdsiter, &rdataset);
+		result = dns_catz_update_process(catzs, zone, name, &rdataset);
+		if (result != ISC_R_SUCCESS) {
+			char cname[DNS_NAME_FORMATSIZE];
+			char typebuf[DNS_RDATATYPE_FORMATSIZE];
+			char classbuf[DNS_RDATACLASS_FORMATSIZE];
+
+			dns_name_format(name, cname, DNS_NAME_FORMATSIZE);
+			dns_rdataclass_format(rdataset.rdclass, classbuf,
+					      sizeof(classbuf));
+			dns_rdatatype_format(rdataset.type, typebuf,
+					     sizeof(typebuf));
+			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+				      DNS_LOGMODULE_MASTER, ISC_LOG_WARNING,
+				      "catz: unknown record in catalog "
+				      "zone - %s %s %s(%s) - ignoring",
+				      cname, classbuf, typebuf,
+				      isc_result_totext(result));
+		}
+		dns_rdataset_disassociate(&rdataset);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		result = dns_rdatasetiter_next(rdsiter);
+	}
+
+	dns_rdatasetiter_destroy(&rdsiter);
+
+	return (ISC_R_SUCCESS);
+}
+
+static isc_result_t
+catz_addname(isc_ht_t *names, const dns_name_t *name) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *lname = dns_fixedname_initname(&fixed);
+
+	dns_name_downcase(name, lname, NULL);
+	result = isc_ht_add(names, lname->ndata, lname->length, names);
+	if (result == ISC_R_EXISTS) {
+		result = ISC_R_SUCCESS;
+	}
+	return (result);
+}
+
+/*
+ * Collect the owner names of the records changed between the last
+ * processed version of 'zone' and 'serial' from the journal into 'names',
+ * and the mhash labels of the member zones they belong to into 'mhashes'.
+ * Anything changed outside the member zones can affect all of them, so
+ * fail if there is such a change.
+ */
+static isc_result_t
+catz_journal_changes(dns_catz_zone_t *zone, uint32_t serial, isc_ht_t *mhashes,
+		     isc_ht_t *names) {
+	isc_result_t result;
+	dns_journal_t *journal = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *lname = dns_fixedname_initname(&fixed);
+
+	result = dns_journal_open(zone->catzs->mctx, zone->journal,
+				  DNS_JOURNAL_READ, &journal);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	result = dns_journal_iter_init(journal, zone->serial, serial, NULL);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	for (result = dns_journal_first_rr(journal); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		dns_name_t *name = NULL;
+		dns_rdata_t *rdata = NULL;
+		dns_name_t prefix;
+		dns_label_t label;
+		uint32_t ttl;
+
+		dns_journal_current_rr(journal, &name, &ttl, &rdata);
+		if (dns_name_equal(name, &zone->name)) {
+			/* SOA and NS changes at the apex are not used. */
+			continue;
+		}
+		if (!dns_name_issubdomain(name, &zone->name)) {
+			continue;
+		}
+
+		dns_name_downcase(name, lname, NULL);
+		dns_name_init(&prefix, NULL);
+		dns_name_split(lname, zone->name.labels, &prefix, NULL);
+		dns_name_getlabel(&prefix, prefix.labels - 1, &label);
+		if (catz_get_option(&label) != CATZ_OPT_ZONES) {
+			result = ISC_R_NOTIMPLEMENTED;
+			goto cleanup;
+		}
+		if (prefix.labels < 2) {
+			continue;
+		}
+
+		dns_name_getlabel(&prefix, prefix.labels - 2, &label);
+		result = isc_ht_add(mhashes, label.base, label.length, mhashes);
+		if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS) {
+			goto cleanup;
+		}
+		result = catz_addname(names, lname);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+	}
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+
+cleanup:
+	dns_journal_destroy(&journal);
+	return (result);
+}
+
+/*
+ * Update 'zone' to version 'zone->dbversion' of 'db', whose serial is
+ * 'serial', by re-reading only the member zones changed in the journal.
+ * A member is read from its own name, the suboption names it had, and
+ * the names changed in the journal; those are all the names it can
+ * have now.
+ */
+static isc_result_t
+catz_update_changed(dns_catz_zone_t *zone, dns_db_t *db, uint32_t serial) {
+	static unsigned char zones_ndata[] = "\005zones";
+	static unsigned char zones_offsets[] = { 0 };
+	static dns_name_t const zones_label =
+		DNS_NAME_INITNONABSOLUTE(zones_ndata, zones_offsets);
+	isc_result_t result;
+	isc_mem_t *mctx = zone->catzs->mctx;
+	isc_ht_t *mhashes = NULL, *names = NULL;
+	isc_ht_iter_t *iter = NULL;
+	dns_catz_zone_t *newzone = NULL;
+	dns_fixedname_t fzones, fname, fmember;
+	dns_name_t *zones, *name, *member;
+	char bname[DNS_NAME_FORMATSIZE];
+
+	zones = dns_fixedname_initname(&fzones);
+	name = dns_fixedname_initname(&fname);
+	member = dns_fixedname_initname(&fmember);
+
+	RUNTIME_CHECK(isc_ht_init(&mhashes, mctx, 4) == ISC_R_SUCCESS);
+	RUNTIME_CHECK(isc_ht_init(&names, mctx, 4) == ISC_R_SUCCESS);
+
+	result = catz_journal_changes(zone, serial, mhashes, names);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	/*
+	 * Add the names of the changed members, and the names of their
+	 * suboptions before the change.
+	 */
+	result = dns_name_concatenate(&zones_label, &zone->name, zones, NULL);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+	result = isc_ht_iter_create(mhashes, &iter);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	for (result = isc_ht_iter_first(iter); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(iter))
+	{
+		dns_catz_entry_t *entry = NULL;
+		unsigned char *key = NULL;
+		size_t keysize;
+		isc_region_t r;
+		dns_name_t mhash;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+		r.base = key;
+		r.length = (unsigned int)keysize;
+		dns_name_init(&mhash, NULL);
+		dns_name_fromregion(&mhash, &r);
+		result = dns_name_concatenate(&mhash, zones, member, NULL);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+		result = catz_addname(names, member);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+
+		if (isc_ht_find(zone->entries, key, (uint32_t)keysize,
+				(void **)&entry) != ISC_R_SUCCESS)
+		{
+			continue;
+		}
+		for (unsigned int i = 0; i < entry->noptnames; i++) {
+			result = dns_name_concatenate(&entry->optnames[i],
+						      member, name, NULL);
+			if (result == ISC_R_SUCCESS) {
+				result = catz_addname(names, name);
+			}
+			if (result != ISC_R_SUCCESS) {
+				goto cleanup;
+			}
+		}
+	}
+	isc_ht_iter_destroy(&iter);
+
+	result = dns_catz_new_zone(zone->catzs, &newzone, &zone->name);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = isc_ht_iter_create(names, &iter);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	for (result = isc_ht_iter_first(iter); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(iter))
+	{
+		dns_dbnode_t *node = NULL;
+		unsigned char *key = NULL;
+		size_t keysize;
+		isc_region_t r;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+		r.base = key;
+		r.length = (unsigned int)keysize;
+		dns_name_fromregion(name, &r);
+
+		result = dns_db_findnode(db, name, false, &node);
+		if (result == ISC_R_NOTFOUND) {
+			continue;
+		} else if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+		result = catz_process_node(zone->catzs, newzone, db,
+					   zone->dbversion, node, name);
+		dns_db_detachnode(db, &node);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+	}
+	isc_ht_iter_destroy(&iter);
+
+	dns_name_format(&zone->name, bname, DNS_NAME_FORMATSIZE);
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_MASTER,
+		      ISC_LOG_DEBUG(3),
+		      "catz: update_from_db: %u changed members of '%s' "
+		      "read from %u names",
+		      isc_ht_count(mhashes), bname, isc_ht_count(names));
+
+	catz_merge_changed(zone, newzone, mhashes);
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	if (result != ISC_R_SUCCESS) {
+		dns_name_format(&zone->name, bname, DNS_NAME_FORMATSIZE);
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(1),
+			      "catz: %s: cannot update from journal: %s", bname,
+			      isc_result_totext(result));
+	}
+	if (iter != NULL) {
+		isc_ht_iter_destroy(&iter);
+	}
+	if (newzone != NULL) {
+		dns_catz_zone_detach(&newzone);
+	}
+	isc_ht_destroy(&names);
+	isc_ht_destroy(&mhashes);
+	return (result);
+}
+
 void
 dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 	dns_catz_zone_t *oldzone = NULL, *newzone = NULL;
@@ -1816,11 +2277,10 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 	dns_dbiterator_t *it = NULL;
 	dns_fixedname_t fixname;
 	dns_name_t *name;
-	dns_rdatasetiter_t *rdsiter = NULL;
-	dns_rdataset_t rdataset;
 	char bname[DNS_NAME_FORMATSIZE];
 	isc_buffer_t ibname;
 	uint32_t vers;
+	bool incremental;
 
 	REQUIRE(DNS_DB_VALID(db));
 	REQUIRE(DNS_CATZ_ZONES_VALID(catzs));
@@ -1857,6 +2317,19 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 		      "catz: updating catalog zone '%s' with serial %d", bname,
 		      vers);
 
+	/*
+	 * If the database is the one we processed last, only the members
+	 * changed in the journal transactions since then need to be read.
+	 */
+	incremental = !oldzone->fullupdate && oldzone->journal != NULL;
+	oldzone->fullupdate = true;
+	if (incremental && vers != oldzone->serial &&
+	    catz_update_changed(oldzone, db, vers) == ISC_R_SUCCESS)
+	{
+		dns_db_closeversion(db, &oldzone->dbversion, false);
+		goto merged;
+	}
+
 	result = dns_catz_new_zone(catzs, &newzone, &db->origin);
 	if (result != ISC_R_SUCCESS) {
 		dns_db_closeversion(db, &oldzone->dbversion, false);
@@ -1901,53 +2374,13 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 			break;
 		}
 
-		result = dns_db_allrdatasets(db, node, oldzone->dbversion, 0,
-					     &rdsiter);
+		result = catz_process_node(catzs, newzone, db,
+					   oldzone->dbversion, node, name);
+		dns_db_detachnode(db, &node);
 		if (result != ISC_R_SUCCESS) {
-			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-				      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
-				      "catz: failed to fetch rrdatasets - %s",
-				      isc_result_totext(result));
-			dns_db_detachnode(db, &node);
 			break;
 		}
 
-		dns_rdataset_init(&rdataset);
-		result = dns_rdatasetiter_first(rdsiter);
-		while (result == ISC_R_SUCCESS) {
-			dns_rdatasetiter_current(rdsiter, &rdataset);
-			result = dns_catz_update_process(catzs, newzone, name,
-							 &rdataset);
-			if (result != ISC_R_SUCCESS) {
-				char cname[DNS_NAME_FORMATSIZE];
-				char typebuf[DNS_RDATATYPE_FORMATSIZE];
-				char classbuf[DNS_RDATACLASS_FORMATSIZE];
-
-				dns_name_format(name, cname,
-						DNS_NAME_FORMATSIZE);
-				dns_rdataclass_format(rdataset.rdclass,
-						      classbuf,
-						      sizeof(classbuf));
-				dns_rdatatype_format(rdataset.type, typebuf,
-						     sizeof(typebuf));
-				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
-					      DNS_LOGMODULE_MASTER,
-					      ISC_LOG_WARNING,
-					      "catz: unknown record in catalog "
-					      "zone - %s %s %s(%s) - ignoring",
-					      cname, classbuf, typebuf,
-					      isc_result_totext(result));
-			}
-			dns_rdataset_disassociate(&rdataset);
-			if (result != ISC_R_SUCCESS) {
-				break;
-			}
-			result = dns_rdatasetiter_next(rdsiter);
-		}
-
-		dns_rdatasetiter_destroy(&rdsiter);
-
-		dns_db_detachnode(db, &node);
 		result = dns_dbiterator_next(it);
 	}
 
@@ -1971,6 +2404,10 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs) {
 		return;
 	}
 
+merged:
+	oldzone->serial = vers;
+	oldzone->fullupdate = false;
+
 	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_MASTER,
 		      ISC_LOG_DEBUG(3),
 		      "catz: update_from_db: new zone merged");
@@ -1089,3 +1089,16 @@ dns_db_setgluecachestats(dns_db_t *db, isc_stats_t *stats) {
 
 	return (ISC_R_NOTIMPLEMENTED);
 }
+
+isc_result_t
+dns_db_expiredata(dns_db_t *db, isc_stdtime_t now, unsigned int budget,
+		  unsigned int *reclaimablep) {
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE((db->attributes & DNS_DBATTR_CACHE) != 0);
+
+	if (db->methods->expiredata != NULL) {
+		return ((db->methods->expiredata)(db, now, budget,
+						  reclaimablep));
+	}
+	return (ISC_R_NOTIMPLEMENTED);
+}
@@ -244,6 +244,7 @@ static isc_result_t
 diff_apply(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver, bool warn) {
 	dns_difftuple_t *t;
 	dns_dbnode_t *node = NULL;
+	bool nsec3node = false;
 	isc_result_t result;
 	char namebuf[DNS_NAME_FORMATSIZE];
 	char typebuf[DNS_RDATATYPE_FORMATSIZE];
@@ -265,6 +266,10 @@ diff_apply(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver, bool warn) {
 		 * contains a deletion of an RR at a nonexistent name,
 		 * but such diffs should never be created in the first
 		 * place.
+		 *
+		 * The node is kept for all the consecutive tuples with
+		 * this owner name, unless they switch between the main
+		 * and the NSEC3 tree.
 		 */
 
 		while (t != NULL && dns_name_equal(&t->name, name)) {
@@ -274,6 +279,7 @@ diff_apply(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver, bool warn) {
 			dns_rdataset_t rds;
 			dns_rdataset_t ardataset;
 			unsigned int options;
+			bool nsec3;
 
 			op = t->op;
 			type = t->rdata.type;
@@ -300,14 +306,18 @@ diff_apply(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver, bool warn) {
 			rdl.rdclass = t->rdata.rdclass;
 			rdl.ttl = t->ttl;
 
-			node = NULL;
-			if (type != dns_rdatatype_nsec3 &&
-			    covers != dns_rdatatype_nsec3) {
+			nsec3 = (type == dns_rdatatype_nsec3 ||
+				 covers == dns_rdatatype_nsec3);
+			if (node != NULL && nsec3 != nsec3node) {
+				dns_db_detachnode(db, &node);
+			}
+			if (node == NULL && !nsec3) {
 				CHECK(dns_db_findnode(db, name, true, &node));
-			} else {
+			} else if (node == NULL) {
 				CHECK(dns_db_findnsec3node(db, name, true,
 							   &node));
 			}
+			nsec3node = nsec3;
 
 			while (t != NULL && dns_name_equal(&t->name, name) &&
 			       t->op == op && t->rdata.type == type &&
@@ -439,11 +449,13 @@ diff_apply(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver, bool warn) {
 				}
 				CHECK(result);
 			}
-			dns_db_detachnode(db, &node);
 			if (dns_rdataset_isassociated(&ardataset)) {
 				dns_rdataset_disassociate(&ardataset);
 			}
 		}
+		if (node != NULL) {
+			dns_db_detachnode(db, &node);
+		}
 	}
 	return (ISC_R_SUCCESS);
 
@@ -2561,6 +2561,7 @@ dns_dispatch_gettcp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *destaddr,
 		LOCK(&disp->lock);
 		if ((disp->shutting_down == 0) &&
 		    ATTRMATCH(disp->attributes, attributes, mask) &&
+		    disp->requests < disp->maxrequests &&
 		    (localaddr == NULL ||
 		     isc_sockaddr_eqaddr(localaddr, &disp->local)))
 		{
@@ -3524,6 +3525,19 @@ dns_dispatch_cancel(dns_dispatch_t *disp) {
 	return;
 }
 
+bool
+dns_dispatch_isshuttingdown(dns_dispatch_t *disp) {
+	bool shuttingdown;
+
+	REQUIRE(VALID_DISPATCH(disp));
+
+	LOCK(&disp->lock);
+	shuttingdown = (disp->shutting_down == 1);
+	UNLOCK(&disp->lock);
+
+	return (shuttingdown);
+}
+
 unsigned int
 dns_dispatch_getattributes(dns_dispatch_t *disp) {
 	REQUIRE(VALID_DISPATCH(disp));
@@ -22,6 +22,7 @@
 #include <isc/serial.h>
 #include <isc/string.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <pk11/site.h>
 
@@ -371,6 +372,156 @@ cleanup_databuf:
 	return (ret);
 }
 
+isc_result_t
+dns_dnssec_signjob_create(isc_mem_t *mctx, const dns_name_t *name,
+			  dns_rdataset_t *set, dst_key_t *key,
+			  isc_stdtime_t inception, isc_stdtime_t expire,
+			  dns_dnssecsignjob_t **jobp) {
+	dns_dnssecsignjob_t *job;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	isc_result_t result;
+	unsigned int i;
+	size_t len;
+
+	REQUIRE(name != NULL);
+	REQUIRE(DNS_RDATASET_VALID(set));
+	REQUIRE(key != NULL);
+	REQUIRE(jobp != NULL && *jobp == NULL);
+
+	job = isc_mem_get(mctx, sizeof(*job));
+	*job = (dns_dnssecsignjob_t){ .inception = inception,
+				      .expire = expire,
+				      .result = ISC_R_UNSET };
+
+	job->name = dns_fixedname_initname(&job->fname);
+	dns_name_copynf(name, job->name);
+	dst_key_attach(key, &job->key);
+	dns_rdata_init(&job->rdata);
+	dns_rdataset_init(&job->rdataset);
+	isc_buffer_init(&job->buffer, job->data, sizeof(job->data));
+
+	/*
+	 * Copy the rdata so that the job does not depend on the
+	 * database.
+	 */
+	len = 0;
+	for (result = dns_rdataset_first(set); result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(set))
+	{
+		dns_rdataset_current(set, &rdata);
+		len += rdata.length;
+		job->nrdatas++;
+		dns_rdata_reset(&rdata);
+	}
+	if (result != ISC_R_NOMORE) {
+		goto failure;
+	}
+
+	job->rdatamemlen = (unsigned int)len;
+	if (job->rdatamemlen > 0) {
+		job->rdatamem = isc_mem_get(mctx, job->rdatamemlen);
+	}
+	if (job->nrdatas > 0) {
+		job->rdatas = isc_mem_get(mctx,
+					  job->nrdatas * sizeof(dns_rdata_t));
+	}
+
+	dns_rdatalist_init(&job->rdatalist);
+	job->rdatalist.rdclass = set->rdclass;
+	job->rdatalist.type = set->type;
+	job->rdatalist.covers = set->covers;
+	job->rdatalist.ttl = set->ttl;
+
+	len = 0;
+	i = 0;
+	for (result = dns_rdataset_first(set); result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(set))
+	{
+		isc_region_t r;
+
+		dns_rdataset_current(set, &rdata);
+		dns_rdata_toregion(&rdata, &r);
+		INSIST(i < job->nrdatas);
+		INSIST(len + r.length <= job->rdatamemlen);
+		memmove(job->rdatamem + len, r.base, r.length);
+		r.base = job->rdatamem + len;
+		len += r.length;
+
+		dns_rdata_init(&job->rdatas[i]);
+		dns_rdata_fromregion(&job->rdatas[i], rdata.rdclass,
+				     rdata.type, &r);
+		ISC_LIST_APPEND(job->rdatalist.rdata, &job->rdatas[i], link);
+		dns_rdata_reset(&rdata);
+		i++;
+	}
+	if (result != ISC_R_NOMORE) {
+		goto failure;
+	}
+	INSIST(i == job->nrdatas);
+
+	RUNTIME_CHECK(dns_rdatalist_tordataset(&job->rdatalist,
+					       &job->rdataset) ==
+		      ISC_R_SUCCESS);
+
+	*jobp = job;
+	return (ISC_R_SUCCESS);
+
+failure:
+	dns_dnssec_signjob_destroy(mctx, &job);
+	return (result);
+}
+
+void
+dns_dnssec_signjob_destroy(isc_mem_t *mctx, dns_dnssecsignjob_t **jobp) {
+	dns_dnssecsignjob_t *job;
+
+	REQUIRE(jobp != NULL && *jobp != NULL);
+
+	job = *jobp;
+	*jobp = NULL;
+
+	if (dns_rdataset_isassociated(&job->rdataset)) {
+		dns_rdataset_disassociate(&job->rdataset);
+	}
+	if (job->rdatas != NULL) {
+		isc_mem_put(mctx, job->rdatas,
+			    job->nrdatas * sizeof(dns_rdata_t));
+	}
+	if (job->rdatamem != NULL) {
+		isc_mem_put(mctx, job->rdatamem, job->rdatamemlen);
+	}
+	dst_key_free(&job->key);
+	isc_mem_put(mctx, job, sizeof(*job));
+}
+
+typedef struct signjobs {
+	dns_dnssecsignjob_t **jobs;
+	isc_mem_t *mctx;
+} signjobs_t;
+
+static void
+signjob_run(void *arg, size_t index) {
+	signjobs_t *batch = arg;
+	dns_dnssecsignjob_t *job = batch->jobs[index];
+
+	isc_buffer_clear(&job->buffer);
+	dns_rdata_reset(&job->rdata);
+	job->result = dns_dnssec_sign(job->name, &job->rdataset, job->key,
+				      &job->inception, &job->expire,
+				      batch->mctx, &job->buffer, &job->rdata);
+}
+
+void
+dns_dnssec_signjobs(isc_workpool_t *pool, dns_dnssecsignjob_t **jobs,
+		    size_t njobs, isc_mem_t *mctx) {
+	signjobs_t batch = { .jobs = jobs, .mctx = mctx };
+
+	REQUIRE(jobs != NULL || njobs == 0);
+	REQUIRE(mctx != NULL);
+
+	isc_workpool_run(pool, njobs, signjob_run, &batch);
+}
+
 isc_result_t
 dns_dnssec_verify(const dns_name_t *name, dns_rdataset_t *set, dst_key_t *key,
 		  bool ignoretime, unsigned int maxbits, isc_mem_t *mctx,
@@ -564,6 +564,29 @@ dns_adb_agesrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, isc_stdtime_t now);
  *	srtt value.  This may include changes made by others.
  */
 
+unsigned int
+dns_adb_getrttpercentile(dns_adb_t *adb, dns_adbaddrinfo_t *addr,
+			 unsigned int percentile);
+/*%<
+ * Estimate the given percentile of the round trip times, in
+ * microseconds, measured for the address in 'addr'.  Only the RTTs
+ * passed to dns_adb_adjustsrtt() with DNS_ADB_RTTADJDEFAULT are
+ * counted, with recent ones weighted most heavily.
+ *
+ * Requires:
+ *
+ *\li	adb be valid.
+ *
+ *\li	addr be valid.
+ *
+ *\li	0 < percentile < 100
+ *
+ * Returns:
+ *
+ *\li	The estimated RTT, or 0 if too few RTTs have been measured
+ *	for the address.
+ */
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask);
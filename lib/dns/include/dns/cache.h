@@ -174,6 +174,12 @@ dns_cache_load(dns_cache_t *cache);
  * Previous cache contents are not discarded.
  * If no file name has been set, do nothing and return success.
  *
+ * The file is expected to be a snapshot written by dns_cache_dump();
+ * TTLs are reduced by the time elapsed since it was written, and
+ * expired data is skipped.  A file in master file format is loaded
+ * as such.  Every record of a snapshot is checked before any of it is
+ * loaded, so a snapshot with a malformed record is rejected as a whole.
+ *
  * MT:
  *\li	Multiple simultaneous attempts to load or dump the cache
  * 	will be serialized with respect to one another, but
@@ -185,15 +191,36 @@ dns_cache_load(dns_cache_t *cache);
  * Returns:
  *
  *\li	#ISC_R_SUCCESS
+ *\li	#DNS_R_FORMERR if the snapshot is malformed
  *  \li    Various failures depending on the database implementation type
  */
 
+isc_result_t
+dns_cache_asyncload(dns_cache_t *cache);
+/*%<
+ * Like dns_cache_load(), but the file is loaded incrementally by the
+ * cache cleaner task, so the cache can be used while it is being
+ * filled.  Names that are cached in the meantime are not overwritten
+ * with data from the file.  A missing file is not an error.
+ *
+ * If the cache has no cleaner task, the file is loaded synchronously.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	Various file-related failures
+ */
+
 isc_result_t
 dns_cache_dump(dns_cache_t *cache);
 /*%<
- * If the cache has a file name, write the cache contents to disk,
- * overwriting any preexisting file.  If no file name has been set,
- * do nothing and return success.
+ * If the cache has a file name, write a snapshot of the cache contents
+ * to disk, replacing any preexisting file.  If no file name has been
+ * set, or the file is still being loaded, do nothing and return success.
+ *
+ * The snapshot preserves the expiry time, trust level and the negative
+ * and prefetch state of each rdataset, but not the proofs of
+ * nonexistence attached to negative and wildcard answers.
  *
  * MT:
  *\li	Multiple simultaneous attempts to load or dump the cache
@@ -208,6 +235,21 @@ dns_cache_dump(dns_cache_t *cache);
  *  \li    Various failures depending on the database implementation type
  */
 
+isc_result_t
+dns_cache_setdumpinterval(dns_cache_t *cache, uint32_t interval);
+/*%<
+ * Dump the cache to its file every 'interval' seconds, in addition to
+ * when it is shut down.  The dump is written incrementally by the
+ * cache cleaner task to a temporary file, which replaces the cache
+ * file when it is complete.  An 'interval' of 0 disables periodic
+ * dumps.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTIMPLEMENTED if the cache has no cleaner task
+ */
+
 isc_result_t
 dns_cache_clean(dns_cache_t *cache, isc_stdtime_t now);
 /*%<
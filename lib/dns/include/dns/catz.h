@@ -325,12 +325,42 @@ typedef isc_result_t (*dns_catz_zoneop_fn_t)(dns_catz_entry_t *entry,
 					     dns_view_t *      view,
 					     isc_taskmgr_t *   taskmgr,
 					     void *	       udata);
+
+/*
+ * A single change of a member zone, part of the batch produced by one
+ * update of a catalog zone.
+ */
+typedef enum {
+	dns_catz_op_add,
+	dns_catz_op_mod,
+	dns_catz_op_del
+} dns_catz_op_t;
+
+struct dns_catz_changed {
+	dns_catz_op_t	  op;
+	dns_catz_entry_t *entry;
+	ISC_LINK(dns_catz_changed_t) link;
+};
+
+typedef isc_result_t (*dns_catz_zonechg_fn_t)(dns_catz_changedlist_t *changes,
+					      dns_catz_zone_t *origin,
+					      dns_view_t *view,
+					      isc_taskmgr_t *taskmgr,
+					      void *udata);
+
 struct dns_catz_zonemodmethods {
-	dns_catz_zoneop_fn_t addzone;
-	dns_catz_zoneop_fn_t modzone;
-	dns_catz_zoneop_fn_t delzone;
-	void *		     udata;
+	dns_catz_zoneop_fn_t  addzone;
+	dns_catz_zoneop_fn_t  modzone;
+	dns_catz_zoneop_fn_t  delzone;
+	dns_catz_zonechg_fn_t chgzones;
+	void *		      udata;
 };
+/*%<
+ * If 'chgzones' is not NULL, all the changes made by one update of a
+ * catalog zone are passed to it at once, deletions first, instead of
+ * calling 'addzone', 'modzone' and 'delzone' for each member.  It must
+ * not modify the list, and has to attach to the entries it keeps.
+ */
 
 isc_result_t
 dns_catz_new_zones(dns_catz_zones_t **catzsp, dns_catz_zonemodmethods_t *zmm,
@@ -413,6 +443,20 @@ dns_catz_dbupdate_callback(dns_db_t *db, void *fn_arg);
  * \li	'fn_arg' is not NULL (casted to dns_catz_zones_t*).
  */
 
+void
+dns_catz_setjournal(dns_catz_zones_t *catzs, const dns_name_t *name,
+		    const char *journal);
+/*%<
+ * Set the journal file of the database of catalog zone 'name'.  When
+ * a new version of the same database is committed, only the member
+ * zones changed in the journal since the last processed version are
+ * re-read and merged, instead of the whole catalog.
+ *
+ * Requires:
+ * \li	'catzs' is a valid dns_catz_zones_t.
+ * \li	'name' is a valid dns_name_t.
+ */
+
 void
 dns_catz_update_taskaction(isc_task_t *task, isc_event_t *event);
 /*%<
@@ -427,7 +471,9 @@ dns_catz_update_from_db(dns_db_t *db, dns_catz_zones_t *catzs);
 /*%<
  * Process an updated database for a catalog zone.
  * It creates a new catz, iterates over database to fill it with content, and
- * then merges new catz into old catz.
+ * then merges new catz into old catz.  If the journal covers the changes
+ * since the last processed version, only the changed members are read
+ * and merged.
  *
  * Requires:
  * \li	'db' is a valid DB.
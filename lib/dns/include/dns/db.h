@@ -179,6 +179,9 @@ typedef struct dns_dbmethods {
 	isc_result_t (*setservestalettl)(dns_db_t *db, dns_ttl_t ttl);
 	isc_result_t (*getservestalettl)(dns_db_t *db, dns_ttl_t *ttl);
 	isc_result_t (*setgluecachestats)(dns_db_t *db, isc_stats_t *stats);
+	isc_result_t (*expiredata)(dns_db_t *db, isc_stdtime_t now,
+				   unsigned int	 budget,
+				   unsigned int *reclaimablep);
 } dns_dbmethods_t;
 
 typedef isc_result_t (*dns_dbcreatefunc_t)(isc_mem_t *	     mctx,
@@ -1698,6 +1701,31 @@ dns_db_setgluecachestats(dns_db_t *db, isc_stats_t *stats);
  *	dns_rdatasetstats_create(); otherwise NULL.
  */
 
+isc_result_t
+dns_db_expiredata(dns_db_t *db, isc_stdtime_t now, unsigned int budget,
+		  unsigned int *reclaimablep);
+/*%<
+ * Remove up to 'budget' entries whose TTL (including any serve-stale
+ * window) expired before 'now' from the cache database 'db'.  If the
+ * cache is over its memory limit, the least recently used entries are
+ * evicted as well, within the same budget.  Successive calls resume
+ * where the previous one stopped, so a cache of any size can be cleaned
+ * a fixed amount of work at a time.  If 'now' is zero, the current time
+ * is used.
+ *
+ * If 'reclaimablep' is not NULL, '*reclaimablep' is set to an estimate
+ * of the number of expired entries still waiting to be removed.
+ *
+ * Calls for the same database must be serialized by the caller.
+ *
+ * Requires:
+ * \li	'db' is a valid cache database.
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_NOTIMPLEMENTED - Not supported by this DB implementation.
+ */
+
 ISC_LANG_ENDDECLS
 
 #endif /* DNS_DB_H */
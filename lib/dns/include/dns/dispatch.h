@@ -367,7 +367,8 @@ dns_dispatch_gettcp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *destaddr,
 		    dns_dispatch_t **dispp);
 /*
  * Attempt to connect to a existing TCP connection (connection completed
- * if connected == NULL).
+ * if connected == NULL).  Connections that already have as many
+ * outstanding requests as they allow are skipped.
  */
 
 isc_result_t
@@ -466,6 +467,17 @@ dns_dispatch_cancel(dns_dispatch_t *disp);
  *\li	disp is valid.
  */
 
+bool
+dns_dispatch_isshuttingdown(dns_dispatch_t *disp);
+/*%<
+ * Return true if 'disp' is shutting down, e.g. because its TCP
+ * connection has been closed by the peer, so that no new responses
+ * can be added to it.
+ *
+ * Requires:
+ *\li	disp is valid.
+ */
+
 unsigned int
 dns_dispatch_getattributes(dns_dispatch_t *disp);
 /*%<
@@ -16,11 +16,16 @@
 
 #include <stdbool.h>
 
+#include <isc/buffer.h>
 #include <isc/lang.h>
 #include <isc/stats.h>
 #include <isc/stdtime.h>
 
 #include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
 #include <dns/types.h>
 
 #include <dst/dst.h>
@@ -72,6 +77,31 @@ struct dns_dnsseckey {
 	ISC_LINK(dns_dnsseckey_t) link;
 };
 
+/*
+ * A signature to be generated by dns_dnssec_signjobs().  The job holds
+ * its own copy of the rdataset, so it does not refer to the database
+ * it was taken from.
+ */
+struct dns_dnssecsignjob {
+	dns_fixedname_t fname;
+	dns_name_t *	name;	   /*% owner name */
+	dns_rdataset_t	rdataset;  /*% the rdataset to sign */
+	dst_key_t *	key;	   /*% the signing key */
+	isc_stdtime_t	inception; /*% signature inception time */
+	isc_stdtime_t	expire;	   /*% signature expiration time */
+	isc_result_t	result;	   /*% result of dns_dnssec_sign() */
+	dns_rdata_t	rdata;	   /*% the generated RRSIG */
+
+	/* Private. */
+	dns_rdatalist_t rdatalist;
+	dns_rdata_t *	rdatas;
+	unsigned int	nrdatas;
+	unsigned char * rdatamem;
+	unsigned int	rdatamemlen;
+	isc_buffer_t	buffer;
+	unsigned char	data[1024];
+};
+
 isc_result_t
 dns_dnssec_keyfromrdata(const dns_name_t *name, const dns_rdata_t *rdata,
 			isc_mem_t *mctx, dst_key_t **key);
@@ -122,6 +152,52 @@ dns_dnssec_sign(const dns_name_t *name, dns_rdataset_t *set, dst_key_t *key,
  *\li		DST_R_*
  */
 
+isc_result_t
+dns_dnssec_signjob_create(isc_mem_t *mctx, const dns_name_t *name,
+			  dns_rdataset_t *set, dst_key_t *key,
+			  isc_stdtime_t inception, isc_stdtime_t expire,
+			  dns_dnssecsignjob_t **jobp);
+/*%<
+ *	Prepare a job to generate a RRSIG record covering 'set' with 'key'
+ *	using dns_dnssec_signjobs().  The name and the contents of 'set'
+ *	are copied and 'key' is attached to, so the job stays valid when
+ *	'set' is disassociated or the database it came from is modified.
+ *
+ *	Requires:
+ *\li		'name' is a valid name
+ *\li		'set' is a valid rdataset
+ *\li		'key' is a valid key
+ *\li		'jobp' is not NULL and '*jobp' is NULL
+ *
+ *	Returns:
+ *\li		#ISC_R_SUCCESS
+ *\li		errors from iterating 'set'
+ */
+
+void
+dns_dnssec_signjob_destroy(isc_mem_t *mctx, dns_dnssecsignjob_t **jobp);
+/*%<
+ *	Free a job created by dns_dnssec_signjob_create().
+ */
+
+void
+dns_dnssec_signjobs(isc_workpool_t *pool, dns_dnssecsignjob_t **jobs,
+		    size_t njobs, isc_mem_t *mctx);
+/*%<
+ *	Generate the signatures for 'njobs' jobs, spreading the work over
+ *	the threads of 'pool'.  On return the result of dns_dnssec_sign()
+ *	is in each job's 'result' and, on success, the RRSIG is in its
+ *	'rdata'.
+ *
+ *	The signatures are identical to those that dns_dnssec_sign() would
+ *	generate for each job in turn; only the work is done concurrently.
+ *
+ *	Requires:
+ *\li		'pool' is a valid worker pool, or NULL to sign on the
+ *		calling thread
+ *\li		'jobs' points to 'njobs' valid jobs
+ */
+
 isc_result_t
 dns_dnssec_verify(const dns_name_t *name, dns_rdataset_t *set, dst_key_t *key,
 		  bool ignoretime, unsigned int maxbits, isc_mem_t *mctx,
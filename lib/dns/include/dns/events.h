@@ -78,6 +78,12 @@
 #define DNS_EVENT_CATZDELZONE	     (ISC_EVENTCLASS_DNS + 56)
 #define DNS_EVENT_RPZUPDATED	     (ISC_EVENTCLASS_DNS + 57)
 #define DNS_EVENT_STARTUPDATE	     (ISC_EVENTCLASS_DNS + 58)
+#define DNS_EVENT_ZONECOMPACT	     (ISC_EVENTCLASS_DNS + 59)
+#define DNS_EVENT_CACHESNAPSHOT	     (ISC_EVENTCLASS_DNS + 60)
+#define DNS_EVENT_CATZCHGZONES	     (ISC_EVENTCLASS_DNS + 61)
+#define DNS_EVENT_XFRINLOAD	     (ISC_EVENTCLASS_DNS + 62)
+#define DNS_EVENT_XFRINLOADED	     (ISC_EVENTCLASS_DNS + 63)
+#define DNS_EVENT_RPZINDEX	     (ISC_EVENTCLASS_DNS + 64)
 
 #define DNS_EVENT_FIRSTEVENT (ISC_EVENTCLASS_DNS + 0)
 #define DNS_EVENT_LASTEVENT  (ISC_EVENTCLASS_DNS + 65535)
@@ -21,11 +21,14 @@
 
 #include <dns/types.h>
 
+typedef struct dns_ipcompiled dns_ipcompiled_t;
+
 struct dns_iptable {
 	unsigned int	  magic;
 	isc_mem_t *	  mctx;
 	isc_refcount_t	  refcount;
 	isc_radix_tree_t *radix;
+	dns_ipcompiled_t *compiled;
 	ISC_LINK(dns_iptable_t) nextincache;
 };
 
@@ -57,6 +60,23 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, bool pos);
  * Merge one IP table into another one.
  */
 
+void
+dns_iptable_compile(dns_iptable_t *tab);
+/*
+ * Build a flat lookup table from the radix tree, which will be used by
+ * dns_iptable_match() in place of the radix tree until the IP table is
+ * next modified.  This is intended for large IP tables which are
+ * searched far more often than they are changed.
+ */
+
+int
+dns_iptable_match(const dns_iptable_t *tab, const isc_netaddr_t *addr);
+/*
+ * Search an IP table for the most significant (lowest numbered) prefix
+ * matching the host address 'addr'.  Returns the node number of that
+ * prefix, negated if it is a negative match, or 0 if nothing matches.
+ */
+
 void
 dns_iptable_attach(dns_iptable_t *source, dns_iptable_t **target);
 
@@ -63,6 +63,12 @@
  */
 typedef struct dns_journal dns_journal_t;
 
+/*%
+ * A dns_journalcompact_t holds the state of a journal compaction that
+ * is performed in stages; see dns_journal_compact_begin().
+ */
+typedef struct dns_journalcompact dns_journalcompact_t;
+
 /***
  *** Functions
  ***/
@@ -293,6 +299,51 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
  * exists and is non-empty 'serial' must exist in the journal.
  */
 
+isc_result_t
+dns_journal_compact_begin(isc_mem_t *mctx, char *filename, uint32_t serial,
+			  uint32_t target_size,
+			  dns_journalcompact_t **compactp);
+isc_result_t
+dns_journal_compact_copy(dns_journalcompact_t *compact);
+isc_result_t
+dns_journal_compact_finish(dns_journalcompact_t *compact);
+void
+dns_journal_compact_destroy(dns_journalcompact_t **compactp);
+/*%<
+ * Compact a journal in stages, so that the bulk of the work can be
+ * performed while new transactions are still being appended to it.
+ *
+ * dns_journal_compact_begin() decides which transactions to keep,
+ * using the same rules as dns_journal_compact(), and records the current
+ * end of the journal.  dns_journal_compact_copy() copies the retained
+ * transactions up to that point into a new file; it does not need to be
+ * serialized with writers and may be run on another thread.
+ * dns_journal_compact_finish() copies any transactions committed after
+ * dns_journal_compact_begin() was called and atomically replaces the
+ * journal with the new file.
+ *
+ * dns_journal_compact_begin() and dns_journal_compact_finish() must not
+ * run concurrently with a transaction being written to the journal.
+ *
+ * Requires:
+ *\li	'compactp' is not NULL and '*compactp' is NULL.
+ *\li	dns_journal_compact_copy() has succeeded before
+ *	dns_journal_compact_finish() is called.
+ *
+ * Returns (dns_journal_compact_begin()):
+ *\li	#ISC_R_SUCCESS		'*compactp' is ready for copying.
+ *\li	#DNS_R_UPTODATE		no compaction is needed.
+ *\li	#ISC_R_RANGE		'serial' is not in the journal.
+ *
+ * Returns (dns_journal_compact_finish()):
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_CANCELED		the journal was replaced or truncated
+ *				since dns_journal_compact_begin() was called.
+ *
+ * dns_journal_compact_destroy() frees '*compactp', removing the new file
+ * if it was not put in place.
+ */
+
 bool
 dns_journal_get_sourceserial(dns_journal_t *j, uint32_t *sourceserial);
 void
@@ -236,8 +236,9 @@ isc_result_t
 dns_master_dumptostreaminc(isc_mem_t *mctx, dns_db_t *db,
 			   dns_dbversion_t *	     version,
 			   const dns_master_style_t *style, FILE *f,
-			   isc_task_t *task, dns_dumpdonefunc_t done,
-			   void *done_arg, dns_dumpctx_t **dctxp);
+			   isc_workpool_t *pool, isc_task_t *task,
+			   dns_dumpdonefunc_t done, void *done_arg,
+			   dns_dumpctx_t **dctxp);
 
 isc_result_t
 dns_master_dumptostream(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
@@ -257,6 +258,11 @@ dns_master_dumptostream(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
  * If 'format' is dns_masterformat_raw, then 'header' can contain
  * information to be written to the file header.
  *
+ * dns_master_dumptostreaminc() formats the database in chunks of
+ * consecutive nodes on the threads of 'pool', if not NULL, and writes
+ * them to 'f' in order.  The output is the same as that of a dump on a
+ * single thread.
+ *
  * Temporary dynamic memory may be allocated from 'mctx'.
  *
  * Require:
@@ -278,7 +284,8 @@ dns_master_dumptostream(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 isc_result_t
 dns_master_dumpinc(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		   const dns_master_style_t *style, const char *filename,
-		   isc_task_t *task, dns_dumpdonefunc_t done, void *done_arg,
+		   isc_workpool_t *pool, isc_task_t *task,
+		   dns_dumpdonefunc_t done, void *done_arg,
 		   dns_dumpctx_t **dctxp, dns_masterformat_t format,
 		   dns_masterrawheader_t *header);
 
@@ -300,6 +307,10 @@ dns_master_dump(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
  * If 'format' is dns_masterformat_raw, then 'header' can contain
  * information to be written to the file header.
  *
+ * dns_master_dumpinc() formats the text and raw formats in parallel
+ * on the threads of 'pool', if not NULL, as dns_master_dumptostreaminc()
+ * does.
+ *
  * Temporary dynamic memory may be allocated from 'mctx'.
  *
  * Returns:
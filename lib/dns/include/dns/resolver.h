@@ -604,6 +604,58 @@ dns_resolver_setnonbackofftries(dns_resolver_t *resolver, unsigned int tries);
  * \li  tries > 0.
  */
 
+unsigned int
+dns_resolver_gethedgebudget(dns_resolver_t *resolver);
+
+void
+dns_resolver_sethedgebudget(dns_resolver_t *resolver, unsigned int budget);
+/*%<
+ * Sets the number of hedged queries the resolver may send, as a
+ * percentage of the queries sent to servers on their own.  A query is
+ * hedged by also sending it to the next server when the first has not
+ * answered within the time given by dns_resolver_sethedgepercentile();
+ * the first answer is used.  Defaults to 0, which disables hedging.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ * \li  budget <= 100.
+ */
+
+void
+dns_resolver_setcoalesce(dns_resolver_t *resolver, dns_view_t *view);
+/*%<
+ * Coalesce the fetches of 'resolver' with those of the resolver of
+ * 'view': a fetch that is not DNS_FETCHOPT_UNSHARED is started in (or
+ * joins an identical fetch already active in) that resolver, and so is
+ * run with the settings of 'view'.  Only views that share a cache and
+ * resolve names in the same way should be coalesced.  A fetch that
+ * joins a fetch started by another view is counted as
+ * dns_resstatscounter_coalesced.
+ *
+ * If the other resolver is shutting down, fetches are made by
+ * 'resolver' itself.
+ *
+ * Requires:
+ * \li	resolver to be valid and not frozen.
+ * \li	view to be valid and not to be the view of 'resolver'.
+ */
+
+unsigned int
+dns_resolver_gethedgepercentile(dns_resolver_t *resolver);
+
+void
+dns_resolver_sethedgepercentile(dns_resolver_t *resolver,
+				unsigned int percentile);
+/*%<
+ * Sets the percentile of a server's recently measured round trip times
+ * after which a query sent to it is hedged, if that is shorter than the
+ * retry interval.  Defaults to 95.
+ *
+ * Requires:
+ * \li	resolver to be valid.
+ * \li  0 < percentile < 100.
+ */
+
 unsigned int
 dns_resolver_getoptions(dns_resolver_t *resolver);
 /*%<
@@ -157,7 +157,14 @@ struct dns_rpz_zone {
 	dns_dbversion_t *updbversion;	 /* version we're currently working
 					  * on */
 	dns_dbiterator_t *updbit;	 /* iterator to use when updating */
-	isc_ht_t *	  newnodes;	 /* entries in zone being updated */
+	isc_ht_t *	  newnodes;	 /* entries in zone being updated,
+					  * or names changed by an
+					  * incremental update */
+	char *		  journal;	 /* zone's journal file */
+	uint32_t	  serial;	 /* serial of the last version
+					  * processed */
+	bool		  fullupdate;	 /* next update must walk the
+					  * whole zone */
 	bool		  db_registered; /* is the notify event
 					  * registered? */
 	bool	     addsoa;		 /* add soa to the additional section */
@@ -170,6 +177,11 @@ struct dns_rpz_zone {
  */
 typedef struct dns_rpz_cidr_node dns_rpz_cidr_node_t;
 
+/*
+ * Read-only, compact copy of the summary databases
+ */
+typedef struct dns_rpz_index dns_rpz_index_t;
+
 /*
  * Bitfields indicating which policy zones have policies of
  * which type.
@@ -267,6 +279,15 @@ struct dns_rpz_zones {
 	dns_rpz_cidr_node_t *cidr;
 	dns_rbt_t *	     rbt;
 
+	/*
+	 * Once an update of a policy zone is done, a compact copy of
+	 * 'cidr' and 'rbt' is built in the background, and searched
+	 * instead of them.  It is replaced as a whole under 'index_lock'.
+	 */
+	isc_rwlock_t	 index_lock;
+	dns_rpz_index_t *index;
+	bool		 indexpending;
+
 	/*
 	 * DNSRPZ librpz configuration string and handle on librpz connection
 	 */
@@ -397,6 +418,17 @@ dns_rpz_new_zone(dns_rpz_zones_t *rpzs, dns_rpz_zone_t **rpzp);
 isc_result_t
 dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg);
 
+void
+dns_rpz_setjournal(dns_rpz_zone_t *rpz, const char *journal);
+/*%<
+ * Set the journal file of the policy zone's database.  When a new
+ * version of the same database is committed, the names changed since
+ * the last processed version are read from the journal, and only those
+ * are updated in the summary.  The whole zone is walked when the
+ * database is replaced (e.g., by AXFR or a reload), or when the
+ * journal does not cover the change.
+ */
+
 void
 dns_rpz_attach_rpzs(dns_rpz_zones_t *source, dns_rpz_zones_t **target);
 
@@ -70,7 +70,12 @@ enum {
 	dns_resstatscounter_serverquota = 42,
 	dns_resstatscounter_nextitem = 43,
 	dns_resstatscounter_priming = 44,
-	dns_resstatscounter_max = 45,
+	dns_resstatscounter_tcpconnect = 45,
+	dns_resstatscounter_tcpreuse = 46,
+	dns_resstatscounter_hedge = 47,
+	dns_resstatscounter_hedgewin = 48,
+	dns_resstatscounter_coalesced = 49,
+	dns_resstatscounter_max = 50,
 
 	/*
 	 * DNSSEC stats.
@@ -98,8 +103,15 @@ enum {
 	dns_zonestatscounter_ixfrreqv6 = 10,
 	dns_zonestatscounter_xfrsuccess = 11,
 	dns_zonestatscounter_xfrfail = 12,
+	dns_zonestatscounter_xfrinbytesrate = 13,
+	dns_zonestatscounter_xfrinrecsrate = 14,
+	dns_zonestatscounter_notifyqueued = 15,
+	dns_zonestatscounter_soaqueued = 16,
+	dns_zonestatscounter_notifyrate = 17,
+	dns_zonestatscounter_startupnotifyrate = 18,
+	dns_zonestatscounter_soarate = 19,
 
-	dns_zonestatscounter_max = 13,
+	dns_zonestatscounter_max = 20,
 
 	/*
 	 * Adb statistics values.
@@ -120,8 +132,10 @@ enum {
 	dns_cachestatscounter_querymisses = 4,
 	dns_cachestatscounter_deletelru = 5,
 	dns_cachestatscounter_deletettl = 6,
+	dns_cachestatscounter_sweeps = 7,
+	dns_cachestatscounter_reclaimable = 8,
 
-	dns_cachestatscounter_max = 7,
+	dns_cachestatscounter_max = 9,
 
 	/*%
 	 * Query statistics counters (obsolete).
@@ -43,6 +43,7 @@ typedef struct dns_catz_entry_options  dns_catz_options_t;
 typedef struct dns_catz_entry	       dns_catz_entry_t;
 typedef struct dns_catz_zone	       dns_catz_zone_t;
 typedef struct dns_catz_changed	       dns_catz_changed_t;
+typedef ISC_LIST(dns_catz_changed_t) dns_catz_changedlist_t;
 typedef struct dns_catz_zones	       dns_catz_zones_t;
 typedef struct dns_client	       dns_client_t;
 typedef void			       dns_clientrestrans_t;
@@ -75,6 +76,7 @@ typedef struct dns_dns64	      dns_dns64_t;
 typedef ISC_LIST(dns_dns64_t) dns_dns64list_t;
 typedef struct dns_dnsseckey dns_dnsseckey_t;
 typedef ISC_LIST(dns_dnsseckey_t) dns_dnsseckeylist_t;
+typedef struct dns_dnssecsignjob dns_dnssecsignjob_t;
 typedef uint8_t			   dns_dsdigest_t;
 typedef struct dns_dtdata	   dns_dtdata_t;
 typedef struct dns_dtenv	   dns_dtenv_t;
@@ -338,6 +338,27 @@ dns_zone_getmaxrecords(dns_zone_t *zone);
  *\li	uint32_t maxrecords.
  */
 
+void
+dns_zone_setupdategroup(dns_zone_t *zone, uint32_t max);
+/*%<
+ * 	Sets the maximum number of queued dynamic updates for the zone
+ *	that are applied in one database version and committed with
+ *	one journal transaction.  0 or 1 commits every update on its own.
+ *
+ * Requires:
+ *\li	'zone' to be valid initialised zone.
+ */
+
+uint32_t
+dns_zone_getupdategroup(dns_zone_t *zone);
+/*%<
+ * 	Gets the maximum number of dynamic updates for the zone that are
+ *	committed together.
+ *
+ * Requires:
+ *\li	'zone' to be valid initialised zone.
+ */
+
 void
 dns_zone_setmaxttl(dns_zone_t *zone, uint32_t maxttl);
 /*%<
@@ -1229,6 +1250,48 @@ dns_zone_getjournalsize(dns_zone_t *zone);
  *\li	'zone' to be a valid zone.
  */
 
+void
+dns_zone_setjournalcompactidle(dns_zone_t *zone, uint32_t idle);
+/*%<
+ *	Hold off journal compaction until the zone has not been
+ *	dynamically updated for 'idle' seconds.  Zero disables the
+ *	hold-off.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+uint32_t
+dns_zone_getjournalcompactidle(dns_zone_t *zone);
+/*%<
+ *	Return the value set with dns_zone_setjournalcompactidle().
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+void
+dns_zone_setdumpdeltaratio(dns_zone_t *zone, uint32_t ratio);
+/*%<
+ *	Leave the master file as it is, rather than rewriting it, while
+ *	the changes journaled since it was written amount to no more
+ *	than 'ratio' percent of the size of the zone.  The master file
+ *	and the journal together then hold the current version of the
+ *	zone.  Zero rewrites the master file after every change.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+uint32_t
+dns_zone_getdumpdeltaratio(dns_zone_t *zone);
+/*%<
+ *	Return the value set with dns_zone_setdumpdeltaratio().
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
 isc_result_t
 dns_zone_notifyreceive(dns_zone_t *zone, isc_sockaddr_t *from,
 		       isc_sockaddr_t *to, dns_message_t *msg);
@@ -1362,6 +1425,19 @@ dns_zone_gettask(dns_zone_t *zone, isc_task_t **target);
  *\li	'target' to be != NULL && '*target' == NULL.
  */
 
+void
+dns_zone_getloadtask(dns_zone_t *zone, isc_task_t **target);
+/*%<
+ * Attach '*target' to the zone's load task, if it has one.  The load
+ * task is used for work that can proceed independently of the zone's
+ * task, such as building a new database during a zone transfer.
+ * '*target' is left NULL if the zone is not managed by a zone manager.
+ *
+ * Requires:
+ *\li	'zone' to be valid initialised zone.
+ *\li	'target' to be != NULL && '*target' == NULL.
+ */
+
 void
 dns_zone_notify(dns_zone_t *zone);
 /*%<
@@ -1761,6 +1837,19 @@ dns_zonemgr_getttransfersin(dns_zonemgr_t *zmgr);
  *\li	'zmgr' to be a valid zone manager.
  */
 
+void
+dns_zonemgr_setworkpool(dns_zonemgr_t *zmgr, isc_workpool_t *pool);
+/*%<
+ *	Attach the worker pool that zones use to spread CPU-bound work,
+ *	such as generating signatures, over several threads.  Without a
+ *	pool that work is done on the zone's task.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ *\li	'pool' to be a valid worker pool.
+ *\li	no worker pool has been set on 'zmgr' yet.
+ */
+
 void
 dns_zonemgr_settransfersperns(dns_zonemgr_t *zmgr, uint32_t value);
 /*%<
@@ -1854,6 +1943,18 @@ dns_zonemgr_getserialqueryrate(dns_zonemgr_t *zmgr);
  *\li	'zmgr' to be a valid zone manager.
  */
 
+void
+dns_zonemgr_setstats(dns_zonemgr_t *zmgr, isc_stats_t *stats);
+/*%<
+ *	Publish the notify and SOA query queue depths and the rates
+ *	currently in use as gauges in 'stats', a set of zone statistics
+ *	counters.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager with no statistics set.
+ *\li	'stats' to be a valid statistics set.
+ */
+
 unsigned int
 dns_zonemgr_getcount(dns_zonemgr_t *zmgr, int state);
 /*%<
@@ -1949,6 +2050,18 @@ dns_zone_setstats(dns_zone_t *zone, isc_stats_t *stats);
  *	(see dns/stats.h).
  */
 
+void
+dns_zone_setxfrinrate(dns_zone_t *zone, uint64_t bytes, uint64_t records,
+		      uint64_t msecs);
+/*%<
+ * Record the rate of the last successful incoming transfer of 'zone',
+ * which received 'bytes' bytes and 'records' records in 'msecs'
+ * milliseconds, in the zone-maintenance statistics set (if any).
+ *
+ * Requires:
+ * \li	'zone' to be a valid zone.
+ */
+
 void
 dns_zone_setrequeststats(dns_zone_t *zone, isc_stats_t *stats);
 
@@ -2235,6 +2348,26 @@ dns_zone_getadded(dns_zone_t *zone);
  * \li	'zone' to be valid.
  */
 
+void
+dns_zone_setconfighash(dns_zone_t *zone, uint64_t hash);
+/*%
+ * Record a hash of the configuration the zone was configured from,
+ * so that reconfiguring it can be skipped when it has not changed.
+ * 0 means the configuration is unknown.
+ *
+ * Requires:
+ * \li	'zone' to be valid.
+ */
+
+uint64_t
+dns_zone_getconfighash(dns_zone_t *zone);
+/*%
+ * Returns the hash set by dns_zone_setconfighash(), or 0.
+ *
+ * Requires:
+ * \li	'zone' to be valid.
+ */
+
 void
 dns_zone_setautomatic(dns_zone_t *zone, bool automatic);
 /*%
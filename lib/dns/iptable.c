@@ -11,16 +11,61 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include <isc/mem.h>
+#include <isc/netaddr.h>
 #include <isc/radix.h>
 #include <isc/util.h>
 
 #include <dns/acl.h>
 
+/*
+ * A compiled IP table flattens the prefixes of each address family
+ * into a sorted array of disjoint address ranges, each labelled with
+ * the (signed) node number isc_radix_search() would find for any
+ * address within it.  A direct index on the leading bits of the
+ * address narrows a lookup down to a few ranges, which are then
+ * binary searched.
+ */
+#define IPTABLE_INDEXMIN 4
+#define IPTABLE_INDEXMAX 16
+
+typedef struct {
+	uint64_t hi;
+	uint64_t lo;
+} ipkey_t;
+
+typedef struct {
+	unsigned int bits;    /* Index bits */
+	unsigned int nranges; /* Ranges in 'start' and 'match' */
+	uint32_t *   index;   /* (1 << bits) + 1 range numbers */
+	uint32_t *   start4;  /* Range start addresses (IPv4) */
+	ipkey_t *    start6;  /* Range start addresses (IPv6) */
+	int *	     match;   /* Signed node numbers */
+} ipranges_t;
+
+struct dns_ipcompiled {
+	ipranges_t family[RADIX_FAMILIES];
+};
+
+/*
+ * A prefix from the radix tree, as a closed range of keys.
+ */
+typedef struct {
+	ipkey_t	     first;
+	ipkey_t	     last;
+	unsigned int bitlen;
+	int	     num;
+	int	     match;
+} ipprefix_t;
+
 static void
 destroy_iptable(dns_iptable_t *dtab);
 
+static void
+uncompile(dns_iptable_t *tab);
+
 /*
  * Create a new IP table and the underlying radix structure
  */
@@ -34,6 +79,7 @@ dns_iptable_create(isc_mem_t *mctx, dns_iptable_t **target) {
 	isc_mem_attach(mctx, &tab->mctx);
 	isc_refcount_init(&tab->refcount, 1);
 	tab->radix = NULL;
+	tab->compiled = NULL;
 	tab->magic = DNS_IPTABLE_MAGIC;
 
 	result = isc_radix_create(mctx, &tab->radix, RADIX_MAXBITS);
@@ -66,6 +112,8 @@ dns_iptable_addprefix(dns_iptable_t *tab, const isc_netaddr_t *addr,
 	INSIST(DNS_IPTABLE_VALID(tab));
 	INSIST(tab->radix != NULL);
 
+	uncompile(tab);
+
 	NETADDR_TO_PREFIX_T(addr, pfx, bitlen);
 
 	result = isc_radix_insert(tab->radix, &node, NULL, &pfx);
@@ -106,6 +154,8 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, bool pos) {
 	isc_radix_node_t *node, *new_node;
 	int i, max_node = 0;
 
+	uncompile(tab);
+
 	RADIX_WALK(source->radix->head, node) {
 		new_node = NULL;
 		result = isc_radix_insert(tab->radix, &new_node, node, NULL);
@@ -139,6 +189,344 @@ dns_iptable_merge(dns_iptable_t *tab, dns_iptable_t *source, bool pos) {
 	return (ISC_R_SUCCESS);
 }
 
+static int
+keycmp(const ipkey_t *a, const ipkey_t *b) {
+	if (a->hi != b->hi) {
+		return ((a->hi < b->hi) ? -1 : 1);
+	}
+	if (a->lo != b->lo) {
+		return ((a->lo < b->lo) ? -1 : 1);
+	}
+	return (0);
+}
+
+static void
+keyload(ipkey_t *key, const unsigned char *bytes) {
+	int i;
+
+	key->hi = key->lo = 0;
+	for (i = 0; i < 8; i++) {
+		key->hi = (key->hi << 8) | bytes[i];
+		key->lo = (key->lo << 8) | bytes[i + 8];
+	}
+}
+
+/*
+ * Mask of the leading 'bitlen' bits of a key.
+ */
+static void
+keymask(ipkey_t *mask, unsigned int bitlen) {
+	mask->hi = (bitlen == 0) ? 0
+				 : (bitlen >= 64) ? UINT64_MAX
+						  : UINT64_MAX << (64 - bitlen);
+	mask->lo = (bitlen <= 64) ? 0 : UINT64_MAX << (128 - bitlen);
+}
+
+/*
+ * Advance 'key' to the next address in a 'keybits' wide address space;
+ * returns false if it was the last one.
+ */
+static bool
+keynext(ipkey_t *key, unsigned int keybits) {
+	if (keybits <= 64) {
+		key->hi += UINT64_C(1) << (64 - keybits);
+		return (key->hi != 0);
+	}
+	key->lo += UINT64_C(1) << (128 - keybits);
+	if (key->lo == 0) {
+		key->hi++;
+		return (key->hi != 0);
+	}
+	return (true);
+}
+
+static int
+prefixcmp(const void *a, const void *b) {
+	const ipprefix_t *pa = a, *pb = b;
+	int order = keycmp(&pa->first, &pb->first);
+
+	if (order != 0) {
+		return (order);
+	}
+	return ((int)pa->bitlen - (int)pb->bitlen);
+}
+
+/*
+ * Append a range starting at 'start' to the arrays being built,
+ * merging it with its predecessor where possible.
+ */
+static void
+addrange(ipkey_t *start, int *match, unsigned int *n, const ipkey_t *key,
+	 int value) {
+	if (*n > 0 && keycmp(&start[*n - 1], key) == 0) {
+		match[*n - 1] = value;
+		if (*n > 1 && match[*n - 2] == value) {
+			(*n)--;
+		}
+		return;
+	}
+	if (*n > 0 && match[*n - 1] == value) {
+		return;
+	}
+	start[*n] = *key;
+	match[*n] = value;
+	(*n)++;
+}
+
+static void
+compile_family(dns_iptable_t *tab, int fam, ipranges_t *ranges) {
+	isc_radix_node_t *node;
+	unsigned int keybits = (fam == RADIX_V6) ? 128 : 32;
+	unsigned int count = 0, n = 0, sp = 0, i, b;
+	ipprefix_t *prefixes = NULL;
+	ipprefix_t stack[2 * (RADIX_MAXBITS + 1)];
+	ipkey_t *start, space, key;
+	int *match;
+
+	RADIX_WALK(tab->radix->head, node) {
+		if (node->node_num[fam] != -1 && node->data[fam] != NULL &&
+		    node->prefix->bitlen <= keybits)
+		{
+			count++;
+		}
+	}
+	RADIX_WALK_END;
+
+	if (count > 0) {
+		prefixes = isc_mem_get(tab->mctx, count * sizeof(*prefixes));
+	}
+
+	keymask(&space, keybits);
+	i = 0;
+	RADIX_WALK(tab->radix->head, node) {
+		if (node->node_num[fam] != -1 && node->data[fam] != NULL &&
+		    node->prefix->bitlen <= keybits)
+		{
+			ipprefix_t *p = &prefixes[i++];
+			ipkey_t mask;
+
+			keyload(&key, isc_prefix_touchar(node->prefix));
+			keymask(&mask, node->prefix->bitlen);
+			p->first.hi = key.hi & mask.hi;
+			p->first.lo = key.lo & mask.lo;
+			p->last.hi = p->first.hi | (~mask.hi & space.hi);
+			p->last.lo = p->first.lo | (~mask.lo & space.lo);
+			p->bitlen = node->prefix->bitlen;
+			p->num = node->node_num[fam];
+			p->match = *(bool *)node->data[fam] ? p->num : -p->num;
+		}
+	}
+	RADIX_WALK_END;
+	INSIST(i == count);
+
+	if (count > 1) {
+		qsort(prefixes, count, sizeof(*prefixes), prefixcmp);
+	}
+
+	/*
+	 * Prefixes are either nested or disjoint, so in this order each
+	 * one either follows or is contained in those on the stack; the
+	 * entries on the stack carry the best match for their range.
+	 */
+	start = isc_mem_get(tab->mctx, (2 * count + 1) * sizeof(*start));
+	match = isc_mem_get(tab->mctx, (2 * count + 1) * sizeof(*match));
+	key.hi = key.lo = 0;
+	addrange(start, match, &n, &key, 0);
+	for (i = 0; i <= count; i++) {
+		while (sp > 0 && (i == count || keycmp(&stack[sp - 1].last,
+						       &prefixes[i].first) < 0))
+		{
+			key = stack[--sp].last;
+			if (keynext(&key, keybits)) {
+				addrange(start, match, &n, &key,
+					 (sp > 0) ? stack[sp - 1].match : 0);
+			}
+		}
+		if (i == count) {
+			break;
+		}
+
+		INSIST(sp < ARRAY_SIZE(stack));
+		stack[sp] = prefixes[i];
+		if (sp > 0 && stack[sp - 1].num < stack[sp].num) {
+			stack[sp].num = stack[sp - 1].num;
+			stack[sp].match = stack[sp - 1].match;
+		}
+		addrange(start, match, &n, &stack[sp].first, stack[sp].match);
+		sp++;
+	}
+
+	if (prefixes != NULL) {
+		isc_mem_put(tab->mctx, prefixes, count * sizeof(*prefixes));
+	}
+
+	ranges->nranges = n;
+	ranges->bits = IPTABLE_INDEXMIN;
+	while (ranges->bits < IPTABLE_INDEXMAX && (1U << ranges->bits) < n) {
+		ranges->bits++;
+	}
+
+	/*
+	 * index[b] is the range containing the first address whose
+	 * leading bits are 'b'.
+	 */
+	ranges->index = isc_mem_get(tab->mctx, ((1U << ranges->bits) + 1) *
+						       sizeof(*ranges->index));
+	for (b = 0, i = 0; b < (1U << ranges->bits); b++) {
+		key.hi = (uint64_t)b << (64 - ranges->bits);
+		key.lo = 0;
+		while (i + 1 < n && keycmp(&start[i + 1], &key) <= 0) {
+			i++;
+		}
+		ranges->index[b] = i;
+	}
+	ranges->index[b] = n - 1;
+
+	ranges->match = isc_mem_get(tab->mctx, n * sizeof(*ranges->match));
+	memmove(ranges->match, match, n * sizeof(*ranges->match));
+	if (fam == RADIX_V6) {
+		ranges->start4 = NULL;
+		ranges->start6 = isc_mem_get(tab->mctx,
+					     n * sizeof(*ranges->start6));
+		memmove(ranges->start6, start, n * sizeof(*ranges->start6));
+	} else {
+		ranges->start6 = NULL;
+		ranges->start4 = isc_mem_get(tab->mctx,
+					     n * sizeof(*ranges->start4));
+		for (i = 0; i < n; i++) {
+			ranges->start4[i] = (uint32_t)(start[i].hi >> 32);
+		}
+	}
+
+	isc_mem_put(tab->mctx, start, (2 * count + 1) * sizeof(*start));
+	isc_mem_put(tab->mctx, match, (2 * count + 1) * sizeof(*match));
+}
+
+static void
+free_family(isc_mem_t *mctx, ipranges_t *ranges) {
+	unsigned int n = ranges->nranges;
+
+	isc_mem_put(mctx, ranges->index,
+		    ((1U << ranges->bits) + 1) * sizeof(*ranges->index));
+	isc_mem_put(mctx, ranges->match, n * sizeof(*ranges->match));
+	if (ranges->start4 != NULL) {
+		isc_mem_put(mctx, ranges->start4, n * sizeof(*ranges->start4));
+	}
+	if (ranges->start6 != NULL) {
+		isc_mem_put(mctx, ranges->start6, n * sizeof(*ranges->start6));
+	}
+}
+
+static void
+uncompile(dns_iptable_t *tab) {
+	int fam;
+
+	if (tab->compiled == NULL) {
+		return;
+	}
+
+	for (fam = 0; fam < RADIX_FAMILIES; fam++) {
+		free_family(tab->mctx, &tab->compiled->family[fam]);
+	}
+	isc_mem_put(tab->mctx, tab->compiled, sizeof(*tab->compiled));
+	tab->compiled = NULL;
+}
+
+/*
+ * Build a compiled lookup table for an IP table
+ */
+void
+dns_iptable_compile(dns_iptable_t *tab) {
+	dns_ipcompiled_t *compiled;
+	int fam;
+
+	REQUIRE(DNS_IPTABLE_VALID(tab));
+
+	uncompile(tab);
+
+	compiled = isc_mem_get(tab->mctx, sizeof(*compiled));
+	for (fam = 0; fam < RADIX_FAMILIES; fam++) {
+		compile_family(tab, fam, &compiled->family[fam]);
+	}
+	tab->compiled = compiled;
+}
+
+static int
+lookup4(const ipranges_t *ranges, uint32_t key) {
+	uint32_t b = key >> (32 - ranges->bits);
+	uint32_t lo = ranges->index[b], hi = ranges->index[b + 1];
+
+	while (lo < hi) {
+		uint32_t mid = hi - (hi - lo) / 2;
+		if (ranges->start4[mid] <= key) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return (ranges->match[lo]);
+}
+
+static int
+lookup6(const ipranges_t *ranges, const ipkey_t *key) {
+	uint32_t b = (uint32_t)(key->hi >> (64 - ranges->bits));
+	uint32_t lo = ranges->index[b], hi = ranges->index[b + 1];
+
+	while (lo < hi) {
+		uint32_t mid = hi - (hi - lo) / 2;
+		if (keycmp(&ranges->start6[mid], key) <= 0) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return (ranges->match[lo]);
+}
+
+/*
+ * Find the best match for a host address in an IP table
+ */
+int
+dns_iptable_match(const dns_iptable_t *tab, const isc_netaddr_t *addr) {
+	isc_prefix_t pfx;
+	isc_radix_node_t *node = NULL;
+	isc_result_t result;
+	int match = 0;
+
+	REQUIRE(DNS_IPTABLE_VALID(tab));
+	REQUIRE(addr != NULL);
+
+	if (tab->compiled != NULL) {
+		const dns_ipcompiled_t *compiled = tab->compiled;
+
+		if (addr->family == AF_INET6) {
+			ipkey_t key;
+
+			keyload(&key, addr->type.in6.s6_addr);
+			return (lookup6(&compiled->family[RADIX_V6], &key));
+		}
+		return (lookup4(&compiled->family[RADIX_V4],
+				ntohl(addr->type.in.s_addr)));
+	}
+
+	NETADDR_TO_PREFIX_T(addr, pfx, (addr->family == AF_INET6) ? 128 : 32);
+
+	result = isc_radix_search(tab->radix, &node, &pfx);
+	if (result == ISC_R_SUCCESS && node != NULL) {
+		int fam = ISC_RADIX_FAMILY(&pfx);
+		match = node->node_num[fam];
+		if (!*(bool *)node->data[fam]) {
+			match = -match;
+		}
+	}
+
+	isc_refcount_destroy(&pfx.refcount);
+
+	return (match);
+}
+
 void
 dns_iptable_attach(dns_iptable_t *source, dns_iptable_t **target) {
 	REQUIRE(DNS_IPTABLE_VALID(source));
@@ -162,6 +550,8 @@ static void
 destroy_iptable(dns_iptable_t *dtab) {
 	REQUIRE(DNS_IPTABLE_VALID(dtab));
 
+	uncompile(dtab);
+
 	if (dtab->radix != NULL) {
 		isc_radix_destroy(dtab->radix, NULL);
 		dtab->radix = NULL;
@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <sys/stat.h>
+
 #include <isc/file.h>
 #include <isc/mem.h>
 #include <isc/print.h>
@@ -1699,8 +1701,12 @@ dns_journal_iter_init(dns_journal_t *j, uint32_t begin_serial,
 		 * adding up sizes and RR counts so we can calculate
 		 * the IXFR size.
 		 */
-		CHECK(journal_seek(j, pos.offset));
 		do {
+			/*
+			 * journal_next() leaves the file positioned
+			 * after the header it read, not at the next one.
+			 */
+			CHECK(journal_seek(j, pos.offset));
 			CHECK(journal_read_xhdr(j, &xhdr));
 
 			size += xhdr.size;
@@ -2200,26 +2206,140 @@ failure:
 	return (result);
 }
 
+/*
+ * Journal compaction is split into three phases so that the bulk of the
+ * copying can be done without blocking writers:
+ *
+ *   - dns_journal_compact_begin() picks the first transaction to retain
+ *     and records the end of the journal as it stands.  This must be
+ *     called while no transaction is being written to the journal.
+ *
+ *   - dns_journal_compact_copy() copies the retained transactions, up to
+ *     the recorded end, into a new journal file and indexes them.  Those
+ *     transactions are immutable, so this may run in parallel with new
+ *     transactions being appended.
+ *
+ *   - dns_journal_compact_finish() copies whatever was appended after the
+ *     recorded end, writes the new header and index, and renames the new
+ *     journal into place.  Like dns_journal_compact_begin(), it must be
+ *     serialized with writers.
+ *
+ * The journal may be removed or replaced in between (for example by a
+ * full zone transfer), and a new journal can look just like the old one
+ * from its header.  So the source is kept open until the end, which
+ * stops its inode from being reused, and dns_journal_compact_finish()
+ * gives up unless the file name still refers to it.
+ */
+struct dns_journalcompact {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	dns_journal_t *j1;     /*%< Source journal */
+	dns_journal_t *j2;     /*%< New journal being built */
+	dev_t dev;	       /*%< Device of the source */
+	ino_t ino;	       /*%< Inode of the source */
+	char *filename;	       /*%< Journal being compacted */
+	bool is_backup;	       /*%< 'filename' did not exist */
+	char newname[PATH_MAX];
+	char backup[PATH_MAX];
+	journal_pos_t origin;  /*%< Source header 'begin' at start */
+	journal_pos_t begin;   /*%< First retained transaction */
+	journal_pos_t end;     /*%< End of source at start */
+	journal_pos_t indexed; /*%< End of the indexed part of j2 */
+	uint32_t indexend;     /*%< Offset of data in j2 */
+	bool copied;
+};
+
+#define JOURNALCOMPACT_MAGIC	ISC_MAGIC('J', 'C', 'M', 'P')
+#define JOURNALCOMPACT_VALID(c) ISC_MAGIC_VALID(c, JOURNALCOMPACT_MAGIC)
+
+/*
+ * Copy 'length' bytes starting at 'offset' in 'src' to the current
+ * position in 'dst'.
+ */
+static isc_result_t
+journal_copy(isc_mem_t *mctx, dns_journal_t *src, dns_journal_t *dst,
+	     uint32_t offset, uint32_t length) {
+	isc_result_t result = ISC_R_SUCCESS;
+	unsigned int size = 64 * 1024;
+	unsigned int i;
+	char *buf;
+
+	if (length == 0) {
+		return (ISC_R_SUCCESS);
+	}
+	if (length < size) {
+		size = length;
+	}
+	buf = isc_mem_get(mctx, size);
+
+	CHECK(journal_seek(src, offset));
+	for (i = 0; i < length; i += size) {
+		unsigned int len = (length - i) > size ? size : (length - i);
+		CHECK(journal_read(src, buf, len));
+		CHECK(journal_write(dst, buf, len));
+	}
+
+failure:
+	isc_mem_put(mctx, buf, size);
+	return (result);
+}
+
+/*
+ * Return true if 'path' is still the file compaction started from.
+ */
+static bool
+compact_samefile(dns_journalcompact_t *compact, const char *path) {
+	struct stat sb;
+
+	if (stat(path, &sb) != 0) {
+		return (false);
+	}
+	return (sb.st_dev == compact->dev && sb.st_ino == compact->ino);
+}
+
+/*
+ * Add index entries for the transactions in 'j' from '*pos' up to the
+ * transaction ending with serial 'end', advancing '*pos'.
+ */
+static isc_result_t
+journal_index_range(dns_journal_t *j, journal_pos_t *pos, uint32_t end) {
+	isc_result_t result = ISC_R_SUCCESS;
+	journal_pos_t saved = j->header.end;
+
+	/*
+	 * journal_next() stops at the header's end serial; point it at
+	 * the end of the range we are indexing.
+	 */
+	j->header.end.serial = end;
+	while (pos->serial != end) {
+		index_add(j, pos);
+		CHECK(journal_next(j, pos));
+	}
+
+failure:
+	j->header.end = saved;
+	return (result);
+}
+
 isc_result_t
-dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
-		    uint32_t target_size) {
+dns_journal_compact_begin(isc_mem_t *mctx, char *filename, uint32_t serial,
+			  uint32_t target_size,
+			  dns_journalcompact_t **compactp) {
 	unsigned int i;
 	journal_pos_t best_guess;
 	journal_pos_t current_pos;
 	dns_journal_t *j1 = NULL;
-	dns_journal_t *j2 = NULL;
-	journal_rawheader_t rawheader;
-	unsigned int copy_length;
+	dns_journalcompact_t *compact = NULL;
 	size_t namelen;
-	char *buf = NULL;
-	unsigned int size = 0;
 	isc_result_t result;
 	unsigned int indexend;
 	char newname[PATH_MAX];
 	char backup[PATH_MAX];
 	bool is_backup = false;
+	struct stat sb;
 
 	REQUIRE(filename != NULL);
+	REQUIRE(compactp != NULL && *compactp == NULL);
 
 	namelen = strlen(filename);
 	if (namelen > 4U && strcmp(filename + namelen - 4, ".jnl") == 0) {
@@ -2245,7 +2365,7 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 
 	if (JOURNAL_EMPTY(&j1->header)) {
 		dns_journal_destroy(&j1);
-		return (ISC_R_SUCCESS);
+		return (DNS_R_UPTODATE);
 	}
 
 	if (DNS_SERIAL_GT(j1->header.begin.serial, serial) ||
@@ -2272,11 +2392,9 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	 */
 	if ((uint32_t)j1->header.end.offset < target_size) {
 		dns_journal_destroy(&j1);
-		return (ISC_R_SUCCESS);
+		return (DNS_R_UPTODATE);
 	}
 
-	CHECK(journal_open(mctx, newname, true, true, &j2));
-
 	/*
 	 * Remove overhead so space test below can succeed.
 	 */
@@ -2322,42 +2440,145 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		CHECK(journal_next(j1, &best_guess));
 	}
 
+	if (fstat(fileno(j1->fp), &sb) != 0) {
+		FAIL(ISC_R_UNEXPECTED);
+	}
+
+	compact = isc_mem_get(mctx, sizeof(*compact));
+	*compact = (dns_journalcompact_t){
+		.j1 = j1,
+		.dev = sb.st_dev,
+		.ino = sb.st_ino,
+		.is_backup = is_backup,
+		.origin = j1->header.begin,
+		.begin = best_guess,
+		.end = j1->header.end,
+		.indexed = best_guess,
+		.indexend = indexend,
+	};
+	j1 = NULL;
+	isc_mem_attach(mctx, &compact->mctx);
+	compact->filename = isc_mem_strdup(mctx, filename);
+	strlcpy(compact->newname, newname, sizeof(compact->newname));
+	strlcpy(compact->backup, backup, sizeof(compact->backup));
+
+	result = journal_open(mctx, newname, true, true, &compact->j2);
+	if (result != ISC_R_SUCCESS) {
+		dns_journal_compact_destroy(&compact);
+		return (result);
+	}
+
+	compact->magic = JOURNALCOMPACT_MAGIC;
+	*compactp = compact;
+	return (ISC_R_SUCCESS);
+
+failure:
+	if (j1 != NULL) {
+		dns_journal_destroy(&j1);
+	}
+	return (result);
+}
+
+isc_result_t
+dns_journal_compact_copy(dns_journalcompact_t *compact) {
+	isc_result_t result;
+	uint32_t copy_length;
+	dns_journal_t *j2;
+
+	REQUIRE(JOURNALCOMPACT_VALID(compact));
+	REQUIRE(!compact->copied);
+
+	j2 = compact->j2;
+	copy_length = compact->end.offset - compact->begin.offset;
+
+	CHECK(journal_seek(j2, compact->indexend));
+	CHECK(journal_copy(compact->mctx, compact->j1, j2,
+			   compact->begin.offset, copy_length));
+	CHECK(journal_fsync(j2));
+
 	/*
-	 * We should now be roughly half target_size provided
-	 * we did not reach 'serial'.  If not we will just copy
-	 * all uncommitted deltas regardless of the size.
+	 * Index what we have copied so far.  Positions in the new file
+	 * are offset by the difference in where the data starts.
 	 */
-	copy_length = j1->header.end.offset - best_guess.offset;
+	compact->indexed.offset = compact->indexend;
+	CHECK(journal_index_range(j2, &compact->indexed, compact->end.serial));
 
-	if (copy_length != 0) {
-		/*
-		 * Copy best_guess to end into space just freed.
-		 */
-		size = 64 * 1024;
-		if (copy_length < size) {
-			size = copy_length;
+	compact->copied = true;
+
+failure:
+	return (result);
+}
+
+isc_result_t
+dns_journal_compact_finish(dns_journalcompact_t *compact) {
+	isc_result_t result;
+	journal_rawheader_t rawheader;
+	journal_xhdr_t xhdr;
+	dns_journal_t *j1 = NULL;
+	dns_journal_t *j2;
+	uint32_t copy_length;
+	const char *source;
+
+	REQUIRE(JOURNALCOMPACT_VALID(compact));
+	REQUIRE(compact->copied);
+
+	j2 = compact->j2;
+	source = compact->is_backup ? compact->backup : compact->filename;
+
+	/*
+	 * Reopen the source to pick up transactions committed in the
+	 * meantime.
+	 */
+	result = journal_open(compact->mctx, source, false, false, &j1);
+	if (result == ISC_R_NOTFOUND) {
+		result = ISC_R_CANCELED;
+	}
+	CHECK(result);
+
+	/*
+	 * Make sure the source is the journal we copied from, extended
+	 * only by appending new transactions.
+	 */
+	if (!compact_samefile(compact, source) ||
+	    j1->header.begin.serial != compact->origin.serial ||
+	    j1->header.begin.offset != compact->origin.offset ||
+	    j1->header.end.offset < compact->end.offset)
+	{
+		FAIL(ISC_R_CANCELED);
+	}
+	if (j1->header.end.offset == compact->end.offset) {
+		if (j1->header.end.serial != compact->end.serial) {
+			FAIL(ISC_R_CANCELED);
 		}
-		buf = isc_mem_get(mctx, size);
-
-		CHECK(journal_seek(j1, best_guess.offset));
-		CHECK(journal_seek(j2, indexend));
-		for (i = 0; i < copy_length; i += size) {
-			unsigned int len = (copy_length - i) > size
-						   ? size
-						   : (copy_length - i);
-			CHECK(journal_read(j1, buf, len));
-			CHECK(journal_write(j2, buf, len));
+	} else {
+		CHECK(journal_seek(j1, compact->end.offset));
+		CHECK(journal_read_xhdr(j1, &xhdr));
+		if (xhdr.serial0 != compact->end.serial) {
+			FAIL(ISC_R_CANCELED);
 		}
+	}
+
+	copy_length = j1->header.end.offset - compact->begin.offset;
+	if (copy_length != 0) {
+		uint32_t tail = j1->header.end.offset - compact->end.offset;
 
+		/*
+		 * Copy the transactions committed since we started.
+		 */
+		CHECK(journal_seek(j2, compact->indexend +
+					       (compact->end.offset -
+						compact->begin.offset)));
+		CHECK(journal_copy(compact->mctx, j1, j2, compact->end.offset,
+				   tail));
 		CHECK(journal_fsync(j2));
 
 		/*
 		 * Compute new header.
 		 */
-		j2->header.begin.serial = best_guess.serial;
-		j2->header.begin.offset = indexend;
+		j2->header.begin.serial = compact->begin.serial;
+		j2->header.begin.offset = compact->indexend;
 		j2->header.end.serial = j1->header.end.serial;
-		j2->header.end.offset = indexend + copy_length;
+		j2->header.end.offset = compact->indexend + copy_length;
 		j2->header.sourceserial = j1->header.sourceserial;
 		j2->header.serialset = j1->header.serialset;
 
@@ -2370,22 +2591,12 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 		CHECK(journal_fsync(j2));
 
 		/*
-		 * Build new index.
-		 */
-		current_pos = j2->header.begin;
-		while (current_pos.serial != j2->header.end.serial) {
-			index_add(j2, &current_pos);
-			CHECK(journal_next(j2, &current_pos));
-		}
-
-		/*
-		 * Write index.
+		 * Finish the index and write it out.
 		 */
+		CHECK(journal_index_range(j2, &compact->indexed,
+					  j2->header.end.serial));
 		CHECK(index_to_disk(j2));
 		CHECK(journal_fsync(j2));
-
-		indexend = j2->header.end.offset;
-		POST(indexend);
 	}
 
 	/*
@@ -2393,7 +2604,11 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	 * necessary on WIN32).
 	 */
 	dns_journal_destroy(&j1);
-	dns_journal_destroy(&j2);
+	dns_journal_destroy(&compact->j2);
+	if (!compact_samefile(compact, source)) {
+		FAIL(ISC_R_CANCELED);
+	}
+	dns_journal_destroy(&compact->j1);
 
 	/*
 	 * With a UFS file system this should just succeed and be atomic.
@@ -2406,20 +2621,20 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	 * if so, hopefully they'll be finished by the next time we
 	 * compact.)
 	 */
-	if (rename(newname, filename) == -1) {
-		if (errno == EEXIST && !is_backup) {
-			result = isc_file_remove(backup);
+	if (rename(compact->newname, compact->filename) == -1) {
+		if (errno == EEXIST && !compact->is_backup) {
+			result = isc_file_remove(compact->backup);
 			if (result != ISC_R_SUCCESS &&
 			    result != ISC_R_FILENOTFOUND) {
 				goto failure;
 			}
-			if (rename(filename, backup) == -1) {
+			if (rename(compact->filename, compact->backup) == -1) {
 				goto maperrno;
 			}
-			if (rename(newname, filename) == -1) {
+			if (rename(compact->newname, compact->filename) == -1) {
 				goto maperrno;
 			}
-			(void)isc_file_remove(backup);
+			(void)isc_file_remove(compact->backup);
 		} else {
 		maperrno:
 			result = ISC_R_FAILURE;
@@ -2430,16 +2645,53 @@ dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
 	result = ISC_R_SUCCESS;
 
 failure:
-	(void)isc_file_remove(newname);
-	if (buf != NULL) {
-		isc_mem_put(mctx, buf, size);
-	}
 	if (j1 != NULL) {
 		dns_journal_destroy(&j1);
 	}
-	if (j2 != NULL) {
-		dns_journal_destroy(&j2);
+	return (result);
+}
+
+void
+dns_journal_compact_destroy(dns_journalcompact_t **compactp) {
+	dns_journalcompact_t *compact;
+
+	REQUIRE(compactp != NULL && *compactp != NULL);
+
+	compact = *compactp;
+	*compactp = NULL;
+
+	compact->magic = 0;
+	if (compact->j1 != NULL) {
+		dns_journal_destroy(&compact->j1);
+	}
+	if (compact->j2 != NULL) {
+		dns_journal_destroy(&compact->j2);
+	}
+	(void)isc_file_remove(compact->newname);
+	isc_mem_free(compact->mctx, compact->filename);
+	isc_mem_putanddetach(&compact->mctx, compact, sizeof(*compact));
+}
+
+isc_result_t
+dns_journal_compact(isc_mem_t *mctx, char *filename, uint32_t serial,
+		    uint32_t target_size) {
+	isc_result_t result;
+	dns_journalcompact_t *compact = NULL;
+
+	result = dns_journal_compact_begin(mctx, filename, serial, target_size,
+					   &compact);
+	if (result == DNS_R_UPTODATE) {
+		return (ISC_R_SUCCESS);
+	}
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	result = dns_journal_compact_copy(compact);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_journal_compact_finish(compact);
 	}
+	dns_journal_compact_destroy(&compact);
 	return (result);
 }
 
@@ -29,6 +29,7 @@
 #include <isc/time.h>
 #include <isc/types.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/db.h>
 #include <dns/dbiterator.h>
@@ -231,6 +232,39 @@ static char spaces[N_SPACES + 1] = "          ";
 #define N_TABS 10
 static char tabs[N_TABS + 1] = "\t\t\t\t\t\t\t\t\t\t";
 
+/*%
+ * A database node taken from the iterator, waiting to be formatted.
+ */
+typedef struct dumpnode {
+	dns_dbnode_t *node;
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	dns_fixedname_t forigin;
+	dns_name_t *origin; /* origin in effect, NULL if none seen yet */
+	bool neworigin;
+} dumpnode_t;
+
+/*%
+ * A run of consecutive nodes formatted into memory by one worker.
+ *
+ * The text format carries state from one node to the next ($ORIGIN,
+ * $TTL, and whether the class has been printed).  A worker starts
+ * each chunk from the initial state, so the output of the first
+ * 'prefix' nodes, 'prefixlen' bytes, may need to be formatted again
+ * once the state left behind by the previous chunk is known; after
+ * that the state is the same either way.
+ */
+typedef struct dumpchunk {
+	unsigned int start;
+	unsigned int count;
+	unsigned int prefix;
+	unsigned int prefixlen;
+	dns_totext_ctx_t tctx;
+	isc_buffer_t buffer;
+	isc_buffer_t *out;
+	isc_result_t result;
+} dumpchunk_t;
+
 struct dns_dumpctx {
 	unsigned int magic;
 	isc_mem_t *mctx;
@@ -257,11 +291,26 @@ struct dns_dumpctx {
 	isc_result_t (*dumpsets)(isc_mem_t *mctx, const dns_name_t *name,
 				 dns_rdatasetiter_t *rdsiter,
 				 dns_totext_ctx_t *ctx, isc_buffer_t *buffer,
-				 FILE *f);
+				 isc_buffer_t *out);
+	/* Parallel formatting */
+	isc_workpool_t *pool;
+	dns_name_t *origin;
+	dumpnode_t *batch;
+	unsigned int batchsize;
+	dumpchunk_t *chunks;
+	unsigned int nchunks;
+	isc_buffer_t *out;
 };
 
 #define NXDOMAIN(x) (((x)->attributes & DNS_RDATASETATTR_NXDOMAIN) != 0)
 
+/*
+ * Upper bound on the number of nodes dumped in one quantum, per thread
+ * formatting them, and the smallest run of nodes handed to a worker.
+ */
+#define DUMP_MAXNODES 1000
+#define DUMP_MINCHUNK 16
+
 static const dns_indent_t default_indent = { "\t", 1 };
 static const dns_indent_t default_yamlindent = { "  ", 1 };
 
@@ -900,7 +949,8 @@ dns_master_questiontotext(const dns_name_t *owner_name,
 }
 
 /*
- * Print an rdataset.  'buffer' is a scratch buffer, which must have been
+ * Print an rdataset to 'out', which must be an automatically reallocating
+ * dynamic buffer.  'buffer' is a scratch buffer, which must have been
  * dynamically allocated by the caller.  It must be large enough to
  * hold the result from dns_ttl_totext().  If more than that is needed,
  * the buffer will be grown automatically.
@@ -908,7 +958,7 @@ dns_master_questiontotext(const dns_name_t *owner_name,
 
 static isc_result_t
 dump_rdataset(isc_mem_t *mctx, const dns_name_t *name, dns_rdataset_t *rdataset,
-	      dns_totext_ctx_t *ctx, isc_buffer_t *buffer, FILE *f) {
+	      dns_totext_ctx_t *ctx, isc_buffer_t *buffer, isc_buffer_t *out) {
 	isc_region_t r;
 	isc_result_t result;
 
@@ -927,10 +977,13 @@ dump_rdataset(isc_mem_t *mctx, const dns_name_t *name, dns_rdataset_t *rdataset,
 							true, buffer);
 				INSIST(result == ISC_R_SUCCESS);
 				isc_buffer_usedregion(buffer, &r);
-				fprintf(f, "$TTL %u\t; %.*s\n", rdataset->ttl,
-					(int)r.length, (char *)r.base);
+				(void)isc_buffer_printf(out, "$TTL %u\t; %.*s\n",
+							rdataset->ttl,
+							(int)r.length,
+							(char *)r.base);
 			} else {
-				fprintf(f, "$TTL %u\n", rdataset->ttl);
+				(void)isc_buffer_printf(out, "$TTL %u\n",
+							rdataset->ttl);
 			}
 			ctx->current_ttl = rdataset->ttl;
 			ctx->current_ttl_valid = true;
@@ -961,17 +1014,10 @@ dump_rdataset(isc_mem_t *mctx, const dns_name_t *name, dns_rdataset_t *rdataset,
 	}
 
 	/*
-	 * Write the buffer contents to the master file.
+	 * Append the buffer contents to the output.
 	 */
 	isc_buffer_usedregion(buffer, &r);
-	result = isc_stdio_write(r.base, 1, (size_t)r.length, f, NULL);
-
-	if (result != ISC_R_SUCCESS) {
-		UNEXPECTED_ERROR(__FILE__, __LINE__,
-				 "master file write failed: %s",
-				 isc_result_totext(result));
-		return (result);
-	}
+	isc_buffer_putmem(out, r.base, r.length);
 
 	return (ISC_R_SUCCESS);
 }
@@ -1031,7 +1077,7 @@ dump_order_compare(const void *a, const void *b) {
 static isc_result_t
 dump_rdatasets_text(isc_mem_t *mctx, const dns_name_t *name,
 		    dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
-		    isc_buffer_t *buffer, FILE *f) {
+		    isc_buffer_t *buffer, isc_buffer_t *out) {
 	isc_result_t itresult, dumpresult;
 	isc_region_t r;
 	dns_rdataset_t rdatasets[MAXSORT];
@@ -1046,7 +1092,8 @@ dump_rdatasets_text(isc_mem_t *mctx, const dns_name_t *name,
 		itresult = dns_name_totext(ctx->neworigin, false, buffer);
 		RUNTIME_CHECK(itresult == ISC_R_SUCCESS);
 		isc_buffer_usedregion(buffer, &r);
-		fprintf(f, "$ORIGIN %.*s\n", (int)r.length, (char *)r.base);
+		(void)isc_buffer_printf(out, "$ORIGIN %.*s\n", (int)r.length,
+					(char *)r.base);
 		ctx->neworigin = NULL;
 	}
 
@@ -1071,10 +1118,12 @@ again:
 			{
 				unsigned int j;
 				for (j = 0; j < ctx->indent.count; j++) {
-					fprintf(f, "%s", ctx->indent.string);
+					isc_buffer_putstr(out,
+							  ctx->indent.string);
 				}
 			}
-			fprintf(f, "; %s\n", dns_trust_totext(rds->trust));
+			(void)isc_buffer_printf(out, "; %s\n",
+						dns_trust_totext(rds->trust));
 		}
 		if (((rds->attributes & DNS_RDATASETATTR_NEGATIVE) != 0) &&
 		    (ctx->style.flags & DNS_STYLEFLAG_NCACHE) == 0)
@@ -1083,13 +1132,15 @@ again:
 		} else {
 			isc_result_t result;
 			if (STALE(rds)) {
-				fprintf(f,
+				(void)isc_buffer_printf(
+					out,
 					"; stale (will be retained for "
 					"%u more seconds)\n",
 					(rds->stale_ttl -
 					 ctx->serve_stale_ttl));
 			}
-			result = dump_rdataset(mctx, name, rds, ctx, buffer, f);
+			result = dump_rdataset(mctx, name, rds, ctx, buffer,
+					       out);
 			if (result != ISC_R_SUCCESS) {
 				dumpresult = result;
 			}
@@ -1111,10 +1162,11 @@ again:
 			{
 				unsigned int j;
 				for (j = 0; j < ctx->indent.count; j++) {
-					fprintf(f, "%s", ctx->indent.string);
+					isc_buffer_putstr(out,
+							  ctx->indent.string);
 				}
 			}
-			fprintf(f, "; resign=%s\n", buf);
+			(void)isc_buffer_printf(out, "; resign=%s\n", buf);
 		}
 		dns_rdataset_disassociate(rds);
 	}
@@ -1143,7 +1195,8 @@ again:
  */
 static isc_result_t
 dump_rdataset_raw(isc_mem_t *mctx, const dns_name_t *name,
-		  dns_rdataset_t *rdataset, isc_buffer_t *buffer, FILE *f) {
+		  dns_rdataset_t *rdataset, isc_buffer_t *buffer,
+		  isc_buffer_t *out) {
 	isc_result_t result;
 	uint32_t totallen;
 	uint16_t dlen;
@@ -1231,24 +1284,17 @@ restart:
 	INSIST(isc_buffer_usedlength(buffer) < totallen);
 
 	/*
-	 * Write the buffer contents to the raw master file.
+	 * Append the buffer contents to the output.
 	 */
-	result = isc_stdio_write(r.base, 1, (size_t)r.length, f, NULL);
+	isc_buffer_putmem(out, r.base, r.length);
 
-	if (result != ISC_R_SUCCESS) {
-		UNEXPECTED_ERROR(__FILE__, __LINE__,
-				 "raw master file write failed: %s",
-				 isc_result_totext(result));
-		return (result);
-	}
-
-	return (result);
+	return (ISC_R_SUCCESS);
 }
 
 static isc_result_t
 dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 		   dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
-		   isc_buffer_t *buffer, FILE *f) {
+		   isc_buffer_t *buffer, isc_buffer_t *out) {
 	isc_result_t result;
 	dns_rdataset_t rdataset;
 	dns_fixedname_t fixed;
@@ -1270,7 +1316,7 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 			/* Omit negative cache entries */
 		} else {
 			result = dump_rdataset_raw(mctx, name, &rdataset,
-						   buffer, f);
+						   buffer, out);
 		}
 		dns_rdataset_disassociate(&rdataset);
 		if (result != ISC_R_SUCCESS) {
@@ -1288,13 +1334,13 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 static isc_result_t
 dump_rdatasets_map(isc_mem_t *mctx, const dns_name_t *name,
 		   dns_rdatasetiter_t *rdsiter, dns_totext_ctx_t *ctx,
-		   isc_buffer_t *buffer, FILE *f) {
+		   isc_buffer_t *buffer, isc_buffer_t *out) {
 	UNUSED(mctx);
 	UNUSED(name);
 	UNUSED(rdsiter);
 	UNUSED(ctx);
 	UNUSED(buffer);
-	UNUSED(f);
+	UNUSED(out);
 
 	return (ISC_R_NOTIMPLEMENTED);
 }
@@ -1316,8 +1362,26 @@ dumptostreaminc(dns_dumpctx_t *dctx);
 
 static void
 dumpctx_destroy(dns_dumpctx_t *dctx) {
+	unsigned int i;
+
 	dctx->magic = 0;
 	isc_mutex_destroy(&dctx->lock);
+	for (i = 0; i < dctx->nchunks; i++) {
+		dumpchunk_t *chunk = &dctx->chunks[i];
+		isc_mem_put(dctx->mctx, chunk->buffer.base,
+			    chunk->buffer.length);
+		isc_buffer_free(&chunk->out);
+	}
+	isc_mem_put(dctx->mctx, dctx->chunks,
+		    dctx->nchunks * sizeof(dctx->chunks[0]));
+	if (dctx->batch != NULL) {
+		isc_mem_put(dctx->mctx, dctx->batch,
+			    dctx->batchsize * sizeof(dctx->batch[0]));
+	}
+	isc_buffer_free(&dctx->out);
+	if (dctx->pool != NULL) {
+		isc_workpool_detach(&dctx->pool);
+	}
 	dns_dbiterator_destroy(&dctx->dbiter);
 	if (dctx->version != NULL) {
 		dns_db_closeversion(dctx->db, &dctx->version, false);
@@ -1501,11 +1565,13 @@ task_send(dns_dumpctx_t *dctx) {
 
 static isc_result_t
 dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
-	       const dns_master_style_t *style, FILE *f, dns_dumpctx_t **dctxp,
-	       dns_masterformat_t format, dns_masterrawheader_t *header) {
+	       const dns_master_style_t *style, FILE *f, isc_workpool_t *pool,
+	       dns_dumpctx_t **dctxp, dns_masterformat_t format,
+	       dns_masterrawheader_t *header) {
 	dns_dumpctx_t *dctx;
 	isc_result_t result;
 	unsigned int options;
+	unsigned int i;
 
 	dctx = isc_mem_get(mctx, sizeof(*dctx));
 
@@ -1523,6 +1589,13 @@ dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	dctx->file = NULL;
 	dctx->tmpfile = NULL;
 	dctx->format = format;
+	dctx->pool = NULL;
+	dctx->origin = NULL;
+	dctx->batch = NULL;
+	dctx->batchsize = 0;
+	dctx->chunks = NULL;
+	dctx->nchunks = 0;
+	dctx->out = NULL;
 	if (header == NULL) {
 		dns_master_initrawheader(&dctx->header);
 	} else {
@@ -1585,6 +1658,33 @@ dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	} else if (!dns_db_iscache(db)) {
 		dns_db_currentversion(dctx->db, &dctx->version);
 	}
+
+	/*
+	 * With more than one thread available, split each quantum into
+	 * twice as many chunks as there are threads, so that a chunk of
+	 * expensive nodes does not hold up the others.
+	 */
+	if (pool != NULL) {
+		isc_workpool_attach(pool, &dctx->pool);
+	}
+	dctx->nchunks = isc_workpool_size(dctx->pool);
+	if (dctx->nchunks > 1) {
+		dctx->nchunks *= 2;
+	}
+	dctx->chunks = isc_mem_get(mctx,
+				   dctx->nchunks * sizeof(dctx->chunks[0]));
+	for (i = 0; i < dctx->nchunks; i++) {
+		dumpchunk_t *chunk = &dctx->chunks[i];
+		isc_buffer_init(&chunk->buffer,
+				isc_mem_get(mctx, initial_buffer_length),
+				initial_buffer_length);
+		chunk->out = NULL;
+		isc_buffer_allocate(mctx, &chunk->out, initial_buffer_length);
+		isc_buffer_setautorealloc(chunk->out, true);
+	}
+	isc_buffer_allocate(mctx, &dctx->out, initial_buffer_length);
+	isc_buffer_setautorealloc(dctx->out, true);
+
 	isc_mem_attach(mctx, &dctx->mctx);
 
 	isc_refcount_init(&dctx->references, 1);
@@ -1676,21 +1776,268 @@ writeheader(dns_dumpctx_t *dctx) {
 	return (result);
 }
 
+/*
+ * Format one node collected from the iterator into 'out'.
+ */
 static isc_result_t
-dumptostreaminc(dns_dumpctx_t *dctx) {
+dump_node(dns_dumpctx_t *dctx, dumpnode_t *dn, dns_totext_ctx_t *ctx,
+	  isc_buffer_t *buffer, isc_buffer_t *out) {
+	isc_result_t result;
+	dns_rdatasetiter_t *rdsiter = NULL;
+
+	if (dn->neworigin) {
+		if ((ctx->style.flags & DNS_STYLEFLAG_REL_DATA) != 0) {
+			ctx->origin = dn->origin;
+		}
+		ctx->neworigin = dn->origin;
+	}
+	result = dns_db_allrdatasets(dctx->db, dn->node, dctx->version,
+				     dctx->now, &rdsiter);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+	result = (dctx->dumpsets)(dctx->mctx, dn->name, rdsiter, ctx, buffer,
+				  out);
+	dns_rdatasetiter_destroy(&rdsiter);
+	return (result);
+}
+
+/*
+ * Is 'ctx' in the state a text dump starts in?
+ */
+static bool
+dump_atstart(const dns_totext_ctx_t *ctx) {
+	return (!ctx->class_printed && !ctx->current_ttl_valid &&
+		ctx->neworigin == NULL);
+}
+
+/*
+ * Worker: format chunk 'index' of the current batch into memory,
+ * starting from the initial text state.
+ */
+static void
+dump_chunk(void *arg, size_t index) {
+	dns_dumpctx_t *dctx = arg;
+	dumpchunk_t *chunk = &dctx->chunks[index];
+	dumpnode_t *dn = &dctx->batch[chunk->start];
+	dns_totext_ctx_t *ctx = &chunk->tctx;
+	bool settled = (dctx->format != dns_masterformat_text);
+	unsigned int i;
+
+	/*
+	 * The style, line break string and indentation are shared with
+	 * dctx->tctx, which is not modified while the workers run.
+	 */
+	*ctx = dctx->tctx;
+	ctx->class_printed = false;
+	ctx->current_ttl = 0;
+	ctx->current_ttl_valid = false;
+	ctx->neworigin = NULL;
+	if ((ctx->style.flags & DNS_STYLEFLAG_REL_DATA) != 0) {
+		ctx->origin = dn->origin;
+	}
+
+	isc_buffer_clear(chunk->out);
+	chunk->prefix = 0;
+	chunk->prefixlen = 0;
+	chunk->result = ISC_R_SUCCESS;
+
+	for (i = 0; i < chunk->count; i++) {
+		chunk->result = dump_node(dctx, &dn[i], ctx, &chunk->buffer,
+					  chunk->out);
+		if (chunk->result != ISC_R_SUCCESS) {
+			return;
+		}
+		/*
+		 * Once an rdataset has been printed, $TTL and the class
+		 * no longer depend on what came before this chunk, and
+		 * any pending $ORIGIN has been printed along with it.
+		 */
+		if (!settled && ctx->class_printed) {
+			settled = true;
+			chunk->prefix = i + 1;
+			chunk->prefixlen = isc_buffer_usedlength(chunk->out);
+		}
+	}
+	if (!settled) {
+		chunk->prefix = chunk->count;
+		chunk->prefixlen = isc_buffer_usedlength(chunk->out);
+	}
+}
+
+static isc_result_t
+dump_write(dns_dumpctx_t *dctx, isc_region_t *r) {
+	isc_result_t result;
+
+	if (r->length == 0) {
+		return (ISC_R_SUCCESS);
+	}
+	result = isc_stdio_write(r->base, 1, (size_t)r->length, dctx->f,
+				 NULL);
+	if (result != ISC_R_SUCCESS) {
+		UNEXPECTED_ERROR(__FILE__, __LINE__,
+				 "master file write failed: %s",
+				 isc_result_totext(result));
+	}
+	return (result);
+}
+
+/*
+ * Write a formatted chunk to the output file.  If the chunk was
+ * formatted from a state other than the one the previous chunk left
+ * behind, the nodes whose text depends on that are formatted again
+ * here first.
+ */
+static isc_result_t
+write_chunk(dns_dumpctx_t *dctx, dumpchunk_t *chunk) {
+	isc_result_t result;
+	isc_region_t r;
+	bool redone = false;
+	unsigned int i;
+
+	if (chunk->result != ISC_R_SUCCESS) {
+		return (chunk->result);
+	}
+
+	isc_buffer_usedregion(chunk->out, &r);
+	if (chunk->prefix > 0 && !dump_atstart(&dctx->tctx)) {
+		isc_region_t pr;
+
+		isc_buffer_clear(dctx->out);
+		for (i = 0; i < chunk->prefix; i++) {
+			RETERR(dump_node(dctx, &dctx->batch[chunk->start + i],
+					 &dctx->tctx, &chunk->buffer,
+					 dctx->out));
+		}
+		isc_buffer_usedregion(dctx->out, &pr);
+		RETERR(dump_write(dctx, &pr));
+		isc_region_consume(&r, chunk->prefixlen);
+		redone = true;
+	}
+	result = dump_write(dctx, &r);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	if (!redone || chunk->prefix < chunk->count) {
+		dctx->tctx.class_printed = chunk->tctx.class_printed;
+		dctx->tctx.current_ttl = chunk->tctx.current_ttl;
+		dctx->tctx.current_ttl_valid = chunk->tctx.current_ttl_valid;
+		dctx->tctx.origin = chunk->tctx.origin;
+		dctx->tctx.neworigin = chunk->tctx.neworigin;
+	}
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Take up to 'max' nodes from the iterator into dctx->batch.
+ */
+static isc_result_t
+collect_nodes(dns_dumpctx_t *dctx, unsigned int max, unsigned int *countp) {
 	isc_result_t result = ISC_R_SUCCESS;
-	isc_buffer_t buffer;
-	char *bufmem;
-	dns_name_t *name;
-	dns_fixedname_t fixname;
-	unsigned int nodes;
-	isc_time_t start;
+	dns_name_t *origin = dctx->origin;
+	unsigned int count = 0;
 
-	bufmem = isc_mem_get(dctx->mctx, initial_buffer_length);
+	/*
+	 * The names in the batch point into it, so it can only be
+	 * resized while empty.
+	 */
+	if (dctx->batchsize < max) {
+		if (dctx->batch != NULL) {
+			isc_mem_put(dctx->mctx, dctx->batch,
+				    dctx->batchsize * sizeof(dctx->batch[0]));
+		}
+		dctx->batch = isc_mem_get(dctx->mctx,
+					  max * sizeof(dctx->batch[0]));
+		dctx->batchsize = max;
+	}
 
-	isc_buffer_init(&buffer, bufmem, initial_buffer_length);
+	while (result == ISC_R_SUCCESS && count < max) {
+		dumpnode_t *dn = &dctx->batch[count];
+
+		dn->node = NULL;
+		dn->name = dns_fixedname_initname(&dn->fname);
+		result = dns_dbiterator_current(dctx->dbiter, &dn->node,
+						dn->name);
+		if (result != ISC_R_SUCCESS && result != DNS_R_NEWORIGIN) {
+			break;
+		}
+		dn->neworigin = (result == DNS_R_NEWORIGIN);
+		if (dn->neworigin) {
+			origin = dns_fixedname_initname(&dn->forigin);
+			result = dns_dbiterator_origin(dctx->dbiter, origin);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		}
+		dn->origin = origin;
+		count++;
+		result = dns_dbiterator_next(dctx->dbiter);
+	}
+
+	*countp = count;
+	return (result);
+}
+
+/*
+ * Format the 'count' nodes in dctx->batch, spread over the worker
+ * pool, and write them out in order.
+ */
+static isc_result_t
+dump_batch(dns_dumpctx_t *dctx, unsigned int count) {
+	isc_result_t result = ISC_R_SUCCESS;
+	unsigned int nchunks, start, i;
+	dumpnode_t *last;
 
-	name = dns_fixedname_initname(&fixname);
+	if (count == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	nchunks = ISC_MIN(dctx->nchunks, count / DUMP_MINCHUNK);
+	if (nchunks == 0) {
+		nchunks = 1;
+	}
+	for (i = 0, start = 0; i < nchunks; i++) {
+		dctx->chunks[i].start = start;
+		dctx->chunks[i].count = count / nchunks +
+					(i < count % nchunks ? 1 : 0);
+		start += dctx->chunks[i].count;
+	}
+	INSIST(start == count);
+
+	isc_workpool_run(dctx->pool, nchunks, dump_chunk, dctx);
+
+	for (i = 0; i < nchunks && result == ISC_R_SUCCESS; i++) {
+		result = write_chunk(dctx, &dctx->chunks[i]);
+	}
+
+	/*
+	 * The batch is about to be reused; keep the origin that is in
+	 * effect where it ends in dctx->tctx.origin_fixname.
+	 */
+	last = &dctx->batch[count - 1];
+	if (last->origin != dctx->origin) {
+		dctx->origin = dns_fixedname_name(&dctx->tctx.origin_fixname);
+		dns_name_copynf(last->origin, dctx->origin);
+		if (dctx->tctx.origin != NULL) {
+			dctx->tctx.origin = dctx->origin;
+		}
+		if (dctx->tctx.neworigin != NULL) {
+			dctx->tctx.neworigin = dctx->origin;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		dns_db_detachnode(dctx->db, &dctx->batch[i].node);
+	}
+
+	return (result);
+}
+
+static isc_result_t
+dumptostreaminc(dns_dumpctx_t *dctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_result_t tresult;
+	unsigned int nodes, maxnodes, count;
+	isc_time_t start;
 
 	if (dctx->first) {
 		CHECK(writeheader(dctx));
@@ -1717,43 +2064,24 @@ dumptostreaminc(dns_dumpctx_t *dctx) {
 		result = ISC_R_SUCCESS;
 	}
 
-	nodes = dctx->nodes;
+	/*
+	 * Nodes are taken from the iterator in batches, which are
+	 * formatted in parallel and written out in order.  The iterator
+	 * is paused while a batch is formatted.
+	 */
+	maxnodes = DUMP_MAXNODES * isc_workpool_size(dctx->pool);
 	isc_time_now(&start);
-	while (result == ISC_R_SUCCESS && (dctx->nodes == 0 || nodes--)) {
-		dns_rdatasetiter_t *rdsiter = NULL;
-		dns_dbnode_t *node = NULL;
-
-		result = dns_dbiterator_current(dctx->dbiter, &node, name);
-		if (result != ISC_R_SUCCESS && result != DNS_R_NEWORIGIN) {
-			break;
-		}
-		if (result == DNS_R_NEWORIGIN) {
-			dns_name_t *origin =
-				dns_fixedname_name(&dctx->tctx.origin_fixname);
-			result = dns_dbiterator_origin(dctx->dbiter, origin);
-			RUNTIME_CHECK(result == ISC_R_SUCCESS);
-			if ((dctx->tctx.style.flags & DNS_STYLEFLAG_REL_DATA) !=
-			    0) {
-				dctx->tctx.origin = origin;
-			}
-			dctx->tctx.neworigin = origin;
-		}
-		result = dns_db_allrdatasets(dctx->db, node, dctx->version,
-					     dctx->now, &rdsiter);
-		if (result != ISC_R_SUCCESS) {
-			dns_db_detachnode(dctx->db, &node);
-			goto cleanup;
-		}
-		result = (dctx->dumpsets)(dctx->mctx, name, rdsiter,
-					  &dctx->tctx, &buffer, dctx->f);
-		dns_rdatasetiter_destroy(&rdsiter);
-		if (result != ISC_R_SUCCESS) {
-			dns_db_detachnode(dctx->db, &node);
+	do {
+		nodes = (dctx->nodes == 0) ? maxnodes : dctx->nodes;
+		result = collect_nodes(dctx, nodes, &count);
+		RUNTIME_CHECK(dns_dbiterator_pause(dctx->dbiter) ==
+			      ISC_R_SUCCESS);
+		tresult = dump_batch(dctx, count);
+		if (tresult != ISC_R_SUCCESS) {
+			result = tresult;
 			goto cleanup;
 		}
-		dns_db_detachnode(dctx->db, &node);
-		result = dns_dbiterator_next(dctx->dbiter);
-	}
+	} while (dctx->nodes == 0 && result == ISC_R_SUCCESS);
 
 	/*
 	 * Work out how many nodes can be written in the time between
@@ -1778,16 +2106,16 @@ dumptostreaminc(dns_dumpctx_t *dctx) {
 		usecs = isc_time_microdiff(&end, &start);
 		if (usecs == 0) {
 			dctx->nodes = dctx->nodes * 2;
-			if (dctx->nodes > 1000) {
-				dctx->nodes = 1000;
+			if (dctx->nodes > maxnodes) {
+				dctx->nodes = maxnodes;
 			}
 		} else {
 			nodes = dctx->nodes * interval;
 			nodes /= (unsigned int)usecs;
 			if (nodes == 0) {
 				nodes = 1;
-			} else if (nodes > 1000) {
-				nodes = 1000;
+			} else if (nodes > maxnodes) {
+				nodes = maxnodes;
 			}
 
 			/* Smooth and assign. */
@@ -1805,7 +2133,6 @@ dumptostreaminc(dns_dumpctx_t *dctx) {
 	}
 cleanup:
 	RUNTIME_CHECK(dns_dbiterator_pause(dctx->dbiter) == ISC_R_SUCCESS);
-	isc_mem_put(dctx->mctx, buffer.base, buffer.length);
 	return (result);
 }
 
@@ -1813,8 +2140,9 @@ isc_result_t
 dns_master_dumptostreaminc(isc_mem_t *mctx, dns_db_t *db,
 			   dns_dbversion_t *version,
 			   const dns_master_style_t *style, FILE *f,
-			   isc_task_t *task, dns_dumpdonefunc_t done,
-			   void *done_arg, dns_dumpctx_t **dctxp) {
+			   isc_workpool_t *pool, isc_task_t *task,
+			   dns_dumpdonefunc_t done, void *done_arg,
+			   dns_dumpctx_t **dctxp) {
 	dns_dumpctx_t *dctx = NULL;
 	isc_result_t result;
 
@@ -1822,7 +2150,7 @@ dns_master_dumptostreaminc(isc_mem_t *mctx, dns_db_t *db,
 	REQUIRE(f != NULL);
 	REQUIRE(done != NULL);
 
-	result = dumpctx_create(mctx, db, version, style, f, &dctx,
+	result = dumpctx_create(mctx, db, version, style, f, pool, &dctx,
 				dns_masterformat_text, NULL);
 	if (result != ISC_R_SUCCESS) {
 		return (result);
@@ -1850,8 +2178,8 @@ dns_master_dumptostream(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	dns_dumpctx_t *dctx = NULL;
 	isc_result_t result;
 
-	result = dumpctx_create(mctx, db, version, style, f, &dctx, format,
-				header);
+	result = dumpctx_create(mctx, db, version, style, f, NULL, &dctx,
+				format, header);
 	if (result != ISC_R_SUCCESS) {
 		return (result);
 	}
@@ -1904,7 +2232,8 @@ cleanup:
 isc_result_t
 dns_master_dumpinc(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		   const dns_master_style_t *style, const char *filename,
-		   isc_task_t *task, dns_dumpdonefunc_t done, void *done_arg,
+		   isc_workpool_t *pool, isc_task_t *task,
+		   dns_dumpdonefunc_t done, void *done_arg,
 		   dns_dumpctx_t **dctxp, dns_masterformat_t format,
 		   dns_masterrawheader_t *header) {
 	FILE *f = NULL;
@@ -1920,8 +2249,8 @@ dns_master_dumpinc(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		goto cleanup;
 	}
 
-	result = dumpctx_create(mctx, db, version, style, f, &dctx, format,
-				header);
+	result = dumpctx_create(mctx, db, version, style, f, pool, &dctx,
+				format, header);
 	if (result != ISC_R_SUCCESS) {
 		(void)isc_stdio_close(f);
 		(void)isc_file_remove(tempname);
@@ -1970,8 +2299,8 @@ dns_master_dump(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		return (result);
 	}
 
-	result = dumpctx_create(mctx, db, version, style, f, &dctx, format,
-				header);
+	result = dumpctx_create(mctx, db, version, style, f, NULL, &dctx,
+				format, header);
 	if (result != ISC_R_SUCCESS) {
 		goto cleanup;
 	}
@@ -1998,10 +2327,12 @@ dns_master_dumpnodetostream(isc_mem_t *mctx, dns_db_t *db,
 			    const dns_master_style_t *style, FILE *f) {
 	isc_result_t result;
 	isc_buffer_t buffer;
+	isc_buffer_t *out = NULL;
 	char *bufmem;
 	isc_stdtime_t now;
 	dns_totext_ctx_t ctx;
 	dns_rdatasetiter_t *rdsiter = NULL;
+	isc_region_t r;
 
 	result = totext_ctx_init(style, NULL, &ctx);
 	if (result != ISC_R_SUCCESS) {
@@ -2015,20 +2346,24 @@ dns_master_dumpnodetostream(isc_mem_t *mctx, dns_db_t *db,
 	bufmem = isc_mem_get(mctx, initial_buffer_length);
 
 	isc_buffer_init(&buffer, bufmem, initial_buffer_length);
+	isc_buffer_allocate(mctx, &out, initial_buffer_length);
+	isc_buffer_setautorealloc(out, true);
 
 	result = dns_db_allrdatasets(db, node, version, now, &rdsiter);
 	if (result != ISC_R_SUCCESS) {
 		goto failure;
 	}
-	result = dump_rdatasets_text(mctx, name, rdsiter, &ctx, &buffer, f);
+	result = dump_rdatasets_text(mctx, name, rdsiter, &ctx, &buffer, out);
+	dns_rdatasetiter_destroy(&rdsiter);
 	if (result != ISC_R_SUCCESS) {
 		goto failure;
 	}
-	dns_rdatasetiter_destroy(&rdsiter);
 
-	result = ISC_R_SUCCESS;
+	isc_buffer_usedregion(out, &r);
+	result = isc_stdio_write(r.base, 1, (size_t)r.length, f, NULL);
 
 failure:
+	isc_buffer_free(&out);
 	isc_mem_put(mctx, buffer.base, buffer.length);
 	return (result);
 }
@@ -334,6 +334,8 @@ typedef struct {
 	isc_refcount_t references;
 	/* Locked by lock. */
 	bool exiting;
+	/* Only used by the cache expiry sweep; see expiredata(). */
+	unsigned int reclaimable;
 } rbtdb_nodelock_t;
 
 typedef struct rbtdb_changed {
@@ -462,6 +464,12 @@ struct dns_rbtdb {
 	isc_mem_t *hmctx;
 	isc_heap_t **heaps;
 
+	/*
+	 * The bucket at which the next cache expiry sweep resumes.
+	 * Only used by expiredata(), whose callers serialize it.
+	 */
+	unsigned int sweep_next;
+
 	/*
 	 * Base values for the mmap() code.
 	 */
@@ -8278,6 +8286,136 @@ getservestalettl(dns_db_t *db, dns_ttl_t *ttl) {
 	return (ISC_R_SUCCESS);
 }
 
+/*%
+ * Count the headers in 'heap' at or below index 'idx' that expired before
+ * 'expire', giving up once 'limit' of them have been found.  Expired
+ * headers always form a subtree rooted at the top of the heap, so only
+ * they and their direct children are examined.
+ *
+ * Caller must hold the node lock of the bucket.
+ */
+static unsigned int
+count_expired(isc_heap_t *heap, unsigned int idx, isc_stdtime_t expire,
+	      unsigned int limit) {
+	rdatasetheader_t *header;
+	unsigned int count;
+
+	if (limit == 0) {
+		return (0);
+	}
+
+	header = isc_heap_element(heap, idx);
+	if (header == NULL || header->rdh_ttl >= expire) {
+		return (0);
+	}
+
+	count = 1;
+	count += count_expired(heap, 2 * idx, expire, limit - count);
+	count += count_expired(heap, 2 * idx + 1, expire, limit - count);
+
+	return (count);
+}
+
+/*%
+ * Incrementally remove expired entries from a cache, spending at most
+ * 'budget' header expirations per call.  Buckets are visited round-robin
+ * starting where the previous call stopped; within each bucket, entries
+ * are taken from the top of the TTL heap, so no tree walk is needed.
+ * When the cache is over its memory limit, the least recently used
+ * entries of each visited bucket are evicted as well.
+ */
+static isc_result_t
+expiredata(dns_db_t *db, isc_stdtime_t now, unsigned int budget,
+	   unsigned int *reclaimablep) {
+	dns_rbtdb_t *rbtdb = (dns_rbtdb_t *)db;
+	rdatasetheader_t *header;
+	isc_heap_t *heap;
+	isc_stdtime_t expire;
+	unsigned int locknum, visited, evict, lrubudget, limit;
+	unsigned int reclaimable = 0;
+	bool overmem;
+
+	REQUIRE(VALID_RBTDB(rbtdb));
+	REQUIRE(IS_CACHE(rbtdb));
+
+	if (now == 0) {
+		isc_stdtime_get(&now);
+	}
+
+	/*
+	 * Data that may still be served stale is not reclaimable yet.
+	 */
+	expire = now - RBTDB_VIRTUAL - rbtdb->serve_stale_ttl;
+
+	overmem = isc_mem_isovermem(rbtdb->common.mctx);
+	lrubudget = ISC_MAX(budget / rbtdb->node_lock_count, 1);
+	limit = budget;
+
+	for (visited = 0; visited < rbtdb->node_lock_count && budget > 0;
+	     visited++)
+	{
+		locknum = rbtdb->sweep_next;
+		heap = rbtdb->heaps[locknum];
+
+		NODE_LOCK(&rbtdb->node_locks[locknum].lock,
+			  isc_rwlocktype_write);
+
+		while (budget > 0) {
+			header = isc_heap_element(heap, 1);
+			if (header == NULL || header->rdh_ttl >= expire) {
+				break;
+			}
+			/*
+			 * Take the header off the heap before expiring it,
+			 * so that a header which cannot be freed yet because
+			 * its node is still in use doesn't stay at the top
+			 * of the heap and hide the entries below it.
+			 */
+			isc_heap_delete(heap, 1);
+			expire_header(rbtdb, header, false, expire_ttl);
+			budget--;
+		}
+
+		for (evict = lrubudget; overmem && evict > 0 && budget > 0;
+		     evict--)
+		{
+			header = ISC_LIST_TAIL(rbtdb->rdatasets[locknum]);
+			if (header == NULL) {
+				break;
+			}
+			ISC_LIST_UNLINK(rbtdb->rdatasets[locknum], header,
+					link);
+			expire_header(rbtdb, header, false, expire_lru);
+			budget--;
+		}
+
+		rbtdb->node_locks[locknum].reclaimable =
+			count_expired(heap, 1, expire, limit);
+
+		NODE_UNLOCK(&rbtdb->node_locks[locknum].lock,
+			    isc_rwlocktype_write);
+
+		/*
+		 * Only move on once the bucket has been drained, so that
+		 * the next call resumes with whatever was left here.
+		 */
+		if (rbtdb->node_locks[locknum].reclaimable == 0) {
+			rbtdb->sweep_next = (locknum + 1) %
+					    rbtdb->node_lock_count;
+		}
+	}
+
+	if (reclaimablep != NULL) {
+		for (locknum = 0; locknum < rbtdb->node_lock_count; locknum++)
+		{
+			reclaimable += rbtdb->node_locks[locknum].reclaimable;
+		}
+		*reclaimablep = reclaimable;
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
 static dns_dbmethods_t zone_methods = { attach,
 					detach,
 					beginload,
@@ -8325,7 +8463,8 @@ static dns_dbmethods_t zone_methods = { attach,
 					getsize,
 					NULL, /* setservestalettl */
 					NULL, /* getservestalettl */
-					setgluecachestats };
+					setgluecachestats,
+					NULL /* expiredata */ };
 
 static dns_dbmethods_t cache_methods = { attach,
 					 detach,
@@ -8374,7 +8513,8 @@ static dns_dbmethods_t cache_methods = { attach,
 					 NULL, /* getsize */
 					 setservestalettl,
 					 getservestalettl,
-					 NULL };
+					 NULL, /* setgluecachestats */
+					 expiredata };
 
 isc_result_t
 dns_rbtdb_create(isc_mem_t *mctx, const dns_name_t *origin, dns_dbtype_t type,
@@ -8507,6 +8647,7 @@ dns_rbtdb_create(isc_mem_t *mctx, const dns_name_t *origin, dns_dbtype_t type,
 			goto cleanup_deadnodes;
 		}
 		rbtdb->node_locks[i].exiting = false;
+		rbtdb->node_locks[i].reclaimable = 0;
 	}
 
 	/*
@@ -197,6 +197,14 @@
 #endif /* ifndef RES_DOMAIN_BUCKETS */
 #define RES_NOBUCKET 0xffffffff
 
+/*%
+ * Number of hash chains used to find an active fetch context within
+ * a bucket.  Must be a power of two.
+ */
+#ifndef RES_FCTX_CHAINS
+#define RES_FCTX_CHAINS 64
+#endif /* ifndef RES_FCTX_CHAINS */
+
 /*%
  * Maximum EDNS0 input packet size.
  */
@@ -208,12 +216,45 @@
  */
 #define MAX_EDNS0_TIMEOUTS 3
 
+/*%
+ * Limits on the pool of TCP connections kept open to upstream servers:
+ * the number of connections, the number of queries outstanding on each
+ * one, and how long (in seconds) an idle connection is kept open unless
+ * the server's EDNS TCP keepalive timeout is shorter.
+ */
+#define DNS_RESOLVER_TCPPOOLSIZE 64
+#define DNS_RESOLVER_TCPQUERIES	 32
+#define DNS_RESOLVER_TCPIDLE	 10
+
+/*%
+ * Hedged queries: the least time (in microseconds) to wait for an answer
+ * before hedging, and the number of hedges that can be saved up by a
+ * resolver that has been sending queries without hedging them.
+ */
+#define DNS_RESOLVER_HEDGEMIN	10000
+#define DNS_RESOLVER_HEDGEBURST 10
+
 #define DNS_RESOLVER_BADCACHESIZE 1021
 #define DNS_RESOLVER_BADCACHETTL(fctx) \
 	(((fctx)->res->lame_ttl > 30) ? (fctx)->res->lame_ttl : 30)
 
 typedef struct fetchctx fetchctx_t;
 
+/*%
+ * A TCP connection the resolver keeps open once its queries are done.
+ * The dispatch is shared like those of lib/dns/request.c, and found
+ * again with dns_dispatch_gettcp(); the pool only holds a reference to
+ * it while it is idle.
+ */
+typedef struct tcpconn {
+	/* Locked by resolver's tcplock. */
+	dns_dispatch_t *dispatch;
+	unsigned int queries; /* Outstanding queries */
+	unsigned int idle;    /* Idle timeout in seconds */
+	isc_stdtime_t expire; /* Closed when idle until then */
+	ISC_LINK(struct tcpconn) link;
+} tcpconn_t;
+
 typedef struct query {
 	/* Locked by task event serialization. */
 	unsigned int magic;
@@ -224,6 +265,8 @@ typedef struct query {
 	bool exclusivesocket;
 	dns_adbaddrinfo_t *addrinfo;
 	isc_socket_t *tcpsocket;
+	isc_sockaddr_t tcpsource;
+	tcpconn_t *tcpconn;
 	isc_time_t start;
 	dns_messageid_t id;
 	dns_dispentry_t *dispentry;
@@ -252,6 +295,9 @@ struct tried {
 #define VALID_QUERY(query) ISC_MAGIC_VALID(query, QUERY_MAGIC)
 
 #define RESQUERY_ATTR_CANCELED 0x02
+#define RESQUERY_ATTR_TCPREUSE 0x04 /* Sent on a pooled TCP connection */
+#define RESQUERY_ATTR_HEDGE    0x08 /* Sent while another was outstanding */
+#define RESQUERY_ATTR_HEDGED   0x10 /* Another was sent while outstanding */
 
 #define RESQUERY_CONNECTING(q) ((q)->connects > 0)
 #define RESQUERY_CANCELED(q)   (((q)->attributes & RESQUERY_ATTR_CANCELED) != 0)
@@ -279,6 +325,7 @@ struct fetchctx {
 	unsigned int options;
 	unsigned int bucketnum;
 	unsigned int dbucketnum;
+	unsigned int hashval;
 	char *info;
 	isc_mem_t *mctx;
 	isc_stdtime_t now;
@@ -293,6 +340,7 @@ struct fetchctx {
 	bool spilled;
 	isc_event_t control_event;
 	ISC_LINK(struct fetchctx) link;
+	ISC_LINK(struct fetchctx) hlink;
 	ISC_LIST(dns_fetchevent_t) events;
 
 	/*% Locked by task event serialization. */
@@ -302,6 +350,7 @@ struct fetchctx {
 	isc_timer_t *timer;
 	isc_time_t expires;
 	isc_interval_t interval;
+	isc_interval_t hedgeremain;
 	dns_message_t *qmessage;
 	dns_message_t *rmessage;
 	ISC_LIST(resquery_t) queries;
@@ -412,6 +461,7 @@ struct fetchctx {
 #define FCTX_ATTR_NEEDEDNS0    0x0040
 #define FCTX_ATTR_TRIEDFIND    0x0080
 #define FCTX_ATTR_TRIEDALT     0x0100
+#define FCTX_ATTR_HEDGEWAIT    0x0200
 
 #define HAVE_ANSWER(f) \
 	((atomic_load_acquire(&(f)->attributes) & FCTX_ATTR_HAVEANSWER) != 0)
@@ -431,6 +481,8 @@ struct fetchctx {
 	((atomic_load_acquire(&(f)->attributes) & FCTX_ATTR_TRIEDFIND) != 0)
 #define TRIEDALT(f) \
 	((atomic_load_acquire(&(f)->attributes) & FCTX_ATTR_TRIEDALT) != 0)
+#define HEDGEWAIT(f) \
+	((atomic_load_acquire(&(f)->attributes) & FCTX_ATTR_HEDGEWAIT) != 0)
 
 #define FCTX_ATTR_SET(f, a) atomic_fetch_or_release(&(f)->attributes, (a))
 #define FCTX_ATTR_CLR(f, a) atomic_fetch_and_release(&(f)->attributes, ~(a))
@@ -453,6 +505,7 @@ typedef struct fctxbucket {
 	isc_task_t *task;
 	isc_mutex_t lock;
 	ISC_LIST(fetchctx_t) fctxs;
+	ISC_LIST(fetchctx_t) chains[RES_FCTX_CHAINS];
 	atomic_bool exiting;
 	isc_mem_t *mctx;
 } fctxbucket_t;
@@ -534,6 +587,11 @@ struct dns_resolver {
 	unsigned int retryinterval; /* in milliseconds */
 	unsigned int nonbackofftries;
 
+	/* Hedged queries. */
+	unsigned int hedgebudget; /* percentage of queries */
+	unsigned int hedgepercentile;
+	atomic_int_fast32_t hedgecredit;
+
 	/* Atomic */
 	isc_refcount_t references;
 	atomic_uint_fast32_t zspill; /* fetches-per-zone */
@@ -550,8 +608,20 @@ struct dns_resolver {
 	/* Locked by primelock. */
 	dns_fetch_t *primefetch;
 
+	/* Locked by tcplock. */
+	isc_mutex_t tcplock;
+	ISC_LIST(tcpconn_t) tcpconns;
+	unsigned int ntcpconns;
+	isc_timer_t *tcptimer;
+
 	/* Atomic. */
 	atomic_uint_fast32_t nfctx;
+
+	/*%
+	 * View whose resolver fetches are coalesced with;
+	 * set before the resolver is frozen.
+	 */
+	dns_view_t *coalesceview;
 };
 
 #define RES_MAGIC	    ISC_MAGIC('R', 'e', 's', '!')
@@ -1211,6 +1281,191 @@ update_edns_stats(resquery_t *query) {
 	}
 }
 
+/*
+ * Close the pooled TCP connections that are no longer in use and have
+ * been idle for too long, or that have been closed by the server.  If
+ * the resolver is shutting down, close all of those not in use.
+ *
+ * Requires the resolver's tcplock to be held.
+ */
+static void
+tcpconn_sweep(dns_resolver_t *res) {
+	tcpconn_t *conn, *next;
+	isc_stdtime_t now;
+	bool exiting = atomic_load_acquire(&res->exiting);
+	isc_result_t result;
+
+	isc_stdtime_get(&now);
+
+	for (conn = ISC_LIST_HEAD(res->tcpconns); conn != NULL; conn = next) {
+		next = ISC_LIST_NEXT(conn, link);
+		if (conn->queries > 0) {
+			continue;
+		}
+		if (exiting || conn->expire <= now ||
+		    dns_dispatch_isshuttingdown(conn->dispatch)) {
+			ISC_LIST_UNLINK(res->tcpconns, conn, link);
+			res->ntcpconns--;
+			dns_dispatch_detach(&conn->dispatch);
+			isc_mem_put(res->mctx, conn, sizeof(*conn));
+		}
+	}
+
+	if (res->ntcpconns == 0 && res->tcptimer != NULL) {
+		result = isc_timer_reset(res->tcptimer, isc_timertype_inactive,
+					 NULL, NULL, true);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+}
+
+static void
+tcpconn_tick(isc_task_t *task, isc_event_t *event) {
+	dns_resolver_t *res = event->ev_arg;
+
+	REQUIRE(VALID_RESOLVER(res));
+
+	UNUSED(task);
+
+	LOCK(&res->tcplock);
+	tcpconn_sweep(res);
+	UNLOCK(&res->tcplock);
+
+	isc_event_free(&event);
+}
+
+/*
+ * Return the pool entry for 'disp', if any.
+ *
+ * Requires the resolver's tcplock to be held.
+ */
+static tcpconn_t *
+tcpconn_find(dns_resolver_t *res, dns_dispatch_t *disp) {
+	tcpconn_t *conn;
+
+	for (conn = ISC_LIST_HEAD(res->tcpconns); conn != NULL;
+	     conn = ISC_LIST_NEXT(conn, link))
+	{
+		if (conn->dispatch == disp) {
+			break;
+		}
+	}
+
+	return (conn);
+}
+
+/*
+ * Look for an open TCP connection to the server of 'query' from its
+ * source address that can take another query.  If there is one, attach
+ * 'query' to its dispatch and return true.
+ */
+static bool
+tcpconn_get(dns_resolver_t *res, resquery_t *query) {
+	const isc_sockaddr_t *local = &query->tcpsource;
+	isc_sockaddr_t any;
+	tcpconn_t *conn;
+	isc_result_t result;
+
+	if (atomic_load_acquire(&res->exiting)) {
+		return (false);
+	}
+
+	/*
+	 * Without a query source address any local address will do.
+	 */
+	isc_sockaddr_anyofpf(&any, isc_sockaddr_pf(local));
+	if (isc_sockaddr_eqaddr(local, &any)) {
+		local = NULL;
+	}
+
+	LOCK(&res->tcplock);
+	result = dns_dispatch_gettcp(query->dispatchmgr,
+				     &query->addrinfo->sockaddr, local, NULL,
+				     &query->dispatch);
+	if (result == ISC_R_SUCCESS) {
+		conn = tcpconn_find(res, query->dispatch);
+		if (conn != NULL &&
+		    (conn->queries >= DNS_RESOLVER_TCPQUERIES ||
+		     conn->idle == 0)) {
+			dns_dispatch_detach(&query->dispatch);
+		} else {
+			if (conn != NULL) {
+				conn->queries++;
+			}
+			query->tcpconn = conn;
+			query->attributes |= RESQUERY_ATTR_TCPREUSE;
+		}
+	}
+	UNLOCK(&res->tcplock);
+
+	return (query->dispatch != NULL);
+}
+
+/*
+ * Add the dispatch of a newly connected TCP query to the pool, if there
+ * is room for it.
+ */
+static void
+tcpconn_add(dns_resolver_t *res, resquery_t *query) {
+	tcpconn_t *conn;
+	isc_interval_t interval;
+	isc_result_t result;
+
+	if (atomic_load_acquire(&res->exiting)) {
+		return;
+	}
+
+	LOCK(&res->tcplock);
+	if (res->ntcpconns < DNS_RESOLVER_TCPPOOLSIZE) {
+		conn = isc_mem_get(res->mctx, sizeof(*conn));
+		*conn = (tcpconn_t){
+			.queries = 1,
+			.idle = DNS_RESOLVER_TCPIDLE,
+		};
+		ISC_LINK_INIT(conn, link);
+		dns_dispatch_attach(query->dispatch, &conn->dispatch);
+		ISC_LIST_APPEND(res->tcpconns, conn, link);
+		query->tcpconn = conn;
+
+		if (res->ntcpconns++ == 0) {
+			isc_interval_set(&interval, 1, 0);
+			result = isc_timer_reset(res->tcptimer,
+						 isc_timertype_ticker, NULL,
+						 &interval, false);
+			RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		}
+	}
+	UNLOCK(&res->tcplock);
+}
+
+/*
+ * The server has sent an EDNS TCP keepalive option; 'timeout' is in
+ * units of 100 milliseconds.
+ */
+static void
+tcpconn_keepalive(dns_resolver_t *res, resquery_t *query, uint16_t timeout) {
+	LOCK(&res->tcplock);
+	query->tcpconn->idle = ISC_MIN(DNS_RESOLVER_TCPIDLE, timeout / 10);
+	UNLOCK(&res->tcplock);
+}
+
+/*
+ * 'query' is done with its pooled TCP connection.
+ */
+static void
+tcpconn_release(dns_resolver_t *res, resquery_t *query) {
+	tcpconn_t *conn = query->tcpconn;
+	isc_stdtime_t now;
+
+	query->tcpconn = NULL;
+	isc_stdtime_get(&now);
+
+	LOCK(&res->tcplock);
+	INSIST(conn->queries > 0);
+	conn->queries--;
+	conn->expire = now + conn->idle;
+	UNLOCK(&res->tcplock);
+}
+
 static void
 fctx_cancelquery(resquery_t **queryp, dns_dispatchevent_t **deventp,
 		 isc_time_t *finish, bool no_response, bool age_untried) {
@@ -1269,7 +1524,15 @@ fctx_cancelquery(resquery_t **queryp, dns_dispatchevent_t **deventp,
 			uint32_t value;
 			uint32_t mask;
 
-			update_edns_stats(query);
+			/*
+			 * A query that lost a race with a hedged one
+			 * may just have been slow.
+			 */
+			if ((query->attributes &
+			     (RESQUERY_ATTR_HEDGE | RESQUERY_ATTR_HEDGED)) == 0)
+			{
+				update_edns_stats(query);
+			}
 
 			/*
 			 * If "forward first;" is used and a forwarder timed
@@ -1436,6 +1699,10 @@ fctx_cancelquery(resquery_t **queryp, dns_dispatchevent_t **deventp,
 		dns_tsigkey_detach(&query->tsigkey);
 	}
 
+	if (query->tcpconn != NULL) {
+		tcpconn_release(fctx->res, query);
+	}
+
 	if (query->dispatch != NULL) {
 		dns_dispatch_detach(&query->dispatch);
 	}
@@ -1915,10 +2182,10 @@ fctx_addopt(dns_message_t *message, unsigned int version, uint16_t udpsize,
 	return (dns_message_setopt(message, rdataset));
 }
 
-static inline void
+static inline unsigned int
 fctx_setretryinterval(fetchctx_t *fctx, unsigned int rtt) {
 	unsigned int seconds;
-	unsigned int us;
+	unsigned int us, total;
 
 	us = fctx->res->retryinterval * 1000;
 	/*
@@ -1958,9 +2225,81 @@ fctx_setretryinterval(fetchctx_t *fctx, unsigned int rtt) {
 		us = MAX_SINGLE_QUERY_TIMEOUT_US;
 	}
 
+	total = us;
 	seconds = us / US_PER_SEC;
 	us -= seconds * US_PER_SEC;
 	isc_interval_set(&fctx->interval, seconds, us * 1000);
+
+	return (total);
+}
+
+/*
+ * Hedge credit is earned by each query sent on its own, at the rate
+ * of 'hedgebudget' percent of a hedged query, up to a limit.
+ */
+static void
+hedge_earn(dns_resolver_t *res) {
+	int_fast32_t limit = DNS_RESOLVER_HEDGEBURST * 100;
+
+	if (atomic_load_relaxed(&res->hedgecredit) < limit) {
+		atomic_fetch_add_relaxed(&res->hedgecredit, res->hedgebudget);
+	}
+}
+
+static bool
+hedge_spend(dns_resolver_t *res) {
+	if (atomic_fetch_sub_relaxed(&res->hedgecredit, 100) >= 100) {
+		return (true);
+	}
+	atomic_fetch_add_relaxed(&res->hedgecredit, 100);
+	return (false);
+}
+
+static void
+hedge_refund(dns_resolver_t *res) {
+	atomic_fetch_add_relaxed(&res->hedgecredit, 100);
+}
+
+/*
+ * Decide whether a query about to be sent to 'addrinfo' should be
+ * hedged, and if so set '*interval' to the time after which another
+ * server is to be queried as well.  That is the configured percentile
+ * of the server's recent RTTs, provided it comes before the retry
+ * interval ('retry' microseconds).  Only UDP queries sent while no
+ * other query is outstanding are hedged.
+ */
+static bool
+fctx_hedgeinterval(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
+		   unsigned int options, unsigned int retry,
+		   isc_interval_t *interval) {
+	dns_resolver_t *res = fctx->res;
+	unsigned int us;
+
+	if (res->hedgebudget == 0 || (options & DNS_FETCHOPT_TCP) != 0 ||
+	    !ISC_LIST_EMPTY(fctx->queries))
+	{
+		return (false);
+	}
+
+	hedge_earn(res);
+
+	us = dns_adb_getrttpercentile(fctx->adb, addrinfo,
+				      res->hedgepercentile);
+	if (us == 0) {
+		return (false);
+	}
+	if (us < DNS_RESOLVER_HEDGEMIN) {
+		us = DNS_RESOLVER_HEDGEMIN;
+	}
+	if (us >= retry) {
+		return (false);
+	}
+
+	isc_interval_set(interval, us / US_PER_SEC, (us % US_PER_SEC) * 1000);
+	retry -= us;
+	isc_interval_set(&fctx->hedgeremain, retry / US_PER_SEC,
+			 (retry % US_PER_SEC) * 1000);
+	return (true);
 }
 
 static isc_result_t
@@ -1972,9 +2311,10 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	resquery_t *query;
 	isc_sockaddr_t addr;
 	bool have_addr = false;
-	unsigned int srtt;
+	unsigned int srtt, retry;
 	isc_dscp_t dscp = -1;
 	unsigned int bucketnum;
+	isc_interval_t hedge, *interval = &fctx->interval;
 
 	FCTXTRACE("query");
 
@@ -2000,8 +2340,14 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 		srtt = 1000000;
 	}
 
-	fctx_setretryinterval(fctx, srtt);
-	result = fctx_startidletimer(fctx, &fctx->interval);
+	retry = fctx_setretryinterval(fctx, srtt);
+	if (fctx_hedgeinterval(fctx, addrinfo, options, retry, &hedge)) {
+		FCTX_ATTR_SET(fctx, FCTX_ATTR_HEDGEWAIT);
+		interval = &hedge;
+	} else {
+		FCTX_ATTR_CLR(fctx, FCTX_ATTR_HEDGEWAIT);
+	}
+	result = fctx_startidletimer(fctx, interval);
 	if (result != ISC_R_SUCCESS) {
 		return (result);
 	}
@@ -2034,6 +2380,7 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	query->dispatch = NULL;
 	query->exclusivesocket = false;
 	query->tcpsocket = NULL;
+	query->tcpconn = NULL;
 	if (res->view->peers != NULL) {
 		dns_peer_t *peer = NULL;
 		isc_netaddr_t dstip;
@@ -2086,24 +2433,28 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 		if (query->dscp == -1) {
 			query->dscp = dscp;
 		}
+		query->tcpsource = addr;
 
-		result = isc_socket_create(res->socketmgr, pf,
-					   isc_sockettype_tcp,
-					   &query->tcpsocket);
-		if (result != ISC_R_SUCCESS) {
-			goto cleanup_query;
-		}
+		/*
+		 * Use an open connection to the server if there is one
+		 * in the pool.  Otherwise, a dispatch will be created
+		 * once the connect succeeds.
+		 */
+		if (!tcpconn_get(res, query)) {
+			result = isc_socket_create(res->socketmgr, pf,
+						   isc_sockettype_tcp,
+						   &query->tcpsocket);
+			if (result != ISC_R_SUCCESS) {
+				goto cleanup_query;
+			}
 
 #ifndef BROKEN_TCP_BIND_BEFORE_CONNECT
-		result = isc_socket_bind(query->tcpsocket, &addr, 0);
-		if (result != ISC_R_SUCCESS) {
-			goto cleanup_socket;
-		}
+			result = isc_socket_bind(query->tcpsocket, &addr, 0);
+			if (result != ISC_R_SUCCESS) {
+				goto cleanup_socket;
+			}
 #endif /* ifndef BROKEN_TCP_BIND_BEFORE_CONNECT */
-
-		/*
-		 * A dispatch will be created once the connect succeeds.
-		 */
+		}
 	} else {
 		if (have_addr) {
 			unsigned int attrs, attrmask;
@@ -2174,7 +2525,18 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	ISC_LINK_INIT(query, link);
 	query->magic = QUERY_MAGIC;
 
-	if ((query->options & DNS_FETCHOPT_TCP) != 0) {
+	if ((query->options & DNS_FETCHOPT_TCP) != 0 &&
+	    query->dispatch != NULL) {
+		/*
+		 * Send the query on the pooled connection.
+		 */
+		result = resquery_send(query);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup_dispatch;
+		}
+		inc_stats(res, dns_resstatscounter_tcpreuse);
+		QTRACE("reusing TCP connection");
+	} else if ((query->options & DNS_FETCHOPT_TCP) != 0) {
 		/*
 		 * Connect to the remote server.
 		 *
@@ -2190,6 +2552,7 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 			goto cleanup_socket;
 		}
 		query->connects++;
+		inc_stats(res, dns_resstatscounter_tcpconnect);
 		QTRACE("connecting via TCP");
 	} else {
 		if (dns_adbentry_overquota(addrinfo->entry)) {
@@ -2228,6 +2591,9 @@ cleanup_socket:
 	isc_socket_detach(&query->tcpsocket);
 
 cleanup_dispatch:
+	if (query->tcpconn != NULL) {
+		tcpconn_release(res, query);
+	}
 	if (query->dispatch != NULL) {
 		dns_dispatch_detach(&query->dispatch);
 	}
@@ -3034,7 +3400,6 @@ resquery_connected(isc_task_t *task, isc_event_t *event) {
 			 */
 			attrs = 0;
 			attrs |= DNS_DISPATCHATTR_TCP;
-			attrs |= DNS_DISPATCHATTR_PRIVATE;
 			attrs |= DNS_DISPATCHATTR_CONNECTED;
 			if (isc_sockaddr_pf(&query->addrinfo->sockaddr) ==
 			    AF_INET) {
@@ -3046,8 +3411,10 @@ resquery_connected(isc_task_t *task, isc_event_t *event) {
 
 			result = dns_dispatch_createtcp(
 				query->dispatchmgr, query->tcpsocket,
-				query->fctx->res->taskmgr, NULL, NULL, 4096, 2,
-				1, 1, 3, attrs, &query->dispatch);
+				query->fctx->res->taskmgr, &query->tcpsource,
+				&query->addrinfo->sockaddr, 4096, 2,
+				DNS_RESOLVER_TCPQUERIES, 1, 3, attrs,
+				&query->dispatch);
 
 			/*
 			 * Regardless of whether dns_dispatch_create()
@@ -3057,6 +3424,11 @@ resquery_connected(isc_task_t *task, isc_event_t *event) {
 			isc_socket_detach(&query->tcpsocket);
 
 			if (result == ISC_R_SUCCESS) {
+				/*
+				 * Keep the connection open for later
+				 * queries to the same server.
+				 */
+				tcpconn_add(fctx->res, query);
 				result = resquery_send(query);
 			}
 
@@ -4474,6 +4846,9 @@ fctx_unlink(fetchctx_t *fctx) {
 	bucketnum = fctx->bucketnum;
 
 	ISC_LIST_UNLINK(res->buckets[bucketnum].fctxs, fctx, link);
+	ISC_LIST_UNLINK(res->buckets[bucketnum]
+				.chains[fctx->hashval & (RES_FCTX_CHAINS - 1)],
+			fctx, hlink);
 
 	REQUIRE(atomic_fetch_sub_release(&res->nfctx, 1) > 0);
 
@@ -4557,6 +4932,74 @@ fctx_destroy(fetchctx_t *fctx) {
 	isc_mem_putanddetach(&fctx->mctx, fctx, sizeof(*fctx));
 }
 
+/*
+ * The outstanding query has not been answered within the hedging
+ * interval: send it to the next server as well, if the budget allows,
+ * and keep waiting for the first answer from either.
+ */
+static void
+fctx_hedge(fetchctx_t *fctx, isc_time_t *due) {
+	isc_result_t result;
+	dns_adbaddrinfo_t *addrinfo = NULL;
+	dns_resolver_t *res = fctx->res;
+	resquery_t *query;
+	unsigned int bucketnum;
+	bool bucket_empty;
+
+	/*
+	 * Nothing to do if the query was replaced by another one since
+	 * the timer was started.
+	 */
+	query = ISC_LIST_HEAD(fctx->queries);
+	if (query != NULL && isc_time_compare(due, &query->start) < 0) {
+		return;
+	}
+
+	if (query != NULL && hedge_spend(res)) {
+		addrinfo = fctx_nextaddress(fctx);
+		while (addrinfo != NULL &&
+		       dns_adbentry_overquota(addrinfo->entry)) {
+			addrinfo = fctx_nextaddress(fctx);
+		}
+		if (addrinfo == NULL) {
+			hedge_refund(res);
+		}
+	}
+
+	if (addrinfo == NULL ||
+	    isc_counter_increment(fctx->qc) != ISC_R_SUCCESS) {
+		/*
+		 * Wait out the rest of the retry interval.
+		 */
+		result = fctx_startidletimer(fctx, &fctx->hedgeremain);
+		if (result != ISC_R_SUCCESS) {
+			fctx_done(fctx, result, __LINE__);
+		}
+		return;
+	}
+
+	FCTXTRACE("hedge");
+
+	query->attributes |= RESQUERY_ATTR_HEDGED;
+	fctx_increference(fctx);
+	result = fctx_query(fctx, addrinfo, fctx->options);
+	if (result != ISC_R_SUCCESS) {
+		bucketnum = fctx->bucketnum;
+		fctx_done(fctx, result, __LINE__);
+		LOCK(&res->buckets[bucketnum].lock);
+		bucket_empty = fctx_decreference(fctx);
+		UNLOCK(&res->buckets[bucketnum].lock);
+		if (bucket_empty) {
+			empty_bucket(res);
+		}
+		return;
+	}
+
+	query = ISC_LIST_TAIL(fctx->queries);
+	query->attributes |= RESQUERY_ATTR_HEDGE;
+	inc_stats(res, dns_resstatscounter_hedge);
+}
+
 /*
  * Fetch event handlers.
  */
@@ -4573,6 +5016,13 @@ fctx_timeout(isc_task_t *task, isc_event_t *event) {
 
 	FCTXTRACE("timeout");
 
+	if (event->ev_type != ISC_TIMEREVENT_LIFE && HEDGEWAIT(fctx)) {
+		FCTX_ATTR_CLR(fctx, FCTX_ATTR_HEDGEWAIT);
+		fctx_hedge(fctx, &tevent->due);
+		isc_event_free(&event);
+		return;
+	}
+
 	inc_stats(fctx->res, dns_resstatscounter_querytimeout);
 
 	if (event->ev_type == ISC_TIMEREVENT_LIFE) {
@@ -4880,8 +5330,8 @@ static isc_result_t
 fctx_create(dns_resolver_t *res, const dns_name_t *name, dns_rdatatype_t type,
 	    const dns_name_t *domain, dns_rdataset_t *nameservers,
 	    const isc_sockaddr_t *client, unsigned int options,
-	    unsigned int bucketnum, unsigned int depth, isc_counter_t *qc,
-	    fetchctx_t **fctxp) {
+	    unsigned int bucketnum, unsigned int hashval, unsigned int depth,
+	    isc_counter_t *qc, fetchctx_t **fctxp) {
 	fetchctx_t *fctx;
 	isc_result_t result;
 	isc_result_t iresult;
@@ -4939,6 +5389,7 @@ fctx_create(dns_resolver_t *res, const dns_name_t *name, dns_rdatatype_t type,
 	fctx->res = res;
 	isc_refcount_init(&fctx->references, 0);
 	fctx->bucketnum = bucketnum;
+	fctx->hashval = hashval;
 	fctx->dbucketnum = RES_NOBUCKET;
 	fctx->state = fetchstate_init;
 	fctx->want_shutdown = false;
@@ -5127,6 +5578,7 @@ fctx_create(dns_resolver_t *res, const dns_name_t *name, dns_rdatatype_t type,
 	 * correct value before a query is issued.
 	 */
 	isc_interval_set(&fctx->interval, 2, 0);
+	isc_interval_set(&fctx->hedgeremain, 0, 0);
 
 	/*
 	 * Create an inactive timer.  It will be made active when the fetch
@@ -5155,6 +5607,7 @@ fctx_create(dns_resolver_t *res, const dns_name_t *name, dns_rdatatype_t type,
 
 	ISC_LIST_INIT(fctx->events);
 	ISC_LINK_INIT(fctx, link);
+	ISC_LINK_INIT(fctx, hlink);
 	fctx->magic = FCTX_MAGIC;
 
 	/*
@@ -5172,6 +5625,9 @@ fctx_create(dns_resolver_t *res, const dns_name_t *name, dns_rdatatype_t type,
 	}
 
 	ISC_LIST_APPEND(res->buckets[bucketnum].fctxs, fctx, link);
+	ISC_LIST_APPEND(res->buckets[bucketnum]
+				.chains[hashval & (RES_FCTX_CHAINS - 1)],
+			fctx, hlink);
 
 	REQUIRE(atomic_fetch_add_relaxed(&res->nfctx, 1) < UINT32_MAX);
 
@@ -7960,8 +8416,17 @@ rctx_dispfail(respctx_t *rctx) {
 		return (ISC_R_SUCCESS);
 	}
 
-	if (devent->result == ISC_R_EOF &&
-	    (rctx->retryopts & DNS_FETCHOPT_NOEDNS0) == 0)
+	if ((query->attributes & RESQUERY_ATTR_TCPREUSE) != 0 &&
+	    (devent->result == ISC_R_EOF ||
+	     devent->result == ISC_R_CONNECTIONRESET))
+	{
+		/*
+		 * The server closed a pooled connection before it got
+		 * the query; try again on a new one.
+		 */
+		rctx->resend = true;
+	} else if (devent->result == ISC_R_EOF &&
+		   (rctx->retryopts & DNS_FETCHOPT_NOEDNS0) == 0)
 	{
 		/*
 		 * The problem might be that they don't understand EDNS0.
@@ -8154,6 +8619,15 @@ rctx_opt(respctx_t *rctx) {
 					  dns_resstatscounter_cookiein);
 				seen_cookie = true;
 				break;
+			case DNS_OPT_TCP_KEEPALIVE:
+				if (optlen == 2 && query->tcpconn != NULL) {
+					tcpconn_keepalive(
+						fctx->res, query,
+						isc_buffer_getuint16(&optbuf));
+				} else {
+					isc_buffer_forward(&optbuf, optlen);
+				}
+				break;
 			default:
 				isc_buffer_forward(&optbuf, optlen);
 				break;
@@ -9656,6 +10130,7 @@ rctx_done(respctx_t *rctx, isc_result_t result) {
 	resquery_t *query = rctx->query;
 	fetchctx_t *fctx = rctx->fctx;
 	dns_adbaddrinfo_t *addrinfo = query->addrinfo;
+	bool hedge = ((query->attributes & RESQUERY_ATTR_HEDGE) != 0);
 
 	FCTXTRACE4("query canceled in response(); ",
 		   rctx->no_response ? "no response" : "responding", result);
@@ -9670,6 +10145,17 @@ rctx_done(respctx_t *rctx, isc_result_t result) {
 				 rctx->no_response, false);
 	}
 
+	/*
+	 * Count hedged queries whose answer is used.  Any other queries
+	 * still outstanding are canceled by fctx_done(), or when
+	 * following a referral.
+	 */
+	if (hedge && !rctx->no_response && !rctx->nextitem && !rctx->resend &&
+	    (!rctx->next_server || rctx->get_nameservers))
+	{
+		inc_stats(fctx->res, dns_resstatscounter_hedgewin);
+	}
+
 #ifdef ENABLE_AFL
 	if (dns_fuzzing_resolver &&
 	    (rctx->next_server || rctx->resend || rctx->nextitem))
@@ -10031,6 +10517,15 @@ destroy(dns_resolver_t *res) {
 	isc_rwlock_destroy(&res->mbslock);
 #endif /* if USE_MBSLOCK */
 	isc_timer_detach(&res->spillattimer);
+	LOCK(&res->tcplock);
+	tcpconn_sweep(res);
+	INSIST(ISC_LIST_EMPTY(res->tcpconns));
+	UNLOCK(&res->tcplock);
+	isc_timer_detach(&res->tcptimer);
+	isc_mutex_destroy(&res->tcplock);
+	if (res->coalesceview != NULL) {
+		dns_view_weakdetach(&res->coalesceview);
+	}
 	res->magic = 0;
 	isc_mem_put(res->mctx, res, sizeof(*res));
 }
@@ -10113,7 +10608,7 @@ dns_resolver_create(dns_view_t *view, isc_taskmgr_t *taskmgr,
 		    dns_resolver_t **resp) {
 	dns_resolver_t *res;
 	isc_result_t result = ISC_R_SUCCESS;
-	unsigned int i, buckets_created = 0, dbuckets_created = 0;
+	unsigned int i, j, buckets_created = 0, dbuckets_created = 0;
 	isc_task_t *task = NULL;
 	char name[16];
 	unsigned dispattr;
@@ -10158,11 +10653,15 @@ dns_resolver_create(dns_view_t *view, isc_taskmgr_t *taskmgr,
 	res->zero_no_soa_ttl = false;
 	res->retryinterval = 30000;
 	res->nonbackofftries = 3;
+	res->hedgebudget = 0;
+	res->hedgepercentile = 95;
+	atomic_init(&res->hedgecredit, 0);
 	res->query_timeout = DEFAULT_QUERY_TIMEOUT;
 	res->maxdepth = DEFAULT_RECURSION_DEPTH;
 	res->maxqueries = DEFAULT_MAX_QUERIES;
 	res->quotaresp[dns_quotatype_zone] = DNS_R_DROP;
 	res->quotaresp[dns_quotatype_server] = DNS_R_SERVFAIL;
+	res->coalesceview = NULL;
 	res->nbuckets = ntasks;
 	if (view->resstats != NULL) {
 		isc_stats_set(view->resstats, ntasks,
@@ -10195,6 +10694,9 @@ dns_resolver_create(dns_view_t *view, isc_taskmgr_t *taskmgr,
 		isc_mem_setname(res->buckets[i].mctx, name, NULL);
 		isc_task_setname(res->buckets[i].task, name, res);
 		ISC_LIST_INIT(res->buckets[i].fctxs);
+		for (j = 0; j < RES_FCTX_CHAINS; j++) {
+			ISC_LIST_INIT(res->buckets[i].chains[j]);
+		}
 		atomic_init(&res->buckets[i].exiting, false);
 		buckets_created++;
 	}
@@ -10238,6 +10740,10 @@ dns_resolver_create(dns_view_t *view, isc_taskmgr_t *taskmgr,
 
 	isc_mutex_init(&res->lock);
 	isc_mutex_init(&res->primelock);
+	isc_mutex_init(&res->tcplock);
+	ISC_LIST_INIT(res->tcpconns);
+	res->ntcpconns = 0;
+	res->tcptimer = NULL;
 
 	task = NULL;
 	result = isc_task_create(taskmgr, 0, &task);
@@ -10249,8 +10755,16 @@ dns_resolver_create(dns_view_t *view, isc_taskmgr_t *taskmgr,
 	result = isc_timer_create(timermgr, isc_timertype_inactive, NULL, NULL,
 				  task, spillattimer_countdown, res,
 				  &res->spillattimer);
+	if (result != ISC_R_SUCCESS) {
+		isc_task_detach(&task);
+		goto cleanup_primelock;
+	}
+
+	result = isc_timer_create(timermgr, isc_timertype_inactive, NULL, NULL,
+				  task, tcpconn_tick, res, &res->tcptimer);
 	isc_task_detach(&task);
 	if (result != ISC_R_SUCCESS) {
+		isc_timer_detach(&res->spillattimer);
 		goto cleanup_primelock;
 	}
 
@@ -10287,10 +10801,12 @@ cleanup_alglock:
 
 #if USE_ALGLOCK || USE_MBSLOCK
 cleanup_spillattimer:
+	isc_timer_detach(&res->tcptimer);
 	isc_timer_detach(&res->spillattimer);
 #endif /* if USE_ALGLOCK || USE_MBSLOCK */
 
 cleanup_primelock:
+	isc_mutex_destroy(&res->tcplock);
 	isc_mutex_destroy(&res->primelock);
 	isc_mutex_destroy(&res->lock);
 
@@ -10525,6 +11041,15 @@ dns_resolver_shutdown(dns_resolver_t *res) {
 					 isc_timertype_inactive, NULL, NULL,
 					 true);
 		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+		/*
+		 * Close the pooled TCP connections that are not in use;
+		 * the rest are closed by the timer once their queries
+		 * are done.
+		 */
+		LOCK(&res->tcplock);
+		tcpconn_sweep(res);
+		UNLOCK(&res->tcplock);
 	}
 	UNLOCK(&res->lock);
 }
@@ -10549,9 +11074,18 @@ dns_resolver_detach(dns_resolver_t **resp) {
 	}
 }
 
+static inline unsigned int
+fctx_hash(const dns_name_t *name, dns_rdatatype_t type) {
+	/*
+	 * Mix the type into the name hash, so that fetches for different
+	 * types of a popular name are spread over different buckets.
+	 */
+	return ((dns_name_fullhash(name, false) ^ type) * 0x9e3779b1U);
+}
+
 static inline bool
 fctx_match(fetchctx_t *fctx, const dns_name_t *name, dns_rdatatype_t type,
-	   unsigned int options) {
+	   unsigned int hashval, unsigned int options) {
 	/*
 	 * Don't match fetch contexts that are shutting down.
 	 */
@@ -10561,7 +11095,8 @@ fctx_match(fetchctx_t *fctx, const dns_name_t *name, dns_rdatatype_t type,
 		return (false);
 	}
 
-	if (fctx->type != type || fctx->options != options) {
+	if (fctx->hashval != hashval || fctx->type != type ||
+	    fctx->options != options) {
 		return (false);
 	}
 	return (dns_name_equal(&fctx->name, name));
@@ -10679,21 +11214,19 @@ fctx_minimize_qname(fetchctx_t *fctx) {
 	return (result);
 }
 
-isc_result_t
-dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
-			 dns_rdatatype_t type, const dns_name_t *domain,
-			 dns_rdataset_t *nameservers,
-			 dns_forwarders_t *forwarders,
-			 const isc_sockaddr_t *client, dns_messageid_t id,
-			 unsigned int options, unsigned int depth,
-			 isc_counter_t *qc, isc_task_t *task,
-			 isc_taskaction_t action, void *arg,
-			 dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
-			 dns_fetch_t **fetchp) {
+static isc_result_t
+createfetch(dns_resolver_t *res, dns_resolver_t *origin,
+	    const dns_name_t *name, dns_rdatatype_t type,
+	    const dns_name_t *domain, dns_rdataset_t *nameservers,
+	    const isc_sockaddr_t *client, dns_messageid_t id,
+	    unsigned int options, unsigned int depth, isc_counter_t *qc,
+	    isc_task_t *task, isc_taskaction_t action, void *arg,
+	    dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
+	    dns_fetch_t **fetchp) {
 	dns_fetch_t *fetch;
 	fetchctx_t *fctx = NULL;
 	isc_result_t result = ISC_R_SUCCESS;
-	unsigned int bucketnum;
+	unsigned int bucketnum, hashval, chain;
 	bool new_fctx = false;
 	isc_event_t *event;
 	unsigned int count = 0;
@@ -10701,24 +11234,6 @@ dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
 	unsigned int spillatmin;
 	bool dodestroy = false;
 
-	UNUSED(forwarders);
-
-	REQUIRE(VALID_RESOLVER(res));
-	REQUIRE(res->frozen);
-	/* XXXRTH  Check for meta type */
-	if (domain != NULL) {
-		REQUIRE(DNS_RDATASET_VALID(nameservers));
-		REQUIRE(nameservers->type == dns_rdatatype_ns);
-	} else {
-		REQUIRE(nameservers == NULL);
-	}
-	REQUIRE(forwarders == NULL);
-	REQUIRE(!dns_rdataset_isassociated(rdataset));
-	REQUIRE(sigrdataset == NULL || !dns_rdataset_isassociated(sigrdataset));
-	REQUIRE(fetchp != NULL && *fetchp == NULL);
-
-	log_fetch(name, type);
-
 	/*
 	 * XXXRTH  use a mempool?
 	 */
@@ -10726,7 +11241,8 @@ dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
 	fetch->mctx = NULL;
 	isc_mem_attach(res->mctx, &fetch->mctx);
 
-	bucketnum = dns_name_fullhash(name, false) % res->nbuckets;
+	hashval = fctx_hash(name, type);
+	bucketnum = (hashval >> 16) % res->nbuckets;
 
 	LOCK(&res->lock);
 	spillat = res->spillat;
@@ -10740,10 +11256,11 @@ dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
 	}
 
 	if ((options & DNS_FETCHOPT_UNSHARED) == 0) {
-		for (fctx = ISC_LIST_HEAD(res->buckets[bucketnum].fctxs);
-		     fctx != NULL; fctx = ISC_LIST_NEXT(fctx, link))
+		chain = hashval & (RES_FCTX_CHAINS - 1);
+		for (fctx = ISC_LIST_HEAD(res->buckets[bucketnum].chains[chain]);
+		     fctx != NULL; fctx = ISC_LIST_NEXT(fctx, hlink))
 		{
-			if (fctx_match(fctx, name, type, options)) {
+			if (fctx_match(fctx, name, type, hashval, options)) {
 				break;
 			}
 		}
@@ -10779,14 +11296,19 @@ dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
 
 	if (fctx == NULL) {
 		result = fctx_create(res, name, type, domain, nameservers,
-				     client, options, bucketnum, depth, qc,
-				     &fctx);
+				     client, options, bucketnum, hashval, depth,
+				     qc, &fctx);
 		if (result != ISC_R_SUCCESS) {
 			goto unlock;
 		}
 		new_fctx = true;
-	} else if (fctx->depth > depth) {
-		fctx->depth = depth;
+	} else {
+		if (fctx->depth > depth) {
+			fctx->depth = depth;
+		}
+		if (origin != res) {
+			inc_stats(origin, dns_resstatscounter_coalesced);
+		}
 	}
 
 	result = fctx_join(fctx, task, client, id, action, arg, rdataset,
@@ -10828,6 +11350,64 @@ unlock:
 	return (result);
 }
 
+isc_result_t
+dns_resolver_createfetch(dns_resolver_t *res, const dns_name_t *name,
+			 dns_rdatatype_t type, const dns_name_t *domain,
+			 dns_rdataset_t *nameservers,
+			 dns_forwarders_t *forwarders,
+			 const isc_sockaddr_t *client, dns_messageid_t id,
+			 unsigned int options, unsigned int depth,
+			 isc_counter_t *qc, isc_task_t *task,
+			 isc_taskaction_t action, void *arg,
+			 dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
+			 dns_fetch_t **fetchp) {
+	dns_resolver_t *peer;
+	isc_result_t result;
+
+	UNUSED(forwarders);
+
+	REQUIRE(VALID_RESOLVER(res));
+	REQUIRE(res->frozen);
+	/* XXXRTH  Check for meta type */
+	if (domain != NULL) {
+		REQUIRE(DNS_RDATASET_VALID(nameservers));
+		REQUIRE(nameservers->type == dns_rdatatype_ns);
+	} else {
+		REQUIRE(nameservers == NULL);
+	}
+	REQUIRE(forwarders == NULL);
+	REQUIRE(!dns_rdataset_isassociated(rdataset));
+	REQUIRE(sigrdataset == NULL || !dns_rdataset_isassociated(sigrdataset));
+	REQUIRE(fetchp != NULL && *fetchp == NULL);
+
+	log_fetch(name, type);
+
+	/*
+	 * If this resolver's fetches are coalesced with those of another
+	 * view, start (or join) the fetch there.  Fall back to our own
+	 * buckets if that resolver is not usable, e.g. because it is
+	 * shutting down.
+	 */
+	if (res->coalesceview != NULL &&
+	    (options & DNS_FETCHOPT_UNSHARED) == 0)
+	{
+		peer = res->coalesceview->resolver;
+		if (peer != NULL && peer->frozen) {
+			result = createfetch(peer, res, name, type, domain,
+					     nameservers, client, id, options,
+					     depth, qc, task, action, arg,
+					     rdataset, sigrdataset, fetchp);
+			if (result != ISC_R_SHUTTINGDOWN) {
+				return (result);
+			}
+		}
+	}
+
+	return (createfetch(res, res, name, type, domain, nameservers, client,
+			    id, options, depth, qc, task, action, arg, rdataset,
+			    sigrdataset, fetchp));
+}
+
 void
 dns_resolver_cancelfetch(dns_fetch_t *fetch) {
 	fetchctx_t *fctx;
@@ -11620,3 +12200,47 @@ dns_resolver_setnonbackofftries(dns_resolver_t *resolver, unsigned int tries) {
 
 	resolver->nonbackofftries = tries;
 }
+
+unsigned int
+dns_resolver_gethedgebudget(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (resolver->hedgebudget);
+}
+
+void
+dns_resolver_sethedgebudget(dns_resolver_t *resolver, unsigned int budget) {
+	REQUIRE(VALID_RESOLVER(resolver));
+	REQUIRE(budget <= 100);
+
+	resolver->hedgebudget = budget;
+}
+
+void
+dns_resolver_setcoalesce(dns_resolver_t *resolver, dns_view_t *view) {
+	REQUIRE(VALID_RESOLVER(resolver));
+	REQUIRE(!resolver->frozen);
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(view->resolver != resolver);
+
+	if (resolver->coalesceview != NULL) {
+		dns_view_weakdetach(&resolver->coalesceview);
+	}
+	dns_view_weakattach(view, &resolver->coalesceview);
+}
+
+unsigned int
+dns_resolver_gethedgepercentile(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (resolver->hedgepercentile);
+}
+
+void
+dns_resolver_sethedgepercentile(dns_resolver_t *resolver,
+				unsigned int percentile) {
+	REQUIRE(VALID_RESOLVER(resolver));
+	REQUIRE(percentile > 0 && percentile < 100);
+
+	resolver->hedgepercentile = percentile;
+}
@@ -30,6 +30,7 @@
 #include <dns/dnsrps.h>
 #include <dns/events.h>
 #include <dns/fixedname.h>
+#include <dns/journal.h>
 #include <dns/log.h>
 #include <dns/rbt.h>
 #include <dns/rdata.h>
@@ -40,6 +41,8 @@
 #include <dns/rpz.h>
 #include <dns/view.h>
 
+#include "rpz_p.h"
+
 /*
  * Parallel radix trees for databases of response policy IP addresses
  *
@@ -91,12 +94,23 @@
  */
 #define DNS_RPZ_QUANTUM 1024
 
+/*
+ * Initial hashtable size for the names changed by an incremental update
+ */
+#define DNS_RPZ_HTSIZE_CHANGED 10
+
 static void
 dns_rpz_update_from_db(dns_rpz_zone_t *rpz);
 
 static void
 dns_rpz_update_taskaction(isc_task_t *task, isc_event_t *event);
 
+static void
+index_schedule(dns_rpz_zones_t *rpzs);
+
+static void
+index_free(isc_mem_t *mctx, dns_rpz_index_t **indexp);
+
 /*
  * Use a private definition of IPv6 addresses because s6_addr32 is not
  * always defined and our IPv6 addresses are in non-standard byte order
@@ -170,6 +184,62 @@ struct dns_rpz_nm_data {
 	dns_rpz_nm_zbits_t wild;
 };
 
+/*
+ * The summary databases above are changed in place as triggers are
+ * added and deleted.  When an update of a policy zone is done, a
+ * compact copy of them is built on the updater task and replaces the
+ * previous one as a whole.  dns_rpz_find_ip() and dns_rpz_find_name()
+ * search the copy when there is one, so they see the triggers of
+ * complete zone versions and do not wait for updates in progress.
+ *
+ * Names are in a trie with a node per name in the summary RBT.  The
+ * children of a node are next to each other in DNSSEC order and are
+ * found by binary search.  Their labels are next to each other in
+ * 'labels'.  The trigger bits of a node are an index into 'nmdata',
+ * which holds each distinct combination of bits once.
+ *
+ * Addresses are in a multibit trie consuming IDX_STRIDE bits per
+ * level, kept as a tree bitmap.  A node has a bit for each of the
+ * IDX_PREFIXES prefixes that can end in it and a bit for each of its
+ * IDX_CHILDREN possible children.  The children of a node are next to
+ * each other in 'ipnodes', as are the indexes into 'ipdata' of its
+ * prefixes in 'ipprefix', so the position of either is the number of
+ * bits set before its own.
+ */
+#define IDX_STRIDE   4
+#define IDX_CHILDREN (1 << IDX_STRIDE)
+#define IDX_PREFIXES (IDX_CHILDREN - 1)
+
+typedef struct {
+	uint32_t label; /* offset of the label in 'labels' */
+	uint32_t down;	/* first child */
+	uint32_t ndown; /* number of children */
+	uint32_t data;	/* trigger bits in 'nmdata' */
+} rpz_nmnode_t;
+
+typedef struct {
+	uint16_t prefixes; /* prefixes ending in the node */
+	uint16_t children; /* children of the node */
+	uint32_t down;	   /* first child */
+	uint32_t prefix;   /* first prefix in 'ipprefix' */
+} rpz_ipnode_t;
+
+struct dns_rpz_index {
+	dns_rpz_have_t	      have;
+	rpz_nmnode_t *	      nmnodes;
+	uint32_t	      nmcount;
+	unsigned char *	      labels;
+	uint32_t	      labelsize;
+	dns_rpz_nm_data_t *   nmdata;
+	uint32_t	      nmdatacount;
+	rpz_ipnode_t *	      ipnodes;
+	uint32_t	      ipcount;
+	uint32_t *	      ipprefix;
+	uint32_t	      ipprefixcount;
+	dns_rpz_addr_zbits_t *ipdata;
+	uint32_t	      ipdatacount;
+};
+
 static void
 rpz_detach(dns_rpz_zone_t **rpzp);
 
@@ -635,11 +705,28 @@ adj_trigger_cnt(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 	}
 }
 
+/*
+ * Clear the bits of an IP address after the first 'prefix' bits.
+ */
+static void
+trim_key(dns_rpz_cidr_key_t *ip, dns_rpz_prefix_t prefix) {
+	int i, wlen;
+
+	i = prefix / DNS_RPZ_CIDR_WORD_BITS;
+	wlen = prefix % DNS_RPZ_CIDR_WORD_BITS;
+	if (wlen != 0) {
+		ip->w[i] &= DNS_RPZ_WORD_MASK(wlen);
+		++i;
+	}
+	while (i < DNS_RPZ_CIDR_WORDS) {
+		ip->w[i++] = 0;
+	}
+}
+
 static dns_rpz_cidr_node_t *
 new_node(dns_rpz_zones_t *rpzs, const dns_rpz_cidr_key_t *ip,
 	 dns_rpz_prefix_t prefix, const dns_rpz_cidr_node_t *child) {
 	dns_rpz_cidr_node_t *node;
-	int i, words, wlen;
 
 	node = isc_mem_get(rpzs->mctx, sizeof(*node));
 	memset(node, 0, sizeof(*node));
@@ -649,20 +736,8 @@ new_node(dns_rpz_zones_t *rpzs, const dns_rpz_cidr_key_t *ip,
 	}
 
 	node->prefix = prefix;
-	words = prefix / DNS_RPZ_CIDR_WORD_BITS;
-	wlen = prefix % DNS_RPZ_CIDR_WORD_BITS;
-	i = 0;
-	while (i < words) {
-		node->ip.w[i] = ip->w[i];
-		++i;
-	}
-	if (wlen != 0) {
-		node->ip.w[i] = ip->w[i] & DNS_RPZ_WORD_MASK(wlen);
-		++i;
-	}
-	while (i < DNS_RPZ_CIDR_WORDS) {
-		node->ip.w[i++] = 0;
-	}
+	node->ip = *ip;
+	trim_key(&node->ip, prefix);
 
 	return (node);
 }
@@ -1464,6 +1539,12 @@ dns_rpz_new_zones(dns_rpz_zones_t **rpzsp, char *rps_cstr, size_t rps_cstr_size,
 		goto cleanup_rwlock;
 	}
 
+	result = isc_rwlock_init(&zones->index_lock, 0, 0);
+	if (result != ISC_R_SUCCESS) {
+		isc_rwlock_destroy(&zones->search_lock);
+		goto cleanup_rwlock;
+	}
+
 	isc_mutex_init(&zones->maint_lock);
 	isc_refcount_init(&zones->refs, 1);
 	isc_refcount_init(&zones->irefs, 1);
@@ -1509,6 +1590,7 @@ cleanup_rbt:
 
 	isc_mutex_destroy(&zones->maint_lock);
 
+	isc_rwlock_destroy(&zones->index_lock);
 	isc_rwlock_destroy(&zones->search_lock);
 
 cleanup_rwlock:
@@ -1569,6 +1651,9 @@ dns_rpz_new_zone(dns_rpz_zones_t *rpzs, dns_rpz_zone_t **rpzp) {
 	zone->updb = NULL;
 	zone->updbversion = NULL;
 	zone->updbit = NULL;
+	zone->journal = NULL;
+	zone->serial = 0;
+	zone->fullupdate = true;
 	isc_refcount_increment(&rpzs->irefs);
 	zone->rpzs = rpzs;
 	zone->db_registered = false;
@@ -1610,6 +1695,9 @@ dns_rpz_dbupdate_callback(dns_db_t *db, void *fn_arg) {
 
 	/* New zone came as AXFR */
 	if (zone->db != NULL && zone->db != db) {
+		/* The journal does not describe the new DB */
+		zone->fullupdate = true;
+
 		/* We need to clean up the old DB */
 		if (zone->dbversion != NULL) {
 			dns_db_closeversion(zone->db, &zone->dbversion, false);
@@ -1679,6 +1767,32 @@ cleanup:
 	return (result);
 }
 
+void
+dns_rpz_setjournal(dns_rpz_zone_t *rpz, const char *journal) {
+	REQUIRE(rpz != NULL);
+
+	LOCK(&rpz->rpzs->maint_lock);
+	if (rpz->journal != NULL) {
+		isc_mem_free(rpz->rpzs->mctx, rpz->journal);
+		rpz->journal = NULL;
+	}
+	if (journal != NULL) {
+		rpz->journal = isc_mem_strdup(rpz->rpzs->mctx, journal);
+	}
+	UNLOCK(&rpz->rpzs->maint_lock);
+}
+
+/*
+ * Make the next update of 'rpz' walk the whole zone, because this
+ * one did not complete.
+ */
+static void
+update_failed(dns_rpz_zone_t *rpz) {
+	LOCK(&rpz->rpzs->maint_lock);
+	rpz->fullupdate = true;
+	UNLOCK(&rpz->rpzs->maint_lock);
+}
+
 static void
 dns_rpz_update_taskaction(isc_task_t *task, isc_event_t *event) {
 	isc_result_t result;
@@ -1783,6 +1897,7 @@ static void
 finish_update(dns_rpz_zone_t *rpz) {
 	LOCK(&rpz->rpzs->maint_lock);
 	rpz->updaterunning = false;
+	index_schedule(rpz->rpzs);
 
 	/*
 	 * If there's an update pending, schedule it.
@@ -1921,6 +2036,9 @@ cleanup_quantum(isc_task_t *task, isc_event_t *event) {
 	 * If we're here, we're finished or something went wrong.
 	 */
 cleanup:
+	if (result != ISC_R_NOMORE) {
+		update_failed(rpz);
+	}
 	if (iter != NULL) {
 		isc_ht_iter_destroy(&iter);
 	}
@@ -1980,6 +2098,12 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 			break;
 		}
 
+		/*
+		 * Node hashtable keys are lower case, so that they match
+		 * the names read from the journal.
+		 */
+		dns_name_downcase(name, name, NULL);
+
 		result = dns_db_allrdatasets(rpz->updb, node, rpz->updbversion,
 					     0, &rdsiter);
 		if (result != ISC_R_SUCCESS) {
@@ -2091,6 +2215,7 @@ update_quantum(isc_task_t *task, isc_event_t *event) {
 	UNLOCK(&rpz->rpzs->maint_lock);
 
 cleanup:
+	update_failed(rpz);
 	if (rpz->updbit != NULL) {
 		dns_dbiterator_destroy(&rpz->updbit);
 	}
@@ -2102,10 +2227,246 @@ cleanup:
 	rpz_detach(&rpz);
 }
 
+/*
+ * Return true if 'name' has data in the version of the zone being
+ * processed.
+ */
+static bool
+name_has_data(dns_rpz_zone_t *rpz, const dns_name_t *name) {
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+	dns_rdatasetiter_t *rdsiter = NULL;
+
+	result = dns_db_findnode(rpz->updb, name, false, &node);
+	if (result != ISC_R_SUCCESS) {
+		return (false);
+	}
+	result = dns_db_allrdatasets(rpz->updb, node, rpz->updbversion, 0,
+				     &rdsiter);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_rdatasetiter_first(rdsiter);
+		dns_rdatasetiter_destroy(&rdsiter);
+	}
+	dns_db_detachnode(rpz->updb, &node);
+
+	return (result == ISC_R_SUCCESS);
+}
+
+/*
+ * Bring the summary up to date for the names changed by an incremental
+ * update, DNS_RPZ_QUANTUM names at a time.
+ */
+static void
+changed_quantum(isc_task_t *task, isc_event_t *event) {
+	isc_result_t result = ISC_R_SUCCESS;
+	char domain[DNS_NAME_FORMATSIZE];
+	char namebuf[DNS_NAME_FORMATSIZE];
+	dns_rpz_zone_t *rpz = NULL;
+	isc_ht_iter_t *iter = NULL;
+	dns_fixedname_t fname;
+	dns_name_t *name = NULL;
+	int count = 0;
+
+	UNUSED(task);
+
+	REQUIRE(event != NULL);
+	REQUIRE(event->ev_sender != NULL);
+
+	rpz = (dns_rpz_zone_t *)event->ev_sender;
+	iter = (isc_ht_iter_t *)event->ev_arg;
+	isc_event_free(&event);
+
+	REQUIRE(rpz->newnodes != NULL);
+
+	dns_name_format(&rpz->origin, domain, DNS_NAME_FORMATSIZE);
+
+	if (iter == NULL) {
+		result = isc_ht_iter_create(rpz->newnodes, &iter);
+		if (result != ISC_R_SUCCESS) {
+			isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+				      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+				      "rpz: %s: failed to create HT "
+				      "iterator - %s",
+				      domain, isc_result_totext(result));
+			goto cleanup;
+		}
+	}
+
+	name = dns_fixedname_initname(&fname);
+
+	LOCK(&rpz->rpzs->maint_lock);
+
+	/* Check that we aren't shutting down. */
+	if (rpz->rpzs->zones[rpz->num] == NULL) {
+		UNLOCK(&rpz->rpzs->maint_lock);
+		result = ISC_R_SHUTTINGDOWN;
+		goto cleanup;
+	}
+
+	for (result = isc_ht_iter_first(iter);
+	     result == ISC_R_SUCCESS && count++ < DNS_RPZ_QUANTUM;
+	     result = isc_ht_iter_delcurrent_next(iter))
+	{
+		isc_region_t region;
+		unsigned char *key = NULL;
+		size_t keysize;
+		bool known;
+
+		isc_ht_iter_currentkey(iter, &key, &keysize);
+		region.base = key;
+		region.length = (unsigned int)keysize;
+		dns_name_fromregion(name, &region);
+
+		known = (isc_ht_find(rpz->nodes, key, (uint32_t)keysize,
+				     NULL) == ISC_R_SUCCESS);
+		if (name_has_data(rpz, name)) {
+			if (known) {
+				continue;
+			}
+			result = isc_ht_add(rpz->nodes, key, (uint32_t)keysize,
+					    rpz);
+			if (result == ISC_R_SUCCESS) {
+				result = dns_rpz_add(rpz->rpzs, rpz->num,
+						     name);
+			}
+			dns_name_format(name, namebuf, sizeof(namebuf));
+			if (result != ISC_R_SUCCESS) {
+				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+					      DNS_LOGMODULE_MASTER,
+					      ISC_LOG_ERROR,
+					      "rpz: %s: adding node %s "
+					      "to RPZ error %s",
+					      domain, namebuf,
+					      isc_result_totext(result));
+			} else {
+				isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+					      DNS_LOGMODULE_MASTER,
+					      ISC_LOG_DEBUG(3),
+					      "rpz: %s: adding node %s", domain,
+					      namebuf);
+			}
+		} else if (known) {
+			isc_ht_delete(rpz->nodes, key, (uint32_t)keysize);
+			dns_rpz_delete(rpz->rpzs, rpz->num, name);
+		}
+		result = ISC_R_SUCCESS;
+	}
+
+	if (result == ISC_R_SUCCESS) {
+		isc_event_t *nevent = NULL;
+
+		/*
+		 * We finished a quantum; trigger the next one and return.
+		 */
+		INSIST(!ISC_LINK_LINKED(&rpz->updateevent, ev_link));
+		ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent), 0,
+			       NULL, DNS_EVENT_RPZUPDATED, changed_quantum,
+			       iter, rpz, NULL, NULL);
+		nevent = &rpz->updateevent;
+		isc_task_send(rpz->rpzs->updater, &nevent);
+		UNLOCK(&rpz->rpzs->maint_lock);
+		return;
+	}
+
+	UNLOCK(&rpz->rpzs->maint_lock);
+
+	if (result == ISC_R_NOMORE) {
+		finish_update(rpz);
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_INFO,
+			      "rpz: %s: incremental update done", domain);
+	}
+
+cleanup:
+	if (result != ISC_R_NOMORE) {
+		update_failed(rpz);
+	}
+	if (iter != NULL) {
+		isc_ht_iter_destroy(&iter);
+	}
+	if (rpz->newnodes != NULL) {
+		isc_ht_destroy(&rpz->newnodes);
+	}
+	dns_db_closeversion(rpz->updb, &rpz->updbversion, false);
+	dns_db_detach(&rpz->updb);
+	rpz_detach(&rpz);
+}
+
+/*
+ * Collect the names changed between the last processed version of the
+ * zone and 'serial' from the zone's journal into rpz->newnodes.
+ */
+static isc_result_t
+setup_incremental(dns_rpz_zone_t *rpz, uint32_t serial) {
+	isc_result_t result;
+	char domain[DNS_NAME_FORMATSIZE];
+	dns_journal_t *journal = NULL;
+	dns_fixedname_t fname;
+	dns_name_t *lname = NULL;
+
+	lname = dns_fixedname_initname(&fname);
+
+	result = dns_journal_open(rpz->rpzs->mctx, rpz->journal,
+				  DNS_JOURNAL_READ, &journal);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = dns_journal_iter_init(journal, rpz->serial, serial, NULL);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = isc_ht_init(&rpz->newnodes, rpz->rpzs->mctx,
+			     DNS_RPZ_HTSIZE_CHANGED);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	for (result = dns_journal_first_rr(journal); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		dns_name_t *name = NULL;
+		dns_rdata_t *rdata = NULL;
+		uint32_t ttl;
+
+		dns_journal_current_rr(journal, &name, &ttl, &rdata);
+		dns_name_downcase(name, lname, NULL);
+		result = isc_ht_add(rpz->newnodes, lname->ndata, lname->length,
+				    rpz);
+		if (result != ISC_R_SUCCESS && result != ISC_R_EXISTS) {
+			goto cleanup;
+		}
+	}
+	if (result == ISC_R_NOMORE) {
+		result = ISC_R_SUCCESS;
+	}
+
+cleanup:
+	if (result != ISC_R_SUCCESS) {
+		dns_name_format(&rpz->origin, domain, DNS_NAME_FORMATSIZE);
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_DEBUG(1),
+			      "rpz: %s: cannot update from journal: %s", domain,
+			      isc_result_totext(result));
+		if (rpz->newnodes != NULL) {
+			isc_ht_destroy(&rpz->newnodes);
+		}
+	}
+	if (journal != NULL) {
+		dns_journal_destroy(&journal);
+	}
+
+	return (result);
+}
+
 static void
 dns_rpz_update_from_db(dns_rpz_zone_t *rpz) {
 	isc_result_t result;
 	isc_event_t *event;
+	isc_taskaction_t action = update_quantum;
+	uint32_t serial;
+	bool incremental;
 
 	REQUIRE(rpz != NULL);
 	REQUIRE(DNS_DB_VALID(rpz->db));
@@ -2119,20 +2480,46 @@ dns_rpz_update_from_db(dns_rpz_zone_t *rpz) {
 	rpz->updbversion = rpz->dbversion;
 	rpz->dbversion = NULL;
 
-	result = setup_update(rpz);
-	if (result != ISC_R_SUCCESS) {
-		goto cleanup;
+	/*
+	 * If the database is the one we processed last, only the names
+	 * in the journal transactions since then need to be looked at.
+	 */
+	incremental = !rpz->fullupdate && rpz->journal != NULL;
+	rpz->fullupdate = true;
+	result = dns_db_getsoaserial(rpz->updb, rpz->updbversion, &serial);
+	if (result == ISC_R_SUCCESS) {
+		if (incremental && serial != rpz->serial &&
+		    setup_incremental(rpz, serial) == ISC_R_SUCCESS)
+		{
+			action = changed_quantum;
+		}
+		rpz->serial = serial;
+		rpz->fullupdate = false;
+	}
+
+	if (action == update_quantum) {
+		result = setup_update(rpz);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
 	}
 
 	event = &rpz->updateevent;
 	INSIST(!ISC_LINK_LINKED(&rpz->updateevent, ev_link));
-	ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent), 0, NULL,
-		       DNS_EVENT_RPZUPDATED, update_quantum, rpz, rpz, NULL,
-		       NULL);
+	if (action == changed_quantum) {
+		ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent), 0,
+			       NULL, DNS_EVENT_RPZUPDATED, changed_quantum,
+			       NULL, rpz, NULL, NULL);
+	} else {
+		ISC_EVENT_INIT(&rpz->updateevent, sizeof(rpz->updateevent), 0,
+			       NULL, DNS_EVENT_RPZUPDATED, update_quantum, rpz,
+			       rpz, NULL, NULL);
+	}
 	isc_task_send(rpz->rpzs->updater, &event);
 	return;
 
 cleanup:
+	rpz->fullupdate = true;
 	if (rpz->updbit != NULL) {
 		dns_dbiterator_destroy(&rpz->updbit);
 	}
@@ -2257,6 +2644,10 @@ rpz_detach(dns_rpz_zone_t **rpzp) {
 
 		isc_ht_destroy(&rpz->nodes);
 
+		if (rpz->journal != NULL) {
+			isc_mem_free(rpzs->mctx, rpz->journal);
+		}
+
 		isc_mem_put(rpzs->mctx, rpz, sizeof(*rpz));
 		rpz_detach_rpzs(&rpzs);
 	}
@@ -2316,8 +2707,12 @@ rpz_detach_rpzs(dns_rpz_zones_t **rpzsp) {
 		if (rpzs->rbt != NULL) {
 			dns_rbt_destroy(&rpzs->rbt);
 		}
+		if (rpzs->index != NULL) {
+			index_free(rpzs->mctx, &rpzs->index);
+		}
 		isc_task_destroy(&rpzs->updater);
 		isc_mutex_destroy(&rpzs->maint_lock);
+		isc_rwlock_destroy(&rpzs->index_lock);
 		isc_rwlock_destroy(&rpzs->search_lock);
 		isc_refcount_destroy(&rpzs->refs);
 		isc_mem_putanddetach(&rpzs->mctx, rpzs, sizeof(*rpzs));
@@ -2594,46 +2989,784 @@ dns_rpz_delete(dns_rpz_zones_t *rpzs, dns_rpz_num_t rpz_num,
 }
 
 /*
- * Search the summary radix tree to get a relative owner name in a
- * policy zone relevant to a triggering IP address.
- *	rpz_type and zbits limit the search for IP address netaddr
- *	return the policy zone's number or DNS_RPZ_INVALID_NUM
- *	ip_name is the relative owner name found and
- *	*prefixp is its prefix length.
+ * A name or an address being added to an index, with the index of its
+ * trigger bits.
  */
-dns_rpz_num_t
-dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
-		dns_rpz_zbits_t zbits, const isc_netaddr_t *netaddr,
-		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp) {
-	dns_rpz_cidr_key_t tgt_ip;
-	dns_rpz_addr_zbits_t tgt_set;
-	dns_rpz_cidr_node_t *found;
+typedef struct {
+	uint32_t name; /* offset of the name in rpz_builder_t.names */
+	uint32_t data;
+} rpz_nmentry_t;
+
+typedef struct {
+	dns_rpz_cidr_key_t ip;
+	dns_rpz_prefix_t   prefix;
+	uint32_t	   data;
+} rpz_ipentry_t;
+
+/*
+ * The state of building an index.  The tries are built twice, first
+ * with the arrays of the index NULL to count their elements, and then
+ * to fill them.
+ */
+typedef struct {
+	dns_rpz_index_t *idx;
+	isc_buffer_t *	 names; /* names with their top label first */
+	rpz_nmentry_t *	 nmentry;
+	uint32_t	 nmentries;
+	uint32_t	 nmsize;
+	rpz_ipentry_t *	 ipentry;
+	uint32_t	 ipentries;
+	uint32_t	 ipsize;
+	isc_ht_t *	 nmdata; /* distinct trigger bits of names */
+	isc_ht_t *	 ipdata; /* distinct trigger bits of addresses */
+} rpz_builder_t;
+
+static inline unsigned int
+popcount16(uint16_t w) {
+	w = w - ((w >> 1) & 0x5555);
+	w = (w & 0x3333) + ((w >> 2) & 0x3333);
+	w = (w + (w >> 4)) & 0x0f0f;
+	return ((w + (w >> 8)) & 0x1f);
+}
+
+/*
+ * Compare two lower case labels in wire format, in DNSSEC order.
+ */
+static inline int
+labelcmp(const unsigned char *l1, const unsigned char *l2) {
+	int order;
+
+	order = memcmp(l1 + 1, l2 + 1, ISC_MIN(l1[0], l2[0]));
+	if (order == 0) {
+		order = (int)l1[0] - (int)l2[0];
+	}
+	return (order);
+}
+
+/*
+ * Get the IDX_STRIDE bits of an address consumed at 'depth' in the
+ * address trie.
+ */
+static inline unsigned int
+key_chunk(const dns_rpz_cidr_key_t *ip, unsigned int depth) {
+	unsigned int bit = depth * IDX_STRIDE;
+
+	if (bit >= DNS_RPZ_CIDR_KEY_BITS) {
+		return (0);
+	}
+	return ((ip->w[bit / DNS_RPZ_CIDR_WORD_BITS] >>
+		 (DNS_RPZ_CIDR_WORD_BITS - IDX_STRIDE -
+		  bit % DNS_RPZ_CIDR_WORD_BITS)) &
+		(IDX_CHILDREN - 1));
+}
+
+static inline dns_rpz_zbits_t
+addr_zbits(const dns_rpz_addr_zbits_t *set, dns_rpz_type_t rpz_type) {
+	switch (rpz_type) {
+	case DNS_RPZ_TYPE_CLIENT_IP:
+		return (set->client_ip);
+	case DNS_RPZ_TYPE_IP:
+		return (set->ip);
+	case DNS_RPZ_TYPE_NSIP:
+		return (set->nsip);
+	default:
+		INSIST(0);
+		ISC_UNREACHABLE();
+	}
+}
+
+/*
+ * Find the index of 'data' among the distinct values in 'ht', adding
+ * it if it is new.
+ */
+static isc_result_t
+intern(isc_ht_t *ht, const void *data, size_t size, uint32_t *indexp) {
+	void *value = NULL;
 	isc_result_t result;
-	dns_rpz_num_t rpz_num = 0;
-	dns_rpz_have_t have;
-	int i;
+
+	result = isc_ht_find(ht, data, (uint32_t)size, &value);
+	if (result == ISC_R_SUCCESS) {
+		*indexp = (uint32_t)(uintptr_t)value;
+		return (ISC_R_SUCCESS);
+	}
+
+	*indexp = isc_ht_count(ht);
+	return (isc_ht_add(ht, data, (uint32_t)size,
+			   (void *)(uintptr_t)*indexp));
+}
+
+/*
+ * Copy the distinct values in 'ht' to 'table', each at its index.
+ */
+static void
+intern_copy(isc_ht_t *ht, void *table, size_t size) {
+	isc_ht_iter_t *it = NULL;
+	isc_result_t result;
+
+	RUNTIME_CHECK(isc_ht_iter_create(ht, &it) == ISC_R_SUCCESS);
+	for (result = isc_ht_iter_first(it); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(it))
+	{
+		unsigned char *key = NULL;
+		size_t keysize;
+		void *value = NULL;
+
+		isc_ht_iter_current(it, &value);
+		isc_ht_iter_currentkey(it, &key, &keysize);
+		INSIST(keysize == size);
+		memmove((unsigned char *)table + (uintptr_t)value * size, key,
+			size);
+	}
+	isc_ht_iter_destroy(&it);
+}
+
+/*
+ * Get the label 'depth' labels below the root of name 'i', or NULL if
+ * the name has only 'depth' labels.
+ */
+static const unsigned char *
+entry_label(const rpz_builder_t *b, uint32_t i, unsigned int depth) {
+	const unsigned char *label;
+
+	label = (unsigned char *)isc_buffer_base(b->names) +
+		b->nmentry[i].name;
+	while (depth-- > 0) {
+		label += label[0] + 1;
+	}
+	return (label[0] == 0 ? NULL : label);
+}
+
+/*
+ * Fill in trie node 'node' for names lo..hi-1, which are all below it.
+ */
+static void
+index_nmbuild(rpz_builder_t *b, uint32_t node, uint32_t lo, uint32_t hi,
+	      unsigned int depth) {
+	dns_rpz_index_t *idx = b->idx;
+	const unsigned char *label, *prev = NULL;
+	uint32_t i, end, down, ndown = 0;
+
+	/*
+	 * The name of the node itself sorts before the names below it.
+	 */
+	if (lo < hi && entry_label(b, lo, depth) == NULL) {
+		if (idx->nmnodes != NULL) {
+			idx->nmnodes[node].data = b->nmentry[lo].data;
+		}
+		lo++;
+	}
+
+	/*
+	 * Add the children, and their labels, next to each other.
+	 */
+	down = idx->nmcount;
+	for (i = lo; i < hi; i++) {
+		label = entry_label(b, i, depth);
+		if (prev != NULL && labelcmp(prev, label) == 0) {
+			continue;
+		}
+		INSIST(prev == NULL || labelcmp(prev, label) < 0);
+		if (idx->nmnodes != NULL) {
+			idx->nmnodes[idx->nmcount] =
+				(rpz_nmnode_t){ .label = idx->labelsize };
+			memmove(idx->labels + idx->labelsize, label,
+				label[0] + 1);
+		}
+		idx->nmcount++;
+		idx->labelsize += label[0] + 1;
+		ndown++;
+		prev = label;
+	}
+	if (idx->nmnodes != NULL) {
+		idx->nmnodes[node].down = down;
+		idx->nmnodes[node].ndown = ndown;
+	}
+
+	for (i = lo; i < hi; i = end) {
+		label = entry_label(b, i, depth);
+		end = i + 1;
+		while (end < hi && labelcmp(label, entry_label(b, end, depth)) == 0)
+		{
+			end++;
+		}
+		index_nmbuild(b, down++, i, end, depth + 1);
+	}
+}
+
+/*
+ * Fill in trie node 'node' for the prefixes among lo..hi-1 that end in
+ * it or below it.
+ */
+static void
+index_ipbuild(rpz_builder_t *b, uint32_t node, uint32_t lo, uint32_t hi,
+	      unsigned int depth) {
+	dns_rpz_index_t *idx = b->idx;
+	unsigned int bit = depth * IDX_STRIDE;
+	uint32_t data[IDX_PREFIXES];
+	uint32_t start[IDX_CHILDREN], end[IDX_CHILDREN];
+	uint16_t prefixes = 0, children = 0;
+	unsigned int chunk, len, pos;
+	uint32_t i, down;
+
+	for (i = lo; i < hi; i++) {
+		const rpz_ipentry_t *e = &b->ipentry[i];
+
+		if (e->prefix < bit) {
+			/*
+			 * This prefix ends in a node above.
+			 */
+			continue;
+		}
+		chunk = key_chunk(&e->ip, depth);
+		if (e->prefix < bit + IDX_STRIDE) {
+			len = e->prefix - bit;
+			pos = (1 << len) - 1 + (chunk >> (IDX_STRIDE - len));
+			prefixes |= 1 << pos;
+			data[pos] = e->data;
+		} else {
+			INSIST((children >> chunk) <= 1);
+			if ((children & (1 << chunk)) == 0) {
+				children |= 1 << chunk;
+				start[chunk] = i;
+			}
+			end[chunk] = i + 1;
+		}
+	}
+
+	if (idx->ipnodes != NULL) {
+		idx->ipnodes[node] =
+			(rpz_ipnode_t){ .prefixes = prefixes,
+					.children = children,
+					.down = idx->ipcount,
+					.prefix = idx->ipprefixcount };
+	}
+	for (pos = 0; pos < IDX_PREFIXES; pos++) {
+		if ((prefixes & (1 << pos)) != 0) {
+			if (idx->ipprefix != NULL) {
+				idx->ipprefix[idx->ipprefixcount] = data[pos];
+			}
+			idx->ipprefixcount++;
+		}
+	}
+
+	down = idx->ipcount;
+	idx->ipcount += popcount16(children);
+	for (chunk = 0; chunk < IDX_CHILDREN; chunk++) {
+		if ((children & (1 << chunk)) != 0) {
+			index_ipbuild(b, down++, start[chunk], end[chunk],
+				      depth + 1);
+		}
+	}
+}
+
+/*
+ * Collect the names in the summary RBT, in DNSSEC order.
+ */
+static isc_result_t
+index_names(dns_rpz_zones_t *rpzs, rpz_builder_t *b) {
+	dns_rbtnodechain_t chain;
+	dns_fixedname_t fname, flower;
+	dns_name_t *name, *lower;
+	dns_rbtnode_t *node;
+	dns_label_t label;
+	isc_result_t result;
+	unsigned int i;
+
+	name = dns_fixedname_initname(&fname);
+	lower = dns_fixedname_initname(&flower);
+
+	b->nmsize = dns_rbt_nodecount(rpzs->rbt) + 1;
+	b->nmentry = isc_mem_get(rpzs->mctx, b->nmsize * sizeof(*b->nmentry));
+
+	dns_rbtnodechain_init(&chain);
+	for (result = dns_rbtnodechain_first(&chain, rpzs->rbt, NULL, NULL);
+	     result == ISC_R_SUCCESS || result == DNS_R_NEWORIGIN;
+	     result = dns_rbtnodechain_next(&chain, NULL, NULL))
+	{
+		rpz_nmentry_t *e = &b->nmentry[b->nmentries];
+
+		node = NULL;
+		(void)dns_rbtnodechain_current(&chain, NULL, NULL, &node);
+		if (node->data == NULL) {
+			continue;
+		}
+		result = dns_rbt_fullnamefromnode(node, name);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+		result = intern(b->nmdata, node->data,
+				sizeof(dns_rpz_nm_data_t), &e->data);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+
+		/*
+		 * isc_buffer_reserve() grows a buffer by a fixed amount,
+		 * so double it here to keep the copying linear.
+		 */
+		if (isc_buffer_availablelength(b->names) < DNS_NAME_MAXWIRE) {
+			result = isc_buffer_reserve(
+				&b->names, isc_buffer_length(b->names));
+			if (result != ISC_R_SUCCESS) {
+				break;
+			}
+		}
+
+		INSIST(b->nmentries < b->nmsize);
+		b->nmentries++;
+		e->name = isc_buffer_usedlength(b->names);
+		(void)dns_name_downcase(name, lower, NULL);
+		for (i = dns_name_countlabels(lower) - 1; i-- > 0;) {
+			dns_name_getlabel(lower, i, &label);
+			isc_buffer_putmem(b->names, label.base, label.length);
+		}
+		isc_buffer_putuint8(b->names, 0);
+	}
+	dns_rbtnodechain_invalidate(&chain);
+
+	if (result == ISC_R_NOMORE || result == ISC_R_NOTFOUND) {
+		result = ISC_R_SUCCESS;
+	}
+	return (result);
+}
+
+/*
+ * Return the node after 'cur' in a depth first walk of the radix tree,
+ * which visits its prefixes in the order of their bits, shorter first.
+ */
+static dns_rpz_cidr_node_t *
+cidr_next(dns_rpz_cidr_node_t *cur) {
+	dns_rpz_cidr_node_t *parent;
+
+	if (cur->child[0] != NULL) {
+		return (cur->child[0]);
+	}
+	if (cur->child[1] != NULL) {
+		return (cur->child[1]);
+	}
+	for (parent = cur->parent; parent != NULL; parent = cur->parent) {
+		if (parent->child[0] == cur && parent->child[1] != NULL) {
+			return (parent->child[1]);
+		}
+		cur = parent;
+	}
+	return (NULL);
+}
+
+static inline bool
+cidr_has_data(const dns_rpz_cidr_node_t *cnode) {
+	return (cnode->set.client_ip != 0 || cnode->set.ip != 0 ||
+		cnode->set.nsip != 0);
+}
+
+/*
+ * Collect the prefixes in the summary radix tree, in order.
+ */
+static isc_result_t
+index_addrs(dns_rpz_zones_t *rpzs, rpz_builder_t *b) {
+	dns_rpz_cidr_node_t *cur;
+	isc_result_t result;
+	uint32_t n = 0;
+
+	for (cur = rpzs->cidr; cur != NULL; cur = cidr_next(cur)) {
+		if (cidr_has_data(cur)) {
+			n++;
+		}
+	}
+	if (n == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	b->ipsize = n;
+	b->ipentry = isc_mem_get(rpzs->mctx, n * sizeof(*b->ipentry));
+	for (cur = rpzs->cidr; cur != NULL; cur = cidr_next(cur)) {
+		rpz_ipentry_t *e = &b->ipentry[b->ipentries];
+
+		if (!cidr_has_data(cur)) {
+			continue;
+		}
+		e->ip = cur->ip;
+		e->prefix = cur->prefix;
+		result = intern(b->ipdata, &cur->set, sizeof(cur->set),
+				&e->data);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		b->ipentries++;
+	}
+	INSIST(b->ipentries == n);
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+index_free(isc_mem_t *mctx, dns_rpz_index_t **idxp) {
+	dns_rpz_index_t *idx = *idxp;
+
+	*idxp = NULL;
+
+	if (idx->nmnodes != NULL) {
+		isc_mem_put(mctx, idx->nmnodes,
+			    idx->nmcount * sizeof(*idx->nmnodes));
+	}
+	if (idx->labels != NULL) {
+		isc_mem_put(mctx, idx->labels, idx->labelsize);
+	}
+	if (idx->nmdata != NULL) {
+		isc_mem_put(mctx, idx->nmdata,
+			    idx->nmdatacount * sizeof(*idx->nmdata));
+	}
+	if (idx->ipnodes != NULL) {
+		isc_mem_put(mctx, idx->ipnodes,
+			    idx->ipcount * sizeof(*idx->ipnodes));
+	}
+	if (idx->ipprefix != NULL) {
+		isc_mem_put(mctx, idx->ipprefix,
+			    idx->ipprefixcount * sizeof(*idx->ipprefix));
+	}
+	if (idx->ipdata != NULL) {
+		isc_mem_put(mctx, idx->ipdata,
+			    idx->ipdatacount * sizeof(*idx->ipdata));
+	}
+	isc_mem_put(mctx, idx, sizeof(*idx));
+}
+
+static size_t
+index_size(const dns_rpz_index_t *idx) {
+	return (sizeof(*idx) + idx->nmcount * sizeof(*idx->nmnodes) +
+		idx->labelsize + idx->nmdatacount * sizeof(*idx->nmdata) +
+		idx->ipcount * sizeof(*idx->ipnodes) +
+		idx->ipprefixcount * sizeof(*idx->ipprefix) +
+		idx->ipdatacount * sizeof(*idx->ipdata));
+}
+
+/*
+ * Build an index of the current contents of the summary databases.
+ */
+static isc_result_t
+index_build(dns_rpz_zones_t *rpzs, dns_rpz_index_t **idxp) {
+	isc_mem_t *mctx = rpzs->mctx;
+	dns_rpz_index_t *idx;
+	dns_rpz_nm_data_t nm_none;
+	rpz_builder_t b;
+	isc_result_t result;
+	uint32_t count, size, none;
+
+	memset(&b, 0, sizeof(b));
+	idx = isc_mem_get(mctx, sizeof(*idx));
+	memset(idx, 0, sizeof(*idx));
+	b.idx = idx;
+
+	RUNTIME_CHECK(isc_ht_init(&b.nmdata, mctx, 4) == ISC_R_SUCCESS);
+	RUNTIME_CHECK(isc_ht_init(&b.ipdata, mctx, 4) == ISC_R_SUCCESS);
+	isc_buffer_allocate(mctx, &b.names, 1024);
+
+	/*
+	 * Trie nodes without triggers, such as the root, refer to the
+	 * first distinct value.
+	 */
+	memset(&nm_none, 0, sizeof(nm_none));
+	RUNTIME_CHECK(intern(b.nmdata, &nm_none, sizeof(nm_none), &none) ==
+		      ISC_R_SUCCESS);
+	INSIST(none == 0);
 
 	RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
-	have = rpzs->have;
+	idx->have = rpzs->have;
+	result = index_names(rpzs, &b);
+	if (result == ISC_R_SUCCESS) {
+		result = index_addrs(rpzs, &b);
+	}
 	RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	idx->nmcount = 1;
+	index_nmbuild(&b, 0, 0, b.nmentries, 0);
+	count = idx->nmcount;
+	size = idx->labelsize;
+	idx->nmnodes = isc_mem_get(mctx, count * sizeof(*idx->nmnodes));
+	if (size != 0) {
+		idx->labels = isc_mem_get(mctx, size);
+	}
+	idx->nmcount = 1;
+	idx->labelsize = 0;
+	idx->nmnodes[0] = (rpz_nmnode_t){ .label = 0 };
+	index_nmbuild(&b, 0, 0, b.nmentries, 0);
+	INSIST(idx->nmcount == count && idx->labelsize == size);
+
+	idx->ipcount = 1;
+	index_ipbuild(&b, 0, 0, b.ipentries, 0);
+	count = idx->ipcount;
+	size = idx->ipprefixcount;
+	idx->ipnodes = isc_mem_get(mctx, count * sizeof(*idx->ipnodes));
+	if (size != 0) {
+		idx->ipprefix = isc_mem_get(mctx, size * sizeof(*idx->ipprefix));
+	}
+	idx->ipcount = 1;
+	idx->ipprefixcount = 0;
+	index_ipbuild(&b, 0, 0, b.ipentries, 0);
+	INSIST(idx->ipcount == count && idx->ipprefixcount == size);
+
+	idx->nmdatacount = isc_ht_count(b.nmdata);
+	idx->nmdata = isc_mem_get(mctx,
+				  idx->nmdatacount * sizeof(*idx->nmdata));
+	intern_copy(b.nmdata, idx->nmdata, sizeof(*idx->nmdata));
+	idx->ipdatacount = isc_ht_count(b.ipdata);
+	if (idx->ipdatacount != 0) {
+		idx->ipdata = isc_mem_get(
+			mctx, idx->ipdatacount * sizeof(*idx->ipdata));
+		intern_copy(b.ipdata, idx->ipdata, sizeof(*idx->ipdata));
+	}
+
+	isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_MASTER,
+		      ISC_LOG_INFO,
+		      "rpz: summary index built: %u names, %u addresses, "
+		      "%zu bytes",
+		      b.nmentries, b.ipentries, index_size(idx));
+
+cleanup:
+	if (b.nmentry != NULL) {
+		isc_mem_put(mctx, b.nmentry, b.nmsize * sizeof(*b.nmentry));
+	}
+	if (b.ipentry != NULL) {
+		isc_mem_put(mctx, b.ipentry, b.ipsize * sizeof(*b.ipentry));
+	}
+	isc_buffer_free(&b.names);
+	isc_ht_destroy(&b.ipdata);
+	isc_ht_destroy(&b.nmdata);
+
+	if (result != ISC_R_SUCCESS) {
+		index_free(mctx, &idx);
+	}
+	*idxp = idx;
+	return (result);
+}
+
+/*
+ * Replace the index of the summary databases with a new one.  If one
+ * cannot be built, search the summary databases themselves.
+ */
+static void
+index_rebuild(dns_rpz_zones_t *rpzs) {
+	dns_rpz_index_t *idx = NULL, *old;
+	isc_result_t result;
+
+	result = index_build(rpzs, &idx);
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_MASTER, ISC_LOG_ERROR,
+			      "rpz: failed to build summary index - %s",
+			      isc_result_totext(result));
+	}
+
+	RWLOCK(&rpzs->index_lock, isc_rwlocktype_write);
+	old = rpzs->index;
+	rpzs->index = idx;
+	RWUNLOCK(&rpzs->index_lock, isc_rwlocktype_write);
+
+	if (old != NULL) {
+		index_free(rpzs->mctx, &old);
+	}
+}
+
+static void
+index_taskaction(isc_task_t *task, isc_event_t *event) {
+	dns_rpz_zones_t *rpzs;
+	bool busy = false;
+
+	UNUSED(task);
+
+	rpzs = (dns_rpz_zones_t *)event->ev_arg;
+	isc_event_free(&event);
+
+	/*
+	 * Do not index a partly updated summary, or one being shut
+	 * down.  The update in progress will schedule another index.
+	 */
+	LOCK(&rpzs->maint_lock);
+	rpzs->indexpending = false;
+	for (dns_rpz_num_t rpz_num = 0; rpz_num < rpzs->p.num_zones;
+	     rpz_num++) {
+		dns_rpz_zone_t *rpz = rpzs->zones[rpz_num];
+		if (rpz == NULL || rpz->updb != NULL) {
+			busy = true;
+		}
+	}
+	UNLOCK(&rpzs->maint_lock);
+
+	if (!busy) {
+		index_rebuild(rpzs);
+	}
+
+	rpz_detach_rpzs(&rpzs);
+}
+
+/*
+ * Build a new index on the updater task, unless one is already to be
+ * built.  Requires the maint_lock.
+ */
+static void
+index_schedule(dns_rpz_zones_t *rpzs) {
+	isc_event_t *event;
+
+	if (rpzs->indexpending) {
+		return;
+	}
+	rpzs->indexpending = true;
+
+	isc_refcount_increment(&rpzs->irefs);
+	event = isc_event_allocate(rpzs->mctx, NULL, DNS_EVENT_RPZINDEX,
+				   index_taskaction, rpzs,
+				   sizeof(isc_event_t));
+	isc_task_send(rpzs->updater, &event);
+}
+
+void
+dns__rpz_index(dns_rpz_zones_t *rpzs) {
+	REQUIRE(rpzs != NULL);
+
+	index_rebuild(rpzs);
+}
+
+/*
+ * Search the index for the policy zones with triggers matching a name.
+ */
+static dns_rpz_zbits_t
+index_findname(const dns_rpz_index_t *idx, dns_rpz_type_t rpz_type,
+	       const dns_name_t *trig_name) {
+	dns_fixedname_t flower;
+	dns_name_t *lower;
+	const rpz_nmnode_t *node;
+	const dns_rpz_nm_data_t *nm_data;
+	dns_rpz_zbits_t found_zbits = 0;
+	dns_label_t label;
+	uint32_t lo, hi, mid;
+	unsigned int i;
+	int order;
+
+	lower = dns_fixedname_initname(&flower);
+	(void)dns_name_downcase(trig_name, lower, NULL);
+	i = dns_name_countlabels(lower);
+	if (dns_name_isabsolute(lower)) {
+		i--;
+	}
 
 	/*
-	 * Convert IP address to CIDR tree key.
+	 * Walk down from the root, collecting the bits for wildcards
+	 * at the names above the trigger name and those for the name
+	 * itself.
 	 */
+	node = &idx->nmnodes[0];
+	for (;;) {
+		nm_data = &idx->nmdata[node->data];
+		if (i == 0) {
+			if (rpz_type == DNS_RPZ_TYPE_QNAME) {
+				found_zbits |= nm_data->set.qname;
+			} else {
+				found_zbits |= nm_data->set.ns;
+			}
+			break;
+		}
+		if (rpz_type == DNS_RPZ_TYPE_QNAME) {
+			found_zbits |= nm_data->wild.qname;
+		} else {
+			found_zbits |= nm_data->wild.ns;
+		}
+
+		dns_name_getlabel(lower, --i, &label);
+		lo = node->down;
+		hi = node->down + node->ndown;
+		node = NULL;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			order = labelcmp(label.base,
+					 &idx->labels[idx->nmnodes[mid].label]);
+			if (order == 0) {
+				node = &idx->nmnodes[mid];
+				break;
+			} else if (order < 0) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		if (node == NULL) {
+			break;
+		}
+	}
+
+	return (found_zbits);
+}
+
+/*
+ * Search the index for the longest prefix of an address with triggers
+ * in the policy zones 'zbits', trimming them at each match as search()
+ * does.  Return the triggers of the prefix found, or 0.
+ */
+static dns_rpz_zbits_t
+index_findip(const dns_rpz_index_t *idx, dns_rpz_type_t rpz_type,
+	     dns_rpz_zbits_t zbits, const dns_rpz_cidr_key_t *tgt_ip,
+	     dns_rpz_prefix_t *prefixp) {
+	const rpz_ipnode_t *node;
+	dns_rpz_zbits_t found_zbits = 0, node_zbits;
+	unsigned int depth, bit, chunk, len, pos;
+	uint32_t data;
+
+	node = &idx->ipnodes[0];
+	for (depth = 0;; depth++) {
+		bit = depth * IDX_STRIDE;
+		chunk = key_chunk(tgt_ip, depth);
+		for (len = 0; len < IDX_STRIDE && bit + len <= 128; len++) {
+			pos = (1 << len) - 1 + (chunk >> (IDX_STRIDE - len));
+			if ((node->prefixes & (1 << pos)) == 0) {
+				continue;
+			}
+			data = idx->ipprefix[node->prefix +
+					     popcount16(node->prefixes &
+							((1 << pos) - 1))];
+			node_zbits = addr_zbits(&idx->ipdata[data], rpz_type);
+			if ((node_zbits & zbits) != 0) {
+				found_zbits = node_zbits;
+				*prefixp = bit + len;
+				zbits = trim_zbits(zbits, node_zbits);
+			}
+		}
+		if ((node->children & (1 << chunk)) == 0) {
+			break;
+		}
+		node = &idx->ipnodes[node->down +
+				     popcount16(node->children &
+						((1 << chunk) - 1))];
+	}
+
+	return (found_zbits);
+}
+
+/*
+ * Convert an IP address to a CIDR tree key, and limit 'zbits' to the
+ * policy zones with triggers of 'rpz_type' for its address family.
+ */
+static dns_rpz_zbits_t
+netaddr2key(const isc_netaddr_t *netaddr, dns_rpz_type_t rpz_type,
+	    const dns_rpz_have_t *have, dns_rpz_zbits_t zbits,
+	    dns_rpz_cidr_key_t *tgt_ip) {
+	int i;
+
 	if (netaddr->family == AF_INET) {
-		tgt_ip.w[0] = 0;
-		tgt_ip.w[1] = 0;
-		tgt_ip.w[2] = ADDR_V4MAPPED;
-		tgt_ip.w[3] = ntohl(netaddr->type.in.s_addr);
+		tgt_ip->w[0] = 0;
+		tgt_ip->w[1] = 0;
+		tgt_ip->w[2] = ADDR_V4MAPPED;
+		tgt_ip->w[3] = ntohl(netaddr->type.in.s_addr);
 		switch (rpz_type) {
 		case DNS_RPZ_TYPE_CLIENT_IP:
-			zbits &= have.client_ipv4;
+			zbits &= have->client_ipv4;
 			break;
 		case DNS_RPZ_TYPE_IP:
-			zbits &= have.ipv4;
+			zbits &= have->ipv4;
 			break;
 		case DNS_RPZ_TYPE_NSIP:
-			zbits &= have.nsipv4;
+			zbits &= have->nsipv4;
 			break;
 		default:
 			INSIST(0);
@@ -2649,38 +3782,89 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 		 */
 		memmove(src_ip6.w, &netaddr->type.in6, sizeof(src_ip6.w));
 		for (i = 0; i < 4; i++) {
-			tgt_ip.w[i] = ntohl(src_ip6.w[i]);
+			tgt_ip->w[i] = ntohl(src_ip6.w[i]);
 		}
 		switch (rpz_type) {
 		case DNS_RPZ_TYPE_CLIENT_IP:
-			zbits &= have.client_ipv6;
+			zbits &= have->client_ipv6;
 			break;
 		case DNS_RPZ_TYPE_IP:
-			zbits &= have.ipv6;
+			zbits &= have->ipv6;
 			break;
 		case DNS_RPZ_TYPE_NSIP:
-			zbits &= have.nsipv6;
+			zbits &= have->nsipv6;
 			break;
 		default:
 			INSIST(0);
 			break;
 		}
 	} else {
-		return (DNS_RPZ_INVALID_NUM);
+		zbits = 0;
 	}
 
-	if (zbits == 0) {
-		return (DNS_RPZ_INVALID_NUM);
+	return (zbits);
+}
+
+/*
+ * Search the summary radix tree to get a relative owner name in a
+ * policy zone relevant to a triggering IP address.
+ *	rpz_type and zbits limit the search for IP address netaddr
+ *	return the policy zone's number or DNS_RPZ_INVALID_NUM
+ *	ip_name is the relative owner name found and
+ *	*prefixp is its prefix length.
+ */
+dns_rpz_num_t
+dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
+		dns_rpz_zbits_t zbits, const isc_netaddr_t *netaddr,
+		dns_name_t *ip_name, dns_rpz_prefix_t *prefixp) {
+	dns_rpz_cidr_key_t tgt_ip, found_ip;
+	dns_rpz_addr_zbits_t tgt_set;
+	dns_rpz_cidr_node_t *found;
+	dns_rpz_zbits_t found_zbits = 0;
+	dns_rpz_prefix_t prefix = 0;
+	isc_result_t result;
+
+	RWLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+	if (rpzs->index != NULL) {
+		zbits = netaddr2key(netaddr, rpz_type, &rpzs->index->have,
+				    zbits, &tgt_ip);
+		if (zbits != 0) {
+			found_zbits = index_findip(rpzs->index, rpz_type, zbits,
+						   &tgt_ip, &prefix);
+		}
+		RWUNLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+		if (found_zbits != 0) {
+			found_ip = tgt_ip;
+			trim_key(&found_ip, prefix);
+		}
+	} else {
+		RWUNLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+
+		/*
+		 * Hold the lock for the whole lookup, so that the summary
+		 * of which kinds of triggers exist and the radix tree
+		 * agree.
+		 */
+		RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
+		zbits = netaddr2key(netaddr, rpz_type, &rpzs->have, zbits,
+				    &tgt_ip);
+		if (zbits != 0) {
+			make_addr_set(&tgt_set, zbits, rpz_type);
+			result = search(rpzs, &tgt_ip, 128, &tgt_set, false,
+					&found);
+			if (result != ISC_R_NOTFOUND) {
+				found_zbits = addr_zbits(&found->set, rpz_type);
+				found_ip = found->ip;
+				prefix = found->prefix;
+			}
+		}
+		RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
 	}
-	make_addr_set(&tgt_set, zbits, rpz_type);
 
-	RWLOCK(&rpzs->search_lock, isc_rwlocktype_read);
-	result = search(rpzs, &tgt_ip, 128, &tgt_set, false, &found);
-	if (result == ISC_R_NOTFOUND) {
+	if (found_zbits == 0) {
 		/*
 		 * There are no eligible zones for this IP address.
 		 */
-		RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
 		return (DNS_RPZ_INVALID_NUM);
 	}
 
@@ -2688,23 +3872,8 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 	 * Construct the trigger name for the longest matching trigger
 	 * in the first eligible zone with a match.
 	 */
-	*prefixp = found->prefix;
-	switch (rpz_type) {
-	case DNS_RPZ_TYPE_CLIENT_IP:
-		rpz_num = zbit_to_num(found->set.client_ip & tgt_set.client_ip);
-		break;
-	case DNS_RPZ_TYPE_IP:
-		rpz_num = zbit_to_num(found->set.ip & tgt_set.ip);
-		break;
-	case DNS_RPZ_TYPE_NSIP:
-		rpz_num = zbit_to_num(found->set.nsip & tgt_set.nsip);
-		break;
-	default:
-		INSIST(0);
-		ISC_UNREACHABLE();
-	}
-	result = ip2name(&found->ip, found->prefix, dns_rootname, ip_name);
-	RWUNLOCK(&rpzs->search_lock, isc_rwlocktype_read);
+	*prefixp = prefix;
+	result = ip2name(&found_ip, prefix, dns_rootname, ip_name);
 	if (result != ISC_R_SUCCESS) {
 		/*
 		 * bin/tests/system/rpz/tests.sh looks for "rpz.*failed".
@@ -2715,7 +3884,7 @@ dns_rpz_find_ip(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 			      isc_result_totext(result));
 		return (DNS_RPZ_INVALID_NUM);
 	}
-	return (rpz_num);
+	return (zbit_to_num(found_zbits & zbits));
 }
 
 /*
@@ -2737,6 +3906,14 @@ dns_rpz_find_name(dns_rpz_zones_t *rpzs, dns_rpz_type_t rpz_type,
 		return (0);
 	}
 
+	RWLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+	if (rpzs->index != NULL) {
+		found_zbits = index_findname(rpzs->index, rpz_type, trig_name);
+		RWUNLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+		return (zbits & found_zbits);
+	}
+	RWUNLOCK(&rpzs->index_lock, isc_rwlocktype_read);
+
 	found_zbits = 0;
 
 	dns_rbtnodechain_init(&chain);
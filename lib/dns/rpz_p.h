@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#ifndef DNS_RPZ_P_H
+#define DNS_RPZ_P_H
+
+/*! \file */
+
+#include <dns/rpz.h>
+
+/*%
+ *     These functions must not be used outside this module and
+ *     its associated unit tests.
+ */
+
+ISC_LANG_BEGINDECLS
+
+void
+dns__rpz_index(dns_rpz_zones_t *rpzs);
+/*%<
+ * Build the index of the summary databases of 'rpzs' now, instead of
+ * when an update of one of its policy zones is done, and search it from
+ * then on.
+ */
+
+ISC_LANG_ENDDECLS
+
+#endif /* DNS_RPZ_P_H */
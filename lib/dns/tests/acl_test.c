@@ -23,11 +23,15 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/netaddr.h>
 #include <isc/print.h>
+#include <isc/random.h>
 #include <isc/string.h>
+#include <isc/time.h>
 #include <isc/util.h>
 
 #include <dns/acl.h>
+#include <dns/iptable.h>
 
 #include "dnstest.h"
 
@@ -133,11 +137,231 @@ dns_acl_isinsecure_test(void **state) {
 #endif /* HAVE_GEOIP2 */
 }
 
+/*
+ * Make a random address in a small part of the address space, so that
+ * prefixes overlap.
+ */
+static void
+randomaddr(isc_netaddr_t *addr, bool v6) {
+	if (v6) {
+		struct in6_addr in6;
+		uint32_t words[4];
+
+		isc_random_buf(words, sizeof(words));
+		memmove(&in6, words, sizeof(in6));
+		in6.s6_addr[0] = 0x20;
+		in6.s6_addr[1] = 0x01;
+		in6.s6_addr[2] &= 0x03;
+		isc_netaddr_fromin6(addr, &in6);
+	} else {
+		struct in_addr ina;
+
+		ina.s_addr = htonl(0x0a000000 | (isc_random32() & 0x0003ffff));
+		isc_netaddr_fromin(addr, &ina);
+	}
+}
+
+static void
+addrandom(dns_acl_t *acl, unsigned int count) {
+	isc_netaddr_t addr;
+	unsigned int i;
+	isc_result_t result;
+
+	for (i = 0; i < count; i++) {
+		bool v6 = (i % 3 == 2);
+		uint16_t bitlen;
+
+		randomaddr(&addr, v6);
+		bitlen = v6 ? 16 + isc_random_uniform(113)
+			    : 8 + isc_random_uniform(25);
+		result = dns_iptable_addprefix(acl->iptable, &addr, bitlen,
+					       (isc_random32() & 1) != 0);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+}
+
+#define NPROBES 2000
+
+/* a compiled IP table matches exactly as the radix tree does */
+static void
+compile_test(void **state) {
+	dns_acl_t *acl = NULL, *nested = NULL, *any = NULL;
+	isc_netaddr_t probes[NPROBES];
+	int expect[NPROBES];
+	isc_result_t result;
+	int i, match;
+
+	UNUSED(state);
+
+	result = dns_acl_create(dt_mctx, 0, &acl);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	addrandom(acl, 200);
+
+	result = dns_acl_create(dt_mctx, 0, &nested);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	addrandom(nested, 200);
+	result = dns_acl_merge(acl, nested, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < NPROBES; i++) {
+		randomaddr(&probes[i], (i & 1) != 0);
+	}
+
+	/* The ends of the address spaces. */
+	for (i = 0; i < 4; i++) {
+		memset(&probes[i].type, (i < 2) ? 0 : 0xff,
+		       sizeof(probes[i].type));
+	}
+
+	for (i = 0; i < NPROBES; i++) {
+		expect[i] = dns_iptable_match(acl->iptable, &probes[i]);
+	}
+
+	dns_iptable_compile(acl->iptable);
+	assert_non_null(acl->iptable->compiled);
+	for (i = 0; i < NPROBES; i++) {
+		match = dns_iptable_match(acl->iptable, &probes[i]);
+		assert_int_equal(match, expect[i]);
+	}
+
+	/* Modifying the IP table discards the compiled table. */
+	result = dns_acl_any(dt_mctx, &any);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_acl_merge(acl, any, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_null(acl->iptable->compiled);
+
+	for (i = 0; i < NPROBES; i++) {
+		expect[i] = dns_iptable_match(acl->iptable, &probes[i]);
+		assert_int_not_equal(expect[i], 0);
+	}
+	dns_iptable_compile(acl->iptable);
+	for (i = 0; i < NPROBES; i++) {
+		match = dns_iptable_match(acl->iptable, &probes[i]);
+		assert_int_equal(match, expect[i]);
+	}
+
+	dns_acl_detach(&any);
+	dns_acl_detach(&nested);
+	dns_acl_detach(&acl);
+}
+
+/* an empty IP table compiles to one that matches nothing */
+static void
+compileempty_test(void **state) {
+	dns_acl_t *acl = NULL;
+	isc_netaddr_t addr;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_acl_create(dt_mctx, 0, &acl);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_iptable_compile(acl->iptable);
+	randomaddr(&addr, false);
+	assert_int_equal(dns_iptable_match(acl->iptable, &addr), 0);
+	randomaddr(&addr, true);
+	assert_int_equal(dns_iptable_match(acl->iptable, &addr), 0);
+
+	dns_acl_detach(&acl);
+}
+
+#ifdef DNS_BENCHMARK_TESTS
+
+/*
+ * Compare lookups in the radix tree and in the compiled table, for
+ * IP tables holding from 10 to 10 million IPv4 prefixes.
+ */
+
+#define NLOOKUPS 1000000
+
+static double
+timelookups(dns_iptable_t *tab, const isc_netaddr_t *addrs) {
+	isc_time_t ts1, ts2;
+	unsigned int i, matched = 0;
+
+	isc_time_now(&ts1);
+	for (i = 0; i < NLOOKUPS; i++) {
+		if (dns_iptable_match(tab, &addrs[i]) != 0) {
+			matched++;
+		}
+	}
+	isc_time_now(&ts2);
+
+	UNUSED(matched);
+
+	return (isc_time_microdiff(&ts2, &ts1) * 1000.0 / NLOOKUPS);
+}
+
+static void
+benchmark_test(void **state) {
+	isc_mem_t *mctx = NULL;
+	isc_netaddr_t *addrs;
+	unsigned int size, i;
+
+	UNUSED(state);
+
+	/* Recording millions of allocations would dominate the run. */
+	isc_mem_debugging &= ~ISC_MEM_DEBUGRECORD;
+	isc_mem_create(&mctx);
+
+	addrs = isc_mem_get(mctx, NLOOKUPS * sizeof(*addrs));
+	for (size = 10; size <= 10000000; size *= 10) {
+		dns_iptable_t *tab = NULL;
+		isc_time_t ts1, ts2;
+		isc_netaddr_t addr;
+		struct in_addr ina;
+		double radix, compiled;
+		uint64_t usecs;
+		isc_result_t result;
+
+		result = dns_iptable_create(mctx, &tab);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		for (i = 0; i < size; i++) {
+			ina.s_addr = isc_random32();
+			isc_netaddr_fromin(&addr, &ina);
+			result = dns_iptable_addprefix(
+				tab, &addr, 16 + isc_random_uniform(17), true);
+			assert_int_equal(result, ISC_R_SUCCESS);
+		}
+		for (i = 0; i < NLOOKUPS; i++) {
+			ina.s_addr = isc_random32();
+			isc_netaddr_fromin(&addrs[i], &ina);
+		}
+
+		radix = timelookups(tab, addrs);
+		isc_time_now(&ts1);
+		dns_iptable_compile(tab);
+		isc_time_now(&ts2);
+		usecs = isc_time_microdiff(&ts2, &ts1);
+		compiled = timelookups(tab, addrs);
+
+		printf("%8u prefixes: radix %6.1f ns, compiled %6.1f ns "
+		       "per lookup, compiled in %" PRIu64 " us\n",
+		       size, radix, compiled, usecs);
+
+		dns_iptable_detach(&tab);
+	}
+	isc_mem_put(mctx, addrs, NLOOKUPS * sizeof(*addrs));
+	isc_mem_destroy(&mctx);
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+
 int
 main(void) {
 	const struct CMUnitTest tests[] = {
 		cmocka_unit_test_setup_teardown(dns_acl_isinsecure_test, _setup,
 						_teardown),
+		cmocka_unit_test_setup_teardown(compile_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(compileempty_test, _setup,
+						_teardown),
+#ifdef DNS_BENCHMARK_TESTS
+		cmocka_unit_test_setup_teardown(benchmark_test, _setup,
+						_teardown),
+#endif /* DNS_BENCHMARK_TESTS */
 	};
 
 	return (cmocka_run_group_tests(tests, NULL, NULL));
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/atomic.h>
+#include <isc/event.h>
+#include <isc/sockaddr.h>
+#include <isc/stdtime.h>
+#include <isc/task.h>
+#include <isc/util.h>
+
+#include <dns/adb.h>
+#include <dns/view.h>
+
+#include "dnstest.h"
+
+static dns_view_t *view = NULL;
+static dns_adb_t *adb = NULL;
+static dns_adbaddrinfo_t *addrinfo = NULL;
+static atomic_bool adb_done;
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+	isc_sockaddr_t sa;
+	struct in_addr in;
+	isc_stdtime_t now;
+
+	UNUSED(state);
+
+	result = dns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_test_makeview("view", &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_adb_create(dt_mctx, view, timermgr, taskmgr, &adb);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	in.s_addr = htonl(INADDR_LOOPBACK);
+	isc_sockaddr_fromin(&sa, &in, 53);
+	isc_stdtime_get(&now);
+	result = dns_adb_findaddrinfo(adb, &sa, &addrinfo, now);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static void
+adb_shutdown(isc_task_t *task, isc_event_t *event) {
+	UNUSED(task);
+
+	atomic_store(&adb_done, true);
+	isc_event_free(&event);
+}
+
+static int
+_teardown(void **state) {
+	isc_task_t *task = NULL;
+	isc_event_t *event = NULL;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	/*
+	 * The ADB refers to the view until it has shut down.
+	 */
+	result = isc_task_create(taskmgr, 0, &task);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	event = isc_event_allocate(dt_mctx, NULL, ISC_TASKEVENT_TEST,
+				   adb_shutdown, NULL, sizeof(*event));
+	atomic_init(&adb_done, false);
+	dns_adb_whenshutdown(adb, task, &event);
+
+	dns_adb_freeaddrinfo(adb, &addrinfo);
+	dns_adb_shutdown(adb);
+	dns_adb_detach(&adb);
+	while (!atomic_load(&adb_done)) {
+		dns_test_nap(1000);
+	}
+	isc_task_detach(&task);
+	dns_view_detach(&view);
+	dns_test_end();
+
+	return (0);
+}
+
+static void
+addrtts(unsigned int count, unsigned int rtt) {
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		dns_adb_adjustsrtt(adb, addrinfo, rtt, DNS_ADB_RTTADJDEFAULT);
+	}
+}
+
+/* RTT percentiles are estimated from the measured RTTs */
+static void
+rttpercentile_test(void **state) {
+	unsigned int rtt;
+
+	UNUSED(state);
+
+	/* Too few samples. */
+	addrtts(5, 5000);
+	assert_int_equal(dns_adb_getrttpercentile(adb, addrinfo, 50), 0);
+
+	/* Timeouts are not counted. */
+	dns_adb_adjustsrtt(adb, addrinfo, 800000, DNS_ADB_RTTADJREPLACE);
+	assert_int_equal(dns_adb_getrttpercentile(adb, addrinfo, 50), 0);
+
+	addrtts(85, 5000);
+	addrtts(10, 300000);
+
+	rtt = dns_adb_getrttpercentile(adb, addrinfo, 50);
+	assert_in_range(rtt, 4000, 8000);
+	rtt = dns_adb_getrttpercentile(adb, addrinfo, 95);
+	assert_in_range(rtt, 256000, 512000);
+}
+
+/* older RTTs carry less weight */
+static void
+rttdecay_test(void **state) {
+	unsigned int rtt;
+
+	UNUSED(state);
+
+	addrtts(200, 300000);
+	rtt = dns_adb_getrttpercentile(adb, addrinfo, 50);
+	assert_in_range(rtt, 256000, 512000);
+
+	addrtts(1000, 2500);
+	rtt = dns_adb_getrttpercentile(adb, addrinfo, 95);
+	assert_in_range(rtt, 2000, 4000);
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(rttpercentile_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(rttdecay_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/file.h>
+#include <isc/print.h>
+#include <isc/stdio.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/cache.h>
+#include <dns/db.h>
+#include <dns/rdatalist.h>
+#include <dns/result.h>
+
+#include "dnstest.h"
+
+#define SNAPSHOT "cache_test.snapshot"
+
+#define SNAPSHOT_NEGATIVE 0x01 /* As in cache.c */
+
+/*
+ * The negative cache data of an NXDOMAIN response: "example." SOA with
+ * authority trust, in the format of ncache.c.
+ */
+static unsigned char ncache[] = {
+	7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0, 0, 6, dns_trust_authauthority,
+	0, 1, 0, 22, 0, 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4,
+	0, 0, 0, 5
+};
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	(void)isc_file_remove(SNAPSHOT);
+	dns_test_end();
+
+	return (0);
+}
+
+static void
+makecache(bool managers, dns_cache_t **cachep) {
+	isc_result_t result;
+
+	result = dns_cache_create(dt_mctx, dt_mctx,
+				  managers ? taskmgr : NULL,
+				  managers ? timermgr : NULL, dns_rdataclass_in,
+				  "test", "rbt", 0, NULL, cachep);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_cache_setfilename(*cachep, SNAPSHOT);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+/*
+ * Add an rdataset with a single record to the cache.  A type of 0 adds
+ * a negative entry for 'covers' holding 'ncache'; 'text' is unused.
+ */
+static void
+addrdataset(dns_cache_t *cache, const char *owner, dns_rdatatype_t type,
+	    dns_rdatatype_t covers, const char *text, dns_ttl_t ttl,
+	    dns_trust_t trust, unsigned int attributes) {
+	unsigned char data[512];
+	dns_fixedname_t fname;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_dbnode_t *node = NULL;
+	dns_db_t *db = NULL;
+	isc_stdtime_t now;
+	isc_result_t result;
+
+	isc_stdtime_get(&now);
+
+	if (type == 0) {
+		rdata.data = ncache;
+		rdata.length = sizeof(ncache);
+		rdata.rdclass = dns_rdataclass_in;
+	} else {
+		result = dns_test_rdatafromstring(&rdata, dns_rdataclass_in,
+						  type, data, sizeof(data),
+						  text, false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = type;
+	rdatalist.covers = covers;
+	rdatalist.ttl = ttl;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	dns_rdataset_init(&rdataset);
+	result = dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	rdataset.trust = trust;
+	rdataset.attributes |= attributes;
+
+	dns_test_namefromstring(owner, &fname);
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+	dns_db_detach(&db);
+}
+
+/*
+ * Look up an rdataset in the cache, as dns_db_findrdataset() does.
+ */
+static isc_result_t
+findrdataset(dns_cache_t *cache, const char *owner, dns_rdatatype_t type,
+	     dns_rdatatype_t covers, dns_rdataset_t *rdataset) {
+	dns_fixedname_t fname;
+	dns_dbnode_t *node = NULL;
+	dns_db_t *db = NULL;
+	isc_stdtime_t now;
+	isc_result_t result;
+
+	isc_stdtime_get(&now);
+
+	dns_test_namefromstring(owner, &fname);
+
+	dns_cache_attachdb(cache, &db);
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), false, &node);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_db_findrdataset(db, node, NULL, type, covers, now,
+					     rdataset, NULL);
+		dns_db_detachnode(db, &node);
+	}
+	dns_db_detach(&db);
+
+	return (result);
+}
+
+static void
+checka(dns_cache_t *cache, const char *owner, const char *address,
+       dns_ttl_t ttl, dns_trust_t trust) {
+	unsigned char data[512];
+	dns_rdataset_t rdataset;
+	dns_rdata_t expected = DNS_RDATA_INIT;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	isc_result_t result;
+
+	dns_rdataset_init(&rdataset);
+	result = findrdataset(cache, owner, dns_rdatatype_a, 0, &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Allow for a clock tick between the dump and the load. */
+	assert_true(rdataset.ttl <= ttl && rdataset.ttl + 2 >= ttl);
+	assert_int_equal(rdataset.trust, trust);
+	assert_int_equal(dns_rdataset_count(&rdataset), 1);
+
+	result = dns_test_rdatafromstring(&expected, dns_rdataclass_in,
+					  dns_rdatatype_a, data, sizeof(data),
+					  address, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_rdataset_first(&rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_current(&rdataset, &rdata);
+	assert_int_equal(dns_rdata_compare(&rdata, &expected), 0);
+
+	dns_rdataset_disassociate(&rdataset);
+}
+
+static void
+populate(dns_cache_t *cache) {
+	isc_result_t result;
+
+	addrdataset(cache, "www.example.", dns_rdatatype_a, 0, "192.0.2.1",
+		    300, dns_trust_answer, 0);
+	addrdataset(cache, "mail.example.", dns_rdatatype_a, 0, "192.0.2.2",
+		    3600, dns_trust_glue, DNS_RDATASETATTR_PREFETCH);
+	addrdataset(cache, "nx.example.", 0, dns_rdatatype_aaaa, NULL,
+		    900, dns_trust_authauthority,
+		    DNS_RDATASETATTR_NEGATIVE | DNS_RDATASETATTR_NXDOMAIN);
+
+	result = dns_cache_dump(cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static void
+checkpopulated(dns_cache_t *cache) {
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	isc_result_t result;
+
+	checka(cache, "www.example.", "192.0.2.1", 300, dns_trust_answer);
+	checka(cache, "mail.example.", "192.0.2.2", 3600, dns_trust_glue);
+
+	dns_rdataset_init(&rdataset);
+	result = findrdataset(cache, "mail.example.", dns_rdatatype_a, 0,
+			      &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true((rdataset.attributes & DNS_RDATASETATTR_PREFETCH) != 0);
+	dns_rdataset_disassociate(&rdataset);
+
+	result = findrdataset(cache, "nx.example.", dns_rdatatype_aaaa, 0,
+			      &rdataset);
+	assert_int_equal(result, DNS_R_NCACHENXDOMAIN);
+	assert_true((rdataset.attributes & DNS_RDATASETATTR_NEGATIVE) != 0);
+	assert_true((rdataset.attributes & DNS_RDATASETATTR_NXDOMAIN) != 0);
+	assert_int_equal(rdataset.trust, dns_trust_authauthority);
+	result = dns_rdataset_first(&rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_current(&rdataset, &rdata);
+	assert_int_equal(rdata.length, sizeof(ncache));
+	assert_memory_equal(rdata.data, ncache, rdata.length);
+	dns_rdataset_disassociate(&rdataset);
+}
+
+/* a dumped cache is restored with its TTLs, trust and attributes */
+static void
+roundtrip_test(void **state) {
+	dns_cache_t *cache = NULL;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	makecache(false, &cache);
+	populate(cache);
+	dns_cache_detach(&cache);
+
+	makecache(false, &cache);
+
+	/* Names cached before the snapshot is loaded are kept. */
+	addrdataset(cache, "www.example.", dns_rdatatype_a, 0, "192.0.2.99",
+		    60, dns_trust_secure, 0);
+
+	result = dns_cache_load(cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	checka(cache, "www.example.", "192.0.2.99", 60, dns_trust_secure);
+	checka(cache, "mail.example.", "192.0.2.2", 3600, dns_trust_glue);
+
+	dns_cache_detach(&cache);
+}
+
+/* the cleaner task loads a snapshot in the background */
+static void
+asyncload_test(void **state) {
+	dns_cache_t *cache = NULL;
+	dns_rdataset_t rdataset;
+	isc_result_t result;
+	int i;
+
+	UNUSED(state);
+
+	makecache(false, &cache);
+	populate(cache);
+	dns_cache_detach(&cache);
+
+	makecache(true, &cache);
+	result = dns_cache_asyncload(cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdataset_init(&rdataset);
+	for (i = 0; i < 100; i++) {
+		result = findrdataset(cache, "nx.example.",
+				      dns_rdatatype_aaaa, 0, &rdataset);
+		if (result == DNS_R_NCACHENXDOMAIN) {
+			dns_rdataset_disassociate(&rdataset);
+			break;
+		}
+		dns_test_nap(10000);
+	}
+	checkpopulated(cache);
+
+	dns_cache_detach(&cache);
+}
+
+/* a missing snapshot or one in master file format can be loaded */
+static void
+fallback_test(void **state) {
+	dns_cache_t *cache = NULL;
+	isc_result_t result;
+	FILE *fp = NULL;
+
+	UNUSED(state);
+
+	(void)isc_file_remove(SNAPSHOT);
+
+	makecache(false, &cache);
+	result = dns_cache_load(cache);
+	assert_int_equal(result, ISC_R_FILENOTFOUND);
+	result = dns_cache_asyncload(cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_cache_detach(&cache);
+
+	result = isc_stdio_open(SNAPSHOT, "w", &fp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	fprintf(fp, "www.example. 300 IN A 192.0.2.1\n");
+	result = isc_stdio_close(fp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	makecache(false, &cache);
+	result = dns_cache_load(cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	checka(cache, "www.example.", "192.0.2.1", 300, dns_trust_ultimate);
+	dns_cache_detach(&cache);
+}
+
+/*
+ * Dump a populated cache, append an rdataset for "bad.example." with a
+ * single record to the snapshot, and load it into a new cache.
+ */
+static isc_result_t
+loadappended(dns_rdatatype_t type, dns_rdatatype_t covers,
+	     unsigned int flags, const unsigned char *data, size_t len,
+	     dns_cache_t **cachep) {
+	static const unsigned char owner[] = "\003bad\007example";
+	unsigned char header[16];
+	isc_buffer_t b;
+	isc_stdtime_t now;
+	isc_result_t result;
+	FILE *fp = NULL;
+
+	makecache(false, cachep);
+	populate(*cachep);
+	dns_cache_detach(cachep);
+
+	isc_stdtime_get(&now);
+	isc_buffer_init(&b, header, sizeof(header));
+	isc_buffer_putuint16(&b, sizeof(owner));
+	isc_buffer_putuint16(&b, type);
+	isc_buffer_putuint16(&b, covers);
+	isc_buffer_putuint8(&b, dns_trust_answer);
+	isc_buffer_putuint8(&b, flags);
+	isc_buffer_putuint32(&b, now + 300);
+	isc_buffer_putuint16(&b, 1);
+	isc_buffer_putuint16(&b, len);
+
+	result = isc_stdio_open(SNAPSHOT, "ab", &fp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stdio_write(header, 1, 2, fp, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stdio_write(owner, 1, sizeof(owner), fp, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stdio_write(header + 2, 1, sizeof(header) - 2, fp, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stdio_write(data, 1, len, fp, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stdio_close(fp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	makecache(false, cachep);
+	return (dns_cache_load(*cachep));
+}
+
+/*
+ * A snapshot ending in a malformed rdataset is rejected, and nothing
+ * from it is loaded.
+ */
+static void
+checkmalformed(dns_rdatatype_t type, dns_rdatatype_t covers,
+	       unsigned int flags, const unsigned char *data, size_t len) {
+	dns_cache_t *cache = NULL;
+	dns_rdataset_t rdataset;
+	isc_result_t result;
+
+	result = loadappended(type, covers, flags, data, len, &cache);
+	assert_int_equal(result, DNS_R_FORMERR);
+
+	dns_rdataset_init(&rdataset);
+	result = findrdataset(cache, "www.example.", dns_rdatatype_a, 0,
+			      &rdataset);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_cache_detach(&cache);
+}
+
+/* a snapshot with a malformed record is rejected as a whole */
+static void
+malformed_test(void **state) {
+	static const unsigned char address[] = { 192, 0, 2, 3 };
+	static const unsigned char compressed[] = { 0xc0, 0x0c };
+	unsigned char data[sizeof(ncache)];
+	dns_cache_t *cache = NULL;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	/* The well-formed records load. */
+	result = loadappended(dns_rdatatype_a, 0, 0, address, sizeof(address),
+			      &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	checkpopulated(cache);
+	checka(cache, "bad.example.", "192.0.2.3", 300, dns_trust_answer);
+	dns_cache_detach(&cache);
+
+	result = loadappended(0, dns_rdatatype_a, SNAPSHOT_NEGATIVE, ncache,
+			      sizeof(ncache), &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	checkpopulated(cache);
+	dns_cache_detach(&cache);
+
+	/* Short, compressed and meta records. */
+	checkmalformed(dns_rdatatype_a, 0, 0, address, 3);
+	checkmalformed(dns_rdatatype_ns, 0, 0, compressed, sizeof(compressed));
+	checkmalformed(dns_rdatatype_any, 0, 0, address, sizeof(address));
+	checkmalformed(dns_rdatatype_a, dns_rdatatype_a, 0, address,
+		       sizeof(address));
+
+	/* Negative entries that aren't in the negative cache format. */
+	checkmalformed(0, dns_rdatatype_a, SNAPSHOT_NEGATIVE, address,
+		       sizeof(address));
+	checkmalformed(0, dns_rdatatype_a, SNAPSHOT_NEGATIVE, ncache,
+		       sizeof(ncache) - 1);
+	memmove(data, ncache, sizeof(ncache));
+	data[11] = dns_trust_ultimate + 1;
+	checkmalformed(0, dns_rdatatype_a, SNAPSHOT_NEGATIVE, data,
+		       sizeof(data));
+	memmove(data, ncache, sizeof(ncache));
+	data[15] = 21;
+	checkmalformed(0, dns_rdatatype_a, SNAPSHOT_NEGATIVE, data,
+		       sizeof(data));
+	checkmalformed(dns_rdatatype_a, 0, SNAPSHOT_NEGATIVE, address,
+		       sizeof(address));
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(roundtrip_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(asyncload_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(fallback_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(malformed_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/atomic.h>
+#include <isc/file.h>
+#include <isc/ht.h>
+#include <isc/print.h>
+#include <isc/util.h>
+
+#include <dns/catz.h>
+#include <dns/db.h>
+#include <dns/diff.h>
+#include <dns/journal.h>
+#include <dns/name.h>
+
+#include "dnstest.h"
+
+#define CATALOG	 "catalog.example"
+#define DBFILE	 "testdata/catz/catalog.db"
+#define JOURNAL	 "testdata/catz/catalog.db.jnl"
+#define LOGFILE	 "catz_test.log"
+#define MAXCHGS	 16
+
+/*
+ * The member zone changes passed to the 'chgzones' method.
+ */
+typedef struct {
+	atomic_uint_fast32_t batches;
+	unsigned int nchanges;
+	char changes[MAXCHGS][DNS_NAME_FORMATSIZE + 4];
+} changes_t;
+
+static FILE *logfile = NULL;
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	(void)isc_file_remove(JOURNAL);
+
+	logfile = fopen(LOGFILE, "w");
+	assert_non_null(logfile);
+
+	result = dns_test_begin(logfile, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_log_setdebuglevel(lctx, 3);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	dns_test_end();
+	fclose(logfile);
+	logfile = NULL;
+	(void)isc_file_remove(LOGFILE);
+	(void)isc_file_remove(JOURNAL);
+
+	return (0);
+}
+
+static isc_result_t
+chgzones(dns_catz_changedlist_t *list, dns_catz_zone_t *origin,
+	 dns_view_t *view, isc_taskmgr_t *tmgr, void *udata) {
+	changes_t *changes = udata;
+	dns_catz_changed_t *changed;
+
+	UNUSED(origin);
+	UNUSED(view);
+	UNUSED(tmgr);
+
+	for (changed = ISC_LIST_HEAD(*list); changed != NULL;
+	     changed = ISC_LIST_NEXT(changed, link))
+	{
+		char *buf = changes->changes[changes->nchanges++];
+		const char *op = (changed->op == dns_catz_op_add)
+					 ? "add"
+					 : (changed->op == dns_catz_op_mod)
+						   ? "mod"
+						   : "del";
+
+		INSIST(changes->nchanges <= MAXCHGS);
+		strlcpy(buf, op, DNS_NAME_FORMATSIZE + 4);
+		strlcat(buf, " ", DNS_NAME_FORMATSIZE + 4);
+		dns_name_format(dns_catz_entry_getname(changed->entry),
+				buf + 4, DNS_NAME_FORMATSIZE);
+	}
+	atomic_fetch_add(&changes->batches, 1);
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+waitfor(changes_t *changes, unsigned int batches) {
+	for (int i = 0;
+	     i < 500 && atomic_load(&changes->batches) < batches; i++) {
+		dns_test_nap(10000);
+	}
+	assert_int_equal(atomic_load(&changes->batches), batches);
+}
+
+static bool
+haschange(changes_t *changes, const char *change) {
+	for (unsigned int i = 0; i < changes->nchanges; i++) {
+		if (strcmp(changes->changes[i], change) == 0) {
+			return (true);
+		}
+	}
+	return (false);
+}
+
+static bool
+logged(const char *message) {
+	char line[1024];
+	bool found = false;
+	FILE *fp;
+
+	fp = fopen(LOGFILE, "r");
+	assert_non_null(fp);
+	while (!found && fgets(line, sizeof(line), fp) != NULL) {
+		found = (strstr(line, message) != NULL);
+	}
+	fclose(fp);
+
+	return (found);
+}
+
+/*
+ * Start tracking catalog zone CATALOG in 'db' with a new collection.
+ */
+static dns_catz_zones_t *
+newcatzs(dns_db_t *db, dns_catz_zonemodmethods_t *zmm, const char *journal) {
+	isc_result_t result;
+	dns_catz_zones_t *catzs = NULL;
+	dns_catz_zone_t *zone = NULL;
+
+	result = dns_catz_new_zones(&catzs, zmm, dt_mctx, taskmgr, timermgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_catz_add_zone(catzs, dns_db_origin(db), &zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_catz_zone_getdefoptions(zone)->min_update_interval = 0;
+	if (journal != NULL) {
+		dns_catz_setjournal(catzs, dns_db_origin(db), journal);
+	}
+	result = dns_catz_dbupdate_callback(db, catzs);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (catzs);
+}
+
+/*
+ * Check that every member of 'a' is a member of 'b', with the same
+ * mhash label and options, and return the number of members of 'a'.
+ */
+static unsigned int
+submembers(dns_catz_zone_t *a, dns_catz_zone_t *b) {
+	isc_result_t result;
+	isc_ht_iter_t *ia = NULL, *ib = NULL;
+	unsigned int count = 0;
+
+	dns_catz_get_iterator(a, &ia);
+	dns_catz_get_iterator(b, &ib);
+	for (result = isc_ht_iter_first(ia); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(ia))
+	{
+		dns_catz_entry_t *ea = NULL;
+		unsigned char *ka = NULL;
+		size_t sa;
+		bool found = false;
+
+		isc_ht_iter_current(ia, (void **)&ea);
+		isc_ht_iter_currentkey(ia, &ka, &sa);
+		for (result = isc_ht_iter_first(ib);
+		     !found && result == ISC_R_SUCCESS;
+		     result = isc_ht_iter_next(ib))
+		{
+			dns_catz_entry_t *eb = NULL;
+			unsigned char *kb = NULL;
+			size_t sb;
+
+			isc_ht_iter_current(ib, (void **)&eb);
+			isc_ht_iter_currentkey(ib, &kb, &sb);
+			found = (sa == sb && memcmp(ka, kb, sa) == 0 &&
+				 dns_catz_entry_cmp(ea, eb));
+		}
+		assert_true(found);
+		count++;
+	}
+	isc_ht_iter_destroy(&ib);
+	isc_ht_iter_destroy(&ia);
+
+	return (count);
+}
+
+/*
+ * Check that the members of 'catzs' are those read by a full update
+ * from the current version of 'db'.
+ */
+static void
+checkmembers(dns_catz_zones_t *catzs, dns_db_t *db) {
+	dns_catz_zonemodmethods_t zmm = { NULL, NULL, NULL, chgzones, NULL };
+	dns_catz_zones_t *full = NULL;
+	dns_catz_zone_t *a, *b;
+	changes_t changes;
+
+	memset(&changes, 0, sizeof(changes));
+	atomic_init(&changes.batches, 0);
+	zmm.udata = &changes;
+
+	full = newcatzs(db, &zmm, NULL);
+	waitfor(&changes, 1);
+
+	a = dns_catz_get_zone(catzs, dns_db_origin(db));
+	b = dns_catz_get_zone(full, dns_db_origin(db));
+	assert_non_null(a);
+	assert_non_null(b);
+	assert_int_equal(submembers(a, b), submembers(b, a));
+
+	dns_catz_catzs_detach(&full);
+}
+
+/*
+ * Apply 'diff' to a new version of 'db', and commit it.
+ */
+static void
+applydiff(dns_db_t *db, dns_diff_t *diff) {
+	isc_result_t result;
+	dns_dbversion_t *version = NULL;
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_diff_apply(diff, db, version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, true);
+}
+
+/* Members updated from the journal match those of a full update */
+static void
+incremental_test(void **state) {
+	const zonechange_t journaled[] = {
+		{ DNS_DIFFOP_DEL, CATALOG, 3600, "SOA",
+		  ". . 1 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_ADD, CATALOG, 3600, "SOA",
+		  ". . 2 86400 3600 86400 3600" },
+		/* Move one.example to a new mhash label. */
+		{ DNS_DIFFOP_DEL, "m1.zones." CATALOG, 3600, "PTR",
+		  "one.example." },
+		{ DNS_DIFFOP_ADD, "m9.zones." CATALOG, 3600, "PTR",
+		  "one.example." },
+		{ DNS_DIFFOP_DEL, "m2.zones." CATALOG, 3600, "PTR",
+		  "two.example." },
+		{ DNS_DIFFOP_ADD, "masters.m3.zones." CATALOG, 3600, "A",
+		  "192.0.2.2" },
+		{ DNS_DIFFOP_ADD, "m4.zones." CATALOG, 3600, "PTR",
+		  "four.example." },
+		ZONECHANGE_SENTINEL,
+	};
+	const zonechange_t unjournaled[] = {
+		{ DNS_DIFFOP_DEL, CATALOG, 3600, "SOA",
+		  ". . 2 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_ADD, CATALOG, 3600, "SOA",
+		  ". . 3 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_DEL, "m4.zones." CATALOG, 3600, "PTR",
+		  "four.example." },
+		{ DNS_DIFFOP_ADD, "m5.zones." CATALOG, 3600, "PTR",
+		  "five.example." },
+		ZONECHANGE_SENTINEL,
+	};
+	dns_catz_zonemodmethods_t zmm = { NULL, NULL, NULL, chgzones, NULL };
+	isc_result_t result;
+	changes_t changes;
+	dns_catz_zones_t *catzs = NULL;
+	dns_db_t *db = NULL;
+	dns_journal_t *journal = NULL;
+	dns_diff_t diff;
+
+	UNUSED(state);
+
+	memset(&changes, 0, sizeof(changes));
+	atomic_init(&changes.batches, 0);
+	zmm.udata = &changes;
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, CATALOG, DBFILE);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	catzs = newcatzs(db, &zmm, JOURNAL);
+	waitfor(&changes, 1);
+	assert_int_equal(changes.nchanges, 3);
+	assert_true(haschange(&changes, "add three.example"));
+
+	/*
+	 * A journaled change is read incrementally, and the member moved
+	 * to a new label is deleted before it is added back.
+	 */
+	result = dns_test_difffromchanges(&diff, journaled, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_CREATE,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_write_transaction(journal, &diff);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_journal_destroy(&journal);
+
+	changes.nchanges = 0;
+	applydiff(db, &diff);
+	dns_diff_clear(&diff);
+	waitfor(&changes, 2);
+
+	assert_true(logged("5 changed members of '" CATALOG "'"));
+	assert_false(logged("cannot update from journal"));
+	assert_int_equal(changes.nchanges, 5);
+	for (unsigned int i = 0; i < changes.nchanges; i++) {
+		bool del = (strncmp(changes.changes[i], "del ", 4) == 0);
+		assert_true(del == (i < 2));
+	}
+	assert_true(haschange(&changes, "del one.example"));
+	assert_true(haschange(&changes, "del two.example"));
+	assert_true(haschange(&changes, "add one.example"));
+	assert_true(haschange(&changes, "add four.example"));
+	assert_true(haschange(&changes, "mod three.example"));
+	checkmembers(catzs, db);
+
+	/*
+	 * A change missing from the journal falls back to a full update.
+	 */
+	result = dns_test_difffromchanges(&diff, unjournaled, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	changes.nchanges = 0;
+	applydiff(db, &diff);
+	dns_diff_clear(&diff);
+	waitfor(&changes, 3);
+
+	assert_true(logged("cannot update from journal"));
+	assert_int_equal(changes.nchanges, 2);
+	assert_string_equal(changes.changes[0], "del four.example");
+	assert_string_equal(changes.changes[1], "add five.example");
+	checkmembers(catzs, db);
+
+	dns_catz_catzs_detach(&catzs);
+	dns_db_detach(&db);
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(incremental_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
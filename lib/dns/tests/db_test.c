@@ -21,11 +21,16 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/print.h>
+#include <isc/stats.h>
+#include <isc/stdtime.h>
+
 #include <dns/db.h>
 #include <dns/dbiterator.h>
 #include <dns/journal.h>
 #include <dns/name.h>
 #include <dns/rdatalist.h>
+#include <dns/stats.h>
 
 #include "dnstest.h"
 
@@ -275,6 +280,108 @@ dns_dbfind_staleok_test(void **state) {
 	isc_mem_detach(&mctx);
 }
 
+#define NEXPIRE	    100
+#define SWEEPBUDGET 7
+
+/* check dns_db_expiredata() removes expired data within its budget */
+static void
+expiredata_test(void **state) {
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	isc_mem_t *mctx = NULL;
+	isc_stats_t *stats = NULL;
+	isc_result_t result;
+	isc_stdtime_t now;
+	uint64_t deleted, last = 0;
+	unsigned int reclaimable = 0;
+	unsigned char data[] = { 0x0a, 0x00, 0x00, 0x01 };
+	char namebuf[DNS_NAME_FORMATSIZE];
+	int i;
+
+	UNUSED(state);
+
+	isc_mem_create(&mctx);
+	isc_stdtime_get(&now);
+
+	result = dns_db_create(mctx, "rbt", dns_rootname, dns_dbtype_cache,
+			       dns_rdataclass_in, 0, NULL, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_stats_create(mctx, &stats, dns_cachestatscounter_max);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_setcachestats(db, stats);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	name = dns_fixedname_initname(&fixed);
+	for (i = 0; i < NEXPIRE; i++) {
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+
+		/* 10.0.0.1 */
+		rdata.data = data;
+		rdata.length = 4;
+		rdata.rdclass = dns_rdataclass_in;
+		rdata.type = dns_rdatatype_a;
+
+		dns_rdatalist_init(&rdatalist);
+		rdatalist.ttl = 10;
+		rdatalist.type = dns_rdatatype_a;
+		rdatalist.rdclass = dns_rdataclass_in;
+		ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+		dns_rdataset_init(&rdataset);
+		result = dns_rdatalist_tordataset(&rdatalist, &rdataset);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		snprintf(namebuf, sizeof(namebuf), "n%d.example", i);
+		result = dns_name_fromstring(name, namebuf, 0, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		result = dns_db_findnode(db, name, true, &node);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0,
+					    NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_db_detachnode(db, &node);
+		dns_rdataset_disassociate(&rdataset);
+	}
+
+	/* Nothing has expired yet. */
+	result = dns_db_expiredata(db, now, SWEEPBUDGET, &reclaimable);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(reclaimable, 0);
+	assert_int_equal(
+		isc_stats_get_counter(stats, dns_cachestatscounter_deletettl),
+		0);
+
+	/*
+	 * Well past the TTL everything is reclaimable, but each call may
+	 * only remove up to its budget.
+	 */
+	now += 3600;
+	for (i = 0; i < 2 * NEXPIRE && last < NEXPIRE; i++) {
+		result = dns_db_expiredata(db, now, SWEEPBUDGET, &reclaimable);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		deleted = isc_stats_get_counter(stats,
+						dns_cachestatscounter_deletettl);
+		assert_true(deleted - last <= SWEEPBUDGET);
+		last = deleted;
+	}
+	assert_int_equal(last, NEXPIRE);
+	assert_true(i >= NEXPIRE / SWEEPBUDGET);
+
+	result = dns_db_expiredata(db, now, SWEEPBUDGET, &reclaimable);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(reclaimable, 0);
+
+	dns_db_detach(&db);
+	isc_stats_detach(&stats);
+	isc_mem_detach(&mctx);
+}
+
 /* database class */
 static void
 class_test(void **state) {
@@ -401,6 +508,7 @@ main(void) {
 		cmocka_unit_test(getoriginnode_test),
 		cmocka_unit_test(getsetservestalettl_test),
 		cmocka_unit_test(dns_dbfind_staleok_test),
+		cmocka_unit_test(expiredata_test),
 		cmocka_unit_test_setup_teardown(class_test, _setup, _teardown),
 		cmocka_unit_test_setup_teardown(dbtype_test, _setup, _teardown),
 		cmocka_unit_test_setup_teardown(version_test, _setup,
@@ -198,6 +198,8 @@ dns_test_end(void) {
 	dst_active = false;
 
 	if (lctx != NULL) {
+		isc_log_setcontext(NULL);
+		dns_log_setcontext(NULL);
 		isc_log_destroy(&lctx);
 	}
 
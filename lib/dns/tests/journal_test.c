@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/diff.h>
+#include <dns/journal.h>
+#include <dns/zone.h>
+
+#include "../zone_p.h"
+#include "dnstest.h"
+
+#define JOURNAL	   "journal_test.jnl"
+#define NEWJOURNAL "journal_test.jnw"
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	(void)isc_file_remove(JOURNAL);
+
+	result = dns_test_begin(NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	dns_test_end();
+	(void)isc_file_remove(JOURNAL);
+	(void)isc_file_remove(NEWJOURNAL);
+
+	return (0);
+}
+
+/*
+ * Write a transaction changing the SOA serial of "example." from
+ * 'serial' to 'serial + 1' and adding 'nrecords' A records, to the
+ * journal JOURNAL.
+ */
+static void
+writetransaction(uint32_t serial, unsigned int nrecords) {
+	char soa[2][64];
+	char owner[64];
+	char addrs[64][16];
+	zonechange_t changes[3 + 64];
+	dns_journal_t *journal = NULL;
+	isc_result_t result;
+	dns_diff_t diff;
+	unsigned int i, n = 0;
+
+	INSIST(nrecords <= 64);
+
+	snprintf(soa[0], sizeof(soa[0]), ". . %u 86400 3600 86400 3600",
+		 serial);
+	snprintf(soa[1], sizeof(soa[1]), ". . %u 86400 3600 86400 3600",
+		 serial + 1);
+	changes[n++] = (zonechange_t){ DNS_DIFFOP_DEL, "example.", 3600, "SOA",
+				       soa[0] };
+	changes[n++] = (zonechange_t){ DNS_DIFFOP_ADD, "example.", 3600, "SOA",
+				       soa[1] };
+	snprintf(owner, sizeof(owner), "s%u.example.", serial);
+	for (i = 0; i < nrecords; i++) {
+		snprintf(addrs[i], sizeof(addrs[i]), "192.0.2.%u", i + 1);
+		changes[n++] = (zonechange_t){ DNS_DIFFOP_ADD, owner, 3600, "A",
+					       addrs[i] };
+	}
+	changes[n] = (zonechange_t)ZONECHANGE_SENTINEL;
+
+	result = dns_test_difffromchanges(&diff, changes, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_CREATE,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_write_transaction(journal, &diff);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_journal_destroy(&journal);
+	dns_diff_clear(&diff);
+}
+
+static size_t
+xfrsize(dns_journal_t *journal, uint32_t begin, uint32_t end) {
+	isc_result_t result;
+	size_t size = 0;
+
+	result = dns_journal_iter_init(journal, begin, end, &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (size);
+}
+
+/* the IXFR size of a range is the sum of the sizes of its transactions */
+static void
+xfrsize_test(void **state) {
+	dns_journal_t *journal = NULL;
+	isc_result_t result;
+	size_t s1, s2, s3;
+
+	UNUSED(state);
+
+	writetransaction(1, 1);
+	writetransaction(2, 20);
+	writetransaction(3, 5);
+
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_READ,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	s1 = xfrsize(journal, 1, 2);
+	s2 = xfrsize(journal, 2, 3);
+	s3 = xfrsize(journal, 3, 4);
+	assert_true(s1 < s3 && s3 < s2);
+
+	assert_int_equal(xfrsize(journal, 1, 3), s1 + s2);
+	assert_int_equal(xfrsize(journal, 2, 4), s2 + s3);
+	assert_int_equal(xfrsize(journal, 1, 4), s1 + s2 + s3);
+
+	dns_journal_destroy(&journal);
+}
+
+/*
+ * Write transactions 'first' to 'last', each with 20 A records.
+ */
+static void
+writetransactions(uint32_t first, uint32_t last) {
+	for (uint32_t serial = first; serial <= last; serial++) {
+		writetransaction(serial, 20);
+	}
+}
+
+/*
+ * Return the first and last serial of JOURNAL in '*first' and '*last',
+ * and check that every transaction in between can be read.
+ */
+static void
+journalrange(uint32_t *first, uint32_t *last) {
+	dns_journal_t *journal = NULL;
+	isc_result_t result;
+	size_t size = 0;
+
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_READ,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	*first = dns_journal_first_serial(journal);
+	*last = dns_journal_last_serial(journal);
+	result = dns_journal_iter_init(journal, *first, *last, &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (result = dns_journal_first_rr(journal); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		;
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	dns_journal_destroy(&journal);
+}
+
+/* transactions appended during a staged compaction are kept */
+static void
+compact_append_test(void **state) {
+	dns_journalcompact_t *compact = NULL;
+	dns_journal_t *journal = NULL;
+	isc_result_t result;
+	uint32_t first, last;
+	size_t tail;
+
+	UNUSED(state);
+
+	writetransactions(1, 20);
+
+	result = dns_journal_compact_begin(dt_mctx, JOURNAL, 21, 0, &compact);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_compact_copy(compact);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	writetransactions(21, 22);
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_READ,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	tail = xfrsize(journal, 20, 23);
+	dns_journal_destroy(&journal);
+
+	result = dns_journal_compact_finish(compact);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_journal_compact_destroy(&compact);
+	assert_false(isc_file_exists(NEWJOURNAL));
+
+	journalrange(&first, &last);
+	assert_true(first > 1 && first <= 20);
+	assert_int_equal(last, 23);
+
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_READ,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(xfrsize(journal, 20, 23), tail);
+	dns_journal_destroy(&journal);
+}
+
+/* a staged compaction gives up if the journal is replaced meanwhile */
+static void
+compact_replaced_test(void **state) {
+	dns_journalcompact_t *compact = NULL;
+	isc_result_t result;
+	uint32_t first, last;
+
+	UNUSED(state);
+
+	writetransactions(1, 20);
+
+	result = dns_journal_compact_begin(dt_mctx, JOURNAL, 21, 0, &compact);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_compact_copy(compact);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/*
+	 * The new journal has exactly the same contents as the old one.
+	 */
+	assert_int_equal(isc_file_remove(JOURNAL), ISC_R_SUCCESS);
+	writetransactions(1, 20);
+
+	result = dns_journal_compact_finish(compact);
+	assert_int_equal(result, ISC_R_CANCELED);
+	dns_journal_compact_destroy(&compact);
+	assert_false(isc_file_exists(NEWJOURNAL));
+
+	journalrange(&first, &last);
+	assert_int_equal(first, 1);
+	assert_int_equal(last, 21);
+}
+
+/* journal-compact-idle holds off compaction until updates stop */
+static void
+compact_idle_test(void **state) {
+	dns_zone_t *zone = NULL;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+	uint32_t first, last;
+	int i;
+
+	UNUSED(state);
+
+	writetransactions(1, 20);
+
+	result = dns_test_makezone("example", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_test_loaddb(&db, dns_dbtype_zone, "example",
+				 "testdata/zt/zone1.db");
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_replacedb(zone, db, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detach(&db);
+	result = dns_zone_setjournal(zone, JOURNAL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_zone_setjournalsize(zone, 0);
+	dns_zone_setjournalcompactidle(zone, 1);
+
+	/*
+	 * The zone has just been updated: nothing happens yet.
+	 */
+	dns_zone_markdirty(zone);
+	dns__zone_compactjournal(zone, 21);
+	dns__zone_compactdeferred(zone);
+	journalrange(&first, &last);
+	assert_int_equal(first, 1);
+
+	/*
+	 * Once the zone has been idle for a second the deferred
+	 * compaction runs.
+	 */
+	for (i = 0; i < 300 && first == 1; i++) {
+		dns_test_nap(10000);
+		dns__zone_compactdeferred(zone);
+		journalrange(&first, &last);
+	}
+	assert_true(i >= 50);
+	assert_true(first > 1 && first <= 20);
+	assert_int_equal(last, 21);
+
+	dns_zone_detach(&zone);
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(xfrsize_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(compact_append_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(compact_replaced_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(compact_idle_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
@@ -23,10 +23,12 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/atomic.h>
 #include <isc/dir.h>
 #include <isc/print.h>
 #include <isc/string.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/cache.h>
 #include <dns/callbacks.h>
@@ -52,6 +54,18 @@ _setup(void **state) {
 	return (0);
 }
 
+static int
+_setup_managers(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
 static int
 _teardown(void **state) {
 	UNUSED(state);
@@ -559,6 +573,115 @@ dumpraw_test(void **state) {
 	dns_db_detach(&db);
 }
 
+static atomic_bool dumped;
+static isc_result_t dumpresult;
+
+static void
+dump_done(void *arg, isc_result_t result) {
+	UNUSED(arg);
+
+	dumpresult = result;
+	atomic_store(&dumped, true);
+}
+
+static void
+compare_files(const char *file1, const char *file2) {
+	FILE *f1, *f2;
+	int c1, c2;
+
+	f1 = fopen(file1, "r");
+	assert_non_null(f1);
+	f2 = fopen(file2, "r");
+	assert_non_null(f2);
+
+	do {
+		c1 = fgetc(f1);
+		c2 = fgetc(f2);
+		assert_int_equal(c1, c2);
+	} while (c1 != EOF);
+
+	fclose(f1);
+	fclose(f2);
+}
+
+/*
+ * Parallel dump test:
+ * dns_master_dumpinc() produces the same output with a worker pool
+ * as dns_master_dump() does on a single thread
+ */
+static void
+dumpparallel_test(void **state) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_dumpctx_t *dctx = NULL;
+	isc_workpool_t *pool = NULL;
+	dns_masterformat_t formats[] = { dns_masterformat_text,
+					 dns_masterformat_raw };
+	FILE *f;
+	unsigned int i, j;
+
+	UNUSED(state);
+
+	/*
+	 * Many nodes at several depths, with varying TTLs and empty
+	 * non-terminals, so that chunk boundaries fall where $ORIGIN
+	 * and $TTL are about to change.
+	 */
+	f = fopen("test.parallel.data", "w");
+	assert_non_null(f);
+	fprintf(f, "$TTL 300\n"
+		   "@ SOA ns hostmaster 1 3600 600 86400 300\n"
+		   "  NS ns\n"
+		   "ns A 192.0.2.1\n");
+	for (i = 0; i < 1000; i++) {
+		fprintf(f, "h%u.sub%u.d%u %u A 192.0.2.%u\n", i, i % 37,
+			i % 5, (i % 3 == 0) ? 300 : 600 + i % 7, i % 250);
+		if (i % 4 == 0) {
+			fprintf(f, "h%u.sub%u.d%u 300 TXT \"%u\"\n", i, i % 37,
+				i % 5, i);
+		}
+	}
+	fclose(f);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, TEST_ORIGIN,
+				 "test.parallel.data");
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_currentversion(db, &version);
+
+	isc_workpool_create(dt_mctx, 3, &pool);
+
+	for (j = 0; j < sizeof(formats) / sizeof(formats[0]); j++) {
+		result = dns_master_dump(dt_mctx, db, version,
+					 &dns_master_style_default,
+					 "test.serial", formats[j], NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		atomic_init(&dumped, false);
+		result = dns_master_dumpinc(dt_mctx, db, version,
+					    &dns_master_style_default,
+					    "test.parallel", pool, maintask,
+					    dump_done, NULL, &dctx, formats[j],
+					    NULL);
+		assert_int_equal(result, DNS_R_CONTINUE);
+		for (i = 0; !atomic_load(&dumped) && i < 5000; i++) {
+			dns_test_nap(1000);
+		}
+		assert_true(atomic_load(&dumped));
+		assert_int_equal(dumpresult, ISC_R_SUCCESS);
+		dns_dumpctx_detach(&dctx);
+
+		compare_files("test.serial", "test.parallel");
+		unlink("test.serial");
+		unlink("test.parallel");
+	}
+
+	isc_workpool_detach(&pool);
+	unlink("test.parallel.data");
+	dns_db_closeversion(db, &version, false);
+	dns_db_detach(&db);
+}
+
 static const char *warn_expect_value;
 static bool warn_expect_result;
 
@@ -627,6 +750,8 @@ main(void) {
 						_teardown),
 		cmocka_unit_test_setup_teardown(dumpraw_test, _setup,
 						_teardown),
+		cmocka_unit_test_setup_teardown(dumpparallel_test,
+						_setup_managers, _teardown),
 		cmocka_unit_test_setup_teardown(toobig_test, _setup, _teardown),
 		cmocka_unit_test_setup_teardown(maxrdata_test, _setup,
 						_teardown),
@@ -15,6 +15,7 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -22,16 +23,23 @@
 #include <cmocka.h>
 
 #include <isc/app.h>
+#include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/print.h>
 #include <isc/socket.h>
+#include <isc/stats.h>
 #include <isc/task.h>
 #include <isc/timer.h>
 #include <isc/util.h>
 
+#include <dns/cache.h>
 #include <dns/dispatch.h>
+#include <dns/fixedname.h>
+#include <dns/forward.h>
 #include <dns/name.h>
+#include <dns/rdataset.h>
 #include <dns/resolver.h>
+#include <dns/stats.h>
 #include <dns/view.h>
 
 #include "dnstest.h"
@@ -194,6 +202,207 @@ settimeout_overmax_test(void **state) {
 	destroy_resolver(&resolver);
 }
 
+/* dns_resolver_sethedgebudget, dns_resolver_sethedgepercentile */
+static void
+sethedge_test(void **state) {
+	dns_resolver_t *resolver = NULL;
+
+	UNUSED(state);
+
+	mkres(&resolver);
+
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 0);
+	assert_int_equal(dns_resolver_gethedgepercentile(resolver), 95);
+
+	dns_resolver_sethedgebudget(resolver, 5);
+	dns_resolver_sethedgepercentile(resolver, 90);
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 5);
+	assert_int_equal(dns_resolver_gethedgepercentile(resolver), 90);
+
+	destroy_resolver(&resolver);
+}
+
+/* dns_resolver_setcoalesce */
+static void
+setcoalesce_test(void **state) {
+	dns_resolver_t *resolver = NULL;
+	dns_view_t *other = NULL;
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_test_makeview("other", &other);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	mkres(&resolver);
+
+	/* Setting it twice replaces the reference to the view. */
+	dns_resolver_setcoalesce(resolver, other);
+	dns_resolver_setcoalesce(resolver, other);
+
+	dns_view_detach(&other);
+	destroy_resolver(&resolver);
+}
+
+static atomic_uint_fast32_t fetchesdone;
+
+static void
+fetchdone(isc_task_t *task, isc_event_t *event) {
+	UNUSED(task);
+
+	atomic_fetch_add(&fetchesdone, 1);
+	isc_event_free(&event);
+}
+
+/*
+ * Create a view using 'cache', with a resolver that forwards all queries
+ * to 'server' and counts its statistics in 'stats'.
+ */
+static void
+mkresview(const char *name, dns_cache_t *cache, isc_sockaddr_t *server,
+	  isc_stats_t *stats, dns_view_t **viewp) {
+	isc_result_t result;
+	isc_sockaddrlist_t addrs;
+	isc_sockaddr_t addr = *server;
+	dns_view_t *v = NULL;
+
+	result = dns_test_makeview(name, &v);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_view_createresolver(v, taskmgr, 1, 1, socketmgr, timermgr,
+					 0, dispatchmgr, dispatch, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_view_setcache(v, cache, true);
+
+	ISC_LIST_INIT(addrs);
+	ISC_LINK_INIT(&addr, link);
+	ISC_LIST_APPEND(addrs, &addr, link);
+	result = dns_fwdtable_add(v->fwdtable, dns_rootname, &addrs,
+				  dns_fwdpolicy_only);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_view_setresstats(v, stats);
+
+	*viewp = v;
+}
+
+/*
+ * Return the active fetches of 'resolver' as dumped by
+ * dns_resolver_dumpfetches().
+ */
+static void
+getfetches(dns_resolver_t *resolver, char *buf, size_t size) {
+	FILE *fp;
+	size_t n;
+
+	fp = tmpfile();
+	assert_non_null(fp);
+	dns_resolver_dumpfetches(resolver, isc_statsformat_file, fp);
+	rewind(fp);
+	n = fread(buf, 1, size - 1, fp);
+	buf[n] = '\0';
+	fclose(fp);
+}
+
+/* Views with coalesced fetches share one fetch for the same query */
+static void
+coalesce_test(void **state) {
+	isc_result_t result;
+	isc_socket_t *sock = NULL;
+	isc_sockaddr_t server;
+	struct in_addr ina;
+	isc_stats_t *stats1 = NULL, *stats2 = NULL;
+	dns_cache_t *cache = NULL;
+	dns_view_t *view1 = NULL, *view2 = NULL;
+	dns_fixedname_t fname;
+	dns_rdataset_t rdataset1, rdataset2;
+	dns_fetch_t *fetch1 = NULL, *fetch2 = NULL;
+	isc_task_t *task = NULL;
+	char buf[256];
+
+	UNUSED(state);
+
+	/*
+	 * A server that never answers, so that the fetch stays active.
+	 */
+	result = isc_socket_create(socketmgr, AF_INET, isc_sockettype_udp,
+				   &sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	ina.s_addr = htonl(INADDR_LOOPBACK);
+	isc_sockaddr_fromin(&server, &ina, 0);
+	result = isc_socket_bind(sock, &server, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_socket_getsockname(sock, &server);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_stats_create(dt_mctx, &stats1, dns_resstatscounter_max);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_stats_create(dt_mctx, &stats2, dns_resstatscounter_max);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_cache_create(dt_mctx, dt_mctx, taskmgr, timermgr,
+				  dns_rdataclass_in, "test", "rbt", 0, NULL,
+				  &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	mkresview("view1", cache, &server, stats1, &view1);
+	mkresview("view2", cache, &server, stats2, &view2);
+	dns_resolver_setcoalesce(view2->resolver, view1);
+	dns_view_freeze(view1);
+	dns_view_freeze(view2);
+
+	result = isc_task_create(taskmgr, 0, &task);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	atomic_init(&fetchesdone, 0);
+	dns_test_namefromstring("www.example.", &fname);
+	dns_rdataset_init(&rdataset1);
+	dns_rdataset_init(&rdataset2);
+
+	result = dns_resolver_createfetch(
+		view1->resolver, dns_fixedname_name(&fname), dns_rdatatype_a,
+		NULL, NULL, NULL, NULL, 0, 0, 0, NULL, task, fetchdone, NULL,
+		&rdataset1, NULL, &fetch1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_resolver_createfetch(
+		view2->resolver, dns_fixedname_name(&fname), dns_rdatatype_a,
+		NULL, NULL, NULL, NULL, 0, 0, 0, NULL, task, fetchdone, NULL,
+		&rdataset2, NULL, &fetch2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/*
+	 * The second fetch joined the first one, in the resolver of the
+	 * first view, and is counted by the second view.
+	 */
+	getfetches(view1->resolver, buf, sizeof(buf));
+	assert_string_equal(buf, ".: 1 active (0 spilled, 1 allowed)\n");
+	getfetches(view2->resolver, buf, sizeof(buf));
+	assert_string_equal(buf, "");
+	assert_int_equal(
+		isc_stats_get_counter(stats1, dns_resstatscounter_coalesced),
+		0);
+	assert_int_equal(
+		isc_stats_get_counter(stats2, dns_resstatscounter_coalesced),
+		1);
+
+	dns_resolver_cancelfetch(fetch1);
+	dns_resolver_cancelfetch(fetch2);
+	for (int i = 0; i < 500 && atomic_load(&fetchesdone) < 2; i++) {
+		dns_test_nap(10000);
+	}
+	assert_int_equal(atomic_load(&fetchesdone), 2);
+	dns_resolver_destroyfetch(&fetch1);
+	dns_resolver_destroyfetch(&fetch2);
+
+	isc_task_detach(&task);
+	dns_view_detach(&view2);
+	dns_view_detach(&view1);
+	dns_cache_detach(&cache);
+	isc_stats_detach(&stats2);
+	isc_stats_detach(&stats1);
+	isc_socket_detach(&sock);
+}
+
 int
 main(void) {
 	const struct CMUnitTest tests[] = {
@@ -208,6 +417,11 @@ main(void) {
 						_setup, _teardown),
 		cmocka_unit_test_setup_teardown(settimeout_overmax_test, _setup,
 						_teardown),
+		cmocka_unit_test_setup_teardown(sethedge_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(setcoalesce_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(coalesce_test, _setup,
+						_teardown),
 	};
 
 	return (cmocka_run_group_tests(tests, NULL, NULL));
@@ -0,0 +1,898 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/mem.h>
+#include <isc/netaddr.h>
+#include <isc/print.h>
+#include <isc/random.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/journal.h>
+#include <dns/rpz.h>
+
+#include "../rpz_p.h"
+#include "dnstest.h"
+
+#define ORIGIN	"rpz0."
+#define DBFILE	"testdata/rpz/rpz0.db"
+#define JOURNAL "testdata/rpz/rpz0.db.jnl"
+#define LOGFILE "rpz_test.log"
+
+static FILE *logfile = NULL;
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	dns_test_end();
+
+	return (0);
+}
+
+static int
+_setup_log(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	(void)isc_file_remove(JOURNAL);
+
+	logfile = fopen(LOGFILE, "w");
+	assert_non_null(logfile);
+
+	result = dns_test_begin(logfile, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_log_setdebuglevel(lctx, 1);
+
+	return (0);
+}
+
+static int
+_teardown_log(void **state) {
+	UNUSED(state);
+
+	dns_test_end();
+	fclose(logfile);
+	logfile = NULL;
+	(void)isc_file_remove(LOGFILE);
+	(void)isc_file_remove(JOURNAL);
+
+	return (0);
+}
+
+static void
+setname(isc_mem_t *mctx, dns_name_t *name, const char *str) {
+	isc_result_t result;
+
+	result = dns_name_fromstring(name, str, DNS_NAME_DOWNCASE, mctx);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+/*
+ * Create the policy zones of a view, with 'nzones' zones named
+ * rpz0., rpz1., ... as named would configure them.
+ */
+static void
+makezones(isc_mem_t *mctx, int nzones, dns_rpz_zones_t **rpzsp) {
+	dns_rpz_zones_t *rpzs = NULL;
+	char buf[DNS_NAME_FORMATSIZE];
+	isc_result_t result;
+	int i;
+
+	result = dns_rpz_new_zones(&rpzs, NULL, 0, mctx, taskmgr, timermgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < nzones; i++) {
+		dns_rpz_zone_t *rpz = NULL;
+
+		result = dns_rpz_new_zone(rpzs, &rpz);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		snprintf(buf, sizeof(buf), "rpz%d.", i);
+		setname(mctx, &rpz->origin, buf);
+		snprintf(buf, sizeof(buf), "%s.rpz%d.", DNS_RPZ_CLIENT_IP_ZONE,
+			 i);
+		setname(mctx, &rpz->client_ip, buf);
+		snprintf(buf, sizeof(buf), "%s.rpz%d.", DNS_RPZ_IP_ZONE, i);
+		setname(mctx, &rpz->ip, buf);
+		snprintf(buf, sizeof(buf), "%s.rpz%d.", DNS_RPZ_NSDNAME_ZONE,
+			 i);
+		setname(mctx, &rpz->nsdname, buf);
+		snprintf(buf, sizeof(buf), "%s.rpz%d.", DNS_RPZ_NSIP_ZONE, i);
+		setname(mctx, &rpz->nsip, buf);
+		setname(mctx, &rpz->passthru, DNS_RPZ_PASSTHRU_NAME);
+		setname(mctx, &rpz->drop, DNS_RPZ_DROP_NAME);
+		setname(mctx, &rpz->tcp_only, DNS_RPZ_TCP_ONLY_NAME);
+	}
+
+	*rpzsp = rpzs;
+}
+
+static void
+add(dns_rpz_zones_t *rpzs, dns_rpz_num_t num, const char *owner) {
+	dns_fixedname_t fname;
+	isc_result_t result;
+
+	dns_test_namefromstring(owner, &fname);
+	result = dns_rpz_add(rpzs, num, dns_fixedname_name(&fname));
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static void
+del(dns_rpz_zones_t *rpzs, dns_rpz_num_t num, const char *owner) {
+	dns_fixedname_t fname;
+
+	dns_test_namefromstring(owner, &fname);
+	dns_rpz_delete(rpzs, num, dns_fixedname_name(&fname));
+}
+
+static dns_rpz_zbits_t
+findname(dns_rpz_zones_t *rpzs, const char *qname) {
+	dns_fixedname_t fname;
+
+	dns_test_namefromstring(qname, &fname);
+	return (dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_QNAME, DNS_RPZ_ALL_ZBITS,
+				  dns_fixedname_name(&fname)));
+}
+
+static dns_rpz_num_t
+findip(dns_rpz_zones_t *rpzs, const char *addr, dns_rpz_prefix_t *prefixp) {
+	dns_fixedname_t fname;
+	isc_netaddr_t netaddr;
+	struct in_addr ina;
+
+	assert_int_equal(inet_pton(AF_INET, addr, &ina), 1);
+	isc_netaddr_fromin(&netaddr, &ina);
+	dns_fixedname_init(&fname);
+	return (dns_rpz_find_ip(rpzs, DNS_RPZ_TYPE_IP, DNS_RPZ_ALL_ZBITS,
+				&netaddr, dns_fixedname_name(&fname), prefixp));
+}
+
+/* QNAME triggers, including wildcards, are found in the right zones */
+static void
+name_test(void **state) {
+	dns_rpz_zones_t *rpzs = NULL;
+
+	UNUSED(state);
+
+	makezones(dt_mctx, 2, &rpzs);
+
+	add(rpzs, 0, "bad.example.rpz0.");
+	add(rpzs, 0, "*.evil.example.rpz0.");
+	add(rpzs, 1, "bad.example.rpz1.");
+	add(rpzs, 1, "evil.example.rpz1.");
+
+	assert_int_equal(findname(rpzs, "bad.example."),
+			 DNS_RPZ_ZBIT(0) | DNS_RPZ_ZBIT(1));
+	assert_int_equal(findname(rpzs, "evil.example."), DNS_RPZ_ZBIT(1));
+	assert_int_equal(findname(rpzs, "www.evil.example."),
+			 DNS_RPZ_ZBIT(0));
+	assert_int_equal(findname(rpzs, "a.b.evil.example."),
+			 DNS_RPZ_ZBIT(0));
+	assert_int_equal(findname(rpzs, "good.example."), 0);
+	assert_int_equal(findname(rpzs, "example."), 0);
+
+	del(rpzs, 0, "bad.example.rpz0.");
+	assert_int_equal(findname(rpzs, "bad.example."), DNS_RPZ_ZBIT(1));
+	del(rpzs, 1, "bad.example.rpz1.");
+	assert_int_equal(findname(rpzs, "bad.example."), 0);
+	del(rpzs, 0, "*.evil.example.rpz0.");
+	assert_int_equal(findname(rpzs, "www.evil.example."), 0);
+	assert_int_equal(findname(rpzs, "evil.example."), DNS_RPZ_ZBIT(1));
+
+	dns_rpz_detach_rpzs(&rpzs);
+}
+
+/* names with triggers in high numbered zones are handled the same way */
+static void
+highzone_test(void **state) {
+	dns_rpz_zones_t *rpzs = NULL;
+
+	UNUSED(state);
+
+	makezones(dt_mctx, 40, &rpzs);
+
+	add(rpzs, 2, "bad.example.rpz2.");
+	add(rpzs, 39, "bad.example.rpz39.");
+	add(rpzs, 39, "*.bad.example.rpz39.");
+	assert_int_equal(findname(rpzs, "bad.example."),
+			 DNS_RPZ_ZBIT(2) | DNS_RPZ_ZBIT(39));
+	assert_int_equal(findname(rpzs, "www.bad.example."),
+			 DNS_RPZ_ZBIT(39));
+
+	del(rpzs, 39, "bad.example.rpz39.");
+	del(rpzs, 39, "*.bad.example.rpz39.");
+	assert_int_equal(findname(rpzs, "bad.example."), DNS_RPZ_ZBIT(2));
+	assert_int_equal(findname(rpzs, "www.bad.example."), 0);
+
+	add(rpzs, 39, "bad.example.rpz39.");
+	assert_int_equal(findname(rpzs, "bad.example."),
+			 DNS_RPZ_ZBIT(2) | DNS_RPZ_ZBIT(39));
+
+	dns_rpz_detach_rpzs(&rpzs);
+}
+
+/* IP triggers match the longest prefix in the first eligible zone */
+static void
+ip_test(void **state) {
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_rpz_prefix_t prefix;
+
+	UNUSED(state);
+
+	makezones(dt_mctx, 2, &rpzs);
+
+	add(rpzs, 1, "24.0.2.0.192.rpz-ip.rpz1.");
+	add(rpzs, 1, "32.1.2.0.192.rpz-ip.rpz1.");
+	add(rpzs, 0, "16.0.0.0.192.rpz-ip.rpz0.");
+	add(rpzs, 1, "32.1.2.0.10.rpz-ip.rpz1.");
+
+	assert_int_equal(findip(rpzs, "192.0.2.1", &prefix), 0);
+	assert_int_equal(prefix, 112);
+	assert_int_equal(findip(rpzs, "10.0.2.1", &prefix), 1);
+	assert_int_equal(prefix, 128);
+	assert_int_equal(findip(rpzs, "10.0.2.2", &prefix),
+			 DNS_RPZ_INVALID_NUM);
+
+	del(rpzs, 0, "16.0.0.0.192.rpz-ip.rpz0.");
+	assert_int_equal(findip(rpzs, "192.0.2.1", &prefix), 1);
+	assert_int_equal(prefix, 128);
+	assert_int_equal(findip(rpzs, "192.0.2.9", &prefix), 1);
+	assert_int_equal(prefix, 120);
+	assert_int_equal(findip(rpzs, "192.0.3.1", &prefix),
+			 DNS_RPZ_INVALID_NUM);
+
+	del(rpzs, 1, "32.1.2.0.192.rpz-ip.rpz1.");
+	del(rpzs, 1, "24.0.2.0.192.rpz-ip.rpz1.");
+	assert_int_equal(findip(rpzs, "192.0.2.1", &prefix),
+			 DNS_RPZ_INVALID_NUM);
+	assert_int_equal(findip(rpzs, "10.0.2.1", &prefix), 1);
+
+	dns_rpz_detach_rpzs(&rpzs);
+}
+
+/* many triggers can be added and removed again */
+static void
+churn_test(void **state) {
+	dns_rpz_zones_t *rpzs = NULL;
+	char buf[DNS_NAME_FORMATSIZE];
+	dns_rpz_prefix_t prefix;
+	unsigned int i;
+
+	UNUSED(state);
+
+	makezones(dt_mctx, 1, &rpzs);
+
+	for (i = 0; i < 5000; i++) {
+		snprintf(buf, sizeof(buf), "h%u.d%u.example.rpz0.", i, i % 97);
+		add(rpzs, 0, buf);
+		snprintf(buf, sizeof(buf), "32.%u.%u.2.10.rpz-ip.rpz0.",
+			 i % 256, i / 256);
+		add(rpzs, 0, buf);
+	}
+	assert_int_equal(findname(rpzs, "h42.d42.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findip(rpzs, "10.2.0.42", &prefix), 0);
+
+	for (i = 0; i < 5000; i += 2) {
+		snprintf(buf, sizeof(buf), "h%u.d%u.example.rpz0.", i, i % 97);
+		del(rpzs, 0, buf);
+		snprintf(buf, sizeof(buf), "32.%u.%u.2.10.rpz-ip.rpz0.",
+			 i % 256, i / 256);
+		del(rpzs, 0, buf);
+	}
+	assert_int_equal(findname(rpzs, "h42.d42.example."), 0);
+	assert_int_equal(findname(rpzs, "h43.d43.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findip(rpzs, "10.2.0.42", &prefix),
+			 DNS_RPZ_INVALID_NUM);
+	assert_int_equal(findip(rpzs, "10.2.0.43", &prefix), 0);
+
+	dns_rpz_detach_rpzs(&rpzs);
+}
+
+#define NZONES	  3
+#define NTRIGGERS 3000
+#define NQUERIES  6000
+
+/*
+ * Add random triggers of every kind to the zones of 'rpzs': 'n' names
+ * with their NSDNAME triggers and wildcards, and 'n' IPv4 and IPv6
+ * prefixes of the three kinds of address triggers.
+ */
+static void
+addrandom(dns_rpz_zones_t *rpzs, unsigned int n) {
+	const char *iptypes[] = { DNS_RPZ_IP_ZONE, DNS_RPZ_NSIP_ZONE,
+				  DNS_RPZ_CLIENT_IP_ZONE };
+	char buf[DNS_NAME_FORMATSIZE];
+	unsigned int i, j, bits, zone;
+	uint16_t w[8];
+	uint32_t a;
+
+	for (i = 0; i < n; i++) {
+		zone = isc_random_uniform(NZONES);
+		snprintf(buf, sizeof(buf), "%sh%u.d%u.example.rpz%u.",
+			 (i % 8) == 0 ? "*." : "", i, i % 50, zone);
+		add(rpzs, zone, buf);
+		if ((i % 3) == 0) {
+			snprintf(buf, sizeof(buf),
+				 "h%u.d%u.example.%s.rpz%u.", i, i % 50,
+				 DNS_RPZ_NSDNAME_ZONE, zone);
+			add(rpzs, zone, buf);
+		}
+
+		bits = 8 + isc_random_uniform(25);
+		a = (0x0a000000 | (isc_random32() & 0x00ffffff)) &
+		    (0xffffffffU << (32 - bits));
+		snprintf(buf, sizeof(buf), "%u.%u.%u.%u.%u.%s.rpz%u.", bits,
+			 a & 0xff, (a >> 8) & 0xff, (a >> 16) & 0xff, a >> 24,
+			 iptypes[i % 3], zone);
+		add(rpzs, zone, buf);
+
+		bits = 32 + isc_random_uniform(97);
+		w[0] = 0x2001;
+		w[1] = 0xdb8;
+		for (j = 2; j < 8; j++) {
+			if (bits <= j * 16) {
+				w[j] = 0;
+			} else {
+				w[j] = isc_random_uniform(4);
+			}
+			if (bits < (j + 1) * 16) {
+				w[j] &= 0xffff << ((j + 1) * 16 - bits);
+			}
+		}
+		snprintf(buf, sizeof(buf),
+			 "%u.%x.%x.%x.%x.%x.%x.%x.%x.%s.rpz%u.", bits, w[7],
+			 w[6], w[5], w[4], w[3], w[2], w[1], w[0],
+			 iptypes[(i + 1) % 3], zone);
+		add(rpzs, zone, buf);
+	}
+}
+
+/*
+ * Look up query 'i' of the names and addresses that addrandom()
+ * triggers on, as each kind of trigger, and describe the results in
+ * 'buf'.
+ */
+static void
+lookup(dns_rpz_zones_t *rpzs, unsigned int i, char *buf, size_t size) {
+	const dns_rpz_type_t iptypes[] = { DNS_RPZ_TYPE_IP,
+					   DNS_RPZ_TYPE_NSIP,
+					   DNS_RPZ_TYPE_CLIENT_IP };
+	char name[DNS_NAME_FORMATSIZE];
+	char ipname[DNS_NAME_FORMATSIZE];
+	dns_fixedname_t fname, fipname;
+	dns_name_t *ip_name;
+	isc_netaddr_t netaddr;
+	struct in_addr ina;
+	struct in6_addr in6a;
+	dns_rpz_prefix_t prefix;
+	dns_rpz_num_t num;
+	unsigned int n, j, used;
+
+	/*
+	 * Names with triggers, names below them, names in other cases,
+	 * and names above them.
+	 */
+	n = i / 4 % (2 * NTRIGGERS);
+	switch (i % 4) {
+	case 0:
+		snprintf(name, sizeof(name), "h%u.d%u.example.", n, n % 50);
+		break;
+	case 1:
+		snprintf(name, sizeof(name), "www.h%u.d%u.example.", n, n % 50);
+		break;
+	case 2:
+		snprintf(name, sizeof(name), "a.b.H%u.D%u.Example.", n, n % 50);
+		break;
+	default:
+		snprintf(name, sizeof(name), "d%u.example.", n % 50);
+		break;
+	}
+	dns_test_namefromstring(name, &fname);
+	used = snprintf(buf, size, "%s %" PRIx64 " %" PRIx64, name,
+			dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_QNAME,
+					  DNS_RPZ_ALL_ZBITS,
+					  dns_fixedname_name(&fname)),
+			dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_NSDNAME,
+					  DNS_RPZ_ALL_ZBITS,
+					  dns_fixedname_name(&fname)));
+
+	ina.s_addr = htonl(0x0a000000 | (i * 2654435761U & 0x00ffffff));
+	memset(&in6a, 0, sizeof(in6a));
+	in6a.s6_addr[0] = 0x20;
+	in6a.s6_addr[1] = 0x01;
+	in6a.s6_addr[2] = 0x0d;
+	in6a.s6_addr[3] = 0xb8;
+	for (j = 4; j < 16; j += 2) {
+		in6a.s6_addr[j + 1] = (i >> (j - 4)) & 3;
+	}
+
+	ip_name = dns_fixedname_initname(&fipname);
+	for (j = 0; j < 6; j++) {
+		if (j < 3) {
+			isc_netaddr_fromin(&netaddr, &ina);
+		} else {
+			isc_netaddr_fromin6(&netaddr, &in6a);
+		}
+		prefix = 0;
+		num = dns_rpz_find_ip(rpzs, iptypes[j % 3], DNS_RPZ_ALL_ZBITS,
+				      &netaddr, ip_name, &prefix);
+		if (num == DNS_RPZ_INVALID_NUM) {
+			used += snprintf(buf + used, size - used, " -");
+			continue;
+		}
+		dns_name_format(ip_name, ipname, sizeof(ipname));
+		used += snprintf(buf + used, size - used, " %u/%u/%s", num,
+				 prefix, ipname);
+	}
+	assert_true(used < size);
+}
+
+/* the summary index finds the same triggers as the summary itself */
+static void
+index_test(void **state) {
+	dns_rpz_zones_t *rpzs = NULL;
+	char(*expect)[512];
+	char result[512];
+	unsigned int i, matched = 0;
+
+	UNUSED(state);
+
+	expect = isc_mem_get(dt_mctx, NQUERIES * sizeof(*expect));
+
+	makezones(dt_mctx, NZONES, &rpzs);
+	addrandom(rpzs, NTRIGGERS);
+
+	for (i = 0; i < NQUERIES; i++) {
+		lookup(rpzs, i, expect[i], sizeof(expect[i]));
+		if (strstr(expect[i], "/") != NULL) {
+			matched++;
+		}
+	}
+	assert_true(matched > NQUERIES / 4);
+
+	dns__rpz_index(rpzs);
+	for (i = 0; i < NQUERIES; i++) {
+		lookup(rpzs, i, result, sizeof(result));
+		assert_string_equal(result, expect[i]);
+	}
+
+	/*
+	 * Triggers added after the index was built are not found until
+	 * it is built again.
+	 */
+	add(rpzs, 1, "new.example.rpz1.");
+	add(rpzs, 2, "32.1.0.0.192.rpz-ip.rpz2.");
+	assert_int_equal(findname(rpzs, "new.example."), 0);
+	assert_int_equal(findip(rpzs, "192.0.0.1", &(dns_rpz_prefix_t){ 0 }),
+			 DNS_RPZ_INVALID_NUM);
+
+	dns__rpz_index(rpzs);
+	assert_int_equal(findname(rpzs, "new.example."), DNS_RPZ_ZBIT(1));
+	assert_int_equal(findip(rpzs, "192.0.0.1", &(dns_rpz_prefix_t){ 0 }),
+			 2);
+	for (i = 0; i < NQUERIES; i++) {
+		lookup(rpzs, i, result, sizeof(result));
+		assert_string_equal(result, expect[i]);
+	}
+
+	dns_rpz_detach_rpzs(&rpzs);
+	isc_mem_put(dt_mctx, expect, NQUERIES * sizeof(*expect));
+}
+
+/*
+ * Return the number of lines of the log containing 'message'.
+ */
+static unsigned int
+logged(const char *message) {
+	char line[1024];
+	unsigned int count = 0;
+	FILE *fp;
+
+	fp = fopen(LOGFILE, "r");
+	assert_non_null(fp);
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (strstr(line, message) != NULL) {
+			count++;
+		}
+	}
+	fclose(fp);
+
+	return (count);
+}
+
+static void
+waitlogged(const char *message, unsigned int count) {
+	for (int i = 0; i < 500 && logged(message) < count; i++) {
+		dns_test_nap(10000);
+	}
+	assert_int_equal(logged(message), count);
+}
+
+/*
+ * Apply 'diff' to a new version of 'db', and commit it.
+ */
+static void
+applydiff(dns_db_t *db, dns_diff_t *diff) {
+	isc_result_t result;
+	dns_dbversion_t *version = NULL;
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_diff_apply(diff, db, version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, true);
+}
+
+/*
+ * Tell policy zone 0 of 'rpzs' that 'db' has a new version, and wait
+ * until the update logging 'message' is done and the summary index has
+ * been built from it.
+ */
+static void
+update(dns_rpz_zones_t *rpzs, dns_db_t *db, const char *message) {
+	unsigned int count = logged(message);
+	unsigned int built = logged("summary index built");
+	isc_result_t result;
+
+	result = dns_rpz_dbupdate_callback(db, rpzs->zones[0]);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	waitlogged(message, count + 1);
+	waitlogged("summary index built", built + 1);
+}
+
+/*
+ * Check that the summary of 'rpzs' matches the one built by a full
+ * update from the current version of 'db'.
+ */
+static void
+checksummary(dns_rpz_zones_t *rpzs, dns_db_t *db) {
+	const char *names[] = { "bad.example.",	     "new.example.",
+				"good.example.",     "www.evil.example.",
+				"www.worse.example.", "worse.example.",
+				"example.",	     NULL };
+	const char *nsnames[] = { "ns.evil.example.", "ns.worse.example.",
+				  NULL };
+	const char *addrs[] = { "192.0.2.1", "192.0.2.9", "198.0.2.5",
+				"10.0.0.1", NULL };
+	dns_rpz_zones_t *full = NULL;
+	dns_fixedname_t fname;
+	dns_rpz_prefix_t p1, p2;
+
+	makezones(dt_mctx, 1, &full);
+	full->zones[0]->min_update_interval = 0;
+	update(full, db, "reload done");
+
+	assert_memory_equal(&rpzs->total_triggers, &full->total_triggers,
+			    sizeof(rpzs->total_triggers));
+	assert_memory_equal(&rpzs->triggers[0], &full->triggers[0],
+			    sizeof(rpzs->triggers[0]));
+	for (int i = 0; names[i] != NULL; i++) {
+		assert_int_equal(findname(rpzs, names[i]),
+				 findname(full, names[i]));
+	}
+	for (int i = 0; nsnames[i] != NULL; i++) {
+		dns_test_namefromstring(nsnames[i], &fname);
+		assert_int_equal(
+			dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_NSDNAME,
+					  DNS_RPZ_ALL_ZBITS,
+					  dns_fixedname_name(&fname)),
+			dns_rpz_find_name(full, DNS_RPZ_TYPE_NSDNAME,
+					  DNS_RPZ_ALL_ZBITS,
+					  dns_fixedname_name(&fname)));
+	}
+	for (int i = 0; addrs[i] != NULL; i++) {
+		p1 = p2 = 0;
+		assert_int_equal(findip(rpzs, addrs[i], &p1),
+				 findip(full, addrs[i], &p2));
+		assert_int_equal(p1, p2);
+	}
+
+	dns_rpz_detach_rpzs(&full);
+}
+
+/* The summary updated from the journal matches that of a full update */
+static void
+incremental_test(void **state) {
+	const zonechange_t journaled[] = {
+		{ DNS_DIFFOP_DEL, ORIGIN, 3600, "SOA",
+		  ". . 1 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_ADD, ORIGIN, 3600, "SOA",
+		  ". . 2 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_DEL, "bad.example." ORIGIN, 3600, "CNAME", "." },
+		{ DNS_DIFFOP_ADD, "new.example." ORIGIN, 3600, "CNAME", "." },
+		{ DNS_DIFFOP_DEL, "*.evil.example." ORIGIN, 3600, "CNAME",
+		  "." },
+		{ DNS_DIFFOP_ADD, "*.worse.example." ORIGIN, 3600, "CNAME",
+		  "." },
+		/* A changed policy keeps the trigger. */
+		{ DNS_DIFFOP_DEL, "good.example." ORIGIN, 3600, "CNAME",
+		  "rpz-passthru." },
+		{ DNS_DIFFOP_ADD, "good.example." ORIGIN, 3600, "CNAME", "." },
+		{ DNS_DIFFOP_DEL, "24.0.2.0.198.rpz-ip." ORIGIN, 3600, "CNAME",
+		  "." },
+		{ DNS_DIFFOP_ADD, "32.9.2.0.192.rpz-ip." ORIGIN, 3600, "CNAME",
+		  "." },
+		{ DNS_DIFFOP_DEL, "ns.evil.example.rpz-nsdname." ORIGIN, 3600,
+		  "CNAME", "." },
+		{ DNS_DIFFOP_ADD, "ns.worse.example.rpz-nsdname." ORIGIN, 3600,
+		  "CNAME", "." },
+		ZONECHANGE_SENTINEL,
+	};
+	const zonechange_t unjournaled[] = {
+		{ DNS_DIFFOP_DEL, ORIGIN, 3600, "SOA",
+		  ". . 2 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_ADD, ORIGIN, 3600, "SOA",
+		  ". . 3 86400 3600 86400 3600" },
+		{ DNS_DIFFOP_ADD, "bad.example." ORIGIN, 3600, "CNAME", "." },
+		{ DNS_DIFFOP_DEL, "new.example." ORIGIN, 3600, "CNAME", "." },
+		ZONECHANGE_SENTINEL,
+	};
+	isc_result_t result;
+	dns_rpz_zones_t *rpzs = NULL;
+	dns_db_t *db = NULL;
+	dns_journal_t *journal = NULL;
+	dns_rpz_prefix_t prefix;
+	dns_diff_t diff;
+
+	UNUSED(state);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, ORIGIN, DBFILE);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	makezones(dt_mctx, 1, &rpzs);
+	rpzs->zones[0]->min_update_interval = 0;
+	dns_rpz_setjournal(rpzs->zones[0], JOURNAL);
+	update(rpzs, db, "reload done");
+	assert_int_equal(findname(rpzs, "bad.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findip(rpzs, "198.0.2.5", &prefix), 0);
+
+	/*
+	 * Journaled adds and deletes are applied incrementally.
+	 */
+	result = dns_test_difffromchanges(&diff, journaled, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_open(dt_mctx, JOURNAL, DNS_JOURNAL_CREATE,
+				  &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_write_transaction(journal, &diff);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_journal_destroy(&journal);
+
+	applydiff(db, &diff);
+	dns_diff_clear(&diff);
+	update(rpzs, db, "incremental update done");
+
+	assert_int_equal(logged("cannot update from journal"), 0);
+	assert_int_equal(findname(rpzs, "bad.example."), 0);
+	assert_int_equal(findname(rpzs, "new.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findname(rpzs, "good.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findname(rpzs, "www.evil.example."), 0);
+	assert_int_equal(findname(rpzs, "www.worse.example."),
+			 DNS_RPZ_ZBIT(0));
+	assert_int_equal(findip(rpzs, "198.0.2.5", &prefix),
+			 DNS_RPZ_INVALID_NUM);
+	assert_int_equal(findip(rpzs, "192.0.2.9", &prefix), 0);
+	checksummary(rpzs, db);
+
+	/*
+	 * A change missing from the journal falls back to a full update.
+	 */
+	result = dns_test_difffromchanges(&diff, unjournaled, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	applydiff(db, &diff);
+	dns_diff_clear(&diff);
+	update(rpzs, db, "reload done");
+
+	assert_int_equal(logged("cannot update from journal"), 1);
+	assert_int_equal(logged("incremental update done"), 1);
+	assert_int_equal(findname(rpzs, "bad.example."), DNS_RPZ_ZBIT(0));
+	assert_int_equal(findname(rpzs, "new.example."), 0);
+	checksummary(rpzs, db);
+
+	dns_rpz_detach_rpzs(&rpzs);
+	dns_db_detach(&db);
+}
+
+#ifdef DNS_BENCHMARK_TESTS
+
+/*
+ * Measure the memory used by the summary databases and by their index,
+ * and the cost of QNAME and IP lookups in each, for policy zones
+ * holding from 1000 to 1 million triggers of each kind.
+ */
+
+#define NLOOKUPS 1000000
+#define NNAMES	 65536
+
+/*
+ * Time NLOOKUPS QNAME and IP lookups in 'rpzs', in nanoseconds per
+ * lookup.
+ */
+static void
+timelookups(dns_rpz_zones_t *rpzs, dns_fixedname_t *names,
+	    isc_netaddr_t *addrs, double *nmtime, double *iptime) {
+	dns_fixedname_t fname;
+	dns_rpz_prefix_t prefix;
+	isc_time_t ts1, ts2;
+	unsigned int i, matched = 0;
+
+	isc_time_now(&ts1);
+	for (i = 0; i < NLOOKUPS; i++) {
+		dns_name_t *name = dns_fixedname_name(&names[i % NNAMES]);
+		if (dns_rpz_find_name(rpzs, DNS_RPZ_TYPE_QNAME,
+				      DNS_RPZ_ALL_ZBITS, name) != 0) {
+			matched++;
+		}
+	}
+	isc_time_now(&ts2);
+	*nmtime = isc_time_microdiff(&ts2, &ts1) * 1000.0 / NLOOKUPS;
+
+	dns_fixedname_init(&fname);
+	isc_time_now(&ts1);
+	for (i = 0; i < NLOOKUPS; i++) {
+		if (dns_rpz_find_ip(rpzs, DNS_RPZ_TYPE_IP, DNS_RPZ_ALL_ZBITS,
+				    &addrs[i], dns_fixedname_name(&fname),
+				    &prefix) != DNS_RPZ_INVALID_NUM)
+		{
+			matched++;
+		}
+	}
+	isc_time_now(&ts2);
+	*iptime = isc_time_microdiff(&ts2, &ts1) * 1000.0 / NLOOKUPS;
+
+	UNUSED(matched);
+}
+
+static void
+benchmark_test(void **state) {
+	isc_mem_t *mctx = NULL;
+	dns_fixedname_t *names;
+	isc_netaddr_t *addrs;
+	char buf[DNS_NAME_FORMATSIZE];
+	unsigned int size, i;
+
+	UNUSED(state);
+
+	/* Recording millions of allocations would dominate the run. */
+	isc_mem_debugging &= ~ISC_MEM_DEBUGRECORD;
+	isc_mem_create(&mctx);
+
+	names = isc_mem_get(dt_mctx, NNAMES * sizeof(*names));
+	addrs = isc_mem_get(dt_mctx, NLOOKUPS * sizeof(*addrs));
+
+	for (size = 1000; size <= 1000000; size *= 10) {
+		dns_rpz_zones_t *rpzs = NULL;
+		isc_time_t ts1, ts2;
+		struct in_addr ina;
+		size_t inuse, idxinuse;
+		double nmtime, iptime;
+		unsigned int bits;
+		uint32_t a;
+
+		makezones(mctx, 1, &rpzs);
+		inuse = isc_mem_inuse(mctx);
+
+		for (i = 0; i < size; i++) {
+			snprintf(buf, sizeof(buf), "%sh%u.d%u.example.rpz0.",
+				 (i % 16) == 0 ? "*." : "", i, i % 1000);
+			add(rpzs, 0, buf);
+			bits = 24 + (i % 9);
+			a = isc_random32() & (0xffffffffU << (32 - bits));
+			snprintf(buf, sizeof(buf), "%u.%u.%u.%u.%u.rpz-ip.rpz0.",
+				 bits, a & 0xff, (a >> 8) & 0xff,
+				 (a >> 16) & 0xff, a >> 24);
+			add(rpzs, 0, buf);
+		}
+		inuse = isc_mem_inuse(mctx) - inuse;
+
+		for (i = 0; i < NNAMES; i++) {
+			unsigned int n = isc_random_uniform(size * 2);
+			snprintf(buf, sizeof(buf), "www.h%u.d%u.example.", n,
+				 n % 1000);
+			dns_test_namefromstring(buf, &names[i]);
+		}
+		for (i = 0; i < NLOOKUPS; i++) {
+			ina.s_addr = isc_random32();
+			isc_netaddr_fromin(&addrs[i], &ina);
+		}
+
+		timelookups(rpzs, names, addrs, &nmtime, &iptime);
+		printf("%8u triggers: summary %6.1f bytes per trigger, "
+		       "QNAME %6.1f ns, IP %6.1f ns per lookup\n",
+		       size, (double)inuse / (2 * size), nmtime, iptime);
+
+		idxinuse = isc_mem_inuse(mctx);
+		isc_time_now(&ts1);
+		dns__rpz_index(rpzs);
+		isc_time_now(&ts2);
+		idxinuse = isc_mem_inuse(mctx) - idxinuse;
+
+		timelookups(rpzs, names, addrs, &nmtime, &iptime);
+		printf("%8u triggers: index   %6.1f bytes per trigger, "
+		       "QNAME %6.1f ns, IP %6.1f ns per lookup, "
+		       "built in %.1f ms\n",
+		       size, (double)idxinuse / (2 * size), nmtime, iptime,
+		       isc_time_microdiff(&ts2, &ts1) / 1000.0);
+
+		dns_rpz_detach_rpzs(&rpzs);
+	}
+
+	isc_mem_put(dt_mctx, addrs, NLOOKUPS * sizeof(*addrs));
+	isc_mem_put(dt_mctx, names, NNAMES * sizeof(*names));
+	isc_mem_destroy(&mctx);
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(name_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(highzone_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(ip_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(churn_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(index_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(incremental_test, _setup_log,
+						_teardown_log),
+#ifdef DNS_BENCHMARK_TESTS
+		cmocka_unit_test_setup_teardown(benchmark_test, _setup,
+						_teardown),
+#endif /* DNS_BENCHMARK_TESTS */
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
@@ -23,19 +23,25 @@
 #include <cmocka.h>
 
 #include <isc/buffer.h>
+#include <isc/file.h>
 #include <isc/list.h>
 #include <isc/region.h>
 #include <isc/result.h>
 #include <isc/stdtime.h>
 #include <isc/types.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/db.h>
+#include <dns/dbiterator.h>
 #include <dns/diff.h>
 #include <dns/dnssec.h>
 #include <dns/fixedname.h>
+#include <dns/masterdump.h>
 #include <dns/name.h>
 #include <dns/rdata.h>
+#include <dns/rdataset.h>
+#include <dns/rdatasetiter.h>
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
 #include <dns/result.h>
@@ -59,6 +65,18 @@ _setup(void **state) {
 	return (0);
 }
 
+static int
+_setup_managers(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = dns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
 static int
 _teardown(void **state) {
 	UNUSED(state);
@@ -437,11 +455,342 @@ updatesigs_next_test(void **state) {
 	dns_zone_detach(&zone);
 }
 
+#define MAXJOBS 64
+
+/* dns_dnssec_signjobs() generates the same signatures as dns_dnssec_sign() */
+static void
+signjobs_test(void **state) {
+	dns_dnssecsignjob_t *jobs[MAXJOBS];
+	dst_key_t *zone_keys[DNS_MAXZONEKEYS];
+	dns_rdatasetiter_t *rdsiter = NULL;
+	dns_dbiterator_t *dbiter = NULL;
+	isc_workpool_t *pool = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_zone_t *zone = NULL;
+	dns_db_t *db = NULL;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	isc_stdtime_t now;
+	isc_result_t result;
+	unsigned int nkeys;
+	size_t i, njobs = 0;
+
+	UNUSED(state);
+
+	result = dns_test_makezone("example", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, "example",
+				 "testdata/master/master18.data");
+	assert_int_equal(result, DNS_R_SEENINCLUDE);
+
+	result = dns_zone_setkeydirectory(zone, "testkeys");
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_stdtime_get(&now);
+	result = dns__zone_findkeys(zone, db, NULL, now, dt_mctx,
+				    DNS_MAXZONEKEYS, zone_keys, &nkeys);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(nkeys, 2);
+
+	/*
+	 * Queue a job for every rdataset in the zone, alternating keys.
+	 */
+	name = dns_fixedname_initname(&fname);
+	dns_rdataset_init(&rdataset);
+	result = dns_db_createiterator(db, 0, &dbiter);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (result = dns_dbiterator_first(dbiter); result == ISC_R_SUCCESS;
+	     result = dns_dbiterator_next(dbiter))
+	{
+		result = dns_dbiterator_current(dbiter, &node, name);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_db_allrdatasets(db, node, NULL, 0, &rdsiter);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		for (result = dns_rdatasetiter_first(rdsiter);
+		     result == ISC_R_SUCCESS && njobs < MAXJOBS;
+		     result = dns_rdatasetiter_next(rdsiter))
+		{
+			dns_rdatasetiter_current(rdsiter, &rdataset);
+			jobs[njobs] = NULL;
+			result = dns_dnssec_signjob_create(
+				dt_mctx, name, &rdataset,
+				zone_keys[njobs % nkeys], now - 3600,
+				now + 3600, &jobs[njobs]);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			njobs++;
+			dns_rdataset_disassociate(&rdataset);
+		}
+		dns_rdatasetiter_destroy(&rdsiter);
+		dns_db_detachnode(db, &node);
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	dns_dbiterator_destroy(&dbiter);
+
+	/*
+	 * The jobs hold their own copies of the data, so the database
+	 * is no longer needed.
+	 */
+	dns_db_detach(&db);
+	assert_true(njobs > 1);
+
+	isc_workpool_create(dt_mctx, 3, &pool);
+	dns_dnssec_signjobs(pool, jobs, njobs, dt_mctx);
+	isc_workpool_detach(&pool);
+
+	for (i = 0; i < njobs; i++) {
+		unsigned char data[1024];
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+		isc_buffer_t buffer;
+
+		assert_int_equal(jobs[i]->result, ISC_R_SUCCESS);
+
+		isc_buffer_init(&buffer, data, sizeof(data));
+		result = dns_dnssec_sign(jobs[i]->name, &jobs[i]->rdataset,
+					 jobs[i]->key, &jobs[i]->inception,
+					 &jobs[i]->expire, dt_mctx, &buffer,
+					 &rdata);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(dns_rdata_compare(&rdata, &jobs[i]->rdata),
+				 0);
+
+		result = dns_dnssec_verify(jobs[i]->name, &jobs[i]->rdataset,
+					   jobs[i]->key, true, 0, dt_mctx,
+					   &jobs[i]->rdata, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		dns_dnssec_signjob_destroy(dt_mctx, &jobs[i]);
+	}
+
+	for (i = 0; i < nkeys; i++) {
+		dst_key_free(&zone_keys[i]);
+	}
+	dns_zone_detach(&zone);
+}
+
+#define JOURNAL "sigs_test.jnl"
+
+/*
+ * Sign the "example" zone with both of its keys, using a worker pool
+ * of 'nworkers' threads if it isn't zero, and return its database.
+ */
+static void
+signzone(unsigned int nworkers, dns_db_t **dbp) {
+	static const uint16_t keyids[] = { 20386, 37464 };
+	isc_workpool_t *pool = NULL;
+	dns_zonemgr_t *zmgr = NULL;
+	dns_zone_t *zone = NULL;
+	isc_result_t result;
+	size_t i;
+
+	(void)isc_file_remove(JOURNAL);
+
+	result = dns_zonemgr_create(dt_mctx, taskmgr, timermgr, socketmgr,
+				    &zmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zonemgr_setsize(zmgr, 1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	if (nworkers != 0) {
+		isc_workpool_create(dt_mctx, nworkers, &pool);
+		dns_zonemgr_setworkpool(zmgr, pool);
+		isc_workpool_detach(&pool);
+	}
+
+	result = dns_test_makezone("example", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_setfile(zone, "testdata/sigs/example.db",
+				  dns_masterformat_text,
+				  &dns_master_style_default);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_setjournal(zone, JOURNAL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_setkeydirectory(zone, "testkeys");
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/*
+	 * Small quanta, so that signing takes several passes.
+	 */
+	dns_zone_setnodes(zone, 2);
+	dns_zone_setsignatures(zone, 3);
+
+	result = dns_zonemgr_managezone(zmgr, zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_load(zone, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < sizeof(keyids) / sizeof(keyids[0]); i++) {
+		result = dns_zone_signwithkey(zone, DST_ALG_RSASHA256,
+					      keyids[i], false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	/*
+	 * The zone has no view, so zone maintenance leaves the signing
+	 * to us.
+	 */
+	for (i = 0; dns__zone_sign(zone); i++) {
+		assert_true(i < 1000);
+	}
+	assert_true(i > 1);
+
+	result = dns_zone_getdb(zone, dbp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_zonemgr_releasezone(zmgr, zone);
+	dns_zone_detach(&zone);
+	dns_zonemgr_shutdown(zmgr);
+	dns_zonemgr_detach(&zmgr);
+	(void)isc_file_remove(JOURNAL);
+}
+
+/*
+ * Check that 'rdata', an RRSIG from one signing of the zone, matches
+ * one of the RRSIGs in 'rdataset' from another, except for the times
+ * and signature.
+ */
+static void
+findrrsig(dns_rdata_t *rdata, dns_rdataset_t *rdataset) {
+	dns_rdata_rrsig_t expected, rrsig;
+	isc_result_t result;
+	bool found = false;
+
+	result = dns_rdata_tostruct(rdata, &expected, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (result = dns_rdataset_first(rdataset);
+	     result == ISC_R_SUCCESS && !found;
+	     result = dns_rdataset_next(rdataset))
+	{
+		dns_rdata_t other = DNS_RDATA_INIT;
+
+		dns_rdataset_current(rdataset, &other);
+		result = dns_rdata_tostruct(&other, &rrsig, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		found = (rrsig.covered == expected.covered &&
+			 rrsig.algorithm == expected.algorithm &&
+			 rrsig.labels == expected.labels &&
+			 rrsig.originalttl == expected.originalttl &&
+			 rrsig.keyid == expected.keyid &&
+			 dns_name_equal(&rrsig.signer, &expected.signer));
+	}
+	assert_true(found);
+}
+
+/*
+ * Check that the NSEC and RRSIG records at each name of 'db' are also
+ * in 'other', and return how many RRSIGs there are.
+ */
+static unsigned int
+comparesigs(dns_db_t *db, dns_db_t *other) {
+	dns_rdatasetiter_t *rdsiter = NULL;
+	dns_dbiterator_t *dbiter = NULL;
+	dns_dbnode_t *node = NULL, *othernode = NULL;
+	dns_rdataset_t rdataset, otherset;
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	isc_result_t result;
+	unsigned int count = 0, nsecs = 0;
+
+	name = dns_fixedname_initname(&fname);
+	dns_rdataset_init(&rdataset);
+	dns_rdataset_init(&otherset);
+	result = dns_db_createiterator(db, 0, &dbiter);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (result = dns_dbiterator_first(dbiter); result == ISC_R_SUCCESS;
+	     result = dns_dbiterator_next(dbiter))
+	{
+		result = dns_dbiterator_current(dbiter, &node, name);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_db_findnode(other, name, false, &othernode);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = dns_db_allrdatasets(db, node, NULL, 0, &rdsiter);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		for (result = dns_rdatasetiter_first(rdsiter);
+		     result == ISC_R_SUCCESS;
+		     result = dns_rdatasetiter_next(rdsiter))
+		{
+			dns_rdatasetiter_current(rdsiter, &rdataset);
+			if (rdataset.type != dns_rdatatype_nsec &&
+			    rdataset.type != dns_rdatatype_rrsig) {
+				dns_rdataset_disassociate(&rdataset);
+				continue;
+			}
+			result = dns_db_findrdataset(other, othernode, NULL,
+						     rdataset.type,
+						     rdataset.covers, 0,
+						     &otherset, NULL);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			assert_int_equal(dns_rdataset_count(&rdataset),
+					 dns_rdataset_count(&otherset));
+			for (result = dns_rdataset_first(&rdataset);
+			     result == ISC_R_SUCCESS;
+			     result = dns_rdataset_next(&rdataset))
+			{
+				dns_rdata_t rdata = DNS_RDATA_INIT;
+
+				dns_rdataset_current(&rdataset, &rdata);
+				if (rdataset.type == dns_rdatatype_nsec) {
+					dns_rdata_t otherrdata =
+						DNS_RDATA_INIT;
+
+					nsecs++;
+					assert_int_equal(
+						dns_rdataset_first(&otherset),
+						ISC_R_SUCCESS);
+					dns_rdataset_current(&otherset,
+							     &otherrdata);
+					assert_int_equal(
+						dns_rdata_compare(&rdata,
+								  &otherrdata),
+						0);
+				} else {
+					count++;
+					findrrsig(&rdata, &otherset);
+				}
+			}
+			dns_rdataset_disassociate(&otherset);
+			dns_rdataset_disassociate(&rdataset);
+		}
+		dns_rdatasetiter_destroy(&rdsiter);
+		dns_db_detachnode(other, &othernode);
+		dns_db_detachnode(db, &node);
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	dns_dbiterator_destroy(&dbiter);
+
+	assert_true(nsecs > 1);
+	return (count);
+}
+
+/* zone signing gives the same NSEC chain and RRSIGs with a worker pool */
+static void
+signzone_test(void **state) {
+	dns_db_t *serial = NULL, *parallel = NULL;
+	unsigned int count;
+
+	UNUSED(state);
+
+	signzone(0, &serial);
+	signzone(3, &parallel);
+
+	count = comparesigs(serial, parallel);
+	assert_true(count > 0);
+	assert_int_equal(comparesigs(parallel, serial), count);
+
+	dns_db_detach(&serial);
+	dns_db_detach(&parallel);
+}
+
 int
 main(void) {
 	const struct CMUnitTest tests[] = {
 		cmocka_unit_test_setup_teardown(updatesigs_next_test, _setup,
 						_teardown),
+		cmocka_unit_test_setup_teardown(signjobs_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(signzone_test, _setup_managers,
+						_teardown),
 	};
 
 	return (cmocka_run_group_tests(tests, NULL, NULL));
@@ -24,13 +24,16 @@
 
 #include <isc/buffer.h>
 #include <isc/task.h>
+#include <isc/time.h>
 #include <isc/timer.h>
 #include <isc/util.h>
 
+#include <dns/diff.h>
 #include <dns/name.h>
 #include <dns/view.h>
 #include <dns/zone.h>
 
+#include "../zone_p.h"
 #include "dnstest.h"
 
 static int
@@ -214,6 +217,83 @@ zonemgr_unreachable(void **state) {
 	assert_null(myzonemgr);
 }
 
+/*
+ * Report 'answered' answered SOA queries to 'live' and 'timedout' timed
+ * out ones to 'remote'.
+ */
+static void
+soaqueries(dns_zonemgr_t *zmgr, unsigned int answered, isc_sockaddr_t *live,
+	   unsigned int timedout, isc_sockaddr_t *remote) {
+	isc_time_t sent;
+
+	TIME_NOW(&sent);
+	for (unsigned int i = 0; i < answered; i++) {
+		dns__zonemgr_soadone(zmgr, ISC_R_SUCCESS, &sent, live);
+	}
+	for (unsigned int i = 0; i < timedout; i++) {
+		dns__zonemgr_soadone(zmgr, ISC_R_TIMEDOUT, &sent, remote);
+	}
+}
+
+/* SOA query pacing ignores unreachable servers and keeps a floor */
+static void
+zonemgr_pace(void **state) {
+	dns_zonemgr_t *myzonemgr = NULL;
+	isc_sockaddr_t live, dead, local;
+	struct in_addr in;
+	isc_result_t result;
+	isc_time_t now;
+
+	UNUSED(state);
+
+	result = dns_zonemgr_create(dt_mctx, taskmgr, timermgr, socketmgr,
+				    &myzonemgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_zonemgr_setserialqueryrate(myzonemgr, 20);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 20);
+
+	in.s_addr = inet_addr("10.53.0.1");
+	isc_sockaddr_fromin(&live, &in, 53);
+	in.s_addr = inet_addr("10.53.0.2");
+	isc_sockaddr_fromin(&dead, &in, 53);
+	in.s_addr = inet_addr("10.53.0.3");
+	isc_sockaddr_fromin(&local, &in, 0);
+	TIME_NOW(&now);
+	dns_zonemgr_unreachableadd(myzonemgr, &dead, &local, &now);
+	dns_zonemgr_unreachableadd(myzonemgr, &dead, &local, &now);
+
+	/*
+	 * Timeouts from a server known to be unreachable are ignored.
+	 */
+	soaqueries(myzonemgr, 10, &live, 10, &dead);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 20);
+
+	/*
+	 * Other timeouts halve the rate, but not below a quarter of the
+	 * configured one.
+	 */
+	soaqueries(myzonemgr, 10, &live, 10, &live);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 10);
+	soaqueries(myzonemgr, 10, &live, 10, &live);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 5);
+	for (int i = 0; i < 5; i++) {
+		soaqueries(myzonemgr, 0, &live, 10, &live);
+		assert_int_equal(dns__zonemgr_soapace(myzonemgr), 5);
+	}
+
+	/*
+	 * Answers alone keep the rate while nothing is queued, and once
+	 * idle the configured rate is used again.
+	 */
+	soaqueries(myzonemgr, 10, &live, 0, &live);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 5);
+	assert_int_equal(dns__zonemgr_soapace(myzonemgr), 20);
+
+	dns_zonemgr_shutdown(myzonemgr);
+	dns_zonemgr_detach(&myzonemgr);
+	assert_null(myzonemgr);
+}
+
 /*
  * XXX:
  * dns_zonemgr API calls that are not yet part of this unit test:
@@ -230,7 +310,6 @@ zonemgr_unreachable(void **state) {
  * 	- dns_zonemgr_setiolimit
  * 	- dns_zonemgr_getiolimit
  * 	- dns_zonemgr_dbdestroyed
- * 	- dns_zonemgr_setserialqueryrate
  * 	- dns_zonemgr_getserialqueryrate
  */
 
@@ -245,6 +324,8 @@ main(void) {
 						_teardown),
 		cmocka_unit_test_setup_teardown(zonemgr_unreachable, _setup,
 						_teardown),
+		cmocka_unit_test_setup_teardown(zonemgr_pace, _setup,
+						_teardown),
 	};
 
 	return (cmocka_run_group_tests(tests, NULL, NULL));
@@ -14,6 +14,7 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/atomic.h>
 #include <isc/mem.h>
 #include <isc/print.h>
 #include <isc/random.h>
@@ -87,6 +88,22 @@ typedef enum {
 	XFRST_AXFR_END
 } xfrin_state_t;
 
+/*%
+ * AXFR data is added to the new database on the zone's load task while
+ * the zone transfer task goes on parsing the following messages.  The
+ * tuples are handed over in batches of XFRIN_BATCHSIZE, and reading
+ * from the primary is suspended while XFRIN_MAXLOADS batches are waiting
+ * to be loaded.  IXFR changes are applied in batches of the same size.
+ */
+#define XFRIN_BATCHSIZE 1000
+#define XFRIN_MAXLOADS	8
+
+typedef struct xfrin_loadevent {
+	ISC_EVENT_COMMON(struct xfrin_loadevent);
+	dns_diff_t diff;
+	isc_result_t result;
+} xfrin_loadevent_t;
+
 /*%
  * Incoming zone transfer context.
  */
@@ -145,6 +162,11 @@ struct dns_xfrin_ctx {
 	dns_diff_t diff; /*%< Pending database changes */
 	int difflen;	 /*%< Number of pending tuples */
 
+	isc_task_t *loadtask;	  /*%< Task adding AXFR data to 'db' */
+	unsigned int loads;	  /*%< Batches sent to 'loadtask' */
+	atomic_bool loadcanceled; /*%< Discard the remaining batches */
+	bool readblocked;	  /*%< Waiting for 'loads' to drain */
+
 	xfrin_state_t state;
 	uint32_t end_serial;
 	bool is_ixfr;
@@ -204,7 +226,11 @@ static isc_result_t
 axfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op, dns_name_t *name,
 	     dns_ttl_t ttl, dns_rdata_t *rdata);
 static isc_result_t
-axfr_apply(dns_xfrin_ctx_t *xfr);
+axfr_queue(dns_xfrin_ctx_t *xfr);
+static void
+axfr_load(isc_task_t *task, isc_event_t *event);
+static void
+axfr_loaded(isc_task_t *task, isc_event_t *event);
 static isc_result_t
 axfr_commit(dns_xfrin_ctx_t *xfr);
 static isc_result_t
@@ -238,6 +264,8 @@ xfrin_recv_done(isc_task_t *task, isc_event_t *event);
 static void
 xfrin_timeout(isc_task_t *task, isc_event_t *event);
 
+static void
+xfrin_end(dns_xfrin_ctx_t *xfr);
 static void
 maybe_free(dns_xfrin_ctx_t *xfr);
 
@@ -312,8 +340,8 @@ axfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op, dns_name_t *name,
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op, name, ttl, rdata,
 				   &tuple));
 	dns_diff_append(&xfr->diff, &tuple);
-	if (++xfr->difflen > 100) {
-		CHECK(axfr_apply(xfr));
+	if (++xfr->difflen >= XFRIN_BATCHSIZE) {
+		CHECK(axfr_queue(xfr));
 	}
 	result = ISC_R_SUCCESS;
 failure:
@@ -321,16 +349,52 @@ failure:
 }
 
 /*
- * Store a set of AXFR RRs in the database.
+ * Hand the pending AXFR RRs over to the load task, which stores them
+ * in the database.
  */
 static isc_result_t
-axfr_apply(dns_xfrin_ctx_t *xfr) {
+axfr_queue(dns_xfrin_ctx_t *xfr) {
+	xfrin_loadevent_t *event;
+
+	if (ISC_LIST_EMPTY(xfr->diff.tuples)) {
+		return (ISC_R_SUCCESS);
+	}
+
+	event = (xfrin_loadevent_t *)isc_event_allocate(
+		xfr->mctx, xfr, DNS_EVENT_XFRINLOAD, axfr_load, xfr,
+		sizeof(*event));
+	dns_diff_init(xfr->mctx, &event->diff);
+	ISC_LIST_APPENDLIST(event->diff.tuples, xfr->diff.tuples, link);
+	event->result = ISC_R_UNSET;
+	xfr->difflen = 0;
+
+	xfr->loads++;
+	isc_task_send(xfr->loadtask, ISC_EVENT_PTR(&event));
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Store a batch of AXFR RRs in the database.  This runs on the load
+ * task; the events are processed in the order they were queued, so
+ * only one batch is being added to the database at any time.
+ */
+static void
+axfr_load(isc_task_t *task, isc_event_t *event) {
+	xfrin_loadevent_t *lev = (xfrin_loadevent_t *)event;
+	dns_xfrin_ctx_t *xfr = (dns_xfrin_ctx_t *)event->ev_arg;
 	isc_result_t result;
 	uint64_t records;
 
-	CHECK(dns_diff_load(&xfr->diff, xfr->axfr.add, xfr->axfr.add_private));
-	xfr->difflen = 0;
-	dns_diff_clear(&xfr->diff);
+	REQUIRE(VALID_XFRIN(xfr));
+
+	UNUSED(task);
+
+	if (atomic_load_acquire(&xfr->loadcanceled)) {
+		CHECK(ISC_R_CANCELED);
+	}
+
+	CHECK(dns_diff_load(&lev->diff, xfr->axfr.add, xfr->axfr.add_private));
 	if (xfr->maxrecords != 0U) {
 		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
 		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
@@ -340,14 +404,75 @@ axfr_apply(dns_xfrin_ctx_t *xfr) {
 	}
 	result = ISC_R_SUCCESS;
 failure:
-	return (result);
+	if (result != ISC_R_SUCCESS) {
+		atomic_store_release(&xfr->loadcanceled, true);
+	}
+	dns_diff_clear(&lev->diff);
+	lev->result = result;
+
+	/*
+	 * Report back to the transfer task.  'xfr' cannot be freed until
+	 * it has seen this event.
+	 */
+	event->ev_type = DNS_EVENT_XFRINLOADED;
+	event->ev_action = axfr_loaded;
+	isc_task_send(xfr->task, &event);
 }
 
+/*
+ * A batch has been stored by axfr_load(): resume reading if we were
+ * waiting for the queue to drain, or finish the transfer if this was
+ * the last batch.
+ */
+static void
+axfr_loaded(isc_task_t *task, isc_event_t *event) {
+	xfrin_loadevent_t *lev = (xfrin_loadevent_t *)event;
+	dns_xfrin_ctx_t *xfr = (dns_xfrin_ctx_t *)event->ev_arg;
+	isc_result_t result;
+
+	REQUIRE(VALID_XFRIN(xfr));
+
+	UNUSED(task);
+
+	INSIST(event->ev_type == DNS_EVENT_XFRINLOADED);
+	result = lev->result;
+	isc_event_free(&event);
+
+	INSIST(xfr->loads > 0);
+	xfr->loads--;
+	if (xfr->shuttingdown) {
+		maybe_free(xfr);
+		return;
+	}
+
+	CHECK(result);
+
+	if (xfr->state == XFRST_AXFR_END) {
+		if (xfr->loads == 0) {
+			CHECK(axfr_finalize(xfr));
+			xfrin_end(xfr);
+		}
+	} else if (xfr->readblocked && xfr->loads < XFRIN_MAXLOADS) {
+		xfr->readblocked = false;
+		CHECK(dns_tcpmsg_readmessage(&xfr->tcpmsg, xfr->task,
+					     xfrin_recv_done, xfr));
+		xfr->recvs++;
+	}
+	return;
+
+failure:
+	xfrin_fail(xfr, result, "failed while loading zone data");
+}
+
+/*
+ * Called once all the batches have been stored.
+ */
 static isc_result_t
 axfr_commit(dns_xfrin_ctx_t *xfr) {
 	isc_result_t result;
 
-	CHECK(axfr_apply(xfr));
+	INSIST(xfr->loads == 0);
+
 	CHECK(dns_db_endload(xfr->db, &xfr->axfr));
 	CHECK(dns_zone_verifydb(xfr->zone, xfr->db, NULL));
 
@@ -360,6 +485,7 @@ static isc_result_t
 axfr_finalize(dns_xfrin_ctx_t *xfr) {
 	isc_result_t result;
 
+	CHECK(axfr_commit(xfr));
 	CHECK(dns_zone_replacedb(xfr->zone, xfr->db, true));
 
 	result = ISC_R_SUCCESS;
@@ -414,7 +540,12 @@ ixfr_putdata(dns_xfrin_ctx_t *xfr, dns_diffop_t op, dns_name_t *name,
 	CHECK(dns_difftuple_create(xfr->diff.mctx, op, name, ttl, rdata,
 				   &tuple));
 	dns_diff_append(&xfr->diff, &tuple);
-	if (++xfr->difflen > 100) {
+	/*
+	 * A difference sequence is applied in batches of XFRIN_BATCHSIZE
+	 * tuples, each sorted by owner name, so the pending changes of a
+	 * large sequence are bounded.
+	 */
+	if (++xfr->difflen >= XFRIN_BATCHSIZE) {
 		CHECK(ixfr_apply(xfr));
 	}
 	result = ISC_R_SUCCESS;
@@ -422,6 +553,50 @@ failure:
 	return (result);
 }
 
+/*
+ * Order IXFR changes by owner name, with the deletions at each name
+ * before the additions, then by type.  Within a difference sequence all
+ * the deletions precede all the additions, so applying the sorted diff
+ * gives the same result while letting dns_diff_apply() handle each
+ * name and rdataset once.
+ */
+static int
+ixfr_apply_order(const void *av, const void *bv) {
+	dns_difftuple_t const *const *ap = av;
+	dns_difftuple_t const *const *bp = bv;
+	dns_difftuple_t const *a = *ap;
+	dns_difftuple_t const *b = *bp;
+	int r;
+
+	r = dns_name_compare(&a->name, &b->name);
+	if (r != 0) {
+		return (r);
+	}
+
+	r = (b->op == DNS_DIFFOP_DEL) - (a->op == DNS_DIFFOP_DEL);
+	if (r != 0) {
+		return (r);
+	}
+
+	r = (a->rdata.type - b->rdata.type);
+	if (r != 0) {
+		return (r);
+	}
+
+	if (a->rdata.type == dns_rdatatype_rrsig) {
+		dns_rdata_t *ardata, *brdata;
+
+		DE_CONST(&a->rdata, ardata);
+		DE_CONST(&b->rdata, brdata);
+		r = (dns_rdata_covers(ardata) - dns_rdata_covers(brdata));
+		if (r != 0) {
+			return (r);
+		}
+	}
+
+	return (dns_rdata_compare(&a->rdata, &b->rdata));
+}
+
 /*
  * Apply a set of IXFR changes to the database.
  */
@@ -436,6 +611,14 @@ ixfr_apply(dns_xfrin_ctx_t *xfr) {
 			CHECK(dns_journal_begin_transaction(xfr->ixfr.journal));
 		}
 	}
+	/*
+	 * The journal keeps the changes in the order they were received,
+	 * so write it before the diff is sorted.
+	 */
+	if (xfr->ixfr.journal != NULL) {
+		CHECK(dns_journal_writediff(xfr->ixfr.journal, &xfr->diff));
+	}
+	CHECK(dns_diff_sort(&xfr->diff, ixfr_apply_order));
 	CHECK(dns_diff_apply(&xfr->diff, xfr->db, xfr->ver));
 	if (xfr->maxrecords != 0U) {
 		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
@@ -444,12 +627,6 @@ ixfr_apply(dns_xfrin_ctx_t *xfr) {
 			goto failure;
 		}
 	}
-	if (xfr->ixfr.journal != NULL) {
-		result = dns_journal_writediff(xfr->ixfr.journal, &xfr->diff);
-		if (result != ISC_R_SUCCESS) {
-			goto failure;
-		}
-	}
 	dns_diff_clear(&xfr->diff);
 	xfr->difflen = 0;
 	result = ISC_R_SUCCESS;
@@ -634,7 +811,7 @@ redo:
 		}
 		CHECK(axfr_putdata(xfr, DNS_DIFFOP_ADD, name, ttl, rdata));
 		if (rdata->type == dns_rdatatype_soa) {
-			CHECK(axfr_commit(xfr));
+			CHECK(axfr_queue(xfr));
 			xfr->state = XFRST_AXFR_END;
 			break;
 		}
@@ -777,6 +954,11 @@ xfrin_reset(dns_xfrin_ctx_t *xfr) {
 
 static void
 xfrin_fail(dns_xfrin_ctx_t *xfr, isc_result_t result, const char *msg) {
+	/*
+	 * Make the load task skip whatever is still queued for it.
+	 */
+	atomic_store_release(&xfr->loadcanceled, true);
+
 	if (result != DNS_R_UPTODATE && result != DNS_R_TOOMANYRECORDS) {
 		xfrin_log(xfr, ISC_LOG_ERROR, "%s: %s", msg,
 			  isc_result_totext(result));
@@ -851,6 +1033,15 @@ xfrin_create(isc_mem_t *mctx, dns_zone_t *zone, dns_db_t *db, isc_task_t *task,
 	dns_diff_init(xfr->mctx, &xfr->diff);
 	xfr->difflen = 0;
 
+	xfr->loadtask = NULL;
+	dns_zone_getloadtask(zone, &xfr->loadtask);
+	if (xfr->loadtask == NULL) {
+		isc_task_attach(task, &xfr->loadtask);
+	}
+	xfr->loads = 0;
+	atomic_init(&xfr->loadcanceled, false);
+	xfr->readblocked = false;
+
 	if (reqtype == dns_rdatatype_soa) {
 		xfr->state = XFRST_SOAQUERY;
 	} else {
@@ -1304,6 +1495,13 @@ xfrin_recv_done(isc_task_t *task, isc_event_t *ev) {
 		xfrin_log(xfr, ISC_LOG_DEBUG(3), "got %s, retrying with AXFR",
 			  isc_result_totext(result));
 	try_axfr:
+		if (xfr->loads > 0) {
+			/*
+			 * The load task is still adding AXFR data to
+			 * xfr->db; give up rather than retry.
+			 */
+			goto failure;
+		}
 		dns_message_destroy(&msg);
 		xfrin_reset(xfr);
 		xfr->reqtype = dns_rdatatype_soa;
@@ -1473,32 +1671,27 @@ xfrin_recv_done(isc_task_t *task, isc_event_t *ev) {
 		CHECK(xfrin_send_request(xfr));
 		break;
 	case XFRST_AXFR_END:
+		if (xfr->loads > 0) {
+			/*
+			 * axfr_loaded() will finish the transfer once the
+			 * last batch has been stored.
+			 */
+			break;
+		}
 		CHECK(axfr_finalize(xfr));
 	/* FALLTHROUGH */
 	case XFRST_IXFR_END:
-		/*
-		 * Close the journal.
-		 */
-		if (xfr->ixfr.journal != NULL) {
-			dns_journal_destroy(&xfr->ixfr.journal);
-		}
-
-		/*
-		 * Inform the caller we succeeded.
-		 */
-		if (xfr->done != NULL) {
-			(xfr->done)(xfr->zone, ISC_R_SUCCESS);
-			xfr->done = NULL;
-		}
-		/*
-		 * We should have no outstanding events at this
-		 * point, thus maybe_free() should succeed.
-		 */
-		xfr->shuttingdown = true;
-		xfr->shutdown_result = ISC_R_SUCCESS;
-		maybe_free(xfr);
+		xfrin_end(xfr);
 		break;
 	default:
+		if (xfr->loads >= XFRIN_MAXLOADS) {
+			/*
+			 * Let the load task catch up; axfr_loaded()
+			 * will read the next message.
+			 */
+			xfr->readblocked = true;
+			break;
+		}
 		/*
 		 * Read the next message.
 		 */
@@ -1517,6 +1710,34 @@ failure:
 	}
 }
 
+/*
+ * The transfer has succeeded.
+ */
+static void
+xfrin_end(dns_xfrin_ctx_t *xfr) {
+	/*
+	 * Close the journal.
+	 */
+	if (xfr->ixfr.journal != NULL) {
+		dns_journal_destroy(&xfr->ixfr.journal);
+	}
+
+	/*
+	 * Inform the caller we succeeded.
+	 */
+	if (xfr->done != NULL) {
+		(xfr->done)(xfr->zone, ISC_R_SUCCESS);
+		xfr->done = NULL;
+	}
+	/*
+	 * We should have no outstanding events at this
+	 * point, thus maybe_free() should succeed.
+	 */
+	xfr->shuttingdown = true;
+	xfr->shutdown_result = ISC_R_SUCCESS;
+	maybe_free(xfr);
+}
+
 static void
 xfrin_timeout(isc_task_t *task, isc_event_t *event) {
 	dns_xfrin_ctx_t *xfr = (dns_xfrin_ctx_t *)event->ev_arg;
@@ -1541,7 +1762,7 @@ maybe_free(dns_xfrin_ctx_t *xfr) {
 	REQUIRE(VALID_XFRIN(xfr));
 
 	if (!xfr->shuttingdown || xfr->refcount != 0 || xfr->connects != 0 ||
-	    xfr->sends != 0 || xfr->recvs != 0)
+	    xfr->sends != 0 || xfr->recvs != 0 || xfr->loads != 0)
 	{
 		return;
 	}
@@ -1574,6 +1795,11 @@ maybe_free(dns_xfrin_ctx_t *xfr) {
 		  xfr->nmsg, xfr->nrecs, xfr->nbytes,
 		  (unsigned int)(msecs / 1000), (unsigned int)(msecs % 1000),
 		  (unsigned int)persec, xfr->end_serial);
+	if (xfr->shutdown_result == ISC_R_SUCCESS &&
+	    xfr->reqtype != dns_rdatatype_soa) {
+		dns_zone_setxfrinrate(xfr->zone, xfr->nbytes, xfr->nrecs,
+				      msecs);
+	}
 
 	if (xfr->socket != NULL) {
 		isc_socket_detach(&xfr->socket);
@@ -1587,6 +1813,10 @@ maybe_free(dns_xfrin_ctx_t *xfr) {
 		isc_task_detach(&xfr->task);
 	}
 
+	if (xfr->loadtask != NULL) {
+		isc_task_detach(&xfr->loadtask);
+	}
+
 	if (xfr->tsigkey != NULL) {
 		dns_tsigkey_detach(&xfr->tsigkey);
 	}
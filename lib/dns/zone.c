@@ -35,6 +35,7 @@
 #include <isc/thread.h>
 #include <isc/timer.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
 #include <dns/acl.h>
 #include <dns/adb.h>
@@ -223,6 +224,8 @@ struct dns_zone {
 	const dns_master_style_t *masterstyle;
 	char *journal;
 	int32_t journalsize;
+	uint32_t compactidle;
+	uint32_t dumpdeltaratio;
 	dns_rdataclass_t rdclass;
 	dns_zonetype_t type;
 	atomic_uint_fast64_t flags;
@@ -238,6 +241,8 @@ struct dns_zone {
 	isc_time_t keywarntime;
 	isc_time_t signingtime;
 	isc_time_t nsec3chaintime;
+	isc_time_t compacttime;
+	isc_time_t updatetime;
 	isc_time_t refreshkeytime;
 	uint32_t refreshkeyinterval;
 	uint32_t refreshkeycount;
@@ -255,6 +260,7 @@ struct dns_zone {
 	uint32_t minretry;
 
 	uint32_t maxrecords;
+	uint32_t updategroup;
 
 	isc_sockaddr_t *masters;
 	isc_dscp_t *masterdscps;
@@ -298,6 +304,7 @@ struct dns_zone {
 	dns_severity_t check_names;
 	ISC_LIST(dns_notify_t) notifies;
 	dns_request_t *request;
+	isc_time_t soaquerytime; /*%< When 'request' was sent */
 	dns_loadctx_t *lctx;
 	dns_io_t *readio;
 	dns_dumpctx_t *dctx;
@@ -352,6 +359,15 @@ struct dns_zone {
 	 * Serial number for deferred journal compaction.
 	 */
 	uint32_t compact_serial;
+	/*%
+	 * Serial number of the version held by the master file, valid
+	 * if DNS_ZONEFLG_HAVEDUMPSERIAL is set.
+	 */
+	uint32_t dumpserial;
+	/*%
+	 * Journal compaction running on the load task.
+	 */
+	dns_journalcompact_t *jcompact;
 	/*%
 	 * Keys that are signing the zone for the first time.
 	 */
@@ -378,6 +394,12 @@ struct dns_zone {
 	 */
 	bool added;
 
+	/*%
+	 * Hash of the configuration the zone was last configured from,
+	 * or 0 if unknown.
+	 */
+	uint64_t confighash;
+
 	/*%
 	 * True if added by automatically by named.
 	 */
@@ -501,6 +523,12 @@ typedef enum {
 						      * notify due to the zone
 						      * just being loaded for
 						      * the first time.  */
+	DNS_ZONEFLG_SOAQUEUED = 0x100000000U, /*%< SOA query waiting in the
+					       * refresh rate limiter */
+	DNS_ZONEFLG_DUMPDEFERRED = 0x200000000U, /*%< master file is behind
+						  * the journal */
+	DNS_ZONEFLG_HAVEDUMPSERIAL = 0x400000000U, /*%< 'dumpserial' is
+						    * valid */
 	DNS_ZONEFLG___MAX = UINT64_MAX, /* trick to make the ENUM 64-bit wide */
 } dns_zoneflg_t;
 
@@ -538,6 +566,30 @@ struct dns_unreachable {
 	uint32_t count;
 };
 
+/*%
+ * Adaptive pacing of a notify or SOA query rate limiter.  The configured
+ * rate is a ceiling: zmgr_pace() halves the rate in use when the
+ * requests it sent during the last second timed out or took much longer
+ * to be answered than usual, and raises it again step by step while
+ * requests are answered and more are queued.  Requests to servers in
+ * the unreachable cache don't count as timeouts, as they say nothing
+ * about congestion, and the rate is never cut below a fraction of the
+ * configured one, so that a few dead servers can't hold back the
+ * refreshes and notifies of all the other zones.
+ */
+typedef struct zonemgr_pace {
+	isc_ratelimiter_t *rl;
+	unsigned int rate;	       /*%< Rate in use */
+	uint64_t minrtt;	       /*%< Lowest average RTT (us) */
+	atomic_uint_fast32_t answered; /*%< Since the last zmgr_pace() */
+	atomic_uint_fast32_t timedout; /*%< Since the last zmgr_pace() */
+	atomic_uint_fast64_t rttsum;   /*%< Of 'answered' requests (us) */
+} zonemgr_pace_t;
+
+#define ZMGR_PACE_INTERVAL 1	  /*%< Seconds between adjustments */
+#define ZMGR_PACE_RTTSLACK 250000 /*%< RTT growth ignored (us) */
+#define ZMGR_PACE_MINSHARE 4	  /*%< Lowest rate is 1/4 of the maximum */
+
 struct dns_zonemgr {
 	unsigned int magic;
 	isc_mem_t *mctx;
@@ -553,6 +605,9 @@ struct dns_zonemgr {
 	isc_ratelimiter_t *refreshrl;
 	isc_ratelimiter_t *startupnotifyrl;
 	isc_ratelimiter_t *startuprefreshrl;
+	isc_workpool_t *workpool;
+	isc_timer_t *pacetimer;
+	isc_stats_t *stats;
 	isc_rwlock_t rwlock;
 	isc_mutex_t iolock;
 	isc_rwlock_t urlock;
@@ -570,6 +625,11 @@ struct dns_zonemgr {
 	unsigned int serialqueryrate;
 	unsigned int startupserialqueryrate;
 
+	/* Adaptive pacing; rates are only changed by the zmgr task. */
+	zonemgr_pace_t notifypace;
+	zonemgr_pace_t startupnotifypace;
+	zonemgr_pace_t refreshpace;
+
 	/* Locked by iolock */
 	uint32_t iolimit;
 	uint32_t ioactive;
@@ -597,6 +657,7 @@ struct dns_notify {
 	isc_dscp_t dscp;
 	ISC_LINK(dns_notify_t) link;
 	isc_event_t *event;
+	isc_time_t sent;
 };
 
 #define DNS_NOTIFY_NOSOA   0x0001U
@@ -791,6 +852,8 @@ zone_postload(dns_zone_t *zone, dns_db_t *db, isc_time_t loadtime,
 	      isc_result_t result);
 static void
 zone_needdump(dns_zone_t *zone, unsigned int delay);
+static bool
+zone_dumpdeferrable(dns_zone_t *zone);
 static void
 zone_shutdown(isc_task_t *, isc_event_t *);
 static void
@@ -835,6 +898,8 @@ notify_send_toaddr(isc_task_t *task, isc_event_t *event);
 static isc_result_t
 zone_dump(dns_zone_t *, bool);
 static void
+zone_compact_deferred(dns_zone_t *zone, isc_time_t *now);
+static void
 got_transfer_quota(isc_task_t *task, isc_event_t *event);
 static isc_result_t
 zmgr_start_xfrin_ifquota(dns_zonemgr_t *zmgr, dns_zone_t *zone);
@@ -882,6 +947,14 @@ static isc_result_t
 zone_send_securedb(dns_zone_t *zone, dns_db_t *db);
 static void
 setrl(isc_ratelimiter_t *rl, unsigned int *rate, unsigned int value);
+static void
+zmgr_pace_init(zonemgr_pace_t *pace, isc_ratelimiter_t *rl);
+static void
+zmgr_pace_done(dns_zonemgr_t *zmgr, zonemgr_pace_t *pace,
+	       isc_result_t result, const isc_time_t *sent,
+	       const isc_sockaddr_t *remote, const isc_sockaddr_t *local);
+static void
+zmgr_pace_tick(isc_task_t *task, isc_event_t *event);
 
 #define ENTER zone_debuglog(zone, me, 1, "enter")
 
@@ -996,7 +1069,11 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx) {
 	zone->masterstyle = NULL;
 	zone->keydirectory = NULL;
 	zone->journalsize = -1;
+	zone->compactidle = 0;
+	zone->dumpdeltaratio = 0;
 	zone->journal = NULL;
+	zone->jcompact = NULL;
+	zone->dumpserial = 0;
 	zone->rdclass = dns_rdataclass_none;
 	zone->type = dns_zone_none;
 	atomic_init(&zone->flags, 0);
@@ -1014,6 +1091,9 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx) {
 	isc_time_settoepoch(&zone->signingtime);
 	isc_time_settoepoch(&zone->nsec3chaintime);
 	isc_time_settoepoch(&zone->refreshkeytime);
+	isc_time_settoepoch(&zone->soaquerytime);
+	isc_time_settoepoch(&zone->compacttime);
+	isc_time_settoepoch(&zone->updatetime);
 	zone->refreshkeyinterval = 0;
 	zone->refreshkeycount = 0;
 	zone->refresh = DNS_ZONE_DEFAULTREFRESH;
@@ -1101,6 +1181,7 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx) {
 	zone->nodes = 100;
 	zone->privatetype = (dns_rdatatype_t)0xffffU;
 	zone->added = false;
+	zone->confighash = 0;
 	zone->automatic = false;
 	zone->rpzs = NULL;
 	zone->rpz_num = DNS_RPZ_INVALID_NUM;
@@ -1126,6 +1207,7 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx) {
 	zone->rss_state = NULL;
 	zone->updatemethod = dns_updatemethod_increment;
 	zone->maxrecords = 0U;
+	zone->updategroup = 0U;
 
 	zone->magic = ZONE_MAGIC;
 
@@ -1186,6 +1268,7 @@ zone_free(dns_zone_t *zone) {
 	INSIST(zone->readio == NULL);
 	INSIST(zone->statelist == NULL);
 	INSIST(zone->writeio == NULL);
+	INSIST(zone->jcompact == NULL);
 
 	if (zone->task != NULL) {
 		isc_task_detach(&zone->task);
@@ -1879,6 +1962,7 @@ dns_zone_rpz_enable_db(dns_zone_t *zone, dns_db_t *db) {
 		return;
 	}
 	REQUIRE(zone->rpzs != NULL);
+	dns_rpz_setjournal(zone->rpzs->zones[zone->rpz_num], zone->journal);
 	result = dns_db_updatenotify_register(db, dns_rpz_dbupdate_callback,
 					      zone->rpzs->zones[zone->rpz_num]);
 	REQUIRE(result == ISC_R_SUCCESS);
@@ -1917,6 +2001,7 @@ dns_zone_catz_enable_db(dns_zone_t *zone, dns_db_t *db) {
 	REQUIRE(db != NULL);
 
 	if (zone->catzs != NULL) {
+		dns_catz_setjournal(zone->catzs, &zone->origin, zone->journal);
 		dns_db_updatenotify_register(db, dns_catz_dbupdate_callback,
 					     zone->catzs);
 	}
@@ -2567,8 +2652,10 @@ zone_gotwritehandle(isc_task_t *task, isc_event_t *event) {
 		}
 		result = dns_master_dumpinc(
 			zone->mctx, zone->db, version, output_style,
-			zone->masterfile, zone->task, dump_done, zone,
-			&zone->dctx, zone->masterformat, &rawdata);
+			zone->masterfile,
+			(zone->zmgr != NULL) ? zone->zmgr->workpool : NULL,
+			zone->task, dump_done, zone, &zone->dctx,
+			zone->masterformat, &rawdata);
 		dns_db_closeversion(zone->db, &version, false);
 	} else {
 		result = ISC_R_CANCELED;
@@ -4705,6 +4792,8 @@ zone_postload(dns_zone_t *zone, dns_db_t *db, isc_time_t loadtime,
 	bool hasinclude = DNS_ZONE_FLAG(zone, DNS_ZONEFLG_HASINCLUDE);
 	bool nomaster = false;
 	bool had_db = false;
+	bool havefileserial = false;
+	uint32_t fileserial = 0;
 	unsigned int options;
 	dns_include_t *inc;
 	bool is_dynamic = false;
@@ -4786,6 +4875,15 @@ zone_postload(dns_zone_t *zone, dns_db_t *db, isc_time_t loadtime,
 		}
 	}
 
+	/*
+	 * Remember the serial of the master file, before the journal
+	 * is applied, for zone_dumpdeferrable().
+	 */
+	if (!nomaster &&
+	    dns_db_getsoaserial(db, NULL, &fileserial) == ISC_R_SUCCESS) {
+		havefileserial = true;
+	}
+
 	/*
 	 * Apply update log, if any, on initial load.
 	 */
@@ -5117,6 +5215,13 @@ zone_postload(dns_zone_t *zone, dns_db_t *db, isc_time_t loadtime,
 		}
 	}
 
+	if (havefileserial) {
+		zone->dumpserial = fileserial;
+		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	} else {
+		DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	}
+
 	/*
 	 * Finished loading inline-signing zone; need to get status
 	 * from the raw side now.
@@ -6385,7 +6490,8 @@ was_dumping(dns_zone_t *zone) {
 	}
 
 	DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_DUMPING);
-	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDDUMP);
+	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDDUMP |
+				       DNS_ZONEFLG_DUMPDEFERRED);
 	isc_time_settoepoch(&zone->dumptime);
 	return (false);
 }
@@ -7380,22 +7486,122 @@ failure:
 	return (result);
 }
 
+/*%
+ * Signatures queued by sign_a_node() for zone_sign().  They are
+ * generated in parallel when the batch is flushed, and then added
+ * to the database in the order they were queued.
+ */
+typedef struct signbatch {
+	dns_dnssecsignjob_t **jobs;
+	size_t count;
+	size_t size;
+} signbatch_t;
+
+static isc_result_t
+signbatch_add(signbatch_t *batch, const dns_name_t *name,
+	      dns_rdataset_t *rdataset, dst_key_t *key,
+	      isc_stdtime_t inception, isc_stdtime_t expire, isc_mem_t *mctx) {
+	dns_dnssecsignjob_t *job = NULL;
+	isc_result_t result;
+
+	result = dns_dnssec_signjob_create(mctx, name, rdataset, key,
+					   inception, expire, &job);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	if (batch->count == batch->size) {
+		size_t newsize = (batch->size == 0) ? 64 : batch->size * 2;
+		dns_dnssecsignjob_t **jobs;
+
+		jobs = isc_mem_get(mctx, newsize * sizeof(jobs[0]));
+		if (batch->jobs != NULL) {
+			memmove(jobs, batch->jobs,
+				batch->count * sizeof(jobs[0]));
+			isc_mem_put(mctx, batch->jobs,
+				    batch->size * sizeof(jobs[0]));
+		}
+		batch->jobs = jobs;
+		batch->size = newsize;
+	}
+	batch->jobs[batch->count++] = job;
+
+	return (ISC_R_SUCCESS);
+}
+
+static isc_result_t
+signbatch_flush(dns_zone_t *zone, signbatch_t *batch, dns_db_t *db,
+		dns_dbversion_t *version, dns_diff_t *diff) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_workpool_t *pool;
+	dns_stats_t *dnssecsignstats;
+	size_t i;
+
+	if (batch->count == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	pool = (zone->zmgr != NULL) ? zone->zmgr->workpool : NULL;
+	dns_dnssec_signjobs(pool, batch->jobs, batch->count, zone->mctx);
+
+	dnssecsignstats = dns_zone_getdnssecsignstats(zone);
+	for (i = 0; i < batch->count; i++) {
+		dns_dnssecsignjob_t *job = batch->jobs[i];
+
+		if (result == ISC_R_SUCCESS) {
+			result = job->result;
+		}
+		if (result == ISC_R_SUCCESS) {
+			/* Update the database and journal with the RRSIG. */
+			/* XXX inefficient - will cause dataset merging */
+			result = update_one_rr(db, version, diff,
+					       DNS_DIFFOP_ADDRESIGN, job->name,
+					       job->rdataset.ttl, &job->rdata);
+		}
+		if (result == ISC_R_SUCCESS && dnssecsignstats != NULL) {
+			/* Generated a new signature. */
+			dns_dnssecsignstats_increment(dnssecsignstats,
+						      ID(job->key),
+						      ALG(job->key),
+						      dns_dnssecsignstats_sign);
+			/* This is a refresh. */
+			dns_dnssecsignstats_increment(
+				dnssecsignstats, ID(job->key), ALG(job->key),
+				dns_dnssecsignstats_refresh);
+		}
+		dns_dnssec_signjob_destroy(zone->mctx, &batch->jobs[i]);
+	}
+	batch->count = 0;
+
+	return (result);
+}
+
+static void
+signbatch_clear(signbatch_t *batch, isc_mem_t *mctx) {
+	size_t i;
+
+	for (i = 0; i < batch->count; i++) {
+		dns_dnssec_signjob_destroy(mctx, &batch->jobs[i]);
+	}
+	if (batch->jobs != NULL) {
+		isc_mem_put(mctx, batch->jobs,
+			    batch->size * sizeof(batch->jobs[0]));
+	}
+	*batch = (signbatch_t){ 0 };
+}
+
 static isc_result_t
 sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 	    dns_dbnode_t *node, dns_dbversion_t *version, bool build_nsec3,
 	    bool build_nsec, dst_key_t *key, isc_stdtime_t inception,
 	    isc_stdtime_t expire, unsigned int minimum, bool is_ksk,
 	    bool is_zsk, bool keyset_kskonly, bool is_bottom_of_zone,
-	    dns_diff_t *diff, int32_t *signatures, isc_mem_t *mctx) {
+	    dns_diff_t *diff, signbatch_t *batch, int32_t *signatures,
+	    isc_mem_t *mctx) {
 	isc_result_t result;
 	dns_kasp_t *kasp = dns_zone_getkasp(zone);
 	dns_rdatasetiter_t *iterator = NULL;
 	dns_rdataset_t rdataset;
-	dns_rdata_t rdata = DNS_RDATA_INIT;
-	dns_stats_t *dnssecsignstats;
-
-	isc_buffer_t buffer;
-	unsigned char data[1024];
 	bool seen_soa, seen_ns, seen_rr, seen_nsec, seen_nsec3, seen_ds;
 
 	result = dns_db_allrdatasets(db, node, version, 0, &iterator);
@@ -7407,7 +7613,6 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 	}
 
 	dns_rdataset_init(&rdataset);
-	isc_buffer_init(&buffer, data, sizeof(data));
 	seen_rr = seen_soa = seen_ns = seen_nsec = seen_nsec3 = seen_ds = false;
 	for (result = dns_rdatasetiter_first(iterator); result == ISC_R_SUCCESS;
 	     result = dns_rdatasetiter_next(iterator))
@@ -7499,28 +7704,12 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 			goto next_rdataset;
 		}
 
-		/* Calculate the signature, creating a RRSIG RDATA. */
-		isc_buffer_clear(&buffer);
-		CHECK(dns_dnssec_sign(name, &rdataset, key, &inception, &expire,
-				      mctx, &buffer, &rdata));
-		/* Update the database and journal with the RRSIG. */
-		/* XXX inefficient - will cause dataset merging */
-		CHECK(update_one_rr(db, version, diff, DNS_DIFFOP_ADDRESIGN,
-				    name, rdataset.ttl, &rdata));
-		dns_rdata_reset(&rdata);
-
-		/* Update DNSSEC sign statistics. */
-		dnssecsignstats = dns_zone_getdnssecsignstats(zone);
-		if (dnssecsignstats != NULL) {
-			/* Generated a new signature. */
-			dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
-						      ALG(key),
-						      dns_dnssecsignstats_sign);
-			/* This is a refresh. */
-			dns_dnssecsignstats_increment(
-				dnssecsignstats, ID(key), ALG(key),
-				dns_dnssecsignstats_refresh);
-		}
+		/*
+		 * Queue the signature; it is calculated and added to the
+		 * database when zone_sign() flushes the batch.
+		 */
+		CHECK(signbatch_add(batch, name, &rdataset, key, inception,
+				    expire, mctx));
 
 		(*signatures)--;
 	next_rdataset:
@@ -9116,6 +9305,7 @@ zone_sign(dns_zone_t *zone) {
 	dns_signing_t *signing, *nextsigning;
 	dns_signinglist_t cleanup;
 	dst_key_t *zone_keys[DNS_MAXZONEKEYS];
+	signbatch_t batch = { 0 };
 	int32_t signatures;
 	bool check_ksk, keyset_kskonly, is_ksk, is_zsk;
 	bool with_ksk, with_zsk;
@@ -9129,6 +9319,7 @@ zone_sign(dns_zone_t *zone) {
 	uint32_t jitter, sigvalidityinterval, expiryinterval;
 	unsigned int i, j;
 	unsigned int nkeys = 0;
+	unsigned int nthreads;
 	uint32_t nodes;
 
 	ENTER;
@@ -9209,10 +9400,15 @@ zone_sign(dns_zone_t *zone) {
 	/*
 	 * We keep pulling nodes off each iterator in turn until
 	 * we have no more nodes to pull off or we reach the limits
-	 * for this quantum.
-	 */
-	nodes = zone->nodes;
-	signatures = zone->signatures;
+	 * for this quantum.  The signatures are generated in parallel,
+	 * so the quantum is scaled by the number of threads that
+	 * generate them.
+	 */
+	nthreads = (zone->zmgr != NULL)
+			   ? isc_workpool_size(zone->zmgr->workpool)
+			   : 1;
+	nodes = zone->nodes * nthreads;
+	signatures = zone->signatures * nthreads;
 	signing = ISC_LIST_HEAD(zone->signing);
 	first = true;
 
@@ -9455,7 +9651,8 @@ zone_sign(dns_zone_t *zone) {
 				build_nsec, zone_keys[i], inception, expire,
 				zone->minimum, is_ksk, is_zsk,
 				(both && keyset_kskonly), is_bottom_of_zone,
-				zonediff.diff, &signatures, zone->mctx));
+				zonediff.diff, &batch, &signatures,
+				zone->mctx));
 			/*
 			 * If we are adding we are done.  Look for other keys
 			 * of the same algorithm if deleting.
@@ -9536,10 +9733,26 @@ zone_sign(dns_zone_t *zone) {
 
 	next_signing:
 		dns_dbiterator_pause(signing->dbiterator);
+		result = signbatch_flush(zone, &batch, db, version,
+					 zonediff.diff);
+		if (result != ISC_R_SUCCESS) {
+			dnssec_log(zone, ISC_LOG_ERROR,
+				   "zone_sign:signbatch_flush -> %s",
+				   dns_result_totext(result));
+			goto cleanup;
+		}
 		signing = nextsigning;
 		first = true;
 	}
 
+	result = signbatch_flush(zone, &batch, db, version, zonediff.diff);
+	if (result != ISC_R_SUCCESS) {
+		dnssec_log(zone, ISC_LOG_ERROR,
+			   "zone_sign:signbatch_flush -> %s",
+			   dns_result_totext(result));
+		goto cleanup;
+	}
+
 	if (ISC_LIST_HEAD(post_diff.tuples) != NULL) {
 		result = dns__zone_updatesigs(&post_diff, db, version,
 					      zone_keys, nkeys, zone, inception,
@@ -9672,6 +9885,8 @@ cleanup:
 
 	dns_diff_clear(&_sig_diff);
 
+	signbatch_clear(&batch, zone->mctx);
+
 	for (i = 0; i < nkeys; i++) {
 		dst_key_free(&zone_keys[i]);
 	}
@@ -9704,6 +9919,18 @@ cleanup:
 	INSIST(version == NULL);
 }
 
+/*
+ * Run a quantum of zone_sign() directly, for the unit tests.  Returns
+ * true while some signing is still pending.
+ */
+bool
+dns__zone_sign(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	zone_sign(zone);
+	return (!ISC_LIST_EMPTY(zone->signing));
+}
+
 static isc_result_t
 normalize_key(dns_rdata_t *rr, dns_rdata_t *target, unsigned char *data,
 	      int size) {
@@ -10965,6 +11192,19 @@ zone_maintenance(dns_zone_t *zone) {
 			dumping = true;
 		}
 		UNLOCK_ZONE(zone);
+		if (!dumping && zone_dumpdeferrable(zone)) {
+			/*
+			 * A flush requested meanwhile still needs the dump.
+			 */
+			LOCK_ZONE(zone);
+			if (!DNS_ZONE_FLAG(zone, DNS_ZONEFLG_FLUSH)) {
+				DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_DUMPING);
+				DNS_ZONE_SETFLAG(zone,
+						 DNS_ZONEFLG_DUMPDEFERRED);
+				dumping = true;
+			}
+			UNLOCK_ZONE(zone);
+		}
 		if (!dumping) {
 			result = zone_dump(zone, true); /* task locked */
 			if (result != ISC_R_SUCCESS) {
@@ -10978,6 +11218,11 @@ zone_maintenance(dns_zone_t *zone) {
 		break;
 	}
 
+	/*
+	 * Run any journal compaction that was held off earlier.
+	 */
+	zone_compact_deferred(zone, &now);
+
 	/*
 	 * Master/redirect zones send notifies now, if needed
 	 */
@@ -11113,6 +11358,7 @@ again:
 	if (secure != NULL) {
 		UNLOCK_ZONE(secure);
 	}
+	TIME_NOW(&zone->updatetime);
 	zone_needdump(zone, DNS_DUMP_DELAY);
 	UNLOCK_ZONE(zone);
 }
@@ -11239,18 +11485,139 @@ unlock:
 	UNLOCK_ZONE(zone);
 }
 
+struct compact_event {
+	isc_event_t e;
+	isc_result_t result;
+};
+
+static void
+zone_journal_compact_log(dns_zone_t *zone, isc_result_t result) {
+	switch (result) {
+	case ISC_R_SUCCESS:
+	case ISC_R_NOSPACE:
+	case ISC_R_NOTFOUND:
+	case ISC_R_CANCELED:
+		dns_zone_log(zone, ISC_LOG_DEBUG(3), "dns_journal_compact: %s",
+			     dns_result_totext(result));
+		break;
+	default:
+		dns_zone_log(zone, ISC_LOG_ERROR,
+			     "dns_journal_compact failed: %s",
+			     dns_result_totext(result));
+		break;
+	}
+}
+
+/*
+ * Called on the zone task once the bulk of the journal has been copied
+ * on the load task: copy any transactions appended in the meantime and
+ * switch to the new journal.
+ */
+static void
+zone_journal_compact_done(isc_task_t *task, isc_event_t *event) {
+	const char me[] = "zone_journal_compact_done";
+	dns_zone_t *zone = event->ev_arg;
+	isc_result_t result = ((struct compact_event *)event)->result;
+	isc_time_t now;
+
+	UNUSED(task);
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	ENTER;
+
+	isc_event_free(&event);
+
+	LOCK_ZONE(zone);
+	INSIST(zone->jcompact != NULL);
+	if (result == ISC_R_SUCCESS &&
+	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING)) {
+		result = ISC_R_CANCELED;
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = dns_journal_compact_finish(zone->jcompact);
+	}
+	dns_journal_compact_destroy(&zone->jcompact);
+	zone_journal_compact_log(zone, result);
+
+	/*
+	 * Pick up any compaction requested while we were busy.
+	 */
+	if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDCOMPACT) &&
+	    zone->task != NULL) {
+		TIME_NOW(&now);
+		zone_settimer(zone, &now);
+	}
+	UNLOCK_ZONE(zone);
+
+	dns_zone_idetach(&zone);
+}
+
+/*
+ * Called on the load task to copy the retained part of the journal
+ * without holding up updates to the zone.
+ */
+static void
+zone_journal_compact_copy(isc_task_t *task, isc_event_t *event) {
+	const char me[] = "zone_journal_compact_copy";
+	dns_zone_t *zone = event->ev_arg;
+
+	UNUSED(task);
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+	INSIST(zone->jcompact != NULL);
+
+	ENTER;
+
+	((struct compact_event *)event)->result =
+		dns_journal_compact_copy(zone->jcompact);
+
+	event->ev_action = zone_journal_compact_done;
+	isc_task_send(zone->task, &event);
+}
+
 static void
 zone_journal_compact(dns_zone_t *zone, dns_db_t *db, uint32_t serial) {
 	isc_result_t result;
 	int32_t journalsize;
 	dns_dbversion_t *ver = NULL;
 	uint64_t dbsize;
+	isc_time_t now, idle;
+	isc_event_t *e = NULL;
+	dns_zone_t *dummy = NULL;
 
 	INSIST(LOCKED_ZONE(zone));
 	if (inline_raw(zone)) {
 		INSIST(LOCKED_ZONE(zone->secure));
 	}
 
+	/*
+	 * Hold off while the zone is receiving a burst of updates, or if
+	 * a previous compaction is still running.
+	 */
+	TIME_NOW(&now);
+	if (zone->compactidle != 0 && !isc_time_isepoch(&zone->updatetime)) {
+		DNS_ZONE_TIME_ADD(&zone->updatetime, zone->compactidle, &idle);
+		if (isc_time_compare(&now, &idle) < 0) {
+			zone_debuglog(zone, "zone_journal_compact", 1,
+				      "deferring journal compaction");
+			zone->compact_serial = serial;
+			zone->compacttime = idle;
+			DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
+			if (zone->task != NULL) {
+				zone_settimer(zone, &now);
+			}
+			return;
+		}
+	}
+	if (zone->jcompact != NULL) {
+		zone->compact_serial = serial;
+		zone->compacttime = now;
+		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
+		return;
+	}
+	isc_time_settoepoch(&zone->compacttime);
+
 	journalsize = zone->journalsize;
 	if (journalsize == -1) {
 		journalsize = DNS_JOURNAL_SIZE_MAX;
@@ -11268,21 +11635,30 @@ zone_journal_compact(dns_zone_t *zone, dns_db_t *db, uint32_t serial) {
 	}
 	zone_debuglog(zone, "zone_journal_compact", 1, "target journal size %d",
 		      journalsize);
-	result = dns_journal_compact(zone->mctx, zone->journal, serial,
-				     journalsize);
-	switch (result) {
-	case ISC_R_SUCCESS:
-	case ISC_R_NOSPACE:
-	case ISC_R_NOTFOUND:
-		dns_zone_log(zone, ISC_LOG_DEBUG(3), "dns_journal_compact: %s",
-			     dns_result_totext(result));
-		break;
-	default:
-		dns_zone_log(zone, ISC_LOG_ERROR,
-			     "dns_journal_compact failed: %s",
-			     dns_result_totext(result));
-		break;
+
+	if (zone->task == NULL || zone->loadtask == NULL) {
+		result = dns_journal_compact(zone->mctx, zone->journal, serial,
+					     journalsize);
+		zone_journal_compact_log(zone, result);
+		return;
+	}
+
+	result = dns_journal_compact_begin(zone->mctx, zone->journal, serial,
+					   journalsize, &zone->jcompact);
+	if (result != ISC_R_SUCCESS) {
+		if (result == DNS_R_UPTODATE) {
+			result = ISC_R_SUCCESS;
+		}
+		zone_journal_compact_log(zone, result);
+		return;
 	}
+
+	e = isc_event_allocate(zone->mctx, NULL, DNS_EVENT_ZONECOMPACT,
+			       zone_journal_compact_copy, zone,
+			       sizeof(struct compact_event));
+	((struct compact_event *)e)->result = ISC_R_UNSET;
+	zone_iattach(zone, &dummy);
+	isc_task_send(zone->loadtask, &e);
 }
 
 isc_result_t
@@ -11294,8 +11670,10 @@ dns_zone_flush(dns_zone_t *zone) {
 
 	LOCK_ZONE(zone);
 	DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_FLUSH);
-	if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDDUMP) &&
-	    zone->masterfile != NULL) {
+	if ((DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDDUMP) ||
+	     DNS_ZONE_FLAG(zone, DNS_ZONEFLG_DUMPDEFERRED)) &&
+	    zone->masterfile != NULL)
+	{
 		result = ISC_R_ALREADYRUNNING;
 		dumping = was_dumping(zone);
 	} else {
@@ -11324,26 +11702,118 @@ dns_zone_dump(dns_zone_t *zone) {
 	return (result);
 }
 
-static void
-zone_needdump(dns_zone_t *zone, unsigned int delay) {
-	const char me[] = "zone_needdump";
-	isc_time_t dumptime;
-	isc_time_t now;
-
-	/*
-	 * 'zone' locked by caller
-	 */
+/*
+ * Return true if rewriting the master file of 'zone' can wait: the
+ * master file and the journal together hold the current version, and
+ * the changes journaled since the master file was written are still
+ * small compared to the zone.
+ */
+static bool
+zone_dumpdeferrable(dns_zone_t *zone) {
+	const char me[] = "zone_dumpdeferrable";
+	dns_db_t *db = NULL;
+	dns_dbversion_t *ver = NULL;
+	dns_journal_t *journal = NULL;
+	char *journalfile = NULL;
+	uint32_t ratio, dumpserial, serial;
+	int32_t journalsize;
+	uint64_t dbsize = 0;
+	size_t jsize = 0;
+	isc_result_t result;
+	bool defer = false;
 
 	REQUIRE(DNS_ZONE_VALID(zone));
-	REQUIRE(LOCKED_ZONE(zone));
 	ENTER;
 
-	/*
-	 * Do we have a place to dump to and are we loaded?
-	 */
-	if (zone->masterfile == NULL ||
-	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_LOADED) == 0) {
-		return;
+	LOCK_ZONE(zone);
+	ratio = zone->dumpdeltaratio;
+	dumpserial = zone->dumpserial;
+	journalsize = zone->journalsize;
+	if (ratio == 0 || zone->journal == NULL ||
+	    !DNS_ZONE_FLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL) ||
+	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_FLUSH))
+	{
+		UNLOCK_ZONE(zone);
+		return (false);
+	}
+	journalfile = isc_mem_strdup(zone->mctx, zone->journal);
+	UNLOCK_ZONE(zone);
+
+	ZONEDB_LOCK(&zone->dblock, isc_rwlocktype_read);
+	if (zone->db != NULL) {
+		dns_db_attach(zone->db, &db);
+	}
+	ZONEDB_UNLOCK(&zone->dblock, isc_rwlocktype_read);
+	if (db == NULL) {
+		goto cleanup;
+	}
+
+	dns_db_currentversion(db, &ver);
+	result = dns_db_getsoaserial(db, ver, &serial);
+	if (result == ISC_R_SUCCESS && serial != dumpserial) {
+		result = dns_db_getsize(db, ver, NULL, &dbsize);
+	} else {
+		result = ISC_R_FAILURE;
+	}
+	dns_db_closeversion(db, &ver, false);
+	if (result != ISC_R_SUCCESS || dbsize == 0) {
+		goto cleanup;
+	}
+
+	/*
+	 * Only the transaction headers are read, so this costs I/O in
+	 * proportion to the changes since the last dump.
+	 */
+	result = dns_journal_open(zone->mctx, journalfile, DNS_JOURNAL_READ,
+				  &journal);
+	if (result == ISC_R_SUCCESS) {
+		result = dns_journal_iter_init(journal, dumpserial, serial,
+					       &jsize);
+		dns_journal_destroy(&journal);
+	}
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	if ((uint64_t)jsize * 100 <= (uint64_t)ratio * dbsize &&
+	    (journalsize < 0 || jsize <= (size_t)journalsize))
+	{
+		defer = true;
+	}
+	dns_zone_log(zone, ISC_LOG_DEBUG(1),
+		     "%s dump: %zu bytes journaled since serial %u, "
+		     "database size %" PRIu64 " bytes",
+		     defer ? "deferring" : "not deferring", jsize, dumpserial,
+		     dbsize);
+
+cleanup:
+	if (db != NULL) {
+		dns_db_detach(&db);
+	}
+	isc_mem_free(zone->mctx, journalfile);
+	return (defer);
+}
+
+static void
+zone_needdump(dns_zone_t *zone, unsigned int delay) {
+	const char me[] = "zone_needdump";
+	isc_time_t dumptime;
+	isc_time_t now;
+
+	/*
+	 * 'zone' locked by caller
+	 */
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(LOCKED_ZONE(zone));
+	ENTER;
+
+	/*
+	 * Do we have a place to dump to and are we loaded?
+	 */
+	if (zone->masterfile == NULL ||
+	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_LOADED) == 0) {
+		return;
 	}
 
 	TIME_NOW(&now);
@@ -11371,7 +11841,7 @@ dump_done(void *arg, isc_result_t result) {
 	bool again = false;
 	bool compact = false;
 	uint32_t serial;
-	isc_result_t tresult;
+	isc_result_t tresult = ISC_R_UNSET;
 
 	REQUIRE(DNS_ZONE_VALID(zone));
 
@@ -11402,6 +11872,10 @@ dump_done(void *arg, isc_result_t result) {
 			}
 		}
 
+		if (tresult == ISC_R_SUCCESS) {
+			zone->dumpserial = serial;
+		}
+
 		/*
 		 * If there is a secure version of this zone
 		 * use its serial if it is less than ours.
@@ -11442,6 +11916,11 @@ dump_done(void *arg, isc_result_t result) {
 	if (compact) {
 		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
 	}
+	if (tresult == ISC_R_SUCCESS) {
+		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	} else if (result == ISC_R_SUCCESS) {
+		DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	}
 	if (result != ISC_R_SUCCESS && result != ISC_R_CANCELED) {
 		/*
 		 * Try again in a short while.
@@ -11471,6 +11950,80 @@ dump_done(void *arg, isc_result_t result) {
 	dns_zone_idetach(&zone);
 }
 
+static void
+zone_compact_deferred(dns_zone_t *zone, isc_time_t *now) {
+	dns_zone_t *secure = NULL;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+
+	/*
+	 * Handle lock order inversion.
+	 */
+again:
+	LOCK_ZONE(zone);
+	if (!DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDCOMPACT) ||
+	    zone->xfr != NULL || zone->jcompact != NULL ||
+	    isc_time_isepoch(&zone->compacttime) ||
+	    isc_time_compare(now, &zone->compacttime) < 0)
+	{
+		UNLOCK_ZONE(zone);
+		return;
+	}
+	if (inline_raw(zone)) {
+		secure = zone->secure;
+		INSIST(secure != zone);
+		TRYLOCK_ZONE(result, secure);
+		if (result != ISC_R_SUCCESS) {
+			UNLOCK_ZONE(zone);
+			secure = NULL;
+			isc_thread_yield();
+			goto again;
+		}
+	}
+	if (dns_zone_getdb(zone, &db) == ISC_R_SUCCESS) {
+		DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
+		zone_journal_compact(zone, db, zone->compact_serial);
+		dns_db_detach(&db);
+	}
+	if (secure != NULL) {
+		UNLOCK_ZONE(secure);
+	}
+	UNLOCK_ZONE(zone);
+}
+
+/*
+ * Ask for the journal to be compacted up to 'serial', as dump_done()
+ * does, for the unit tests.
+ */
+void
+dns__zone_compactjournal(dns_zone_t *zone, uint32_t serial) {
+	dns_db_t *db = NULL;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(!inline_raw(zone));
+
+	LOCK_ZONE(zone);
+	if (dns_zone_getdb(zone, &db) == ISC_R_SUCCESS) {
+		zone_journal_compact(zone, db, serial);
+		dns_db_detach(&db);
+	}
+	UNLOCK_ZONE(zone);
+}
+
+/*
+ * Run any deferred journal compaction that is due, as
+ * zone_maintenance() does, for the unit tests.
+ */
+void
+dns__zone_compactdeferred(dns_zone_t *zone) {
+	isc_time_t now;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	TIME_NOW(&now);
+	zone_compact_deferred(zone, &now);
+}
+
 static isc_result_t
 zone_dump(dns_zone_t *zone, bool compact) {
 	const char me[] = "zone_dump";
@@ -11480,6 +12033,8 @@ zone_dump(dns_zone_t *zone, bool compact) {
 	dns_db_t *db = NULL;
 	char *masterfile = NULL;
 	dns_masterformat_t masterformat = dns_masterformat_none;
+	uint32_t serial;
+	isc_result_t tresult = ISC_R_UNSET;
 
 	/*
 	 * 'compact' MUST only be set if we are task locked.
@@ -11536,6 +12091,7 @@ redo:
 		} else {
 			output_style = &dns_master_style_default;
 		}
+		tresult = dns_db_getsoaserial(db, version, &serial);
 		result = dns_master_dump(zone->mctx, db, version, output_style,
 					 masterfile, masterformat, &rawdata);
 		dns_db_closeversion(db, &version, false);
@@ -11556,6 +12112,12 @@ fail:
 	again = false;
 	LOCK_ZONE(zone);
 	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_DUMPING);
+	if (result == ISC_R_SUCCESS && tresult == ISC_R_SUCCESS) {
+		zone->dumpserial = serial;
+		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	} else if (result == ISC_R_SUCCESS) {
+		DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+	}
 	if (result != ISC_R_SUCCESS) {
 		/*
 		 * Try again in a short while.
@@ -11696,7 +12258,9 @@ zone_unload(dns_zone_t *zone) {
 	zone_detachdb(zone);
 	ZONEDB_UNLOCK(&zone->dblock, isc_rwlocktype_write);
 	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_LOADED);
-	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDDUMP);
+	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDDUMP |
+				       DNS_ZONEFLG_DUMPDEFERRED |
+				       DNS_ZONEFLG_HAVEDUMPSERIAL);
 
 	if (zone->type == dns_zone_mirror) {
 		dns_zone_log(zone, ISC_LOG_INFO,
@@ -11751,6 +12315,20 @@ dns_zone_setmaxrecords(dns_zone_t *zone, uint32_t val) {
 	zone->maxrecords = val;
 }
 
+uint32_t
+dns_zone_getupdategroup(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	return (zone->updategroup);
+}
+
+void
+dns_zone_setupdategroup(dns_zone_t *zone, uint32_t val) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	zone->updategroup = val;
+}
+
 static bool
 notify_isqueued(dns_zone_t *zone, unsigned int flags, dns_name_t *name,
 		isc_sockaddr_t *addr, dns_tsigkey_t *key) {
@@ -11910,6 +12488,7 @@ notify_create(isc_mem_t *mctx, unsigned int flags, dns_notify_t **notifyp) {
 	notify->key = NULL;
 	notify->event = NULL;
 	isc_sockaddr_any(&notify->dst);
+	isc_time_settoepoch(&notify->sent);
 	dns_name_init(&notify->ns, NULL);
 	ISC_LINK_INIT(notify, link);
 	notify->magic = NOTIFY_MAGIC;
@@ -12141,6 +12720,7 @@ notify_send_toaddr(isc_task_t *task, isc_event_t *event) {
 		dscp, options, key, timeout * 3, timeout, 0, notify->zone->task,
 		notify_done, notify, &notify->request);
 	if (result == ISC_R_SUCCESS) {
+		TIME_NOW(&notify->sent);
 		if (isc_sockaddr_pf(&notify->dst) == AF_INET) {
 			inc_stats(notify->zone,
 				  dns_zonestatscounter_notifyoutv4);
@@ -12962,6 +13542,12 @@ refresh_callback(isc_task_t *task, isc_event_t *event) {
 		goto detach;
 	}
 
+	if (zone->zmgr != NULL) {
+		zmgr_pace_done(zone->zmgr, &zone->zmgr->refreshpace,
+			       revent->result, &zone->soaquerytime,
+			       &zone->masteraddr, &zone->sourceaddr);
+	}
+
 	/*
 	 * if timeout log and next master;
 	 */
@@ -13392,7 +13978,9 @@ queue_soa_query(dns_zone_t *zone) {
 		zone_idetach(&dummy);
 		isc_event_free(&e);
 		cancel_refresh(zone);
+		return;
 	}
+	DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_SOAQUEUED);
 }
 
 static inline isc_result_t
@@ -13502,6 +14090,7 @@ soa_query(isc_task_t *task, isc_event_t *event) {
 	ENTER;
 
 	LOCK_ZONE(zone);
+	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_SOAQUEUED);
 	if (((event->ev_attributes & ISC_EVENTATTR_CANCELED) != 0) ||
 	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING) ||
 	    zone->view->requestmgr == NULL)
@@ -13656,6 +14245,7 @@ again:
 			      dns_result_totext(result));
 		goto skip_master;
 	} else {
+		TIME_NOW(&zone->soaquerytime);
 		if (isc_sockaddr_pf(&zone->masteraddr) == PF_INET) {
 			inc_stats(zone, dns_zonestatscounter_soaoutv4);
 		} else {
@@ -14222,6 +14812,15 @@ zone_settimer(dns_zone_t *zone, isc_time_t *now) {
 		break;
 	}
 
+	if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDCOMPACT) &&
+	    zone->jcompact == NULL && !isc_time_isepoch(&zone->compacttime))
+	{
+		if (isc_time_isepoch(&next) ||
+		    isc_time_compare(&zone->compacttime, &next) < 0) {
+			next = zone->compacttime;
+		}
+	}
+
 	if (isc_time_isepoch(&next)) {
 		zone_debuglog(zone, me, 10, "settimer inactive");
 		result = isc_timer_reset(zone->timer, isc_timertype_inactive,
@@ -14604,6 +15203,22 @@ dns_zone_notifyreceive(dns_zone_t *zone, isc_sockaddr_t *from,
 	 * can perform a refresh check when the current one completes
 	 */
 	if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_REFRESH)) {
+		/*
+		 * If the SOA query of that refresh is still waiting to be
+		 * sent, and will go to the server the notify came from,
+		 * it will see the new serial anyway.
+		 */
+		if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_SOAQUEUED) &&
+		    zone->curmaster < zone->masterscnt &&
+		    isc_sockaddr_eqaddr(from, &zone->masters[zone->curmaster]))
+		{
+			UNLOCK_ZONE(zone);
+			dns_zone_log(zone, ISC_LOG_INFO,
+				     "notify from %s: refresh check already "
+				     "queued",
+				     fromtext);
+			return (ISC_R_SUCCESS);
+		}
 		DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NEEDREFRESH);
 		zone->notifyfrom = *from;
 		UNLOCK_ZONE(zone);
@@ -14869,6 +15484,34 @@ dns_zone_getjournalsize(dns_zone_t *zone) {
 	return (zone->journalsize);
 }
 
+void
+dns_zone_setjournalcompactidle(dns_zone_t *zone, uint32_t idle) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	zone->compactidle = idle;
+}
+
+uint32_t
+dns_zone_getjournalcompactidle(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	return (zone->compactidle);
+}
+
+void
+dns_zone_setdumpdeltaratio(dns_zone_t *zone, uint32_t ratio) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	zone->dumpdeltaratio = ratio;
+}
+
+uint32_t
+dns_zone_getdumpdeltaratio(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	return (zone->dumpdeltaratio);
+}
+
 static void
 zone_namerd_tostr(dns_zone_t *zone, char *buf, size_t length) {
 	isc_result_t result = ISC_R_FAILURE;
@@ -15169,6 +15812,18 @@ dns_zone_gettask(dns_zone_t *zone, isc_task_t **target) {
 	isc_task_attach(zone->task, target);
 }
 
+void
+dns_zone_getloadtask(dns_zone_t *zone, isc_task_t **target) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(target != NULL && *target == NULL);
+
+	LOCK_ZONE(zone);
+	if (zone->loadtask != NULL) {
+		isc_task_attach(zone->loadtask, target);
+	}
+	UNLOCK_ZONE(zone);
+}
+
 void
 dns_zone_setidlein(dns_zone_t *zone, uint32_t idlein) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -15220,6 +15875,13 @@ notify_done(isc_task_t *task, isc_event_t *event) {
 	isc_sockaddr_format(&notify->dst, addrbuf, sizeof(addrbuf));
 
 	result = revent->result;
+	if (notify->zone->zmgr != NULL) {
+		zmgr_pace_done(notify->zone->zmgr,
+			       (notify->flags & DNS_NOTIFY_STARTUP) != 0
+				       ? &notify->zone->zmgr->startupnotifypace
+				       : &notify->zone->zmgr->notifypace,
+			       result, &notify->sent, &notify->dst, NULL);
+	}
 	if (result == ISC_R_SUCCESS) {
 		result = dns_message_create(notify->zone->mctx,
 					    DNS_MESSAGE_INTENTPARSE, &message);
@@ -16181,6 +16843,7 @@ receive_secure_db(isc_task_t *task, isc_event_t *event) {
 	LOCK_ZONE(zone->raw);
 	DNS_ZONE_SETFLAG(zone, DNS_ZONEFLG_NEEDNOTIFY);
 	result = zone_postload(zone, db, loadtime, ISC_R_SUCCESS);
+	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
 	zone_needdump(zone, 0); /* XXXMPA */
 	UNLOCK_ZONE(zone->raw);
 
@@ -16406,6 +17069,9 @@ zone_replacedb(dns_zone_t *zone, dns_db_t *db, bool dump) {
 				zone_needdump(zone, 0);
 			}
 		}
+		if (dump) {
+			DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_HAVEDUMPSERIAL);
+		}
 		if (dump && zone->journal != NULL) {
 			/*
 			 * The in-memory database just changed, and
@@ -16713,9 +17379,9 @@ again:
 	if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_NEEDCOMPACT)) {
 		dns_db_t *db = NULL;
 		if (dns_zone_getdb(zone, &db) == ISC_R_SUCCESS) {
+			DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
 			zone_journal_compact(zone, db, zone->compact_serial);
 			dns_db_detach(&db);
-			DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDCOMPACT);
 		}
 	}
 
@@ -17403,6 +18069,7 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
 		   dns_zonemgr_t **zmgrp) {
 	dns_zonemgr_t *zmgr;
 	isc_result_t result;
+	isc_interval_t interval;
 
 	zmgr = isc_mem_get(mctx, sizeof(*zmgr));
 	zmgr->mctx = NULL;
@@ -17419,6 +18086,9 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
 	zmgr->refreshrl = NULL;
 	zmgr->startupnotifyrl = NULL;
 	zmgr->startuprefreshrl = NULL;
+	zmgr->workpool = NULL;
+	zmgr->pacetimer = NULL;
+	zmgr->stats = NULL;
 	ISC_LIST_INIT(zmgr->zones);
 	ISC_LIST_INIT(zmgr->waiting_for_xfrin);
 	ISC_LIST_INIT(zmgr->xfrin_in_progress);
@@ -17476,6 +18146,21 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
 	isc_ratelimiter_setpushpop(zmgr->startupnotifyrl, true);
 	isc_ratelimiter_setpushpop(zmgr->startuprefreshrl, true);
 
+	zmgr_pace_init(&zmgr->notifypace, zmgr->notifyrl);
+	zmgr_pace_init(&zmgr->startupnotifypace, zmgr->startupnotifyrl);
+	zmgr_pace_init(&zmgr->refreshpace, zmgr->refreshrl);
+	zmgr->notifypace.rate = zmgr->notifyrate;
+	zmgr->startupnotifypace.rate = zmgr->startupnotifyrate;
+	zmgr->refreshpace.rate = zmgr->serialqueryrate;
+
+	isc_interval_set(&interval, ZMGR_PACE_INTERVAL, 0);
+	result = isc_timer_create(timermgr, isc_timertype_ticker, NULL,
+				  &interval, zmgr->task, zmgr_pace_tick, zmgr,
+				  &zmgr->pacetimer);
+	if (result != ISC_R_SUCCESS) {
+		goto free_startuprefreshrl;
+	}
+
 	zmgr->iolimit = 1;
 	zmgr->ioactive = 0;
 	ISC_LIST_INIT(zmgr->high);
@@ -17492,6 +18177,8 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_taskmgr_t *taskmgr,
  free_iolock:
 	isc_mutex_destroy(&zmgr->iolock);
 #endif /* if 0 */
+free_startuprefreshrl:
+	isc_ratelimiter_detach(&zmgr->startuprefreshrl);
 free_startupnotifyrl:
 	isc_ratelimiter_detach(&zmgr->startupnotifyrl);
 free_refreshrl:
@@ -17693,6 +18380,10 @@ dns_zonemgr_shutdown(dns_zonemgr_t *zmgr) {
 	isc_ratelimiter_shutdown(zmgr->startupnotifyrl);
 	isc_ratelimiter_shutdown(zmgr->startuprefreshrl);
 
+	if (zmgr->pacetimer != NULL) {
+		isc_timer_detach(&zmgr->pacetimer);
+	}
+
 	if (zmgr->task != NULL) {
 		isc_task_destroy(&zmgr->task);
 	}
@@ -17833,6 +18524,15 @@ zonemgr_free(dns_zonemgr_t *zmgr) {
 	isc_ratelimiter_detach(&zmgr->refreshrl);
 	isc_ratelimiter_detach(&zmgr->startupnotifyrl);
 	isc_ratelimiter_detach(&zmgr->startuprefreshrl);
+	if (zmgr->workpool != NULL) {
+		isc_workpool_detach(&zmgr->workpool);
+	}
+	if (zmgr->pacetimer != NULL) {
+		isc_timer_detach(&zmgr->pacetimer);
+	}
+	if (zmgr->stats != NULL) {
+		isc_stats_detach(&zmgr->stats);
+	}
 
 	isc_rwlock_destroy(&zmgr->urlock);
 	isc_rwlock_destroy(&zmgr->rwlock);
@@ -17855,6 +18555,14 @@ dns_zonemgr_getttransfersin(dns_zonemgr_t *zmgr) {
 	return (zmgr->transfersin);
 }
 
+void
+dns_zonemgr_setworkpool(dns_zonemgr_t *zmgr, isc_workpool_t *pool) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(zmgr->workpool == NULL);
+
+	isc_workpool_attach(pool, &zmgr->workpool);
+}
+
 void
 dns_zonemgr_settransfersperns(dns_zonemgr_t *zmgr, uint32_t value) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
@@ -18217,6 +18925,7 @@ dns_zonemgr_setnotifyrate(dns_zonemgr_t *zmgr, unsigned int value) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
 
 	setrl(zmgr->notifyrl, &zmgr->notifyrate, value);
+	zmgr->notifypace.rate = zmgr->notifyrate;
 }
 
 void
@@ -18224,6 +18933,7 @@ dns_zonemgr_setstartupnotifyrate(dns_zonemgr_t *zmgr, unsigned int value) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
 
 	setrl(zmgr->startupnotifyrl, &zmgr->startupnotifyrate, value);
+	zmgr->startupnotifypace.rate = zmgr->startupnotifyrate;
 }
 
 void
@@ -18231,6 +18941,7 @@ dns_zonemgr_setserialqueryrate(dns_zonemgr_t *zmgr, unsigned int value) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
 
 	setrl(zmgr->refreshrl, &zmgr->serialqueryrate, value);
+	zmgr->refreshpace.rate = zmgr->serialqueryrate;
 	/* XXXMPA separate out once we have the code to support this. */
 	setrl(zmgr->startuprefreshrl, &zmgr->startupserialqueryrate, value);
 }
@@ -18256,6 +18967,193 @@ dns_zonemgr_getserialqueryrate(dns_zonemgr_t *zmgr) {
 	return (zmgr->serialqueryrate);
 }
 
+void
+dns_zonemgr_setstats(dns_zonemgr_t *zmgr, isc_stats_t *stats) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(zmgr->stats == NULL);
+
+	isc_stats_attach(stats, &zmgr->stats);
+	isc_stats_set(stats, zmgr->notifypace.rate,
+		      dns_zonestatscounter_notifyrate);
+	isc_stats_set(stats, zmgr->startupnotifypace.rate,
+		      dns_zonestatscounter_startupnotifyrate);
+	isc_stats_set(stats, zmgr->refreshpace.rate,
+		      dns_zonestatscounter_soarate);
+}
+
+static void
+zmgr_pace_init(zonemgr_pace_t *pace, isc_ratelimiter_t *rl) {
+	pace->rl = rl;
+	pace->rate = 0;
+	pace->minrtt = 0;
+	atomic_init(&pace->answered, 0);
+	atomic_init(&pace->timedout, 0);
+	atomic_init(&pace->rttsum, 0);
+}
+
+/*
+ * Return true if 'remote' is in the unreachable cache, after any number
+ * of failures.  A NULL 'local' matches any source address.
+ */
+static bool
+zmgr_unreachable_cached(dns_zonemgr_t *zmgr, const isc_sockaddr_t *remote,
+			const isc_sockaddr_t *local, const isc_time_t *now) {
+	unsigned int i;
+	uint32_t seconds = isc_time_seconds(now);
+
+	RWLOCK(&zmgr->urlock, isc_rwlocktype_read);
+	for (i = 0; i < UNREACH_CACHE_SIZE; i++) {
+		if (atomic_load(&zmgr->unreachable[i].expire) >= seconds &&
+		    isc_sockaddr_equal(&zmgr->unreachable[i].remote, remote) &&
+		    (local == NULL ||
+		     isc_sockaddr_equal(&zmgr->unreachable[i].local, local)))
+		{
+			break;
+		}
+	}
+	RWUNLOCK(&zmgr->urlock, isc_rwlocktype_read);
+	return (i < UNREACH_CACHE_SIZE);
+}
+
+/*
+ * Account for the outcome of a request sent through 'pace' to 'remote'
+ * from 'local'.
+ */
+static void
+zmgr_pace_done(dns_zonemgr_t *zmgr, zonemgr_pace_t *pace,
+	       isc_result_t result, const isc_time_t *sent,
+	       const isc_sockaddr_t *remote, const isc_sockaddr_t *local) {
+	isc_time_t now;
+
+	TIME_NOW(&now);
+
+	if (result == ISC_R_TIMEDOUT) {
+		if (!zmgr_unreachable_cached(zmgr, remote, local, &now)) {
+			atomic_fetch_add_relaxed(&pace->timedout, 1);
+		}
+	} else if (result == ISC_R_SUCCESS && !isc_time_isepoch(sent)) {
+		atomic_fetch_add_relaxed(&pace->answered, 1);
+		atomic_fetch_add_relaxed(&pace->rttsum,
+					 isc_time_microdiff(&now, sent));
+	}
+}
+
+/*
+ * Adjust the rate 'pace' sends at, never exceeding 'maxrate' nor going
+ * below 'maxrate' / ZMGR_PACE_MINSHARE.
+ */
+static void
+zmgr_pace(zonemgr_pace_t *pace, unsigned int maxrate, const char *what) {
+	uint_fast32_t answered, timedout, samples;
+	uint64_t rtt = 0;
+	unsigned int pending, minrate, rate = pace->rate;
+
+	answered = atomic_exchange_relaxed(&pace->answered, 0);
+	timedout = atomic_exchange_relaxed(&pace->timedout, 0);
+	samples = answered + timedout;
+	pending = isc_ratelimiter_getpending(pace->rl);
+	minrate = ISC_MAX(maxrate / ZMGR_PACE_MINSHARE, 1);
+
+	if (answered != 0) {
+		rtt = atomic_exchange_relaxed(&pace->rttsum, 0) / answered;
+		if (pace->minrtt == 0 || rtt < pace->minrtt) {
+			pace->minrtt = rtt;
+		}
+	}
+
+	if (samples == 0 && pending == 0) {
+		/*
+		 * Idle: start from the configured rate next time.
+		 */
+		rate = maxrate;
+		pace->minrtt = 0;
+	} else if (timedout * 20 > samples ||
+		   (answered != 0 && rtt > 4 * pace->minrtt &&
+		    rtt - pace->minrtt > ZMGR_PACE_RTTSLACK))
+	{
+		rate = ISC_MAX(rate / 2, minrate);
+	} else if (pending != 0) {
+		rate += ISC_MAX(maxrate / 10, 1);
+	}
+
+	if (rate > maxrate) {
+		rate = maxrate;
+	} else if (rate < minrate) {
+		rate = minrate;
+	}
+
+	if (rate != pace->rate) {
+		isc_log_write(dns_lctx, DNS_LOGCATEGORY_GENERAL,
+			      DNS_LOGMODULE_ZONE, ISC_LOG_DEBUG(1),
+			      "%s rate %u -> %u (%u queued, %u answered, "
+			      "%u timed out, rtt %" PRIu64 "us)",
+			      what, pace->rate, rate, pending,
+			      (unsigned int)answered, (unsigned int)timedout,
+			      rtt);
+		setrl(pace->rl, &pace->rate, rate);
+	}
+}
+
+/*
+ * Account for the outcome of a SOA query to 'remote', for the unit
+ * tests.
+ */
+void
+dns__zonemgr_soadone(dns_zonemgr_t *zmgr, isc_result_t result,
+		     const isc_time_t *sent, const isc_sockaddr_t *remote) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	zmgr_pace_done(zmgr, &zmgr->refreshpace, result, sent, remote, NULL);
+}
+
+/*
+ * Adjust the SOA query rate now and return it, for the unit tests.  The
+ * periodic adjustment is stopped, so that only these calls change it.
+ */
+unsigned int
+dns__zonemgr_soapace(dns_zonemgr_t *zmgr) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	(void)isc_timer_reset(zmgr->pacetimer, isc_timertype_inactive, NULL,
+			      NULL, true);
+	zmgr_pace(&zmgr->refreshpace, zmgr->serialqueryrate, "serial query");
+
+	return (zmgr->refreshpace.rate);
+}
+
+static void
+zmgr_pace_tick(isc_task_t *task, isc_event_t *event) {
+	dns_zonemgr_t *zmgr = event->ev_arg;
+
+	UNUSED(task);
+
+	isc_event_free(&event);
+
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	zmgr_pace(&zmgr->notifypace, zmgr->notifyrate, "notify");
+	zmgr_pace(&zmgr->startupnotifypace, zmgr->startupnotifyrate,
+		  "startup notify");
+	zmgr_pace(&zmgr->refreshpace, zmgr->serialqueryrate, "serial query");
+
+	if (zmgr->stats == NULL) {
+		return;
+	}
+
+	isc_stats_set(zmgr->stats,
+		      isc_ratelimiter_getpending(zmgr->notifyrl) +
+			      isc_ratelimiter_getpending(zmgr->startupnotifyrl),
+		      dns_zonestatscounter_notifyqueued);
+	isc_stats_set(zmgr->stats, isc_ratelimiter_getpending(zmgr->refreshrl),
+		      dns_zonestatscounter_soaqueued);
+	isc_stats_set(zmgr->stats, zmgr->notifypace.rate,
+		      dns_zonestatscounter_notifyrate);
+	isc_stats_set(zmgr->stats, zmgr->startupnotifypace.rate,
+		      dns_zonestatscounter_startupnotifyrate);
+	isc_stats_set(zmgr->stats, zmgr->refreshpace.rate,
+		      dns_zonestatscounter_soarate);
+}
+
 bool
 dns_zonemgr_unreachable(dns_zonemgr_t *zmgr, isc_sockaddr_t *remote,
 			isc_sockaddr_t *local, isc_time_t *now) {
@@ -18414,6 +19312,25 @@ dns_zone_setstats(dns_zone_t *zone, isc_stats_t *stats) {
 	UNLOCK_ZONE(zone);
 }
 
+void
+dns_zone_setxfrinrate(dns_zone_t *zone, uint64_t bytes, uint64_t records,
+		      uint64_t msecs) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	if (msecs == 0) {
+		msecs = 1;
+	}
+
+	LOCK_ZONE(zone);
+	if (zone->stats != NULL) {
+		isc_stats_set(zone->stats, (bytes * 1000) / msecs,
+			      dns_zonestatscounter_xfrinbytesrate);
+		isc_stats_set(zone->stats, (records * 1000) / msecs,
+			      dns_zonestatscounter_xfrinrecsrate);
+	}
+	UNLOCK_ZONE(zone);
+}
+
 void
 dns_zone_setrequeststats(dns_zone_t *zone, isc_stats_t *stats) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -20022,6 +20939,21 @@ dns_zone_getadded(dns_zone_t *zone) {
 	return (zone->added);
 }
 
+void
+dns_zone_setconfighash(dns_zone_t *zone, uint64_t hash) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	zone->confighash = hash;
+	UNLOCK_ZONE(zone);
+}
+
+uint64_t
+dns_zone_getconfighash(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	return (zone->confighash);
+}
+
 isc_result_t
 dns_zone_dlzpostload(dns_zone_t *zone, dns_db_t *db) {
 	isc_time_t loadtime;
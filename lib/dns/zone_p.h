@@ -28,6 +28,12 @@ typedef struct {
 	bool offline;
 } dns__zonediff_t;
 
+void
+dns__zone_compactdeferred(dns_zone_t *zone);
+
+void
+dns__zone_compactjournal(dns_zone_t *zone, uint32_t serial);
+
 isc_result_t
 dns__zone_findkeys(dns_zone_t *zone, dns_db_t *db, dns_dbversion_t *ver,
 		   isc_stdtime_t now, isc_mem_t *mctx, unsigned int maxkeys,
@@ -41,6 +47,16 @@ dns__zone_updatesigs(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *version,
 		     isc_stdtime_t now, bool check_ksk, bool keyset_kskonly,
 		     dns__zonediff_t *zonediff);
 
+bool
+dns__zone_sign(dns_zone_t *zone);
+
+void
+dns__zonemgr_soadone(dns_zonemgr_t *zmgr, isc_result_t result,
+		     const isc_time_t *sent, const isc_sockaddr_t *remote);
+
+unsigned int
+dns__zonemgr_soapace(dns_zonemgr_t *zmgr);
+
 ISC_LANG_ENDDECLS
 
 #endif /* DNS_ZONE_P_H */
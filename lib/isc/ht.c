@@ -10,6 +10,7 @@
  */
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <isc/hash.h>
@@ -25,51 +26,217 @@ typedef struct isc_ht_node isc_ht_node_t;
 #define ISC_HT_MAGIC	 ISC_MAGIC('H', 'T', 'a', 'b')
 #define ISC_HT_VALID(ht) ISC_MAGIC_VALID(ht, ISC_HT_MAGIC)
 
+/*
+ * The table grows when it holds more nodes than buckets and shrinks,
+ * but never below the size it was created with, when it holds fewer
+ * than one node for every HT_SHRINK buckets.
+ *
+ * Resizing is done incrementally: a second table is allocated, and
+ * every following add or delete moves the nodes of HT_REHASH_STEP
+ * buckets from the old table into it, so that no single operation
+ * pays for rehashing the whole table.  While the tables are being
+ * rehashed, nodes are added to the new one and looked up in both.
+ *
+ * Nodes are never moved while an iterator is positioned on the table,
+ * as the iterator could otherwise miss or revisit them.
+ */
+#define HT_MAX_BITS    32
+#define HT_SHRINK      4
+#define HT_REHASH_STEP 2
+
+#define HASHSIZE(bits)	      ((size_t)1 << (bits))
+#define HASHINDEX(hash, bits) ((hash) & (HASHSIZE(bits) - 1))
+
 struct isc_ht_node {
 	void *value;
 	isc_ht_node_t *next;
-	size_t keysize;
+	uint32_t keysize;
+	uint32_t hashval;
 	unsigned char key[];
 };
 
 struct isc_ht {
 	unsigned int magic;
 	isc_mem_t *mctx;
-	size_t size;
-	size_t mask;
 	unsigned int count;
-	isc_ht_node_t **table;
+	unsigned int iterators; /* positioned iterators */
+	uint8_t minbits;
+	uint8_t hindex;
+	uint8_t hashbits[2];
+	isc_ht_node_t **table[2];
+	size_t hiter; /* next bucket of the old table to rehash */
 };
 
 struct isc_ht_iter {
 	isc_ht_t *ht;
+	uint8_t hindex;
+	bool active;
 	size_t i;
 	isc_ht_node_t *cur;
 };
 
+static isc_ht_node_t **
+table_new(isc_mem_t *mctx, uint8_t bits) {
+	isc_ht_node_t **table = NULL;
+
+	table = isc_mem_get(mctx, HASHSIZE(bits) * sizeof(isc_ht_node_t *));
+	memset(table, 0, HASHSIZE(bits) * sizeof(isc_ht_node_t *));
+
+	return (table);
+}
+
+static bool
+rehashing(const isc_ht_t *ht) {
+	return (ht->table[!ht->hindex] != NULL);
+}
+
+/*
+ * Move the nodes of up to 'buckets' buckets of the old table into
+ * the new one; free the old table when it is empty.
+ */
+static void
+rehash_step(isc_ht_t *ht, size_t buckets) {
+	uint8_t oldindex = !ht->hindex;
+	uint8_t newbits = ht->hashbits[ht->hindex];
+	size_t oldsize = HASHSIZE(ht->hashbits[oldindex]);
+	size_t stop = ISC_MIN(ht->hiter + buckets, oldsize);
+
+	for (; ht->hiter < stop; ht->hiter++) {
+		isc_ht_node_t *node = ht->table[oldindex][ht->hiter];
+		while (node != NULL) {
+			isc_ht_node_t *next = node->next;
+			size_t idx = HASHINDEX(node->hashval, newbits);
+
+			node->next = ht->table[ht->hindex][idx];
+			ht->table[ht->hindex][idx] = node;
+			node = next;
+		}
+		ht->table[oldindex][ht->hiter] = NULL;
+	}
+
+	if (ht->hiter == oldsize) {
+		isc_mem_put(ht->mctx, ht->table[oldindex],
+			    oldsize * sizeof(isc_ht_node_t *));
+		ht->table[oldindex] = NULL;
+		ht->hashbits[oldindex] = 0;
+		ht->hiter = 0;
+	}
+}
+
+/*
+ * Called after every add and delete: continue rehashing if a resize is
+ * in progress, otherwise start one if the table has become too crowded
+ * or too sparse.
+ */
+static void
+maybe_rehash(isc_ht_t *ht) {
+	uint8_t bits = ht->hashbits[ht->hindex];
+	uint8_t newbits = bits;
+
+	if (ht->iterators > 0) {
+		return;
+	}
+
+	if (rehashing(ht)) {
+		rehash_step(ht, HT_REHASH_STEP);
+		return;
+	}
+
+	if (ht->count > HASHSIZE(bits) && bits < HT_MAX_BITS) {
+		newbits = bits + 1;
+	} else if (ht->count < HASHSIZE(bits) / HT_SHRINK &&
+		   bits > ht->minbits)
+	{
+		newbits = bits - 1;
+	}
+	if (newbits == bits) {
+		return;
+	}
+
+	ht->hindex = !ht->hindex;
+	ht->hashbits[ht->hindex] = newbits;
+	ht->table[ht->hindex] = table_new(ht->mctx, newbits);
+	ht->hiter = 0;
+
+	rehash_step(ht, HT_REHASH_STEP);
+}
+
+/*
+ * Find the node matching 'key', looking in both tables while they are
+ * being rehashed.  If 'prevp' is not NULL, it is set to the preceding
+ * node in the bucket, and '*tablep' to the table the node is in.
+ */
+static isc_ht_node_t *
+node_find(const isc_ht_t *ht, const unsigned char *key, uint32_t keysize,
+	  uint32_t hashval, uint8_t *tablep, isc_ht_node_t **prevp) {
+	uint8_t hindex = ht->hindex;
+	int i;
+
+	for (i = 0; i < 2; i++, hindex = !hindex) {
+		isc_ht_node_t *prev = NULL;
+		isc_ht_node_t *node = NULL;
+
+		if (ht->table[hindex] == NULL) {
+			continue;
+		}
+
+		node = ht->table[hindex]
+				[HASHINDEX(hashval, ht->hashbits[hindex])];
+		while (node != NULL) {
+			if (keysize == node->keysize &&
+			    memcmp(key, node->key, keysize) == 0) {
+				if (tablep != NULL) {
+					*tablep = hindex;
+				}
+				if (prevp != NULL) {
+					*prevp = prev;
+				}
+				return (node);
+			}
+			prev = node;
+			node = node->next;
+		}
+	}
+
+	return (NULL);
+}
+
+static void
+node_unlink(isc_ht_t *ht, isc_ht_node_t *node, uint8_t hindex,
+	    isc_ht_node_t *prev) {
+	if (prev == NULL) {
+		ht->table[hindex][HASHINDEX(node->hashval,
+					    ht->hashbits[hindex])] = node->next;
+	} else {
+		prev->next = node->next;
+	}
+	isc_mem_put(ht->mctx, node,
+		    offsetof(isc_ht_node_t, key) + node->keysize);
+	ht->count--;
+}
+
 isc_result_t
 isc_ht_init(isc_ht_t **htp, isc_mem_t *mctx, uint8_t bits) {
 	isc_ht_t *ht = NULL;
-	size_t i;
 
 	REQUIRE(htp != NULL && *htp == NULL);
 	REQUIRE(mctx != NULL);
-	REQUIRE(bits >= 1 && bits <= (sizeof(size_t) * 8 - 1));
+	REQUIRE(bits >= 1 && bits <= HT_MAX_BITS);
 
 	ht = isc_mem_get(mctx, sizeof(struct isc_ht));
 
 	ht->mctx = NULL;
 	isc_mem_attach(mctx, &ht->mctx);
 
-	ht->size = ((size_t)1 << bits);
-	ht->mask = ((size_t)1 << bits) - 1;
 	ht->count = 0;
-
-	ht->table = isc_mem_get(ht->mctx, ht->size * sizeof(isc_ht_node_t *));
-
-	for (i = 0; i < ht->size; i++) {
-		ht->table[i] = NULL;
-	}
+	ht->iterators = 0;
+	ht->minbits = bits;
+	ht->hindex = 0;
+	ht->hashbits[0] = bits;
+	ht->hashbits[1] = 0;
+	ht->table[0] = table_new(ht->mctx, bits);
+	ht->table[1] = NULL;
+	ht->hiter = 0;
 
 	ht->magic = ISC_HT_MAGIC;
 
@@ -81,6 +248,7 @@ void
 isc_ht_destroy(isc_ht_t **htp) {
 	isc_ht_t *ht;
 	size_t i;
+	int t;
 
 	REQUIRE(htp != NULL);
 
@@ -91,21 +259,28 @@ isc_ht_destroy(isc_ht_t **htp) {
 
 	ht->magic = 0;
 
-	for (i = 0; i < ht->size; i++) {
-		isc_ht_node_t *node = ht->table[i];
-		while (node != NULL) {
-			isc_ht_node_t *next = node->next;
-			ht->count--;
-			isc_mem_put(ht->mctx, node,
-				    offsetof(isc_ht_node_t, key) +
-					    node->keysize);
-			node = next;
+	for (t = 0; t < 2; t++) {
+		if (ht->table[t] == NULL) {
+			continue;
 		}
+		for (i = 0; i < HASHSIZE(ht->hashbits[t]); i++) {
+			isc_ht_node_t *node = ht->table[t][i];
+			while (node != NULL) {
+				isc_ht_node_t *next = node->next;
+				ht->count--;
+				isc_mem_put(ht->mctx, node,
+					    offsetof(isc_ht_node_t, key) +
+						    node->keysize);
+				node = next;
+			}
+		}
+		isc_mem_put(ht->mctx, ht->table[t],
+			    HASHSIZE(ht->hashbits[t]) *
+				    sizeof(isc_ht_node_t *));
 	}
 
 	INSIST(ht->count == 0);
 
-	isc_mem_put(ht->mctx, ht->table, ht->size * sizeof(isc_ht_node_t *));
 	isc_mem_putanddetach(&ht->mctx, ht, sizeof(struct isc_ht));
 }
 
@@ -114,29 +289,30 @@ isc_ht_add(isc_ht_t *ht, const unsigned char *key, uint32_t keysize,
 	   void *value) {
 	isc_ht_node_t *node;
 	uint32_t hash;
+	size_t idx;
 
 	REQUIRE(ISC_HT_VALID(ht));
 	REQUIRE(key != NULL && keysize > 0);
 
 	hash = isc_hash_function(key, keysize, true);
-	node = ht->table[hash & ht->mask];
-	while (node != NULL) {
-		if (keysize == node->keysize &&
-		    memcmp(key, node->key, keysize) == 0) {
-			return (ISC_R_EXISTS);
-		}
-		node = node->next;
+	if (node_find(ht, key, keysize, hash, NULL, NULL) != NULL) {
+		return (ISC_R_EXISTS);
 	}
 
 	node = isc_mem_get(ht->mctx, offsetof(isc_ht_node_t, key) + keysize);
 
 	memmove(node->key, key, keysize);
 	node->keysize = keysize;
-	node->next = ht->table[hash & ht->mask];
+	node->hashval = hash;
 	node->value = value;
 
+	idx = HASHINDEX(hash, ht->hashbits[ht->hindex]);
+	node->next = ht->table[ht->hindex][idx];
+	ht->table[ht->hindex][idx] = node;
 	ht->count++;
-	ht->table[hash & ht->mask] = node;
+
+	maybe_rehash(ht);
+
 	return (ISC_R_SUCCESS);
 }
 
@@ -151,52 +327,48 @@ isc_ht_find(const isc_ht_t *ht, const unsigned char *key, uint32_t keysize,
 	REQUIRE(valuep == NULL || *valuep == NULL);
 
 	hash = isc_hash_function(key, keysize, true);
-	node = ht->table[hash & ht->mask];
-	while (node != NULL) {
-		if (keysize == node->keysize &&
-		    memcmp(key, node->key, keysize) == 0) {
-			if (valuep != NULL) {
-				*valuep = node->value;
-			}
-			return (ISC_R_SUCCESS);
-		}
-		node = node->next;
+	node = node_find(ht, key, keysize, hash, NULL, NULL);
+	if (node == NULL) {
+		return (ISC_R_NOTFOUND);
 	}
 
-	return (ISC_R_NOTFOUND);
+	if (valuep != NULL) {
+		*valuep = node->value;
+	}
+	return (ISC_R_SUCCESS);
 }
 
 isc_result_t
 isc_ht_delete(isc_ht_t *ht, const unsigned char *key, uint32_t keysize) {
-	isc_ht_node_t *node, *prev;
+	isc_ht_node_t *node, *prev = NULL;
+	uint8_t hindex = 0;
 	uint32_t hash;
 
 	REQUIRE(ISC_HT_VALID(ht));
 	REQUIRE(key != NULL && keysize > 0);
 
-	prev = NULL;
 	hash = isc_hash_function(key, keysize, true);
-	node = ht->table[hash & ht->mask];
-	while (node != NULL) {
-		if (keysize == node->keysize &&
-		    memcmp(key, node->key, keysize) == 0) {
-			if (prev == NULL) {
-				ht->table[hash & ht->mask] = node->next;
-			} else {
-				prev->next = node->next;
-			}
-			isc_mem_put(ht->mctx, node,
-				    offsetof(isc_ht_node_t, key) +
-					    node->keysize);
-			ht->count--;
+	node = node_find(ht, key, keysize, hash, &hindex, &prev);
+	if (node == NULL) {
+		return (ISC_R_NOTFOUND);
+	}
 
-			return (ISC_R_SUCCESS);
-		}
+	node_unlink(ht, node, hindex, prev);
 
-		prev = node;
-		node = node->next;
+	maybe_rehash(ht);
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+iter_setactive(isc_ht_iter_t *it, bool active) {
+	if (active && !it->active) {
+		it->ht->iterators++;
+	} else if (!active && it->active) {
+		INSIST(it->ht->iterators > 0);
+		it->ht->iterators--;
 	}
-	return (ISC_R_NOTFOUND);
+	it->active = active;
 }
 
 isc_result_t
@@ -209,6 +381,8 @@ isc_ht_iter_create(isc_ht_t *ht, isc_ht_iter_t **itp) {
 	it = isc_mem_get(ht->mctx, sizeof(isc_ht_iter_t));
 
 	it->ht = ht;
+	it->hindex = ht->hindex;
+	it->active = false;
 	it->i = 0;
 	it->cur = NULL;
 
@@ -227,25 +401,47 @@ isc_ht_iter_destroy(isc_ht_iter_t **itp) {
 	it = *itp;
 	*itp = NULL;
 	ht = it->ht;
+	iter_setactive(it, false);
 	isc_mem_put(ht->mctx, it, sizeof(isc_ht_iter_t));
 }
 
+/*
+ * Advance the iterator to the first node at or after bucket 'it->i',
+ * continuing into the old table while the tables are being rehashed.
+ */
+static isc_result_t
+iter_bucket(isc_ht_iter_t *it) {
+	isc_ht_t *ht = it->ht;
+
+	for (;;) {
+		while (it->i < HASHSIZE(ht->hashbits[it->hindex]) &&
+		       ht->table[it->hindex][it->i] == NULL)
+		{
+			it->i++;
+		}
+		if (it->i < HASHSIZE(ht->hashbits[it->hindex])) {
+			it->cur = ht->table[it->hindex][it->i];
+			iter_setactive(it, true);
+			return (ISC_R_SUCCESS);
+		}
+		if (it->hindex != ht->hindex || !rehashing(ht)) {
+			it->cur = NULL;
+			iter_setactive(it, false);
+			return (ISC_R_NOMORE);
+		}
+		it->hindex = !ht->hindex;
+		it->i = ht->hiter;
+	}
+}
+
 isc_result_t
 isc_ht_iter_first(isc_ht_iter_t *it) {
 	REQUIRE(it != NULL);
 
+	it->hindex = it->ht->hindex;
 	it->i = 0;
-	while (it->i < it->ht->size && it->ht->table[it->i] == NULL) {
-		it->i++;
-	}
 
-	if (it->i == it->ht->size) {
-		return (ISC_R_NOMORE);
-	}
-
-	it->cur = it->ht->table[it->i];
-
-	return (ISC_R_SUCCESS);
+	return (iter_bucket(it));
 }
 
 isc_result_t
@@ -254,60 +450,41 @@ isc_ht_iter_next(isc_ht_iter_t *it) {
 	REQUIRE(it->cur != NULL);
 
 	it->cur = it->cur->next;
-	if (it->cur == NULL) {
-		do {
-			it->i++;
-		} while (it->i < it->ht->size && it->ht->table[it->i] == NULL);
-		if (it->i >= it->ht->size) {
-			return (ISC_R_NOMORE);
-		}
-		it->cur = it->ht->table[it->i];
+	if (it->cur != NULL) {
+		return (ISC_R_SUCCESS);
 	}
 
-	return (ISC_R_SUCCESS);
+	it->i++;
+	return (iter_bucket(it));
 }
 
 isc_result_t
 isc_ht_iter_delcurrent_next(isc_ht_iter_t *it) {
-	isc_result_t result = ISC_R_SUCCESS;
+	isc_result_t result;
 	isc_ht_node_t *to_delete = NULL;
 	isc_ht_node_t *prev = NULL;
 	isc_ht_node_t *node = NULL;
-	uint32_t hash;
+	uint8_t hindex;
 	isc_ht_t *ht;
+
 	REQUIRE(it != NULL);
 	REQUIRE(it->cur != NULL);
+
 	to_delete = it->cur;
+	hindex = it->hindex;
 	ht = it->ht;
 
-	it->cur = it->cur->next;
-	if (it->cur == NULL) {
-		do {
-			it->i++;
-		} while (it->i < ht->size && ht->table[it->i] == NULL);
-		if (it->i >= ht->size) {
-			result = ISC_R_NOMORE;
-		} else {
-			it->cur = ht->table[it->i];
-		}
-	}
+	result = isc_ht_iter_next(it);
 
-	hash = isc_hash_function(to_delete->key, to_delete->keysize, true);
-	node = ht->table[hash & ht->mask];
+	node = ht->table[hindex][HASHINDEX(to_delete->hashval,
+					   ht->hashbits[hindex])];
 	while (node != to_delete) {
 		prev = node;
 		node = node->next;
 		INSIST(node != NULL);
 	}
 
-	if (prev == NULL) {
-		ht->table[hash & ht->mask] = node->next;
-	} else {
-		prev->next = node->next;
-	}
-	isc_mem_put(ht->mctx, node,
-		    offsetof(isc_ht_node_t, key) + node->keysize);
-	ht->count--;
+	node_unlink(ht, node, hindex, prev);
 
 	return (result);
 }
@@ -26,6 +26,11 @@ typedef struct isc_ht_iter isc_ht_iter_t;
 /*%
  * Initialize hashtable at *htp, using memory context and size of (1<<bits)
  *
+ * The hashtable grows as nodes are added, and shrinks back towards its
+ * initial size as they are deleted.  It is resized incrementally by the
+ * following adds and deletes, but not while an iterator is positioned
+ * on it.
+ *
  * Requires:
  *\li	'htp' is not NULL and '*htp' is NULL.
  *\li	'mctx' is a valid memory context.
@@ -96,6 +101,10 @@ isc_ht_delete(isc_ht_t *ht, const unsigned char *key, uint32_t keysize);
 /*%
  * Create an iterator for the hashtable; point '*itp' to it.
  *
+ * Nodes added while the iterator is positioned on the hashtable may or
+ * may not be visited.  The hashtable is not resized until the iterator
+ * has reached the end or been destroyed.
+ *
  * Requires:
  *\li	'ht' is a valid hashtable
  *\li	'itp' is non NULL and '*itp' is NULL.
@@ -11,7 +11,10 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include <isc/lang.h>
+#include <isc/types.h>
 
 /*
  * The maximal hash length that can be encoded in a name
@@ -25,6 +28,16 @@
  */
 #define NSEC3_MAX_LABEL_HASH 35
 
+/*
+ * One input to isc_iterated_hash_batch().
+ */
+typedef struct isc_iterated_hash_item {
+	const unsigned char *in;			/* data to hash */
+	int		     inlength;			/* length of 'in' */
+	unsigned char	     out[NSEC3_MAX_HASH_LENGTH]; /* the hash */
+	int		     outlength; /* length of 'out'; 0 on failure */
+} isc_iterated_hash_item_t;
+
 ISC_LANG_BEGINDECLS
 
 int
@@ -33,4 +46,17 @@ isc_iterated_hash(unsigned char *out, const unsigned int hashalg,
 		  const int saltlength, const unsigned char *in,
 		  const int inlength);
 
+void
+isc_iterated_hash_batch(isc_workpool_t *pool, const unsigned int hashalg,
+			const int iterations, const unsigned char *salt,
+			const int saltlength, isc_iterated_hash_item_t *items,
+			size_t count);
+/*
+ * Hash each of the 'count' 'items' as isc_iterated_hash() would, with
+ * the same algorithm, iterations and salt.  The items are split into
+ * chunks which are hashed in parallel on 'pool' (or on the calling
+ * thread if 'pool' is NULL), each chunk reusing a single digest
+ * context.
+ */
+
 ISC_LANG_ENDDECLS
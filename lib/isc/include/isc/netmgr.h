@@ -340,6 +340,55 @@ isc_nm_maxudp(isc_nm_t *mgr, uint32_t maxudp);
  * size.
  */
 
+typedef enum {
+	isc_nm_udpsteer_hash = 0, /*%< kernel default, by 4-tuple hash */
+	isc_nm_udpsteer_cpu,	  /*%< to the worker on the receiving CPU */
+	isc_nm_udpsteer_prefix	  /*%< by hash of the client's prefix */
+} isc_nm_udpsteer_t;
+
+void
+isc_nm_setudpsteering(isc_nm_t *mgr, isc_nm_udpsteer_t steer);
+/*%<
+ * Set how packets arriving at UDP sockets subsequently opened with
+ * isc_nm_listenudp() are distributed among the workers.  With
+ * isc_nm_udpsteer_cpu, a packet goes to the worker bound to the CPU
+ * that received it (see isc_thread_bind()).  With
+ * isc_nm_udpsteer_prefix, all packets from a client's /24 (IPv4) or
+ * /48 (IPv6) network go to the same worker, so that a single client
+ * cannot flood every worker.
+ *
+ * Steering uses a classic BPF program attached with
+ * SO_ATTACH_REUSEPORT_CBPF, and is silently unavailable where that is
+ * not supported.
+ *
+ * Requires:
+ * \li	'mgr' is a valid netmgr.
+ */
+
+typedef enum {
+	isc__nm_cbpf_normal = 0,
+	isc__nm_cbpf_fail,	/*%< the kernel rejects the program */
+	isc__nm_cbpf_unavailable /*%< no program is attached */
+} isc__nm_cbpf_t;
+
+void
+isc__nm_setcbpf(isc_nm_t *mgr, isc__nm_cbpf_t cbpf);
+/*%<
+ * For testing only: simulate a kernel that refuses the UDP steering
+ * program, or one without SO_ATTACH_REUSEPORT_CBPF, for UDP sockets
+ * subsequently opened with isc_nm_listenudp().
+ */
+
+size_t
+isc_nm_pktcounts(isc_nm_t *mgr, uint64_t *counts, size_t size);
+/*%<
+ * Store the number of UDP packets received by each worker so far in
+ * 'counts', up to 'size' workers, and return the number of workers.
+ *
+ * Requires:
+ * \li	'mgr' is a valid netmgr.
+ */
+
 void
 isc_nm_setstats(isc_nm_t *mgr, isc_stats_t *stats);
 /*%<
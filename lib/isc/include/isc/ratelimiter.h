@@ -69,6 +69,12 @@ isc_ratelimiter_setpushpop(isc_ratelimiter_t *rl, bool pushpop);
  * first in - first out mode (default).
  */
 
+unsigned int
+isc_ratelimiter_getpending(isc_ratelimiter_t *rl);
+/*%<
+ * Return the number of events waiting in the queue of 'rl'.
+ */
+
 isc_result_t
 isc_ratelimiter_enqueue(isc_ratelimiter_t *rl, isc_task_t *task,
 			isc_event_t **eventp);
@@ -95,6 +95,7 @@ typedef struct isc_textregion isc_textregion_t; /*%< Text Region */
 typedef struct isc_time	      isc_time_t;	/*%< Time */
 typedef struct isc_timer      isc_timer_t;	/*%< Timer */
 typedef struct isc_timermgr   isc_timermgr_t;	/*%< Timer Manager */
+typedef struct isc_workpool   isc_workpool_t;	/*%< Worker Pool */
 
 typedef void (*isc_taskaction_t)(isc_task_t *, isc_event_t *);
 typedef int (*isc_sockfdwatch_t)(isc_task_t *, isc_socket_t *, void *, int);
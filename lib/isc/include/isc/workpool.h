@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#ifndef ISC_WORKPOOL_H
+#define ISC_WORKPOOL_H 1
+
+/*****
+***** Module Info
+*****/
+
+/*! \file isc/workpool.h
+ *
+ * \brief The isc_workpool_t object is a fixed set of worker threads
+ * used to run CPU-bound batches of independent work items in parallel.
+ *
+ * A batch is submitted with isc_workpool_run(), which calls a function
+ * once for every index in the batch, spread across the workers and the
+ * calling thread, and returns only once all of them have completed.
+ * Callers therefore keep their existing synchronous structure: they
+ * prepare an array of work, run it, and consume the results in order.
+ *
+ * Only one batch runs at a time.  If the pool is busy with another
+ * caller's batch, isc_workpool_run() executes the batch on the calling
+ * thread instead of waiting.
+ */
+
+/***
+ *** Imports.
+ ***/
+
+#include <stddef.h>
+
+#include <isc/lang.h>
+#include <isc/types.h>
+
+/*****
+***** Types.
+*****/
+
+typedef void (*isc_workfunc_t)(void *arg, size_t index);
+
+ISC_LANG_BEGINDECLS
+
+void
+isc_workpool_create(isc_mem_t *mctx, unsigned int nworkers,
+		    isc_workpool_t **poolp);
+/*%<
+ * Create a worker pool with 'nworkers' threads.  A pool with zero workers
+ * is valid and runs every batch on the calling thread.
+ *
+ * Requires:
+ *\li	'poolp' is not NULL and '*poolp' is NULL.
+ */
+
+void
+isc_workpool_run(isc_workpool_t *pool, size_t count, isc_workfunc_t func,
+		 void *arg);
+/*%<
+ * Call 'func(arg, i)' for each 'i' in [0, count), in parallel and in
+ * no particular order, and wait for all calls to complete.
+ *
+ * 'func' must be safe to call concurrently for different indexes.
+ *
+ * Requires:
+ *\li	'pool' is a valid worker pool, or NULL, in which case the batch
+ *	is run on the calling thread.
+ *\li	'func' is not called from within a batch running on 'pool'.
+ */
+
+unsigned int
+isc_workpool_size(isc_workpool_t *pool);
+/*%<
+ * Return the number of threads that can work on a batch at the same
+ * time, including the calling thread.  Returns 1 if 'pool' is NULL.
+ */
+
+void
+isc_workpool_attach(isc_workpool_t *source, isc_workpool_t **targetp);
+/*%<
+ * Attach to a worker pool, increasing its reference count.
+ */
+
+void
+isc_workpool_detach(isc_workpool_t **poolp);
+/*%<
+ * Detach from a worker pool, stopping its threads and freeing it when
+ * the last reference is gone.
+ */
+
+ISC_LANG_ENDDECLS
+
+#endif /* ISC_WORKPOOL_H */
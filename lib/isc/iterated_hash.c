@@ -14,61 +14,133 @@
 #include <isc/iterated_hash.h>
 #include <isc/md.h>
 #include <isc/util.h>
+#include <isc/workpool.h>
 
-int
-isc_iterated_hash(unsigned char *out, const unsigned int hashalg,
-		  const int iterations, const unsigned char *salt,
-		  const int saltlength, const unsigned char *in,
-		  const int inlength) {
-	isc_md_t *md;
+/*
+ * Number of items hashed with one digest context in
+ * isc_iterated_hash_batch().
+ */
+#define BATCH_CHUNK 64
+
+static int
+iterated_hash(isc_md_t *md, unsigned char *out, const int iterations,
+	      const unsigned char *salt, const int saltlength,
+	      const unsigned char *in, const int inlength) {
 	isc_result_t result;
 	int n = 0;
 	unsigned int outlength = 0;
 	size_t len;
 	const unsigned char *buf;
 
-	REQUIRE(out != NULL);
-
-	if (hashalg != 1) {
-		return (0);
-	}
-
-	if ((md = isc_md_new()) == NULL) {
-		return (0);
-	}
-
 	len = inlength;
 	buf = in;
 	do {
 		result = isc_md_init(md, ISC_MD_SHA1);
 		if (result != ISC_R_SUCCESS) {
-			goto md_fail;
+			return (0);
 		}
 		result = isc_md_update(md, buf, len);
 		if (result != ISC_R_SUCCESS) {
-			goto md_fail;
+			return (0);
 		}
 		result = isc_md_update(md, salt, saltlength);
 		if (result != ISC_R_SUCCESS) {
-			goto md_fail;
+			return (0);
 		}
 		result = isc_md_final(md, out, &outlength);
 		if (result != ISC_R_SUCCESS) {
-			goto md_fail;
+			return (0);
 		}
 		result = isc_md_reset(md);
 		if (result != ISC_R_SUCCESS) {
-			goto md_fail;
+			return (0);
 		}
 		buf = out;
 		len = outlength;
 	} while (n++ < iterations);
 
+	return (outlength);
+}
+
+int
+isc_iterated_hash(unsigned char *out, const unsigned int hashalg,
+		  const int iterations, const unsigned char *salt,
+		  const int saltlength, const unsigned char *in,
+		  const int inlength) {
+	isc_md_t *md;
+	int outlength;
+
+	REQUIRE(out != NULL);
+
+	if (hashalg != 1) {
+		return (0);
+	}
+
+	if ((md = isc_md_new()) == NULL) {
+		return (0);
+	}
+
+	outlength = iterated_hash(md, out, iterations, salt, saltlength, in,
+				  inlength);
+
 	isc_md_free(md);
 
 	return (outlength);
-md_fail:
-	isc_md_free(md);
-	return (0);
+}
+
+typedef struct hashbatch {
+	int iterations;
+	const unsigned char *salt;
+	int saltlength;
+	isc_iterated_hash_item_t *items;
+	size_t count;
+} hashbatch_t;
+
+static void
+hash_chunk(void *arg, size_t index) {
+	hashbatch_t *batch = arg;
+	size_t i = index * BATCH_CHUNK;
+	size_t end = ISC_MIN(i + BATCH_CHUNK, batch->count);
+	isc_md_t *md = isc_md_new();
+
+	for (; i < end; i++) {
+		isc_iterated_hash_item_t *item = &batch->items[i];
+
+		item->outlength = 0;
+		if (md != NULL) {
+			item->outlength = iterated_hash(
+				md, item->out, batch->iterations, batch->salt,
+				batch->saltlength, item->in, item->inlength);
+		}
+	}
+
+	if (md != NULL) {
+		isc_md_free(md);
+	}
+}
+
+void
+isc_iterated_hash_batch(isc_workpool_t *pool, const unsigned int hashalg,
+			const int iterations, const unsigned char *salt,
+			const int saltlength, isc_iterated_hash_item_t *items,
+			size_t count) {
+	hashbatch_t batch = { .iterations = iterations,
+			      .salt = salt,
+			      .saltlength = saltlength,
+			      .items = items,
+			      .count = count };
+	size_t i;
+
+	REQUIRE(items != NULL || count == 0);
+
+	if (hashalg != 1) {
+		for (i = 0; i < count; i++) {
+			items[i].outlength = 0;
+		}
+		return;
+	}
+
+	isc_workpool_run(pool, (count + BATCH_CHUNK - 1) / BATCH_CHUNK,
+			 hash_chunk, &batch);
 }
 #undef RETERR
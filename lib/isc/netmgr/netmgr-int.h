@@ -301,6 +301,8 @@ struct isc_nm {
 	atomic_uint_fast32_t workers_running;
 	atomic_uint_fast32_t workers_paused;
 	atomic_uint_fast32_t maxudp;
+	atomic_uint_fast32_t udpsteer;
+	atomic_uint_fast32_t cbpf;
 	atomic_bool paused;
 
 	/*
@@ -154,6 +154,8 @@ isc_nm_start(isc_mem_t *mctx, uint32_t workers) {
 	atomic_init(&mgr->workers_running, 0);
 	atomic_init(&mgr->workers_paused, 0);
 	atomic_init(&mgr->maxudp, 0);
+	atomic_init(&mgr->udpsteer, isc_nm_udpsteer_hash);
+	atomic_init(&mgr->cbpf, isc__nm_cbpf_normal);
 	atomic_init(&mgr->paused, false);
 	atomic_init(&mgr->interlocked, false);
 
@@ -204,6 +206,7 @@ isc_nm_start(isc_mem_t *mctx, uint32_t workers) {
 		worker->ievents = isc_queue_new(mgr->mctx, 128);
 		worker->ievents_prio = isc_queue_new(mgr->mctx, 128);
 		worker->recvbuf = isc_mem_get(mctx, ISC_NETMGR_RECVBUF_SIZE);
+		atomic_init(&worker->pktcount, 0);
 
 		/*
 		 * We need to do this here and not in nm_thread to avoid a
@@ -436,6 +439,32 @@ isc_nm_maxudp(isc_nm_t *mgr, uint32_t maxudp) {
 	atomic_store(&mgr->maxudp, maxudp);
 }
 
+void
+isc_nm_setudpsteering(isc_nm_t *mgr, isc_nm_udpsteer_t steer) {
+	REQUIRE(VALID_NM(mgr));
+
+	atomic_store(&mgr->udpsteer, steer);
+}
+
+void
+isc__nm_setcbpf(isc_nm_t *mgr, isc__nm_cbpf_t cbpf) {
+	REQUIRE(VALID_NM(mgr));
+
+	atomic_store(&mgr->cbpf, cbpf);
+}
+
+size_t
+isc_nm_pktcounts(isc_nm_t *mgr, uint64_t *counts, size_t size) {
+	REQUIRE(VALID_NM(mgr));
+	REQUIRE(counts != NULL || size == 0);
+
+	for (size_t i = 0; i < size && i < mgr->nworkers; i++) {
+		counts[i] = atomic_load_relaxed(&mgr->workers[i].pktcount);
+	}
+
+	return (mgr->nworkers);
+}
+
 void
 isc_nm_tcp_settimeouts(isc_nm_t *mgr, uint32_t init, uint32_t idle,
 		       uint32_t keepalive, uint32_t advertised) {
@@ -478,7 +507,7 @@ nm_thread(isc_threadarg_t worker0) {
 	isc__networker_t *worker = (isc__networker_t *)worker0;
 
 	isc__nm_tid_v = worker->id;
-	isc_thread_setaffinity(isc__nm_tid_v);
+	isc_thread_bind(isc__nm_tid_v);
 
 	while (true) {
 		int r = uv_run(&worker->loop, UV_RUN_DEFAULT);
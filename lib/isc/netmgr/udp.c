@@ -12,6 +12,10 @@
 #include <unistd.h>
 #include <uv.h>
 
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+#include <linux/filter.h>
+#endif /* if defined(SO_ATTACH_REUSEPORT_CBPF) */
+
 #include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/condition.h>
@@ -40,6 +44,93 @@ udp_recv_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 static void
 udp_send_cb(uv_udp_send_t *req, int status);
 
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+/*
+ * Multiplier for hashing client prefixes (Knuth's multiplicative
+ * hashing); the middle bits of the product are used.
+ */
+#define PREFIX_HASH 0x9e3779b1U
+
+/*
+ * Attach a program to the SO_REUSEPORT group of 'fd' that returns the
+ * index, in the order they were bound, of the socket that should
+ * receive a packet.  The kernel falls back to hashing if the program
+ * cannot be attached or returns an index past the end of the group.
+ */
+static void
+udp_attach_steering(isc_nm_t *mgr, int fd, sa_family_t family) {
+	struct sock_filter *code = NULL;
+	struct sock_fprog prog;
+	uint32_t nworkers = mgr->nworkers;
+	size_t size = 0, len = 0;
+
+	switch (atomic_load(&mgr->udpsteer)) {
+	case isc_nm_udpsteer_cpu:
+		size = 2 * nworkers + 3;
+		if (size > BPF_MAXINSNS) {
+			size = 3;
+		}
+		code = isc_mem_get(mgr->mctx, size * sizeof(*code));
+		code[len++] = (struct sock_filter)BPF_STMT(
+			BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU);
+		/*
+		 * Look the receiving CPU up among the CPUs the workers
+		 * are bound to; on other CPUs, use the CPU number.
+		 */
+		for (uint32_t i = 0; i < nworkers && size > 3; i++) {
+			code[len++] = (struct sock_filter)BPF_JUMP(
+				BPF_JMP | BPF_JEQ | BPF_K, isc_thread_cpu(i), 0,
+				1);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_RET | BPF_K, i);
+		}
+		break;
+	case isc_nm_udpsteer_prefix:
+		size = 9;
+		code = isc_mem_get(mgr->mctx, size * sizeof(*code));
+		if (family == AF_INET) {
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_ALU | BPF_AND | BPF_K, 0xffffff00);
+		} else {
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 8);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_ALU | BPF_MUL | BPF_K, PREFIX_HASH);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_MISC | BPF_TAX, 0);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF + 12);
+			code[len++] = (struct sock_filter)BPF_STMT(
+				BPF_ALU | BPF_ADD | BPF_X, 0);
+		}
+		code[len++] = (struct sock_filter)BPF_STMT(
+			BPF_ALU | BPF_MUL | BPF_K, PREFIX_HASH);
+		code[len++] = (struct sock_filter)BPF_STMT(
+			BPF_ALU | BPF_RSH | BPF_K, 16);
+		break;
+	default:
+		return;
+	}
+
+	code[len++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_MOD | BPF_K,
+						   nworkers);
+	code[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_A, 0);
+	INSIST(len <= size);
+
+	prog.len = len;
+	prog.filter = code;
+	if (atomic_load(&mgr->cbpf) == isc__nm_cbpf_fail) {
+		prog.len = 0;
+	}
+	(void)setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+			 sizeof(prog));
+
+	isc_mem_put(mgr->mctx, code, size * sizeof(*code));
+}
+#endif /* if defined(SO_ATTACH_REUSEPORT_CBPF) */
+
 isc_result_t
 isc_nm_listenudp(isc_nm_t *mgr, isc_nmiface_t *iface, isc_nm_recv_cb_t cb,
 		 void *cbarg, size_t extrahandlesize, isc_nmsocket_t **sockp) {
@@ -120,8 +211,32 @@ isc_nm_listenudp(isc_nm_t *mgr, isc_nmiface_t *iface, isc_nm_recv_cb_t cb,
 		 * setting SO_INCOMING_CPU is just an optimization.
 		 */
 		(void)setsockopt(csock->fd, SOL_SOCKET, SO_INCOMING_CPU,
-				 &(int){ 1 }, sizeof(int));
+				 &(int){ isc_thread_cpu(i) }, sizeof(int));
 #endif
+		if (family == AF_INET6) {
+			(void)setsockopt(csock->fd, IPPROTO_IPV6, IPV6_V6ONLY,
+					 &(int){ 1 }, sizeof(int));
+		}
+
+		/*
+		 * The sockets are bound here, in order, rather than by
+		 * the workers, so that the socket of worker 'i' is socket
+		 * 'i' of the SO_REUSEPORT group, as the steering program
+		 * expects.
+		 */
+		res = bind(csock->fd, &iface->addr.type.sa,
+			   iface->addr.length);
+		if (res < 0) {
+			isc__nm_incstats(mgr,
+					 csock->statsindex[STATID_BINDFAIL]);
+		}
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+		if (i == 0 &&
+		    atomic_load(&mgr->cbpf) != isc__nm_cbpf_unavailable) {
+			udp_attach_steering(mgr, csock->fd, family);
+		}
+#endif /* if defined(SO_ATTACH_REUSEPORT_CBPF) */
+
 		ievent = isc__nm_get_ievent(mgr, netievent_udplisten);
 		ievent->sock = csock;
 		isc__nm_enqueue_ievent(&mgr->workers[i],
@@ -139,8 +254,7 @@ void
 isc__nm_async_udplisten(isc__networker_t *worker, isc__netievent_t *ev0) {
 	isc__netievent_udplisten_t *ievent = (isc__netievent_udplisten_t *)ev0;
 	isc_nmsocket_t *sock = ievent->sock;
-	int r, uv_bind_flags = 0;
-	int uv_init_flags = 0;
+	int r, uv_init_flags = 0;
 
 	REQUIRE(sock->type == isc_nm_udpsocket);
 	REQUIRE(sock->iface != NULL);
@@ -161,15 +275,9 @@ isc__nm_async_udplisten(isc__networker_t *worker, isc__netievent_t *ev0) {
 		isc__nm_incstats(sock->mgr, sock->statsindex[STATID_OPENFAIL]);
 	}
 
-	if (sock->iface->addr.type.sa.sa_family == AF_INET6) {
-		uv_bind_flags |= UV_UDP_IPV6ONLY;
-	}
-
-	r = uv_udp_bind(&sock->uv_handle.udp,
-			&sock->parent->iface->addr.type.sa, uv_bind_flags);
-	if (r < 0) {
-		isc__nm_incstats(sock->mgr, sock->statsindex[STATID_BINDFAIL]);
-	}
+	/*
+	 * The socket has been bound by isc_nm_listenudp().
+	 */
 #ifdef ISC_RECV_BUFFER_SIZE
 	uv_recv_buffer_size(&sock->uv_handle.handle,
 			    &(int){ ISC_RECV_BUFFER_SIZE });
@@ -340,6 +448,8 @@ udp_recv_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 		return;
 	}
 
+	atomic_fetch_add_relaxed(&sock->mgr->workers[sock->tid].pktcount, 1);
+
 	/*
 	 * Simulate a firewall blocking UDP packets bigger than
 	 * 'maxudp' bytes.
@@ -50,6 +50,49 @@ isc_thread_setname(isc_thread_t thread, const char *name);
 isc_result_t
 isc_thread_setaffinity(int cpu);
 
+/*%
+ * How worker threads are placed by isc_thread_bind().
+ */
+typedef enum {
+	isc_threadaffinity_none, /*%< leave placement to the OS */
+	isc_threadaffinity_cpu,	 /*%< bind each worker to one CPU */
+	isc_threadaffinity_node	 /*%< bind each worker to a NUMA node */
+} isc_threadaffinity_t;
+
+void
+isc_thread_setaffinitypolicy(isc_threadaffinity_t policy);
+/*%<
+ * Set the policy used by isc_thread_bind(); the default is
+ * isc_threadaffinity_cpu.  This must be called before any worker
+ * threads are started.
+ */
+
+isc_result_t
+isc_thread_bind(unsigned int index);
+/*%<
+ * Bind the calling thread, worker 'index' of a thread pool, according
+ * to the affinity policy.  The CPUs the process may run on are taken
+ * in NUMA node order, so that workers with consecutive indexes share
+ * a node, and worker 'index' is placed on the CPU at 'index' modulo
+ * their number, or on all the CPUs of that CPU's node.
+ */
+
+int
+isc_thread_cpu(unsigned int index);
+/*%<
+ * Return the CPU that isc_thread_bind() places worker 'index' on, or
+ * with the node policy, a CPU in the worker's node.
+ */
+
+void
+isc__thread_setnodedir(const char *dir);
+/*%<
+ * Read the NUMA node layout from 'dir' instead of
+ * /sys/devices/system/node, and compute the worker placement again.
+ * For testing only; it must be called before any worker threads are
+ * bound.
+ */
+
 #define isc_thread_self (unsigned long)pthread_self
 
 ISC_LANG_ENDDECLS
@@ -26,6 +26,16 @@
 #include <sys/types.h>
 #endif /* if defined(HAVE_SYS_PROCSET_H) */
 
+#if defined(__linux__) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define USE_NUMA_PLACEMENT 1
+#endif /* if defined(__linux__) && defined(HAVE_PTHREAD_SETAFFINITY_NP) */
+
+#include <isc/once.h>
 #include <isc/strerr.h>
 #include <isc/thread.h>
 #include <isc/util.h>
@@ -171,3 +181,195 @@ isc_thread_setaffinity(int cpu) {
 #endif /* if defined(HAVE_CPUSET_SETAFFINITY) */
 	return (ISC_R_SUCCESS);
 }
+
+static isc_threadaffinity_t affinity_policy = isc_threadaffinity_cpu;
+
+void
+isc_thread_setaffinitypolicy(isc_threadaffinity_t policy) {
+	REQUIRE(policy == isc_threadaffinity_none ||
+		policy == isc_threadaffinity_cpu ||
+		policy == isc_threadaffinity_node);
+
+	affinity_policy = policy;
+}
+
+#ifdef USE_NUMA_PLACEMENT
+#define NODE_DIR "/sys/devices/system/node"
+
+typedef struct placement {
+	int node;
+	int cpu;
+} placement_t;
+
+/*
+ * The CPUs the process may run on, sorted by NUMA node.
+ */
+static isc_once_t placement_once = ISC_ONCE_INIT;
+static const char *nodedir = NODE_DIR;
+static placement_t placements[CPU_SETSIZE];
+static unsigned int nplacements = 0;
+
+/*
+ * Record 'node' for the CPUs in a node's "cpulist" file, which
+ * holds ranges such as "0-7,16-23".
+ */
+static void
+read_cpulist(const char *path, int node, int *cpunode) {
+	FILE *fp;
+	int first, last, c;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		return;
+	}
+
+	while (fscanf(fp, "%d", &first) == 1) {
+		last = first;
+		c = fgetc(fp);
+		if (c == '-') {
+			if (fscanf(fp, "%d", &last) != 1) {
+				break;
+			}
+			c = fgetc(fp);
+		}
+		for (int cpu = ISC_MAX(first, 0);
+		     cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+			cpunode[cpu] = node;
+		}
+		if (c != ',') {
+			break;
+		}
+	}
+
+	(void)fclose(fp);
+}
+
+static int
+placement_cmp(const void *a, const void *b) {
+	const placement_t *pa = a, *pb = b;
+
+	if (pa->node != pb->node) {
+		return (pa->node < pb->node ? -1 : 1);
+	}
+	return (pa->cpu < pb->cpu ? -1 : pa->cpu > pb->cpu ? 1 : 0);
+}
+
+static void
+placement_init(void) {
+	static int cpunode[CPU_SETSIZE];
+	cpu_set_t allowed;
+	struct dirent *de;
+	DIR *dir;
+
+	memset(cpunode, 0, sizeof(cpunode));
+	nplacements = 0;
+
+	CPU_ZERO(&allowed);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(allowed),
+				   &allowed) != 0) {
+		return;
+	}
+
+	/*
+	 * Without NUMA information in sysfs, all CPUs are on node 0.
+	 */
+	dir = opendir(nodedir);
+	if (dir != NULL) {
+		while ((de = readdir(dir)) != NULL) {
+			char path[PATH_MAX];
+			unsigned int node;
+
+			if (sscanf(de->d_name, "node%u", &node) != 1) {
+				continue;
+			}
+			snprintf(path, sizeof(path), "%s/%s/cpulist", nodedir,
+				 de->d_name);
+			read_cpulist(path, (int)node, cpunode);
+		}
+		(void)closedir(dir);
+	}
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed)) {
+			placements[nplacements].node = cpunode[cpu];
+			placements[nplacements].cpu = cpu;
+			nplacements++;
+		}
+	}
+	qsort(placements, nplacements, sizeof(placements[0]), placement_cmp);
+}
+
+void
+isc__thread_setnodedir(const char *dir) {
+	REQUIRE(dir != NULL);
+
+	RUNTIME_CHECK(isc_once_do(&placement_once, placement_init) ==
+		      ISC_R_SUCCESS);
+	nodedir = dir;
+	placement_init();
+}
+
+int
+isc_thread_cpu(unsigned int index) {
+	RUNTIME_CHECK(isc_once_do(&placement_once, placement_init) ==
+		      ISC_R_SUCCESS);
+	if (nplacements == 0) {
+		return ((int)index);
+	}
+	return (placements[index % nplacements].cpu);
+}
+
+isc_result_t
+isc_thread_bind(unsigned int index) {
+	const placement_t *placement;
+	cpu_set_t set;
+
+	if (affinity_policy == isc_threadaffinity_none) {
+		return (ISC_R_SUCCESS);
+	}
+
+	RUNTIME_CHECK(isc_once_do(&placement_once, placement_init) ==
+		      ISC_R_SUCCESS);
+	if (nplacements == 0) {
+		return (isc_thread_setaffinity(index));
+	}
+
+	placement = &placements[index % nplacements];
+	if (affinity_policy == isc_threadaffinity_cpu) {
+		return (isc_thread_setaffinity(placement->cpu));
+	}
+
+	CPU_ZERO(&set);
+	for (unsigned int i = 0; i < nplacements; i++) {
+		if (placements[i].node == placement->node) {
+			CPU_SET(placements[i].cpu, &set);
+		}
+	}
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		return (ISC_R_FAILURE);
+	}
+	return (ISC_R_SUCCESS);
+}
+#else  /* ifdef USE_NUMA_PLACEMENT */
+void
+isc__thread_setnodedir(const char *dir) {
+	UNUSED(dir);
+}
+
+int
+isc_thread_cpu(unsigned int index) {
+	return ((int)index);
+}
+
+isc_result_t
+isc_thread_bind(unsigned int index) {
+	/*
+	 * Without NUMA information, binding to a node is binding to
+	 * a CPU.
+	 */
+	if (affinity_policy == isc_threadaffinity_none) {
+		return (ISC_R_SUCCESS);
+	}
+	return (isc_thread_setaffinity(index));
+}
+#endif /* ifdef USE_NUMA_PLACEMENT */
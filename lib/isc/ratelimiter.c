@@ -41,6 +41,7 @@ struct isc_ratelimiter {
 	isc_ratelimiter_state_t state;
 	isc_event_t shutdownevent;
 	ISC_LIST(isc_event_t) pending;
+	unsigned int npending;
 };
 
 #define ISC_RATELIMITEREVENT_SHUTDOWN (ISC_EVENTCLASS_RATELIMITER + 1)
@@ -157,6 +158,7 @@ isc_ratelimiter_enqueue(isc_ratelimiter_t *rl, isc_task_t *task,
 		} else {
 			ISC_LIST_APPEND(rl->pending, ev, ev_ratelink);
 		}
+		rl->npending++;
 	} else if (rl->state == isc_ratelimiter_idle) {
 		result = isc_timer_reset(rl->timer, isc_timertype_ticker, NULL,
 					 &rl->interval, false);
@@ -185,6 +187,7 @@ isc_ratelimiter_dequeue(isc_ratelimiter_t *rl, isc_event_t *event) {
 	LOCK(&rl->lock);
 	if (ISC_LINK_LINKED(event, ev_ratelink)) {
 		ISC_LIST_UNLINK(rl->pending, event, ev_ratelink);
+		rl->npending--;
 		event->ev_sender = NULL;
 	} else {
 		result = ISC_R_NOTFOUND;
@@ -193,6 +196,19 @@ isc_ratelimiter_dequeue(isc_ratelimiter_t *rl, isc_event_t *event) {
 	return (result);
 }
 
+unsigned int
+isc_ratelimiter_getpending(isc_ratelimiter_t *rl) {
+	unsigned int npending;
+
+	REQUIRE(rl != NULL);
+
+	LOCK(&rl->lock);
+	npending = rl->npending;
+	UNLOCK(&rl->lock);
+
+	return (npending);
+}
+
 static void
 ratelimiter_tick(isc_task_t *task, isc_event_t *event) {
 	isc_ratelimiter_t *rl = (isc_ratelimiter_t *)event->ev_arg;
@@ -213,6 +229,7 @@ ratelimiter_tick(isc_task_t *task, isc_event_t *event) {
 			 * There is work to do.  Let's do it after unlocking.
 			 */
 			ISC_LIST_UNLINK(rl->pending, p, ev_ratelink);
+			rl->npending--;
 		} else {
 			/*
 			 * No work left to do.  Stop the timer so that we don't
@@ -250,6 +267,7 @@ isc_ratelimiter_shutdown(isc_ratelimiter_t *rl) {
 		ev->ev_attributes |= ISC_EVENTATTR_CANCELED;
 		isc_task_send(task, &ev);
 	}
+	rl->npending = 0;
 	isc_timer_detach(&rl->timer);
 
 	/*
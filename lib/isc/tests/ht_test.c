@@ -195,7 +195,7 @@ test_ht_full(int bits, uintptr_t count) {
 }
 
 static void
-test_ht_iterator(void) {
+test_ht_iterator(int bits) {
 	isc_ht_t *ht = NULL;
 	isc_result_t result;
 	isc_ht_iter_t *iter = NULL;
@@ -205,7 +205,7 @@ test_ht_iterator(void) {
 	unsigned char key[16];
 	size_t tksize;
 
-	result = isc_ht_init(&ht, test_mctx, 16);
+	result = isc_ht_init(&ht, test_mctx, bits);
 	assert_int_equal(result, ISC_R_SUCCESS);
 	assert_non_null(ht);
 	for (i = 1; i <= count; i++) {
@@ -331,8 +331,202 @@ isc_ht_1(void **state) {
 static void
 isc_ht_iterator_test(void **state) {
 	UNUSED(state);
-	test_ht_iterator();
+	test_ht_iterator(16);
+}
+
+/* test hashtable iterator on a table that was grown from 1 bit */
+static void
+isc_ht_iterator_grow_test(void **state) {
+	UNUSED(state);
+	test_ht_iterator(1);
+}
+
+static void
+makekey(unsigned char *key, uintptr_t i) {
+	memset(key, 0, 16);
+	memmove(key, &i, sizeof(i));
+}
+
+static uint32_t
+walk(isc_ht_t *ht) {
+	isc_ht_iter_t *iter = NULL;
+	isc_result_t result;
+	uint32_t walked = 0;
+
+	result = isc_ht_iter_create(ht, &iter);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (result = isc_ht_iter_first(iter); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(iter))
+	{
+		walked++;
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	isc_ht_iter_destroy(&iter);
+
+	return (walked);
+}
+
+/* a table grows and shrinks while it is used and walked */
+static void
+isc_ht_resize_test(void **state) {
+	isc_ht_t *ht = NULL;
+	isc_ht_iter_t *iter = NULL;
+	isc_result_t result;
+	unsigned char key[16];
+	uintptr_t i, count = 100000;
+	uint32_t walked;
+
+	UNUSED(state);
+
+	result = isc_ht_init(&ht, test_mctx, 1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (i = 1; i <= count; i++) {
+		makekey(key, i);
+		result = isc_ht_add(ht, key, 16, (void *)i);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		/* Check the whole table at a few sizes, mid-rehash or not. */
+		if (i == 3 || i == 1000 || i == 1500 || i == 70000) {
+			assert_int_equal(walk(ht), i);
+		}
+	}
+	assert_int_equal(isc_ht_count(ht), count);
+
+	for (i = 1; i <= count; i++) {
+		void *f = NULL;
+		makekey(key, i);
+		result = isc_ht_find(ht, key, 16, &f);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_ptr_equal(f, (void *)i);
+	}
+
+	/*
+	 * Keys added while an iterator is positioned do not move the
+	 * nodes; every node that was there before is visited once.
+	 */
+	result = isc_ht_iter_create(ht, &iter);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	walked = 0;
+	i = count;
+	for (result = isc_ht_iter_first(iter); result == ISC_R_SUCCESS;
+	     result = isc_ht_iter_next(iter))
+	{
+		void *v = NULL;
+		isc_ht_iter_current(iter, &v);
+		if ((uintptr_t)v <= count) {
+			walked++;
+		}
+		if (i < 2 * count) {
+			i++;
+			makekey(key, i);
+			result = isc_ht_add(ht, key, 16, (void *)i);
+			assert_int_equal(result, ISC_R_SUCCESS);
+		}
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	assert_int_equal(walked, count);
+	isc_ht_iter_destroy(&iter);
+	assert_int_equal(isc_ht_count(ht), 2 * count);
+	assert_int_equal(walk(ht), 2 * count);
+
+	/* Shrink, checking the remaining nodes along the way. */
+	for (i = 1; i <= 2 * count; i++) {
+		makekey(key, i);
+		result = isc_ht_delete(ht, key, 16);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		if (i < 2 * count && (i % 20000 == 0 || i == 2 * count - 3)) {
+			void *f = NULL;
+			assert_int_equal(walk(ht), 2 * count - i);
+			makekey(key, i + 1);
+			result = isc_ht_find(ht, key, 16, &f);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			assert_ptr_equal(f, (void *)(i + 1));
+		}
+	}
+	assert_int_equal(isc_ht_count(ht), 0);
+	assert_int_equal(walk(ht), 0);
+
+	isc_ht_destroy(&ht);
+	assert_null(ht);
+}
+
+#if defined(ISC_BENCHMARK_TESTS)
+
+#include <isc/time.h>
+
+/*
+ * Add, find and delete 'count' keys, reporting the time taken by each.
+ */
+static void
+benchmark_ht(isc_mem_t *mctx, const char *desc, int bits, uintptr_t count) {
+	isc_ht_t *ht = NULL;
+	isc_result_t result;
+	unsigned char key[16];
+	isc_time_t ts1, ts2;
+	uint64_t add, find, del;
+	uintptr_t i;
+
+	result = isc_ht_init(&ht, mctx, bits);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_time_now(&ts1);
+	for (i = 0; i < count; i++) {
+		makekey(key, i);
+		result = isc_ht_add(ht, key, 16, (void *)i);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	isc_time_now(&ts2);
+	add = isc_time_microdiff(&ts2, &ts1);
+
+	isc_time_now(&ts1);
+	for (i = 0; i < count; i++) {
+		void *f = NULL;
+		makekey(key, i);
+		result = isc_ht_find(ht, key, 16, &f);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	isc_time_now(&ts2);
+	find = isc_time_microdiff(&ts2, &ts1);
+
+	isc_time_now(&ts1);
+	for (i = 0; i < count; i++) {
+		makekey(key, i);
+		result = isc_ht_delete(ht, key, 16);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	isc_time_now(&ts2);
+	del = isc_time_microdiff(&ts2, &ts1);
+
+	isc_ht_destroy(&ht);
+
+	printf("%s: %lu keys: add %0.3fs, find %0.3fs, delete %0.3fs\n", desc,
+	       (unsigned long)count, add / 1000000.0, find / 1000000.0,
+	       del / 1000000.0);
+}
+
+/* Benchmark a growing hashtable against presized ones */
+static void
+isc_ht_benchmark(void **state) {
+	isc_mem_t *mctx = NULL;
+	unsigned int debugging = isc_mem_debugging;
+
+	UNUSED(state);
+
+	/* Recording millions of allocations would dominate the run. */
+	isc_mem_debugging &= ~ISC_MEM_DEBUGRECORD;
+	isc_mem_create(&mctx);
+	isc_mem_debugging = debugging;
+
+	benchmark_ht(mctx, "presized 20 bits", 20, 1000000);
+	benchmark_ht(mctx, "grown from 4 bits", 4, 1000000);
+	benchmark_ht(mctx, "grown from 1 bit", 1, 1000000);
+	benchmark_ht(mctx, "presized 16 bits", 16, 200000);
+	benchmark_ht(mctx, "grown from 4 bits", 4, 200000);
+
+	isc_mem_destroy(&mctx);
 }
+#endif /* defined(ISC_BENCHMARK_TESTS) */
 
 int
 main(void) {
@@ -341,6 +535,11 @@ main(void) {
 		cmocka_unit_test(isc_ht_8),
 		cmocka_unit_test(isc_ht_1),
 		cmocka_unit_test(isc_ht_iterator_test),
+		cmocka_unit_test(isc_ht_iterator_grow_test),
+		cmocka_unit_test(isc_ht_resize_test),
+#if defined(ISC_BENCHMARK_TESTS)
+		cmocka_unit_test(isc_ht_benchmark),
+#endif /* defined(ISC_BENCHMARK_TESTS) */
 	};
 
 	return (cmocka_run_group_tests(tests, _setup, _teardown));
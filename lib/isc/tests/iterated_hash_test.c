@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/base32.h>
+#include <isc/buffer.h>
+#include <isc/iterated_hash.h>
+#include <isc/mem.h>
+#include <isc/util.h>
+#include <isc/workpool.h>
+
+#include "isctest.h"
+
+#define NITEMS 1000
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = isc_test_begin(NULL, true, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	isc_test_end();
+
+	return (0);
+}
+
+/*
+ * RFC 5155 Appendix A: "example", salt aabbccdd, 12 iterations.
+ */
+static const unsigned char example[] = { 7,   'e', 'x', 'a', 'm',
+					 'p', 'l', 'e', 0 };
+static const unsigned char salt[] = { 0xaa, 0xbb, 0xcc, 0xdd };
+static const char *example_hash = "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom";
+
+/* isc_iterated_hash() matches the RFC 5155 test vector */
+static void
+iterated_hash_test(void **state) {
+	unsigned char hash[NSEC3_MAX_HASH_LENGTH];
+	unsigned char expect[NSEC3_MAX_HASH_LENGTH];
+	isc_buffer_t b;
+	isc_result_t result;
+	int len;
+
+	UNUSED(state);
+
+	isc_buffer_init(&b, expect, sizeof(expect));
+	result = isc_base32hexnp_decodestring(example_hash, &b);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	len = isc_iterated_hash(hash, 1, 12, salt, sizeof(salt), example,
+				sizeof(example));
+	assert_int_equal(len, isc_buffer_usedlength(&b));
+	assert_memory_equal(hash, expect, len);
+
+	/* Unknown algorithm. */
+	len = isc_iterated_hash(hash, 2, 12, salt, sizeof(salt), example,
+				sizeof(example));
+	assert_int_equal(len, 0);
+}
+
+/* isc_iterated_hash_batch() matches isc_iterated_hash() */
+static void
+iterated_hash_batch_test(void **state) {
+	isc_iterated_hash_item_t *items;
+	unsigned char (*names)[16];
+	unsigned char hash[NSEC3_MAX_HASH_LENGTH];
+	isc_workpool_t *pool = NULL;
+	size_t i;
+	int len;
+
+	UNUSED(state);
+
+	items = isc_mem_get(test_mctx, NITEMS * sizeof(*items));
+	names = isc_mem_get(test_mctx, NITEMS * sizeof(*names));
+
+	for (i = 0; i < NITEMS; i++) {
+		int n = snprintf((char *)names[i] + 1, sizeof(names[i]) - 1,
+				 "h%zu", i);
+		names[i][0] = n;
+		items[i].in = names[i];
+		items[i].inlength = n + 1;
+	}
+
+	isc_workpool_create(test_mctx, 3, &pool);
+	isc_iterated_hash_batch(pool, 1, 5, salt, sizeof(salt), items,
+				NITEMS);
+	isc_workpool_detach(&pool);
+
+	for (i = 0; i < NITEMS; i++) {
+		len = isc_iterated_hash(hash, 1, 5, salt, sizeof(salt),
+					items[i].in, items[i].inlength);
+		assert_int_equal(items[i].outlength, len);
+		assert_memory_equal(items[i].out, hash, len);
+	}
+
+	/* Without a pool, and with an unknown algorithm. */
+	isc_iterated_hash_batch(NULL, 1, 0, NULL, 0, items, NITEMS);
+	len = isc_iterated_hash(hash, 1, 0, NULL, 0, items[7].in,
+				items[7].inlength);
+	assert_int_equal(items[7].outlength, len);
+	assert_memory_equal(items[7].out, hash, len);
+
+	isc_iterated_hash_batch(NULL, 2, 0, NULL, 0, items, NITEMS);
+	for (i = 0; i < NITEMS; i++) {
+		assert_int_equal(items[i].outlength, 0);
+	}
+
+	isc_mem_put(test_mctx, names, NITEMS * sizeof(*names));
+	isc_mem_put(test_mctx, items, NITEMS * sizeof(*items));
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(iterated_hash_test),
+		cmocka_unit_test(iterated_hash_batch_test),
+	};
+
+	return (cmocka_run_group_tests(tests, _setup, _teardown));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/* ! \file */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/atomic.h>
+#include <isc/netmgr.h>
+#include <isc/sockaddr.h>
+#include <isc/util.h>
+
+#include "isctest.h"
+
+#define NWORKERS 4
+#define NCLIENTS 64
+
+static isc_nm_t *nm = NULL;
+static isc_sockaddr_t listenaddr;
+static atomic_uint_fast32_t received;
+
+static int
+_setup(void **state) {
+	struct sockaddr_in sin;
+	socklen_t len = sizeof(sin);
+	isc_result_t result;
+	int fd;
+
+	UNUSED(state);
+
+	result = isc_test_begin(NULL, false, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	nm = isc_nm_start(test_mctx, NWORKERS);
+	assert_non_null(nm);
+	atomic_init(&received, 0);
+
+	/*
+	 * Find a free port on the loopback address.
+	 */
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	assert_true(fd >= 0);
+	assert_int_equal(bind(fd, (struct sockaddr *)&sin, sizeof(sin)), 0);
+	assert_int_equal(getsockname(fd, (struct sockaddr *)&sin, &len), 0);
+	close(fd);
+	isc_sockaddr_fromin(&listenaddr, &sin.sin_addr, ntohs(sin.sin_port));
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	isc_nm_destroy(&nm);
+	isc_test_end();
+
+	return (0);
+}
+
+static void
+recv_cb(isc_nmhandle_t *handle, isc_region_t *region, void *cbarg) {
+	UNUSED(handle);
+	UNUSED(region);
+	UNUSED(cbarg);
+
+	atomic_fetch_add(&received, 1);
+}
+
+/*
+ * Listen on 'listenaddr', send one packet from each of NCLIENTS
+ * sockets, and return how many packets each worker received in
+ * 'counts'.
+ */
+static void
+sendpackets(uint64_t counts[NWORKERS]) {
+	isc_nmsocket_t *listener = NULL;
+	uint64_t total;
+	isc_result_t result;
+	int i;
+
+	result = isc_nm_listenudp(nm, (isc_nmiface_t *)&listenaddr, recv_cb,
+				  NULL, 0, &listener);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (i = 0; i < NCLIENTS; i++) {
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		assert_true(fd >= 0);
+		assert_int_equal(sendto(fd, "x", 1, 0, &listenaddr.type.sa,
+					listenaddr.length),
+				 1);
+		close(fd);
+	}
+
+	for (i = 0; i < 500 && atomic_load(&received) < NCLIENTS; i++) {
+		isc_test_nap(10000);
+	}
+	assert_int_equal(atomic_load(&received), NCLIENTS);
+
+	assert_int_equal(isc_nm_pktcounts(nm, counts, NWORKERS), NWORKERS);
+	total = 0;
+	for (i = 0; i < NWORKERS; i++) {
+		total += counts[i];
+	}
+	assert_int_equal(total, NCLIENTS);
+
+	isc_nm_stoplistening(listener);
+	isc_nmsocket_detach(&listener);
+}
+
+/*
+ * Every worker gets some of the packets when they are spread by the
+ * kernel's hash of the source port.
+ */
+static void
+checkspread(void) {
+	uint64_t counts[NWORKERS];
+
+	sendpackets(counts);
+	for (int i = 0; i < NWORKERS; i++) {
+		assert_true(counts[i] > 0);
+	}
+}
+
+/* UDP packets are spread over all workers by default */
+static void
+udp_hash_test(void **state) {
+	UNUSED(state);
+
+	checkspread();
+}
+
+/* all workers still receive when the steering program is refused */
+static void
+udp_cbpf_fail_test(void **state) {
+	UNUSED(state);
+
+	isc_nm_setudpsteering(nm, isc_nm_udpsteer_prefix);
+	isc__nm_setcbpf(nm, isc__nm_cbpf_fail);
+	checkspread();
+}
+
+/* all workers still receive without SO_ATTACH_REUSEPORT_CBPF */
+static void
+udp_cbpf_unavailable_test(void **state) {
+	UNUSED(state);
+
+	isc_nm_setudpsteering(nm, isc_nm_udpsteer_prefix);
+	isc__nm_setcbpf(nm, isc__nm_cbpf_unavailable);
+	checkspread();
+}
+
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+/* with prefix steering, all packets from 127.0.0.0/24 go to one worker */
+static void
+udp_cbpf_prefix_test(void **state) {
+	uint64_t counts[NWORKERS];
+	int busy = 0;
+
+	UNUSED(state);
+
+	isc_nm_setudpsteering(nm, isc_nm_udpsteer_prefix);
+	sendpackets(counts);
+	for (int i = 0; i < NWORKERS; i++) {
+		if (counts[i] > 0) {
+			assert_int_equal(counts[i], NCLIENTS);
+			busy++;
+		}
+	}
+	assert_int_equal(busy, 1);
+}
+#endif /* if defined(SO_ATTACH_REUSEPORT_CBPF) */
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(udp_hash_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(udp_cbpf_fail_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(udp_cbpf_unavailable_test,
+						_setup, _teardown),
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+		cmocka_unit_test_setup_teardown(udp_cbpf_prefix_test, _setup,
+						_teardown),
+#endif /* if defined(SO_ATTACH_REUSEPORT_CBPF) */
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
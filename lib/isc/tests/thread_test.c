@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/* ! \file */
+
+#if HAVE_CMOCKA && defined(__linux__) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/string.h>
+#include <isc/thread.h>
+#include <isc/util.h>
+
+#define NODEDIR "thread_test.nodes"
+
+/*
+ * The CPUs the process may run on, in ascending order.
+ */
+static int cpus[CPU_SETSIZE];
+static int ncpus = 0;
+
+static int
+_setup(void **state) {
+	cpu_set_t allowed;
+
+	UNUSED(state);
+
+	CPU_ZERO(&allowed);
+	assert_int_equal(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+	ncpus = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed)) {
+			cpus[ncpus++] = cpu;
+		}
+	}
+	assert_true(ncpus > 0);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	(void)isc_file_remove(NODEDIR "/node0/cpulist");
+	(void)isc_file_remove(NODEDIR "/node1/cpulist");
+	(void)isc_file_remove(NODEDIR "/possible");
+	(void)rmdir(NODEDIR "/node0");
+	(void)rmdir(NODEDIR "/node1");
+	(void)rmdir(NODEDIR);
+
+	isc__thread_setnodedir("/sys/devices/system/node");
+	isc_thread_setaffinitypolicy(isc_threadaffinity_cpu);
+
+	return (0);
+}
+
+typedef struct {
+	unsigned int index;
+	isc_result_t result;
+	cpu_set_t set;
+} bindarg_t;
+
+static isc_threadresult_t
+bindthread(isc_threadarg_t arg) {
+	bindarg_t *ba = arg;
+
+	ba->result = isc_thread_bind(ba->index);
+	CPU_ZERO(&ba->set);
+	(void)pthread_getaffinity_np(pthread_self(), sizeof(ba->set),
+				     &ba->set);
+
+	return ((isc_threadresult_t)0);
+}
+
+/*
+ * Bind a new thread as worker 'index', and return the CPUs it is then
+ * allowed to run on in 'set'.
+ */
+static void
+bindworker(unsigned int index, cpu_set_t *set) {
+	isc_thread_t thread;
+	bindarg_t ba;
+
+	ba.index = index;
+	ba.result = ISC_R_UNSET;
+	isc_thread_create(bindthread, &ba, &thread);
+	isc_thread_join(thread, NULL);
+
+	assert_int_equal(ba.result, ISC_R_SUCCESS);
+	*set = ba.set;
+}
+
+static void
+writecpulist(const char *node, const int *list, int n, bool ranges) {
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), NODEDIR "/%s", node);
+	assert_int_equal(mkdir(path, 0700), 0);
+	strlcat(path, "/cpulist", sizeof(path));
+	fp = fopen(path, "w");
+	assert_non_null(fp);
+	for (int i = 0; i < n; i++) {
+		if (ranges) {
+			fprintf(fp, "%s%d-%d", i > 0 ? "," : "", list[i],
+				list[i]);
+		} else {
+			fprintf(fp, "%s%d", i > 0 ? "," : "", list[i]);
+		}
+	}
+	fprintf(fp, "\n");
+	assert_int_equal(fclose(fp), 0);
+}
+
+/* without a NUMA node directory, all CPUs are placed on one node */
+static void
+nonode_test(void **state) {
+	cpu_set_t set;
+
+	UNUSED(state);
+
+	isc__thread_setnodedir(NODEDIR "/missing");
+
+	for (int i = 0; i < 2 * ncpus; i++) {
+		assert_int_equal(isc_thread_cpu(i), cpus[i % ncpus]);
+	}
+
+	isc_thread_setaffinitypolicy(isc_threadaffinity_cpu);
+	for (int i = 0; i < ncpus + 1; i++) {
+		bindworker(i, &set);
+		assert_int_equal(CPU_COUNT(&set), 1);
+		assert_true(CPU_ISSET(cpus[i % ncpus], &set));
+	}
+
+	isc_thread_setaffinitypolicy(isc_threadaffinity_node);
+	bindworker(ncpus, &set);
+	assert_int_equal(CPU_COUNT(&set), ncpus);
+	for (int i = 0; i < ncpus; i++) {
+		assert_true(CPU_ISSET(cpus[i], &set));
+	}
+}
+
+/* CPUs are placed in NUMA node order, and bound to their node */
+static void
+nodes_test(void **state) {
+	int half = (ncpus + 1) / 2;
+	cpu_set_t set;
+	FILE *fp;
+
+	UNUSED(state);
+
+	/*
+	 * The lower half of the CPUs are on node 1, the others on node 0.
+	 */
+	assert_int_equal(mkdir(NODEDIR, 0700), 0);
+	writecpulist("node0", cpus + half, ncpus - half, false);
+	writecpulist("node1", cpus, half, true);
+	fp = fopen(NODEDIR "/possible", "w");
+	assert_non_null(fp);
+	assert_int_equal(fclose(fp), 0);
+
+	isc__thread_setnodedir(NODEDIR);
+
+	for (int i = 0; i < ncpus; i++) {
+		int expect = (i < ncpus - half) ? cpus[half + i]
+						: cpus[i - (ncpus - half)];
+		assert_int_equal(isc_thread_cpu(i), expect);
+	}
+
+	/*
+	 * The last worker is on node 1 with the first 'half' CPUs.
+	 */
+	isc_thread_setaffinitypolicy(isc_threadaffinity_node);
+	bindworker(ncpus - 1, &set);
+	assert_int_equal(CPU_COUNT(&set), half);
+	for (int i = 0; i < half; i++) {
+		assert_true(CPU_ISSET(cpus[i], &set));
+	}
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(nonode_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(nodes_test, _setup, _teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA && __linux__ && HAVE_PTHREAD_SETAFFINITY_NP */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available, or not Linux\n");
+	return (0);
+}
+
+#endif /* HAVE_CMOCKA && __linux__ && HAVE_PTHREAD_SETAFFINITY_NP */
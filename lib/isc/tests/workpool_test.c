@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/* ! \file */
+
+#if HAVE_CMOCKA
+
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/atomic.h>
+#include <isc/mem.h>
+#include <isc/util.h>
+#include <isc/workpool.h>
+
+#include "isctest.h"
+
+#define NITEMS 10000
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+
+	UNUSED(state);
+
+	result = isc_test_begin(NULL, true, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	isc_test_end();
+
+	return (0);
+}
+
+struct batch {
+	unsigned int seen[NITEMS];
+	atomic_uint_fast32_t calls;
+};
+
+static void
+work(void *arg, size_t index) {
+	struct batch *batch = arg;
+
+	batch->seen[index]++;
+	atomic_fetch_add(&batch->calls, 1);
+}
+
+static void
+run_and_check(isc_workpool_t *pool, size_t count) {
+	struct batch *batch;
+	size_t i;
+
+	batch = isc_mem_get(test_mctx, sizeof(*batch));
+	memset(batch->seen, 0, sizeof(batch->seen));
+	atomic_init(&batch->calls, 0);
+
+	isc_workpool_run(pool, count, work, batch);
+
+	assert_int_equal(atomic_load(&batch->calls), count);
+	for (i = 0; i < count; i++) {
+		assert_int_equal(batch->seen[i], 1);
+	}
+
+	isc_mem_put(test_mctx, batch, sizeof(*batch));
+}
+
+/* each index of a batch is processed exactly once */
+static void
+run_test(void **state) {
+	isc_workpool_t *pool = NULL;
+	int i;
+
+	UNUSED(state);
+
+	isc_workpool_create(test_mctx, 4, &pool);
+	assert_non_null(pool);
+	assert_int_equal(isc_workpool_size(pool), 5);
+
+	for (i = 0; i < 50; i++) {
+		run_and_check(pool, NITEMS);
+	}
+	run_and_check(pool, 1);
+	run_and_check(pool, 0);
+
+	isc_workpool_detach(&pool);
+	assert_null(pool);
+}
+
+/* a NULL pool or a pool without workers runs batches inline */
+static void
+inline_test(void **state) {
+	isc_workpool_t *pool = NULL;
+
+	UNUSED(state);
+
+	assert_int_equal(isc_workpool_size(NULL), 1);
+	run_and_check(NULL, NITEMS);
+
+	isc_workpool_create(test_mctx, 0, &pool);
+	assert_int_equal(isc_workpool_size(pool), 1);
+	run_and_check(pool, NITEMS);
+	isc_workpool_detach(&pool);
+}
+
+/* the pool stays alive until the last reference is dropped */
+static void
+attach_test(void **state) {
+	isc_workpool_t *pool = NULL, *pool2 = NULL;
+
+	UNUSED(state);
+
+	isc_workpool_create(test_mctx, 2, &pool);
+	isc_workpool_attach(pool, &pool2);
+	isc_workpool_detach(&pool);
+	assert_null(pool);
+
+	run_and_check(pool2, NITEMS);
+	isc_workpool_detach(&pool2);
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(run_test, _setup, _teardown),
+		cmocka_unit_test_setup_teardown(inline_test, _setup,
+						_teardown),
+		cmocka_unit_test_setup_teardown(attach_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+
+#else /* HAVE_CMOCKA */
+
+#include <stdio.h>
+
+int
+main(void) {
+	printf("1..0 # Skipped: cmocka not available\n");
+	return (0);
+}
+
+#endif /* if HAVE_CMOCKA */
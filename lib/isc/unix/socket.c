@@ -3371,7 +3371,7 @@ netthread(void *uap) {
 	bool done;
 	int cc;
 	if (manager->nthreads > 1) {
-		isc_thread_setaffinity(thread->threadid);
+		isc_thread_bind(thread->threadid);
 	}
 #ifdef USE_KQUEUE
 	const char *fnname = "kevent()";
@@ -70,3 +70,25 @@ isc_thread_setaffinity(int cpu) {
 	/* no-op on Windows for now */
 	return (ISC_R_SUCCESS);
 }
+
+void
+isc_thread_setaffinitypolicy(isc_threadaffinity_t policy) {
+	UNUSED(policy);
+}
+
+isc_result_t
+isc_thread_bind(unsigned int index) {
+	/* no-op on Windows for now */
+	UNUSED(index);
+	return (ISC_R_SUCCESS);
+}
+
+int
+isc_thread_cpu(unsigned int index) {
+	return ((int)index);
+}
+
+void
+isc__thread_setnodedir(const char *dir) {
+	UNUSED(dir);
+}
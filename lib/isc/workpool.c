@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <isc/atomic.h>
+#include <isc/condition.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/refcount.h>
+#include <isc/thread.h>
+#include <isc/util.h>
+#include <isc/workpool.h>
+
+#define WORKPOOL_MAGIC	  ISC_MAGIC('W', 'r', 'k', 'P')
+#define VALID_WORKPOOL(p) ISC_MAGIC_VALID(p, WORKPOOL_MAGIC)
+
+struct isc_workpool {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	unsigned int nworkers;
+	isc_thread_t *threads;
+
+	/*% Serializes batches. */
+	isc_mutex_t runlock;
+
+	/*% Locks the fields below. */
+	isc_mutex_t lock;
+	isc_condition_t wakeup;
+	isc_condition_t done;
+	bool exiting;
+	uint64_t generation;
+	unsigned int pending;
+
+	/*% The current batch. */
+	isc_workfunc_t func;
+	void *arg;
+	size_t count;
+	atomic_uint_fast64_t next;
+};
+
+static void
+run_batch(isc_workpool_t *pool) {
+	for (;;) {
+		size_t i = (size_t)atomic_fetch_add_relaxed(&pool->next, 1);
+		if (i >= pool->count) {
+			break;
+		}
+		pool->func(pool->arg, i);
+	}
+}
+
+static isc_threadresult_t
+worker(isc_threadarg_t arg) {
+	isc_workpool_t *pool = (isc_workpool_t *)arg;
+	uint64_t seen = 0;
+
+	LOCK(&pool->lock);
+	for (;;) {
+		while (!pool->exiting && pool->generation == seen) {
+			WAIT(&pool->wakeup, &pool->lock);
+		}
+		if (pool->exiting) {
+			break;
+		}
+		seen = pool->generation;
+		UNLOCK(&pool->lock);
+
+		run_batch(pool);
+
+		LOCK(&pool->lock);
+		INSIST(pool->pending > 0);
+		if (--pool->pending == 0) {
+			SIGNAL(&pool->done);
+		}
+	}
+	UNLOCK(&pool->lock);
+
+	return ((isc_threadresult_t)0);
+}
+
+void
+isc_workpool_create(isc_mem_t *mctx, unsigned int nworkers,
+		    isc_workpool_t **poolp) {
+	isc_workpool_t *pool;
+	unsigned int i;
+
+	REQUIRE(poolp != NULL && *poolp == NULL);
+
+	pool = isc_mem_get(mctx, sizeof(*pool));
+	*pool = (isc_workpool_t){ .nworkers = nworkers };
+
+	isc_mem_attach(mctx, &pool->mctx);
+	isc_refcount_init(&pool->references, 1);
+	isc_mutex_init(&pool->runlock);
+	isc_mutex_init(&pool->lock);
+	isc_condition_init(&pool->wakeup);
+	isc_condition_init(&pool->done);
+	atomic_init(&pool->next, 0);
+
+	if (nworkers > 0) {
+		pool->threads = isc_mem_get(mctx,
+					    nworkers * sizeof(isc_thread_t));
+		for (i = 0; i < nworkers; i++) {
+			char name[21];
+			isc_thread_create(worker, pool, &pool->threads[i]);
+			snprintf(name, sizeof(name), "isc-work-%04u", i);
+			isc_thread_setname(pool->threads[i], name);
+		}
+	}
+
+	pool->magic = WORKPOOL_MAGIC;
+	*poolp = pool;
+}
+
+void
+isc_workpool_run(isc_workpool_t *pool, size_t count, isc_workfunc_t func,
+		 void *arg) {
+	size_t i;
+
+	REQUIRE(pool == NULL || VALID_WORKPOOL(pool));
+	REQUIRE(func != NULL);
+
+	if (pool == NULL || pool->nworkers == 0 || count < 2 ||
+	    isc_mutex_trylock(&pool->runlock) != ISC_R_SUCCESS)
+	{
+		for (i = 0; i < count; i++) {
+			func(arg, i);
+		}
+		return;
+	}
+
+	LOCK(&pool->lock);
+	pool->func = func;
+	pool->arg = arg;
+	pool->count = count;
+	atomic_store_relaxed(&pool->next, 0);
+	pool->pending = pool->nworkers;
+	pool->generation++;
+	BROADCAST(&pool->wakeup);
+	UNLOCK(&pool->lock);
+
+	run_batch(pool);
+
+	/*
+	 * Every worker checks in for every batch, so none of them can
+	 * still be looking at this batch once we return.
+	 */
+	LOCK(&pool->lock);
+	while (pool->pending > 0) {
+		WAIT(&pool->done, &pool->lock);
+	}
+	pool->func = NULL;
+	pool->arg = NULL;
+	UNLOCK(&pool->lock);
+
+	UNLOCK(&pool->runlock);
+}
+
+unsigned int
+isc_workpool_size(isc_workpool_t *pool) {
+	REQUIRE(pool == NULL || VALID_WORKPOOL(pool));
+
+	if (pool == NULL) {
+		return (1);
+	}
+	return (pool->nworkers + 1);
+}
+
+void
+isc_workpool_attach(isc_workpool_t *source, isc_workpool_t **targetp) {
+	REQUIRE(VALID_WORKPOOL(source));
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+	isc_refcount_increment(&source->references);
+
+	*targetp = source;
+}
+
+void
+isc_workpool_detach(isc_workpool_t **poolp) {
+	isc_workpool_t *pool;
+	unsigned int i;
+
+	REQUIRE(poolp != NULL && VALID_WORKPOOL(*poolp));
+
+	pool = *poolp;
+	*poolp = NULL;
+
+	if (isc_refcount_decrement(&pool->references) > 1) {
+		return;
+	}
+
+	isc_refcount_destroy(&pool->references);
+	pool->magic = 0;
+
+	LOCK(&pool->lock);
+	pool->exiting = true;
+	BROADCAST(&pool->wakeup);
+	UNLOCK(&pool->lock);
+
+	for (i = 0; i < pool->nworkers; i++) {
+		isc_thread_join(pool->threads[i], NULL);
+	}
+	if (pool->threads != NULL) {
+		isc_mem_put(pool->mctx, pool->threads,
+			    pool->nworkers * sizeof(isc_thread_t));
+	}
+
+	(void)isc_condition_destroy(&pool->done);
+	(void)isc_condition_destroy(&pool->wakeup);
+	isc_mutex_destroy(&pool->lock);
+	isc_mutex_destroy(&pool->runlock);
+	isc_mem_putanddetach(&pool->mctx, pool, sizeof(*pool));
+}
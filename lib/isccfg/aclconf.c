@@ -637,7 +637,7 @@ cfg_acl_fromconfig2(const cfg_obj_t *caml, const cfg_obj_t *cctx,
 	const cfg_listelt_t *elt;
 	dns_iptable_t *iptab;
 	int new_nest_level = 0;
-	bool setpos;
+	bool setpos, compile = false;
 
 	if (nest_level != 0) {
 		new_nest_level = nest_level - 1;
@@ -678,6 +678,7 @@ cfg_acl_fromconfig2(const cfg_obj_t *caml, const cfg_obj_t *cctx,
 		if (result != ISC_R_SUCCESS) {
 			return (result);
 		}
+		compile = (nest_level == 0);
 	}
 
 	de = dacl->elements;
@@ -915,6 +916,14 @@ cfg_acl_fromconfig2(const cfg_obj_t *caml, const cfg_obj_t *cctx,
 		INSIST(dacl->length <= dacl->alloc);
 	}
 
+	/*
+	 * Top-level ACLs are not modified once they have been built, so
+	 * compile their IP tables for faster matching.
+	 */
+	if (compile) {
+		dns_iptable_compile(dacl->iptable);
+	}
+
 	dns_acl_attach(dacl, target);
 	result = ISC_R_SUCCESS;
 
@@ -103,6 +103,12 @@ cfg_parser_setflags(cfg_parser_t *pctx, unsigned int flags, bool turn_on);
  * If 'turn_on' is 'true' the flags will be set, otherwise the flags will
  * be cleared.
  *
+ * While CFG_PCTX_ARENA is set, configuration objects are carved out of
+ * large blocks owned by the parser instead of being allocated one by
+ * one, and identical strings are stored only once.  Such objects stay
+ * valid until the parser itself is destroyed, so the parser must
+ * outlive every configuration it has parsed in this mode.
+ *
  * Requires:
  *\li 	"pctx" is not NULL.
  */
@@ -120,6 +126,26 @@ cfg_parser_setcallback(cfg_parser_t *pctx, cfg_parsecallback_t callback,
  * callback==NULL and arg==NULL.
  */
 
+void
+cfg_parser_setstreaming(cfg_parser_t *pctx, const char *clausename,
+			cfg_parsecallback_t callback, void *arg);
+/*%<
+ * Make the parser pass each value of the multi-valued clause
+ * 'clausename' (for example "zone") to 'callback' as soon as it
+ * has been parsed, in whatever map it appears.  The value is
+ * destroyed when the callback returns and is not added to the
+ * parse tree, so that configurations with a very large number
+ * of such clauses can be processed in bounded memory.  If the
+ * callback returns an error, parsing stops with that error.
+ *
+ * To restore the default of building the complete parse tree,
+ * pass clausename==NULL, callback==NULL and arg==NULL.
+ *
+ * Requires:
+ *\li	"pctx" is not NULL.
+ *\li	"clausename" is NULL if and only if "callback" is NULL.
+ */
+
 isc_result_t
 cfg_parse_file(cfg_parser_t *pctx, const char *file, const cfg_type_t *type,
 	       cfg_obj_t **ret);
@@ -150,7 +176,8 @@ cfg_parse_buffer(cfg_parser_t *pctx, isc_buffer_t *buffer, const char *file,
  *\li 	"mem" is valid.
  *\li	"type" is valid.
  *\li 	"cfg" is non-NULL and "*cfg" is NULL.
- *\li   "flags" be one or more of CFG_PCTX_NODEPRECATED or zero.
+ *\li   "flags" be one or more of CFG_PCTX_NODEPRECATED and
+ *      CFG_PCTX_ARENA, or zero.
  *
  * Returns:
  *     \li #ISC_R_SUCCESS                 - success
@@ -192,6 +192,16 @@ struct cfg_rep {
 
 struct cfg_obj {
 	const cfg_type_t *type;
+	isc_refcount_t	  references; /*%< reference counter */
+	const char *	  file;
+	unsigned int	  line;
+	bool		  arena; /*%< allocated from the parser arena */
+	cfg_parser_t *	  pctx;
+	/*%
+	 * The value comes last: objects allocated from the parser
+	 * arena only have room for the member their representation
+	 * uses.
+	 */
 	union {
 		uint32_t	 uint32;
 		uint64_t	 uint64;
@@ -208,10 +218,6 @@ struct cfg_obj {
 		cfg_netprefix_t netprefix;
 		cfg_duration_t	duration;
 	} value;
-	isc_refcount_t references; /*%< reference counter */
-	const char *   file;
-	unsigned int   line;
-	cfg_parser_t * pctx;
 };
 
 /*% A list element. */
@@ -279,11 +285,28 @@ struct cfg_parser {
 
 	cfg_parsecallback_t callback;
 	void *		    callbackarg;
+
+	/*%
+	 * Multi-valued clause whose values are passed to
+	 * 'streamcallback' and discarded instead of being
+	 * added to the parse tree.
+	 */
+	const char *	    streamclause;
+	cfg_parsecallback_t streamcallback;
+	void *		    streamarg;
+
+	/*%
+	 * Memory used for configuration objects while
+	 * CFG_PCTX_ARENA is set; released when the parser
+	 * is destroyed.
+	 */
+	struct cfg_arena *arena;
 };
 
 /* Parser context flags */
 #define CFG_PCTX_SKIP	      0x1
 #define CFG_PCTX_NODEPRECATED 0x2
+#define CFG_PCTX_ARENA	      0x4
 
 /*@{*/
 /*%
@@ -362,6 +385,10 @@ cfg_ungettoken(cfg_parser_t *pctx);
 isc_result_t
 cfg_create_obj(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **objp);
 
+isc_result_t
+cfg_create_string(cfg_parser_t *pctx, const char *contents,
+		  const cfg_type_t *type, cfg_obj_t **objp);
+
 void
 cfg_print_rawuint(cfg_printer_t *pctx, unsigned int u);
 
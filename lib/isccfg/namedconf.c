@@ -363,15 +363,8 @@ parse_updatepolicy(cfg_parser_t *pctx, const cfg_type_t *type,
 	if (pctx->token.type == isc_tokentype_string &&
 	    strcasecmp(TOKEN_STRING(pctx), "local") == 0)
 	{
-		cfg_obj_t *obj = NULL;
-		CHECK(cfg_create_obj(pctx, &cfg_type_ustring, &obj));
-		obj->value.string.length = strlen("local");
-		obj->value.string.base =
-			isc_mem_get(pctx->mctx, obj->value.string.length + 1);
-		memmove(obj->value.string.base, "local", 5);
-		obj->value.string.base[5] = '\0';
-		*ret = obj;
-		return (ISC_R_SUCCESS);
+		return (cfg_create_string(pctx, "local", &cfg_type_ustring,
+					  ret));
 	}
 
 	cfg_ungettoken(pctx);
@@ -668,6 +661,12 @@ static cfg_type_t cfg_type_dnssecupdatemode = {
 	cfg_doc_enum,	    &cfg_rep_string, &dnssecupdatemode_enums
 };
 
+static const char *udpsteering_enums[] = { "cpu", "hash", "prefix", NULL };
+static cfg_type_t cfg_type_udpsteering = {
+	"udpsteering", cfg_parse_enum,	cfg_print_ustring,
+	cfg_doc_enum,  &cfg_rep_string, &udpsteering_enums
+};
+
 static const char *updatemethods_enums[] = { "date", "increment", "unixtime",
 					     NULL };
 static cfg_type_t cfg_type_updatemethod = {
@@ -1228,6 +1227,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "transfers-out", &cfg_type_uint32, 0 },
 	{ "transfers-per-ns", &cfg_type_uint32, 0 },
 	{ "treat-cr-as-space", &cfg_type_boolean, CFG_CLAUSEFLAG_ANCIENT },
+	{ "udp-steering", &cfg_type_udpsteering, 0 },
 	{ "use-id-pool", &cfg_type_boolean, CFG_CLAUSEFLAG_ANCIENT },
 	{ "use-ixfr", &cfg_type_boolean, CFG_CLAUSEFLAG_OBSOLETE },
 	{ "use-v4-udp-ports", &cfg_type_bracketed_portlist, 0 },
@@ -1936,10 +1936,12 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "attach-cache", &cfg_type_astring, 0 },
 	{ "auth-nxdomain", &cfg_type_boolean, CFG_CLAUSEFLAG_NEWDEFAULT },
 	{ "cache-file", &cfg_type_qstring, 0 },
+	{ "cache-file-interval", &cfg_type_duration, 0 },
 	{ "catalog-zones", &cfg_type_catz, 0 },
 	{ "check-names", &cfg_type_checknames, CFG_CLAUSEFLAG_MULTI },
 	{ "cleaning-interval", &cfg_type_uint32, CFG_CLAUSEFLAG_OBSOLETE },
 	{ "clients-per-query", &cfg_type_uint32, 0 },
+	{ "coalesce-fetches", &cfg_type_boolean, 0 },
 	{ "deny-answer-addresses", &cfg_type_denyaddresses, 0 },
 	{ "deny-answer-aliases", &cfg_type_denyaliases, 0 },
 	{ "disable-algorithms", &cfg_type_disablealgorithm,
@@ -2030,6 +2032,8 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "request-nsid", &cfg_type_boolean, 0 },
 	{ "request-sit", &cfg_type_boolean, CFG_CLAUSEFLAG_OBSOLETE },
 	{ "require-server-cookie", &cfg_type_boolean, 0 },
+	{ "resolver-hedge-budget", &cfg_type_uint32, 0 },
+	{ "resolver-hedge-percentile", &cfg_type_uint32, 0 },
 	{ "resolver-nonbackoff-tries", &cfg_type_uint32, 0 },
 	{ "resolver-query-timeout", &cfg_type_uint32, 0 },
 	{ "resolver-retry-interval", &cfg_type_uint32, 0 },
@@ -2149,6 +2153,8 @@ static cfg_clausedef_t zone_clauses[] = {
 	{ "dnssec-secure-to-insecure", &cfg_type_boolean, CFG_ZONE_MASTER },
 	{ "dnssec-update-mode", &cfg_type_dnssecupdatemode,
 	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE },
+	{ "dump-delta-ratio", &cfg_type_percentage,
+	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE | CFG_ZONE_MIRROR },
 	{ "forward", &cfg_type_forwardtype,
 	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE | CFG_ZONE_STUB |
 		  CFG_ZONE_STATICSTUB | CFG_ZONE_FORWARD },
@@ -2157,6 +2163,8 @@ static cfg_clausedef_t zone_clauses[] = {
 		  CFG_ZONE_STATICSTUB | CFG_ZONE_FORWARD },
 	{ "inline-signing", &cfg_type_boolean,
 	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE },
+	{ "journal-compact-idle", &cfg_type_duration,
+	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE | CFG_ZONE_MIRROR },
 	{ "key-directory", &cfg_type_qstring,
 	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE },
 	{ "maintain-ixfr-base", &cfg_type_boolean, CFG_CLAUSEFLAG_ANCIENT },
@@ -2228,6 +2236,7 @@ static cfg_clausedef_t zone_clauses[] = {
 	  CFG_ZONE_SLAVE | CFG_ZONE_MIRROR },
 	{ "update-check-ksk", &cfg_type_boolean,
 	  CFG_ZONE_MASTER | CFG_ZONE_SLAVE },
+	{ "update-group-commit", &cfg_type_uint32, CFG_ZONE_MASTER },
 	{ "use-alt-transfer-source", &cfg_type_boolean,
 	  CFG_ZONE_SLAVE | CFG_ZONE_MIRROR | CFG_ZONE_STUB },
 	{ "zero-no-soa-ttl", &cfg_type_boolean,
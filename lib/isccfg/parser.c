@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -23,6 +24,7 @@
 #include <isc/errno.h>
 #include <isc/formatcheck.h>
 #include <isc/glob.h>
+#include <isc/hash.h>
 #include <isc/lex.h>
 #include <isc/log.h>
 #include <isc/mem.h>
@@ -68,6 +70,16 @@
  * Forward declarations of static functions.
  */
 
+static void *
+parser_get(cfg_parser_t *pctx, bool arena, size_t size);
+
+static void
+parser_put(cfg_parser_t *pctx, bool arena, void *ptr, size_t size);
+
+static char *
+parser_strdup(cfg_parser_t *pctx, bool arena, const char *contents,
+	      size_t len);
+
 static void
 free_tuple(cfg_parser_t *pctx, cfg_obj_t *obj);
 
@@ -81,11 +93,7 @@ static void
 free_list(cfg_parser_t *pctx, cfg_obj_t *obj);
 
 static isc_result_t
-create_listelt(cfg_parser_t *pctx, cfg_listelt_t **eltp);
-
-static isc_result_t
-create_string(cfg_parser_t *pctx, const char *contents, const cfg_type_t *type,
-	      cfg_obj_t **ret);
+create_listelt(cfg_parser_t *pctx, bool arena, cfg_listelt_t **eltp);
 
 static void
 free_string(cfg_parser_t *pctx, cfg_obj_t *obj);
@@ -269,8 +277,8 @@ cfg_create_tuple(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 	}
 
 	CHECK(cfg_create_obj(pctx, type, &obj));
-	obj->value.tuple = isc_mem_get(pctx->mctx,
-				       nfields * sizeof(cfg_obj_t *));
+	obj->value.tuple = parser_get(pctx, obj->arena,
+				      nfields * sizeof(cfg_obj_t *));
 	for (f = fields, i = 0; f->name != NULL; f++, i++) {
 		obj->value.tuple[i] = NULL;
 	}
@@ -279,7 +287,7 @@ cfg_create_tuple(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 
 cleanup:
 	if (obj != NULL) {
-		isc_mem_put(pctx->mctx, obj, sizeof(*obj));
+		parser_put(pctx, obj->arena, obj, sizeof(*obj));
 	}
 	return (result);
 }
@@ -369,8 +377,8 @@ free_tuple(cfg_parser_t *pctx, cfg_obj_t *obj) {
 		CLEANUP_OBJ(obj->value.tuple[i]);
 		nfields++;
 	}
-	isc_mem_put(pctx->mctx, obj->value.tuple,
-		    nfields * sizeof(cfg_obj_t *));
+	parser_put(pctx, obj->arena, obj->value.tuple,
+		   nfields * sizeof(cfg_obj_t *));
 }
 
 bool
@@ -460,6 +468,245 @@ cleanup:
 	return (result);
 }
 
+/*
+ * Parser arena.  While CFG_PCTX_ARENA is set, configuration objects
+ * and the memory hanging off them are carved out of large chunks
+ * instead of being allocated individually, and strings are interned
+ * so that the many copies of "master", "file" names and the like in
+ * a large configuration share storage.  Arena memory is released as
+ * a whole in cfg_parser_destroy().
+ */
+#define ARENA_CHUNKSIZE (64 * 1024)
+#define ARENA_BIGSIZE	(ARENA_CHUNKSIZE / 8)
+#define ARENA_ALIGN(x)	(((x) + 7) & ~((size_t)7))
+#define ARENA_INITSTRINGS 1024
+
+typedef struct arenachunk arenachunk_t;
+struct arenachunk {
+	arenachunk_t *next;
+	size_t	      size;
+	size_t	      used;
+};
+
+#define ARENA_HDRSIZE ARENA_ALIGN(sizeof(arenachunk_t))
+
+struct cfg_arena {
+	arenachunk_t *chunks;
+	char **	      strings; /* open addressed, power of two size */
+	size_t	      nstrings;
+	size_t	      stringsize;
+};
+
+static struct cfg_arena *
+arena_attach(cfg_parser_t *pctx) {
+	struct cfg_arena *arena = pctx->arena;
+
+	if (arena == NULL) {
+		arena = isc_mem_get(pctx->mctx, sizeof(*arena));
+		arena->chunks = NULL;
+		arena->strings = NULL;
+		arena->nstrings = 0;
+		arena->stringsize = 0;
+		pctx->arena = arena;
+	}
+
+	return (arena);
+}
+
+static void *
+arena_get(cfg_parser_t *pctx, size_t size) {
+	struct cfg_arena *arena = arena_attach(pctx);
+	arenachunk_t *chunk;
+	void *ptr;
+
+	size = ARENA_ALIGN(size);
+	chunk = arena->chunks;
+	if (size > ARENA_BIGSIZE || chunk == NULL ||
+	    chunk->size - chunk->used < size) {
+		size_t csize = (size > ARENA_BIGSIZE) ? size : ARENA_CHUNKSIZE;
+
+		chunk = isc_mem_get(pctx->mctx, ARENA_HDRSIZE + csize);
+		chunk->size = csize;
+		chunk->used = 0;
+
+		/*
+		 * A chunk holding a single large allocation goes behind
+		 * the current one, which may still have room to spare.
+		 */
+		if (size > ARENA_BIGSIZE && arena->chunks != NULL) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			chunk->next = arena->chunks;
+			arena->chunks = chunk;
+		}
+	}
+
+	ptr = (unsigned char *)chunk + ARENA_HDRSIZE + chunk->used;
+	chunk->used += size;
+	return (ptr);
+}
+
+static void
+arena_growstrings(cfg_parser_t *pctx) {
+	struct cfg_arena *arena = pctx->arena;
+	size_t newsize, i;
+	char **strings;
+
+	newsize = (arena->stringsize == 0) ? ARENA_INITSTRINGS
+					   : arena->stringsize * 2;
+	strings = isc_mem_get(pctx->mctx, newsize * sizeof(char *));
+	memset(strings, 0, newsize * sizeof(char *));
+
+	for (i = 0; i < arena->stringsize; i++) {
+		char *str = arena->strings[i];
+		size_t h;
+
+		if (str == NULL) {
+			continue;
+		}
+		h = isc_hash_function(str, strlen(str), true) & (newsize - 1);
+		while (strings[h] != NULL) {
+			h = (h + 1) & (newsize - 1);
+		}
+		strings[h] = str;
+	}
+
+	if (arena->strings != NULL) {
+		isc_mem_put(pctx->mctx, arena->strings,
+			    arena->stringsize * sizeof(char *));
+	}
+	arena->strings = strings;
+	arena->stringsize = newsize;
+}
+
+/*
+ * Return an interned, null terminated copy of the 'len' bytes
+ * at 'contents'.  The result must not be modified.
+ */
+static char *
+arena_intern(cfg_parser_t *pctx, const char *contents, size_t len) {
+	struct cfg_arena *arena = arena_attach(pctx);
+	size_t h;
+	char *str;
+
+	if (arena->nstrings * 2 >= arena->stringsize) {
+		arena_growstrings(pctx);
+	}
+
+	h = isc_hash_function(contents, len, true) & (arena->stringsize - 1);
+	while ((str = arena->strings[h]) != NULL) {
+		if (strncmp(str, contents, len) == 0 && str[len] == '\0') {
+			return (str);
+		}
+		h = (h + 1) & (arena->stringsize - 1);
+	}
+
+	str = arena_get(pctx, len + 1);
+	memmove(str, contents, len);
+	str[len] = '\0';
+	arena->strings[h] = str;
+	arena->nstrings++;
+
+	return (str);
+}
+
+static void
+arena_destroy(cfg_parser_t *pctx) {
+	struct cfg_arena *arena = pctx->arena;
+	arenachunk_t *chunk, *next;
+
+	if (arena == NULL) {
+		return;
+	}
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		isc_mem_put(pctx->mctx, chunk, ARENA_HDRSIZE + chunk->size);
+	}
+	if (arena->strings != NULL) {
+		isc_mem_put(pctx->mctx, arena->strings,
+			    arena->stringsize * sizeof(char *));
+	}
+	isc_mem_put(pctx->mctx, arena, sizeof(*arena));
+	pctx->arena = NULL;
+}
+
+/*
+ * Size of an arena object with representation 'rep'; only the
+ * member of the value union that the representation uses is
+ * allocated.
+ */
+#define VALUESIZE(member) sizeof(((cfg_obj_t *)NULL)->value.member)
+
+static size_t
+arena_objsize(const cfg_rep_t *rep) {
+	size_t size;
+
+	if (rep == &cfg_rep_void) {
+		size = 0;
+	} else if (rep == &cfg_rep_uint32 || rep == &cfg_rep_fixedpoint ||
+		   rep == &cfg_rep_percentage)
+	{
+		size = VALUESIZE(uint32);
+	} else if (rep == &cfg_rep_uint64) {
+		size = VALUESIZE(uint64);
+	} else if (rep == &cfg_rep_boolean) {
+		size = VALUESIZE(boolean);
+	} else if (rep == &cfg_rep_string) {
+		size = VALUESIZE(string);
+	} else if (rep == &cfg_rep_map) {
+		size = VALUESIZE(map);
+	} else if (rep == &cfg_rep_list) {
+		size = VALUESIZE(list);
+	} else if (rep == &cfg_rep_tuple) {
+		size = VALUESIZE(tuple);
+	} else if (rep == &cfg_rep_sockaddr) {
+		size = VALUESIZE(sockaddrdscp);
+	} else if (rep == &cfg_rep_netprefix) {
+		size = VALUESIZE(netprefix);
+	} else if (rep == &cfg_rep_duration) {
+		size = VALUESIZE(duration);
+	} else {
+		return (sizeof(cfg_obj_t));
+	}
+
+	return (offsetof(cfg_obj_t, value) + size);
+}
+
+/*
+ * Allocate and free memory belonging to a configuration object;
+ * 'arena' is the object's own 'arena' flag.
+ */
+static void *
+parser_get(cfg_parser_t *pctx, bool arena, size_t size) {
+	if (arena) {
+		return (arena_get(pctx, size));
+	}
+	return (isc_mem_get(pctx->mctx, size));
+}
+
+static void
+parser_put(cfg_parser_t *pctx, bool arena, void *ptr, size_t size) {
+	if (!arena) {
+		isc_mem_put(pctx->mctx, ptr, size);
+	}
+}
+
+static char *
+parser_strdup(cfg_parser_t *pctx, bool arena, const char *contents,
+	      size_t len) {
+	char *str;
+
+	if (arena) {
+		return (arena_intern(pctx, contents, len));
+	}
+	str = isc_mem_get(pctx->mctx, len + 1);
+	memmove(str, contents, len);
+	str[len] = '\0';
+	return (str);
+}
+
 /* A list of files, used internally for pctx->files. */
 
 static cfg_type_t cfg_type_filelist = { "filelist",    NULL,
@@ -493,6 +740,10 @@ cfg_parser_create(isc_mem_t *mctx, isc_log_t *lctx, cfg_parser_t **ret) {
 	pctx->line = 0;
 	pctx->callback = NULL;
 	pctx->callbackarg = NULL;
+	pctx->streamclause = NULL;
+	pctx->streamcallback = NULL;
+	pctx->streamarg = NULL;
+	pctx->arena = NULL;
 	pctx->token.type = isc_tokentype_unknown;
 	pctx->flags = 0;
 	pctx->buf_name = NULL;
@@ -552,8 +803,8 @@ parser_openfile(cfg_parser_t *pctx, const char *filename) {
 		goto cleanup;
 	}
 
-	CHECK(create_string(pctx, filename, &cfg_type_qstring, &stringobj));
-	CHECK(create_listelt(pctx, &elt));
+	CHECK(cfg_create_string(pctx, filename, &cfg_type_qstring, &stringobj));
+	CHECK(create_listelt(pctx, pctx->open_files->arena, &elt));
 	elt->obj = stringobj;
 	ISC_LIST_APPEND(pctx->open_files->value.list, elt, link);
 
@@ -572,6 +823,17 @@ cfg_parser_setcallback(cfg_parser_t *pctx, cfg_parsecallback_t callback,
 	pctx->callbackarg = arg;
 }
 
+void
+cfg_parser_setstreaming(cfg_parser_t *pctx, const char *clausename,
+			cfg_parsecallback_t callback, void *arg) {
+	REQUIRE(pctx != NULL);
+	REQUIRE((clausename == NULL) == (callback == NULL));
+
+	pctx->streamclause = clausename;
+	pctx->streamcallback = callback;
+	pctx->streamarg = arg;
+}
+
 void
 cfg_parser_reset(cfg_parser_t *pctx) {
 	REQUIRE(pctx != NULL);
@@ -658,7 +920,7 @@ cfg_parse_buffer(cfg_parser_t *pctx, isc_buffer_t *buffer, const char *file,
 	REQUIRE(type != NULL);
 	REQUIRE(buffer != NULL);
 	REQUIRE(ret != NULL && *ret == NULL);
-	REQUIRE((flags & ~(CFG_PCTX_NODEPRECATED)) == 0);
+	REQUIRE((flags & ~(CFG_PCTX_NODEPRECATED | CFG_PCTX_ARENA)) == 0);
 
 	CHECK(isc_lex_openbuffer(pctx->lexer, buffer));
 
@@ -702,6 +964,7 @@ cfg_parser_destroy(cfg_parser_t **pctxp) {
 		 */
 		CLEANUP_OBJ(pctx->open_files);
 		CLEANUP_OBJ(pctx->closed_files);
+		arena_destroy(pctx);
 		isc_mem_putanddetach(&pctx->mctx, pctx, sizeof(*pctx));
 	}
 }
@@ -1417,23 +1680,22 @@ LIBISCCFG_EXTERNAL_DATA cfg_type_t cfg_type_duration_or_unlimited = {
  */
 
 /* Create a string object from a null-terminated C string. */
-static isc_result_t
-create_string(cfg_parser_t *pctx, const char *contents, const cfg_type_t *type,
-	      cfg_obj_t **ret) {
+isc_result_t
+cfg_create_string(cfg_parser_t *pctx, const char *contents,
+		  const cfg_type_t *type, cfg_obj_t **ret) {
 	isc_result_t result;
 	cfg_obj_t *obj = NULL;
 	int len;
 
+	REQUIRE(pctx != NULL);
+	REQUIRE(contents != NULL);
+	REQUIRE(ret != NULL && *ret == NULL);
+
 	CHECK(cfg_create_obj(pctx, type, &obj));
 	len = strlen(contents);
 	obj->value.string.length = len;
-	obj->value.string.base = isc_mem_get(pctx->mctx, len + 1);
-	if (obj->value.string.base == 0) {
-		isc_mem_put(pctx->mctx, obj, sizeof(*obj));
-		return (ISC_R_NOMEMORY);
-	}
-	memmove(obj->value.string.base, contents, len);
-	obj->value.string.base[len] = '\0';
+	obj->value.string.base = parser_strdup(pctx, obj->arena, contents,
+					       len);
 
 	*ret = obj;
 cleanup:
@@ -1454,7 +1716,7 @@ cfg_parse_qstring(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 		cfg_parser_error(pctx, CFG_LOG_NEAR, "expected quoted string");
 		return (ISC_R_UNEXPECTEDTOKEN);
 	}
-	return (create_string(pctx, TOKEN_STRING(pctx), &cfg_type_qstring,
+	return (cfg_create_string(pctx, TOKEN_STRING(pctx), &cfg_type_qstring,
 			      ret));
 cleanup:
 	return (result);
@@ -1472,7 +1734,7 @@ parse_ustring(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 				 "expected unquoted string");
 		return (ISC_R_UNEXPECTEDTOKEN);
 	}
-	return (create_string(pctx, TOKEN_STRING(pctx), &cfg_type_ustring,
+	return (cfg_create_string(pctx, TOKEN_STRING(pctx), &cfg_type_ustring,
 			      ret));
 cleanup:
 	return (result);
@@ -1488,7 +1750,7 @@ cfg_parse_astring(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 	UNUSED(type);
 
 	CHECK(cfg_getstringtoken(pctx));
-	return (create_string(pctx, TOKEN_STRING(pctx), &cfg_type_qstring,
+	return (cfg_create_string(pctx, TOKEN_STRING(pctx), &cfg_type_qstring,
 			      ret));
 cleanup:
 	return (result);
@@ -1504,7 +1766,7 @@ cfg_parse_sstring(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 	UNUSED(type);
 
 	CHECK(cfg_getstringtoken(pctx));
-	return (create_string(pctx, TOKEN_STRING(pctx), &cfg_type_sstring,
+	return (cfg_create_string(pctx, TOKEN_STRING(pctx), &cfg_type_sstring,
 			      ret));
 cleanup:
 	return (result);
@@ -1521,7 +1783,7 @@ parse_btext(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 		cfg_parser_error(pctx, CFG_LOG_NEAR, "expected bracketed text");
 		return (ISC_R_UNEXPECTEDTOKEN);
 	}
-	return (create_string(pctx, TOKEN_STRING(pctx),
+	return (cfg_create_string(pctx, TOKEN_STRING(pctx),
 			      &cfg_type_bracketed_text, ret));
 cleanup:
 	return (result);
@@ -1696,8 +1958,8 @@ print_sstring(cfg_printer_t *pctx, const cfg_obj_t *obj) {
 
 static void
 free_string(cfg_parser_t *pctx, cfg_obj_t *obj) {
-	isc_mem_put(pctx->mctx, obj->value.string.base,
-		    obj->value.string.length + 1);
+	parser_put(pctx, obj->arena, obj->value.string.base,
+		   obj->value.string.length + 1);
 }
 
 bool
@@ -2080,11 +2342,15 @@ cleanup:
 	return (result);
 }
 
+/*
+ * List elements are allocated like the list object they belong to;
+ * 'arena' is that object's 'arena' flag.
+ */
 static isc_result_t
-create_listelt(cfg_parser_t *pctx, cfg_listelt_t **eltp) {
+create_listelt(cfg_parser_t *pctx, bool arena, cfg_listelt_t **eltp) {
 	cfg_listelt_t *elt;
 
-	elt = isc_mem_get(pctx->mctx, sizeof(*elt));
+	elt = parser_get(pctx, arena, sizeof(*elt));
 	elt->obj = NULL;
 	ISC_LINK_INIT(elt, link);
 	*eltp = elt;
@@ -2092,11 +2358,11 @@ create_listelt(cfg_parser_t *pctx, cfg_listelt_t **eltp) {
 }
 
 static void
-free_listelt(cfg_parser_t *pctx, cfg_listelt_t *elt) {
+free_listelt(cfg_parser_t *pctx, bool arena, cfg_listelt_t *elt) {
 	if (elt->obj != NULL) {
 		cfg_obj_destroy(pctx, &elt->obj);
 	}
-	isc_mem_put(pctx->mctx, elt, sizeof(*elt));
+	parser_put(pctx, arena, elt, sizeof(*elt));
 }
 
 static void
@@ -2104,7 +2370,7 @@ free_list(cfg_parser_t *pctx, cfg_obj_t *obj) {
 	cfg_listelt_t *elt, *next;
 	for (elt = ISC_LIST_HEAD(obj->value.list); elt != NULL; elt = next) {
 		next = ISC_LIST_NEXT(elt, link);
-		free_listelt(pctx, elt);
+		free_listelt(pctx, obj->arena, elt);
 	}
 }
 
@@ -2114,12 +2380,14 @@ cfg_parse_listelt(cfg_parser_t *pctx, const cfg_type_t *elttype,
 	isc_result_t result;
 	cfg_listelt_t *elt = NULL;
 	cfg_obj_t *value = NULL;
+	bool arena;
 
 	REQUIRE(pctx != NULL);
 	REQUIRE(elttype != NULL);
 	REQUIRE(ret != NULL && *ret == NULL);
 
-	CHECK(create_listelt(pctx, &elt));
+	arena = ((pctx->flags & CFG_PCTX_ARENA) != 0);
+	CHECK(create_listelt(pctx, arena, &elt));
 
 	result = cfg_parse_obj(pctx, elttype, &value);
 	if (result != ISC_R_SUCCESS) {
@@ -2132,7 +2400,7 @@ cfg_parse_listelt(cfg_parser_t *pctx, const cfg_type_t *elttype,
 	return (ISC_R_SUCCESS);
 
 cleanup:
-	isc_mem_put(pctx->mctx, elt, sizeof(*elt));
+	parser_put(pctx, arena, elt, sizeof(*elt));
 	return (result);
 }
 
@@ -2166,7 +2434,7 @@ parse_list(cfg_parser_t *pctx, const cfg_type_t *listtype, cfg_obj_t **ret) {
 
 cleanup:
 	if (elt != NULL) {
-		free_listelt(pctx, elt);
+		free_listelt(pctx, listobj->arena, elt);
 	}
 	CLEANUP_OBJ(listobj);
 	return (result);
@@ -2494,6 +2762,30 @@ cfg_parse_mapbody(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 		 * not its presence.
 		 */
 
+		/*
+		 * Values of a streamed clause are passed to the callback
+		 * and discarded.  They are allocated outside of the arena
+		 * so that their memory is reclaimed right away.
+		 */
+		if ((clause->flags & CFG_CLAUSEFLAG_MULTI) != 0 &&
+		    pctx->streamcallback != NULL &&
+		    strcasecmp(clause->name, pctx->streamclause) == 0)
+		{
+			bool arena = ((pctx->flags & CFG_PCTX_ARENA) != 0);
+
+			pctx->flags &= ~CFG_PCTX_ARENA;
+			result = cfg_parse_obj(pctx, clause->type, &value);
+			if (arena) {
+				pctx->flags |= CFG_PCTX_ARENA;
+			}
+			CHECK(result);
+			CHECK(parse_semicolon(pctx));
+			CHECK(pctx->streamcallback(clause->name, value,
+						   pctx->streamarg));
+			cfg_obj_destroy(pctx, &value);
+			continue;
+		}
+
 		/* See if the clause already has a value; if not create one. */
 		result = isc_symtab_lookup(obj->value.map.symtab, clause->name,
 					   0, &symval);
@@ -2950,16 +3242,15 @@ parse_token(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 
 	isc_lex_getlasttokentext(pctx->lexer, &pctx->token, &r);
 
-	obj->value.string.base = isc_mem_get(pctx->mctx, r.length + 1);
+	obj->value.string.base = parser_strdup(pctx, obj->arena,
+					       (const char *)r.base, r.length);
 	obj->value.string.length = r.length;
-	memmove(obj->value.string.base, r.base, r.length);
-	obj->value.string.base[r.length] = '\0';
 	*ret = obj;
 	return (result);
 
 cleanup:
 	if (obj != NULL) {
-		isc_mem_put(pctx->mctx, obj, sizeof(*obj));
+		parser_put(pctx, obj->arena, obj, sizeof(*obj));
 	}
 	return (result);
 }
@@ -3853,14 +4144,21 @@ cfg_obj_line(const cfg_obj_t *obj) {
 isc_result_t
 cfg_create_obj(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 	cfg_obj_t *obj;
+	bool arena;
 
 	REQUIRE(pctx != NULL);
 	REQUIRE(type != NULL);
 	REQUIRE(ret != NULL && *ret == NULL);
 
-	obj = isc_mem_get(pctx->mctx, sizeof(cfg_obj_t));
+	arena = ((pctx->flags & CFG_PCTX_ARENA) != 0);
+	if (arena) {
+		obj = arena_get(pctx, arena_objsize(type->rep));
+	} else {
+		obj = isc_mem_get(pctx->mctx, sizeof(cfg_obj_t));
+	}
 
 	obj->type = type;
+	obj->arena = arena;
 	obj->file = current_file(pctx);
 	obj->line = pctx->line;
 	obj->pctx = pctx;
@@ -3901,7 +4199,7 @@ create_map(cfg_parser_t *pctx, const cfg_type_t *type, cfg_obj_t **ret) {
 
 cleanup:
 	if (obj != NULL) {
-		isc_mem_put(pctx->mctx, obj, sizeof(*obj));
+		parser_put(pctx, obj->arena, obj, sizeof(*obj));
 	}
 	return (result);
 }
@@ -3934,7 +4232,7 @@ cfg_obj_destroy(cfg_parser_t *pctx, cfg_obj_t **objp) {
 	if (isc_refcount_decrement(&obj->references) == 1) {
 		obj->type->rep->free(pctx, obj);
 		isc_refcount_destroy(&obj->references);
-		isc_mem_put(pctx->mctx, obj, sizeof(cfg_obj_t));
+		parser_put(pctx, obj->arena, obj, sizeof(cfg_obj_t));
 	}
 }
 
@@ -3992,6 +4290,7 @@ cfg_parser_mapadd(cfg_parser_t *pctx, cfg_obj_t *mapobj, cfg_obj_t *obj,
 	isc_symvalue_t symval;
 	cfg_obj_t *destobj = NULL;
 	cfg_listelt_t *elt = NULL;
+	bool arena = false;
 	const cfg_clausedef_t *const *clauseset;
 	const cfg_clausedef_t *clause;
 
@@ -4021,7 +4320,8 @@ breakout:
 		if ((clause->flags & CFG_CLAUSEFLAG_MULTI) != 0) {
 			CHECK(cfg_create_list(pctx, &cfg_type_implicitlist,
 					      &destobj));
-			CHECK(create_listelt(pctx, &elt));
+			arena = destobj->arena;
+			CHECK(create_listelt(pctx, arena, &elt));
 			cfg_obj_attach(obj, &elt->obj);
 			ISC_LIST_APPEND(destobj->value.list, elt, link);
 			symval.as_pointer = destobj;
@@ -4037,7 +4337,8 @@ breakout:
 		INSIST(result == ISC_R_SUCCESS);
 
 		if (destobj2->type == &cfg_type_implicitlist) {
-			CHECK(create_listelt(pctx, &elt));
+			arena = destobj2->arena;
+			CHECK(create_listelt(pctx, arena, &elt));
 			cfg_obj_attach(obj, &elt->obj);
 			ISC_LIST_APPEND(destobj2->value.list, elt, link);
 		} else {
@@ -4050,7 +4351,7 @@ breakout:
 
 cleanup:
 	if (elt != NULL) {
-		free_listelt(pctx, elt);
+		free_listelt(pctx, arena, elt);
 	}
 	CLEANUP_OBJ(destobj);
 
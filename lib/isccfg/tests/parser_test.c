@@ -29,6 +29,7 @@
 #include <isc/mem.h>
 #include <isc/print.h>
 #include <isc/string.h>
+#include <isc/time.h>
 #include <isc/types.h>
 #include <isc/util.h>
 
@@ -263,6 +264,284 @@ cfg_map_nextclause_test(void **state) {
 	} while (name != NULL);
 }
 
+static const char arenaconf[] =
+	"options { directory \"/tmp\"; recursion no; };\n"
+	"zone \"example.com\" { type master; file \"example.db\"; };\n"
+	"zone \"example.net\" { type master; file \"example.db\"; };\n"
+	"view \"internal\" {\n"
+	"	match-clients { 10.0.0.0/8; !192.0.2.1; };\n"
+	"	zone \"example.org\" { type slave; masters { 10.53.0.1; };\n"
+	"		file \"example.org.bk\"; };\n"
+	"};\n";
+
+struct printbuf {
+	char   text[4096];
+	size_t len;
+};
+
+static void
+printbuf(void *arg, const char *str, int len) {
+	struct printbuf *pb = arg;
+
+	assert_true(pb->len + len < sizeof(pb->text));
+	memmove(pb->text + pb->len, str, len);
+	pb->len += len;
+	pb->text[pb->len] = '\0';
+}
+
+static void
+parsetext(cfg_parser_t *p, const char *text, unsigned int flags,
+	  cfg_obj_t **confp) {
+	isc_result_t result;
+	isc_buffer_t b;
+
+	isc_buffer_constinit(&b, text, strlen(text));
+	isc_buffer_add(&b, strlen(text));
+
+	result = cfg_parse_buffer(p, &b, "text", 0, &cfg_type_namedconf,
+				  flags, confp);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static const char *
+zonefile(const cfg_obj_t *zone) {
+	const cfg_obj_t *file = NULL;
+	isc_result_t result;
+
+	result = cfg_map_get(cfg_tuple_get(zone, "options"), "file", &file);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	return (cfg_obj_asstring(file));
+}
+
+/* the arena parser produces the same configuration as the default one */
+static void
+arena_test(void **state) {
+	cfg_parser_t *p1 = NULL, *p2 = NULL;
+	cfg_obj_t *c1 = NULL, *c2 = NULL, *zone = NULL;
+	const cfg_obj_t *zlist = NULL;
+	const cfg_listelt_t *elt;
+	struct printbuf pb1, pb2;
+	isc_result_t result;
+	const char *f1, *f2;
+
+	UNUSED(state);
+
+	result = cfg_parser_create(mctx, lctx, &p1);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	parsetext(p1, arenaconf, 0, &c1);
+
+	result = cfg_parser_create(mctx, lctx, &p2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	parsetext(p2, arenaconf, CFG_PCTX_ARENA, &c2);
+
+	pb1.len = pb2.len = 0;
+	cfg_printx(c1, 0, printbuf, &pb1);
+	cfg_printx(c2, 0, printbuf, &pb2);
+	assert_true(pb1.len > 0);
+	assert_string_equal(pb1.text, pb2.text);
+
+	/* Identical strings are shared only in the arena. */
+	result = cfg_map_get(c1, "zone", &zlist);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	elt = cfg_list_first(zlist);
+	f1 = zonefile(cfg_listelt_value(elt));
+	f2 = zonefile(cfg_listelt_value(cfg_list_next(elt)));
+	assert_string_equal(f1, f2);
+	assert_ptr_not_equal(f1, f2);
+
+	zlist = NULL;
+	result = cfg_map_get(c2, "zone", &zlist);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	elt = cfg_list_first(zlist);
+	f1 = zonefile(cfg_listelt_value(elt));
+	f2 = zonefile(cfg_listelt_value(cfg_list_next(elt)));
+	assert_ptr_equal(f1, f2);
+
+	/* Objects from a default parse can be added to an arena parse. */
+	zlist = NULL;
+	result = cfg_map_get(c1, "zone", &zlist);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	DE_CONST(cfg_listelt_value(cfg_list_first(zlist)), zone);
+	result = cfg_parser_mapadd(p2, c2, zone, "zone");
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	cfg_obj_destroy(p1, &c1);
+	cfg_obj_destroy(p2, &c2);
+	cfg_parser_destroy(&p1);
+	cfg_parser_destroy(&p2);
+}
+
+struct streamstate {
+	unsigned int count;
+	unsigned int fail;
+	char	     names[8][64];
+};
+
+static isc_result_t
+streamzone(const char *clausename, const cfg_obj_t *obj, void *arg) {
+	struct streamstate *st = arg;
+	const char *name;
+
+	assert_string_equal(clausename, "zone");
+	name = cfg_obj_asstring(cfg_tuple_get(obj, "name"));
+	strlcpy(st->names[st->count % 8], name, sizeof(st->names[0]));
+	if (++st->count == st->fail) {
+		return (ISC_R_FAILURE);
+	}
+	return (ISC_R_SUCCESS);
+}
+
+/* streamed zone clauses are passed to the callback and not kept */
+static void
+streaming_test(void **state) {
+	struct streamstate st;
+	cfg_parser_t *p = NULL;
+	cfg_obj_t *conf = NULL;
+	const cfg_obj_t *obj = NULL, *view;
+	isc_result_t result;
+	isc_buffer_t b;
+
+	UNUSED(state);
+
+	memset(&st, 0, sizeof(st));
+
+	result = cfg_parser_create(mctx, lctx, &p);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	cfg_parser_setstreaming(p, "zone", streamzone, &st);
+	parsetext(p, arenaconf, CFG_PCTX_ARENA, &conf);
+
+	assert_int_equal(st.count, 3);
+	assert_string_equal(st.names[0], "example.com");
+	assert_string_equal(st.names[1], "example.net");
+	assert_string_equal(st.names[2], "example.org");
+
+	result = cfg_map_get(conf, "zone", &obj);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	result = cfg_map_get(conf, "view", &obj);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	view = cfg_tuple_get(cfg_listelt_value(cfg_list_first(obj)),
+			     "options");
+	obj = NULL;
+	result = cfg_map_get(view, "zone", &obj);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	result = cfg_map_get(view, "match-clients", &obj);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	cfg_obj_destroy(p, &conf);
+	cfg_parser_destroy(&p);
+
+	/* An error from the callback stops the parser. */
+	memset(&st, 0, sizeof(st));
+	st.fail = 2;
+
+	result = cfg_parser_create(mctx, lctx, &p);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	cfg_parser_setstreaming(p, "zone", streamzone, &st);
+
+	isc_buffer_constinit(&b, arenaconf, strlen(arenaconf));
+	isc_buffer_add(&b, strlen(arenaconf));
+	result = cfg_parse_buffer(p, &b, "text", 0, &cfg_type_namedconf, 0,
+				  &conf);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+	assert_null(conf);
+	assert_int_equal(st.count, 2);
+
+	cfg_parser_destroy(&p);
+}
+
+#ifdef DNS_BENCHMARK_TESTS
+
+/*
+ * Parse a configuration with a large number of zones with the
+ * default parser, in arena mode, and streaming the zones.
+ */
+
+#define NZONES 200000
+
+static isc_result_t
+countzone(const char *clausename, const cfg_obj_t *obj, void *arg) {
+	UNUSED(clausename);
+	UNUSED(obj);
+
+	(*(unsigned int *)arg)++;
+	return (ISC_R_SUCCESS);
+}
+
+static void
+benchparse(isc_mem_t *bmctx, const char *text, size_t len, bool arena,
+	   bool streaming) {
+	cfg_parser_t *p = NULL;
+	cfg_obj_t *conf = NULL;
+	isc_time_t ts1, ts2;
+	isc_result_t result;
+	isc_buffer_t b;
+	unsigned int count = 0;
+	size_t inuse;
+
+	result = cfg_parser_create(bmctx, lctx, &p);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	if (streaming) {
+		cfg_parser_setstreaming(p, "zone", countzone, &count);
+	}
+
+	isc_buffer_constinit(&b, text, len);
+	isc_buffer_add(&b, len);
+
+	inuse = isc_mem_inuse(bmctx);
+	isc_time_now(&ts1);
+	result = cfg_parse_buffer(p, &b, "bench", 0, &cfg_type_namedconf,
+				  arena ? CFG_PCTX_ARENA : 0, &conf);
+	isc_time_now(&ts2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	fprintf(stderr, "%-9s %-9s %8.1f ms %8zu KB\n",
+		arena ? "arena" : "default",
+		streaming ? "streaming" : "",
+		isc_time_microdiff(&ts2, &ts1) / 1000.0,
+		(isc_mem_inuse(bmctx) - inuse) / 1024);
+	if (streaming) {
+		assert_int_equal(count, NZONES);
+	}
+
+	cfg_obj_destroy(p, &conf);
+	cfg_parser_destroy(&p);
+}
+
+static void
+benchmark_test(void **state) {
+	isc_mem_t *bmctx = NULL;
+	size_t size = NZONES * 128, len = 0;
+	unsigned int debugging = isc_mem_debugging;
+	char *text;
+	int i;
+
+	UNUSED(state);
+
+	/* Recording millions of allocations would dominate the run. */
+	isc_mem_debugging &= ~ISC_MEM_DEBUGRECORD;
+	isc_mem_create(&bmctx);
+	isc_mem_debugging = debugging;
+
+	text = isc_mem_get(bmctx, size);
+	for (i = 0; i < NZONES; i++) {
+		len += snprintf(text + len, size - len,
+				"zone \"zone%d.example\" { type master; "
+				"file \"zone%d.db\"; notify no; };\n",
+				i, i);
+		INSIST(len < size);
+	}
+
+	benchparse(bmctx, text, len, false, false);
+	benchparse(bmctx, text, len, true, false);
+	benchparse(bmctx, text, len, false, true);
+	benchparse(bmctx, text, len, true, true);
+
+	isc_mem_put(bmctx, text, size);
+	isc_mem_destroy(&bmctx);
+}
+
+#endif /* DNS_BENCHMARK_TESTS */
+
 int
 main(void) {
 	const struct CMUnitTest tests[] = {
@@ -270,6 +549,11 @@ main(void) {
 		cmocka_unit_test(parse_buffer_test),
 		cmocka_unit_test(cfg_map_firstclause_test),
 		cmocka_unit_test(cfg_map_nextclause_test),
+		cmocka_unit_test(arena_test),
+		cmocka_unit_test(streaming_test),
+#ifdef DNS_BENCHMARK_TESTS
+		cmocka_unit_test(benchmark_test),
+#endif /* DNS_BENCHMARK_TESTS */
 	};
 
 	return (cmocka_run_group_tests(tests, _setup, _teardown));
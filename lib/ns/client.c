@@ -2470,10 +2470,16 @@ ns_clientmgr_create(isc_mem_t *mctx, ns_server_t *sctx, isc_taskmgr_t *taskmgr,
 	int ntasks = CLIENT_NTASKS_PERCPU * manager->ncpus;
 	manager->taskpool = isc_mem_get(mctx, ntasks * sizeof(isc_task_t *));
 	for (i = 0; i < ntasks; i++) {
+		/*
+		 * get_clienttask() picks a task with the index of the
+		 * network thread modulo ncpus; bind it to the worker
+		 * with the same index, which runs on the same CPU or
+		 * NUMA node.
+		 */
 		manager->taskpool[i] = NULL;
 		result = isc_task_create_bound(manager->taskmgr, 20,
 					       &manager->taskpool[i],
-					       i % CLIENT_NTASKS_PERCPU);
+					       i % manager->ncpus);
 		RUNTIME_CHECK(result == ISC_R_SUCCESS);
 	}
 	isc_refcount_init(&manager->references, 1);
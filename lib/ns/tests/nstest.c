@@ -77,9 +77,26 @@ static dns_zone_t *served_zone = NULL;
 atomic_uint_fast32_t client_refs[32];
 atomic_uintptr_t client_addrs[32];
 
+void
+__wrap_isc_nmhandle_ref(isc_nmhandle_t *handle);
 void
 __wrap_isc_nmhandle_unref(isc_nmhandle_t *handle);
 
+void
+__wrap_isc_nmhandle_ref(isc_nmhandle_t *handle) {
+	ns_client_t *client = (ns_client_t *)handle;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		if (atomic_load(&client_addrs[i]) == (uintptr_t)client) {
+			break;
+		}
+	}
+	REQUIRE(i < 32);
+
+	atomic_fetch_add(&client_refs[i], 1);
+}
+
 void
 __wrap_isc_nmhandle_unref(isc_nmhandle_t *handle) {
 	ns_client_t *client = (ns_client_t *)handle;
@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <isc/util.h>
+
+#if HAVE_CMOCKA && !__SANITIZE_ADDRESS__
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/atomic.h>
+#include <isc/event.h>
+#include <isc/file.h>
+#include <isc/lex.h>
+#include <isc/print.h>
+#include <isc/task.h>
+
+#include <dns/acl.h>
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/journal.h>
+#include <dns/message.h>
+#include <dns/rcode.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+#include <dns/view.h>
+#include <dns/zone.h>
+
+#include <ns/client.h>
+#include <ns/update.h>
+
+#include "nstest.h"
+
+#define ZONEFILE "update_test.db"
+#define NREQUESTS 4
+
+static const char *zonetext = "$TTL 1000\n"
+			      "@ SOA ns.example.com. postmaster.example.com. "
+			      "1 3600 1800 604800 3600\n"
+			      "@ NS ns.example.com.\n"
+			      "ns A 10.0.0.1\n";
+
+static atomic_bool released;
+static atomic_uint_fast32_t nresponses;
+static dns_rcode_t rcodes[NREQUESTS + 1];
+
+static int
+_setup(void **state) {
+	isc_result_t result;
+	FILE *fp;
+
+	UNUSED(state);
+
+	result = ns_test_begin(NULL, true);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	fp = fopen(ZONEFILE, "w");
+	assert_non_null(fp);
+	fputs(zonetext, fp);
+	fclose(fp);
+	(void)isc_file_remove(ZONEFILE ".jnl");
+
+	return (0);
+}
+
+static int
+_teardown(void **state) {
+	UNUSED(state);
+
+	(void)isc_file_remove(ZONEFILE);
+	(void)isc_file_remove(ZONEFILE ".jnl");
+	ns_test_end();
+
+	return (0);
+}
+
+/*
+ * Record the rcode of an update response, by message ID.
+ */
+static void
+check_response(isc_buffer_t *buf) {
+	isc_result_t result;
+	dns_message_t *message = NULL;
+
+	result = dns_message_create(mctx, DNS_MESSAGE_INTENTPARSE, &message);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_message_parse(message, buf, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_in_range(message->id, 1, NREQUESTS);
+	rcodes[message->id] = message->rcode;
+
+	dns_message_destroy(&message);
+	atomic_fetch_add(&nresponses, 1);
+}
+
+/*
+ * Keep the zone task busy until the test releases it, so that the
+ * update requests sent meanwhile wait in its queue.
+ */
+static void
+block_action(isc_task_t *task, isc_event_t *event) {
+	UNUSED(task);
+
+	while (!atomic_load(&released)) {
+		ns_test_nap(1000);
+	}
+	isc_event_free(&event);
+}
+
+/*
+ * Add the record 'owner IN type text' to the update section of
+ * 'message'.
+ */
+static void
+add_update(dns_message_t *message, const char *owner, dns_rdatatype_t type,
+	   const char *text, isc_buffer_t *target) {
+	isc_result_t result;
+	isc_lex_t *lex = NULL;
+	isc_buffer_t source;
+	dns_name_t *name = NULL;
+	dns_rdata_t *rdata = NULL;
+	dns_rdatalist_t *rdatalist = NULL;
+	dns_rdataset_t *rdataset = NULL;
+
+	assert_int_equal(dns_message_gettempname(message, &name),
+			 ISC_R_SUCCESS);
+	assert_int_equal(dns_message_gettemprdata(message, &rdata),
+			 ISC_R_SUCCESS);
+	assert_int_equal(dns_message_gettemprdatalist(message, &rdatalist),
+			 ISC_R_SUCCESS);
+	assert_int_equal(dns_message_gettemprdataset(message, &rdataset),
+			 ISC_R_SUCCESS);
+
+	result = dns_name_fromstring(name, owner, 0, mctx);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_lex_create(mctx, 64, &lex);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_buffer_constinit(&source, text, strlen(text));
+	isc_buffer_add(&source, strlen(text));
+	result = isc_lex_openbuffer(lex, &source);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdata_init(rdata);
+	result = dns_rdata_fromtext(rdata, dns_rdataclass_in, type, lex,
+				    dns_rootname, 0, mctx, target, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_lex_destroy(&lex);
+
+	rdatalist->rdclass = dns_rdataclass_in;
+	rdatalist->type = type;
+	rdatalist->ttl = 300;
+	ISC_LIST_APPEND(rdatalist->rdata, rdata, link);
+	result = dns_rdatalist_tordataset(rdatalist, rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	ISC_LIST_APPEND(name->list, rdataset, link);
+	dns_message_addname(message, name, DNS_SECTION_UPDATE);
+}
+
+/*
+ * Attach to 'client' an update request for example.com with ID 'id',
+ * adding 'owner' A 'address', and if 'ns' is not NULL, an apex NS
+ * record for it.
+ */
+static void
+make_update(ns_client_t *client, dns_messageid_t id, const char *owner,
+	    const char *address, const char *ns) {
+	isc_result_t result;
+	dns_message_t *message = NULL;
+	dns_name_t *zname = NULL;
+	dns_rdataset_t *zrdataset = NULL;
+	unsigned char rdatabuf[1024];
+	unsigned char wire[4096];
+	isc_buffer_t rdatabuffer, wirebuf;
+	dns_compress_t cctx;
+
+	result = dns_message_create(mctx, DNS_MESSAGE_INTENTRENDER, &message);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	message->id = id;
+	message->opcode = dns_opcode_update;
+
+	assert_int_equal(dns_message_gettempname(message, &zname),
+			 ISC_R_SUCCESS);
+	assert_int_equal(dns_message_gettemprdataset(message, &zrdataset),
+			 ISC_R_SUCCESS);
+	result = dns_name_fromstring(zname, "example.com", 0, mctx);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_makequestion(zrdataset, dns_rdataclass_in,
+				  dns_rdatatype_soa);
+	ISC_LIST_APPEND(zname->list, zrdataset, link);
+	dns_message_addname(message, zname, DNS_SECTION_ZONE);
+
+	isc_buffer_init(&rdatabuffer, rdatabuf, sizeof(rdatabuf));
+	add_update(message, owner, dns_rdatatype_a, address, &rdatabuffer);
+	if (ns != NULL) {
+		add_update(message, "example.com", dns_rdatatype_ns, ns,
+			   &rdatabuffer);
+	}
+
+	dns_compress_init(&cctx, -1, mctx);
+	isc_buffer_init(&wirebuf, wire, sizeof(wire));
+	result = dns_message_renderbegin(message, &cctx, &wirebuf);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_message_rendersection(message, DNS_SECTION_ZONE, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_message_rendersection(message, DNS_SECTION_UPDATE, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_message_renderend(message);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_compress_invalidate(&cctx);
+	dns_message_destroy(&message);
+
+	isc_buffer_first(&wirebuf);
+	result = dns_message_parse(client->message, &wirebuf, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static bool
+has_address(dns_db_t *db, const char *owner) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset;
+
+	result = dns_name_fromstring(name, owner, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findnode(db, name, false, &node);
+	if (result != ISC_R_SUCCESS) {
+		return (false);
+	}
+	dns_rdataset_init(&rdataset);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, 0,
+				     &rdataset, NULL);
+	if (dns_rdataset_isassociated(&rdataset)) {
+		dns_rdataset_disassociate(&rdataset);
+	}
+	dns_db_detachnode(db, &node);
+
+	return (result == ISC_R_SUCCESS);
+}
+
+/*
+ * Queued updates are committed in one journal transaction, without the
+ * changes of the request that fails.
+ */
+static void
+update_group_test(void **state) {
+	const char *owners[NREQUESTS + 1] = { NULL, "a1.example.com",
+					      "a2.example.com",
+					      "x.example.com",
+					      "a3.example.com" };
+	isc_result_t result;
+	ns_client_t *clients[NREQUESTS + 1];
+	dns_view_t *view = NULL;
+	dns_zone_t *zone = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *origin;
+	dns_acl_t *acl = NULL;
+	isc_task_t *zonetask = NULL;
+	isc_event_t *event = NULL;
+	struct in_addr ina;
+	dns_journal_t *journal = NULL;
+	dns_db_t *db = NULL;
+	dns_name_t *name = NULL;
+	dns_rdata_t *rdata = NULL;
+	uint32_t ttl;
+	unsigned int nsoa = 0;
+	dns_messageid_t id;
+
+	UNUSED(state);
+
+	atomic_init(&released, false);
+	atomic_init(&nresponses, 0);
+
+	result = ns_test_makeview("view", false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = ns_test_serve_zone("example.com", ZONEFILE, view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	origin = dns_fixedname_initname(&fixed);
+	result = dns_name_fromstring(origin, "example.com", 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_view_findzone(view, origin, &zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_acl_any(mctx, &acl);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_zone_setupdateacl(zone, acl);
+	dns_acl_detach(&acl);
+	dns_zone_setupdategroup(zone, 8);
+
+	/*
+	 * Hold the zone task, and queue one request per client behind
+	 * it; the third one adds an NS record without an address, which
+	 * fails the post-update checks after its changes are made.
+	 */
+	dns_zone_gettask(zone, &zonetask);
+	event = isc_event_allocate(mctx, NULL, ISC_TASKEVENT_TEST,
+				   block_action, NULL, sizeof(*event));
+	isc_task_send(zonetask, &event);
+
+	ina.s_addr = htonl(INADDR_LOOPBACK);
+	for (id = 1; id <= NREQUESTS; id++) {
+		clients[id] = NULL;
+		result = ns_test_getclient(NULL, false, &clients[id]);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_view_attach(view, &clients[id]->view);
+		isc_sockaddr_fromin(&clients[id]->peeraddr, &ina, 53);
+		clients[id]->sendcb = check_response;
+		make_update(clients[id], id, owners[id], "10.0.0.9",
+			    (id == 3) ? "ns9.example.com." : NULL);
+		ns_update_start(clients[id], ISC_R_SUCCESS);
+	}
+
+	atomic_store(&released, true);
+	for (int i = 0; i < 500 && atomic_load(&nresponses) < NREQUESTS; i++)
+	{
+		ns_test_nap(10000);
+	}
+	assert_int_equal(atomic_load(&nresponses), NREQUESTS);
+
+	assert_int_equal(rcodes[1], dns_rcode_noerror);
+	assert_int_equal(rcodes[2], dns_rcode_noerror);
+	assert_int_equal(rcodes[3], dns_rcode_refused);
+	assert_int_equal(rcodes[4], dns_rcode_noerror);
+
+	/*
+	 * The rejected request left nothing behind.
+	 */
+	result = dns_zone_getdb(zone, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(has_address(db, "a1.example.com"));
+	assert_true(has_address(db, "a2.example.com"));
+	assert_false(has_address(db, "x.example.com"));
+	assert_true(has_address(db, "a3.example.com"));
+	dns_db_detach(&db);
+
+	/*
+	 * One transaction, with one SOA change, holds all the others.
+	 */
+	result = dns_journal_open(mctx, dns_zone_getjournal(zone),
+				  DNS_JOURNAL_READ, &journal);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_journal_iter_init(journal,
+				       dns_journal_first_serial(journal),
+				       dns_journal_last_serial(journal), NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	for (result = dns_journal_first_rr(journal); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(journal))
+	{
+		dns_journal_current_rr(journal, &name, &ttl, &rdata);
+		if (rdata->type == dns_rdatatype_soa) {
+			nsoa++;
+		}
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	assert_int_equal(nsoa, 2);
+	dns_journal_destroy(&journal);
+
+	for (id = 1; id <= NREQUESTS; id++) {
+		isc_nmhandle_unref(clients[id]->handle);
+	}
+	isc_task_detach(&zonetask);
+	dns_zone_detach(&zone);
+	ns_test_cleanup_zone();
+	dns_view_detach(&view);
+}
+
+int
+main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup_teardown(update_group_test, _setup,
+						_teardown),
+	};
+
+	return (cmocka_run_group_tests(tests, NULL, NULL));
+}
+#else /* HAVE_CMOCKA && !__SANITIZE_ADDRESS__ */
+
+#include <stdio.h>
+
+int
+main(void) {
+#if __SANITIZE_ADDRESS__
+	/*
+	 * We disable this test when the address sanitizer is in
+	 * the use, as libuv will trigger errors.
+	 */
+	printf("1..0 # Skip ASAN is in use\n");
+#else  /* __SANITIZE_ADDRESS__ */
+	printf("1..0 # Skip cmocka not available\n");
+#endif /* __SANITIZE_ADDRESS__ */
+	return (0);
+}
+
+#endif /* HAVE_CMOCKA && !__SANITIZE_ADDRESS__ */
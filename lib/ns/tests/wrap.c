@@ -26,14 +26,22 @@
 #include <ns/client.h>
 
 /*
- * This overrides calls to isc_nmhandle_unref(), sending them to
+ * This overrides calls to isc_nmhandle_ref() and isc_nmhandle_unref(),
+ * sending them to __wrap_isc_nmhandle_ref() and
  * __wrap_isc_nmhandle_unref(), when libtool is in use and LD_WRAP
  * can't be used.
  */
 
+extern void
+__wrap_isc_nmhandle_ref(isc_nmhandle_t *handle);
 extern void
 __wrap_isc_nmhandle_unref(isc_nmhandle_t *handle);
 
+void
+isc_nmhandle_ref(isc_nmhandle_t *handle) {
+	__wrap_isc_nmhandle_ref(handle);
+}
+
 void
 isc_nmhandle_unref(isc_nmhandle_t *handle) {
 	__wrap_isc_nmhandle_unref(handle);
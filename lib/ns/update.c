@@ -461,10 +461,12 @@ do_one_tuple(dns_difftuple_t **tuple, dns_db_t *db, dns_dbversion_t *ver,
 
 /*%
  * Perform the updates in 'updates' in version 'ver' of 'db' and log the
- * update in 'diff'.
+ * update in 'diff'.  On failure, the updates already performed stay
+ * logged in 'diff', so that the caller can roll them back; the ones
+ * not performed are left in 'updates'.
  *
  * Ensures:
- * \li	'updates' is empty.
+ * \li	'updates' is empty on success.
  */
 static isc_result_t
 do_diff(dns_diff_t *updates, dns_db_t *db, dns_dbversion_t *ver,
@@ -478,7 +480,6 @@ do_diff(dns_diff_t *updates, dns_db_t *db, dns_dbversion_t *ver,
 	return (ISC_R_SUCCESS);
 
 failure:
-	dns_diff_clear(diff);
 	return (result);
 }
 
@@ -1562,6 +1563,11 @@ send_update_event(ns_client_t *client, dns_zone_t *zone) {
 		sizeof(*event));
 	event->zone = zone;
 	event->result = ISC_R_SUCCESS;
+	/*
+	 * Tag the event with the zone, so that the requests for the zone
+	 * that are waiting can be committed together.
+	 */
+	event->ev_tag = zone;
 
 	INSIST(client->nupdates == 0);
 	client->nupdates++;
@@ -2549,16 +2555,17 @@ isdnssec(dns_db_t *db, dns_dbversion_t *ver, dns_rdatatype_t privatetype) {
 	return (build_nsec || build_nsec3);
 }
 
-static void
-update_action(isc_task_t *task, isc_event_t *event) {
-	update_event_t *uev = (update_event_t *)event;
-	dns_zone_t *zone = uev->zone;
-	ns_client_t *client = (ns_client_t *)event->ev_arg;
+/*%
+ * Check the prerequisites of the update request of 'client' against the
+ * open version 'ver' of the zone database and apply its update section,
+ * recording the changes made in 'diff'.  'oldver' is the version that
+ * 'ver' was opened from.  Nothing is committed, and on failure the
+ * caller must roll back the changes recorded in 'diff'.
+ */
+static isc_result_t
+update_apply(ns_client_t *client, dns_zone_t *zone, dns_db_t *db,
+	     dns_dbversion_t *oldver, dns_dbversion_t *ver, dns_diff_t *diff) {
 	isc_result_t result;
-	dns_db_t *db = NULL;
-	dns_dbversion_t *oldver = NULL;
-	dns_dbversion_t *ver = NULL;
-	dns_diff_t diff; /* Pending updates. */
 	dns_diff_t temp; /* Pending RR existence assertions. */
 	bool soa_serial_changed = false;
 	isc_mem_t *mctx = client->mctx;
@@ -2570,8 +2577,6 @@ update_action(isc_task_t *task, isc_event_t *event) {
 	dns_fixedname_t tmpnamefixed;
 	dns_name_t *tmpname = NULL;
 	dns_zoneopt_t options;
-	dns_difftuple_t *tuple;
-	dns_rdata_dnskey_t dnskey;
 	bool had_dnskey;
 	dns_rdatatype_t privatetype = dns_zone_getprivatetype(zone);
 	dns_ttl_t maxttl = 0;
@@ -2583,12 +2588,8 @@ update_action(isc_task_t *task, isc_event_t *event) {
 	size_t rule;
 	const dns_ssurule_t **rules = NULL;
 
-	INSIST(event->ev_type == DNS_EVENT_UPDATE);
-
-	dns_diff_init(mctx, &diff);
 	dns_diff_init(mctx, &temp);
 
-	CHECK(dns_zone_getdb(zone, &db));
 	zonename = dns_db_origin(db);
 	zoneclass = dns_db_class(db);
 	dns_zone_getssutable(zone, &ssutable);
@@ -2601,12 +2602,6 @@ update_action(isc_task_t *task, isc_event_t *event) {
 	CHECK(checkqueryacl(client, dns_zone_getqueryacl(zone), zonename,
 			    dns_zone_getupdateacl(zone), ssutable));
 
-	/*
-	 * Get old and new versions now that queryacl has been checked.
-	 */
-	dns_db_currentversion(db, &oldver);
-	CHECK(dns_db_newversion(db, &ver));
-
 	/*
 	 * Check prerequisites.
 	 */
@@ -3084,7 +3079,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 				add_rr_prepare_ctx_t ctx;
 				ctx.db = db;
 				ctx.ver = ver;
-				ctx.diff = &diff;
+				ctx.diff = diff;
 				ctx.name = name;
 				ctx.oldname = name;
 				ctx.update_rr = &rdata;
@@ -3101,18 +3096,18 @@ update_action(isc_task_t *task, isc_event_t *event) {
 					dns_diff_clear(&ctx.add_diff);
 				} else {
 					result = do_diff(&ctx.del_diff, db, ver,
-							 &diff);
+							 diff);
 					if (result == ISC_R_SUCCESS) {
 						result = do_diff(&ctx.add_diff,
 								 db, ver,
-								 &diff);
+								 diff);
 					}
 					if (result != ISC_R_SUCCESS) {
 						dns_diff_clear(&ctx.del_diff);
 						dns_diff_clear(&ctx.add_diff);
 						goto failure;
 					}
-					CHECK(update_one_rr(db, ver, &diff,
+					CHECK(update_one_rr(db, ver, diff,
 							    DNS_DIFFOP_ADD,
 							    name, ttl, &rdata));
 				}
@@ -3134,12 +3129,12 @@ update_action(isc_task_t *task, isc_event_t *event) {
 					CHECK(delete_if(type_not_soa_nor_ns_p,
 							db, ver, name,
 							dns_rdatatype_any, 0,
-							&rdata, &diff));
+							&rdata, diff));
 				} else {
 					CHECK(delete_if(type_not_dnssec, db,
 							ver, name,
 							dns_rdatatype_any, 0,
-							&rdata, &diff));
+							&rdata, diff));
 				}
 			} else if (dns_name_equal(name, zonename) &&
 				   (rdata.type == dns_rdatatype_soa ||
@@ -3166,7 +3161,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 				}
 				CHECK(delete_if(true_p, db, ver, name,
 						rdata.type, covers, &rdata,
-						&diff));
+						diff));
 			}
 		} else if (update_class == dns_rdataclass_none) {
 			char namestr[DNS_NAME_FORMATSIZE];
@@ -3205,7 +3200,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 			update_log(client, zone, LOGLEVEL_PROTOCOL,
 				   "deleting an RR at %s %s", namestr, typestr);
 			CHECK(delete_if(rr_equal_p, db, ver, name, rdata.type,
-					covers, &rdata, &diff));
+					covers, &rdata, diff));
 		}
 	}
 	if (result != ISC_R_NOMORE) {
@@ -3217,11 +3212,11 @@ update_action(isc_task_t *task, isc_event_t *event) {
 	 * If they don't then back out all changes to DNSKEY/NSEC3PARAM
 	 * records.
 	 */
-	if (!ISC_LIST_EMPTY(diff.tuples)) {
-		CHECK(check_dnssec(client, zone, db, ver, &diff));
+	if (!ISC_LIST_EMPTY(diff->tuples)) {
+		CHECK(check_dnssec(client, zone, db, ver, diff));
 	}
 
-	if (!ISC_LIST_EMPTY(diff.tuples)) {
+	if (!ISC_LIST_EMPTY(diff->tuples)) {
 		unsigned int errors = 0;
 		CHECK(dns_zone_nscheck(zone, db, ver, &errors));
 		if (errors != 0) {
@@ -3232,7 +3227,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 			goto failure;
 		}
 	}
-	if (!ISC_LIST_EMPTY(diff.tuples)) {
+	if (!ISC_LIST_EMPTY(diff->tuples)) {
 		result = dns_zone_cdscheck(zone, db, ver);
 		if (result == DNS_R_BADCDS || result == DNS_R_BADCDNSKEY) {
 			update_log(client, zone, LOGLEVEL_PROTOCOL,
@@ -3251,9 +3246,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 	 * update RRSIGs and NSECs (if zone is secure), and write the update
 	 * to the journal.
 	 */
-	if (!ISC_LIST_EMPTY(diff.tuples)) {
-		char *journalfile;
-		dns_journal_t *journal;
+	if (!ISC_LIST_EMPTY(diff->tuples)) {
 		bool has_dnskey;
 
 		/*
@@ -3262,13 +3255,13 @@ update_action(isc_task_t *task, isc_event_t *event) {
 		 */
 		if (!soa_serial_changed) {
 			CHECK(update_soa_serial(
-				db, ver, &diff, mctx,
+				db, ver, diff, mctx,
 				dns_zone_getserialupdatemethod(zone)));
 		}
 
-		CHECK(check_mx(client, zone, db, ver, &diff));
+		CHECK(check_mx(client, zone, db, ver, diff));
 
-		CHECK(remove_orphaned_ds(db, ver, &diff));
+		CHECK(remove_orphaned_ds(db, ver, diff));
 
 		CHECK(rrset_exists(db, ver, zonename, dns_rdatatype_dnskey, 0,
 				   &has_dnskey));
@@ -3290,11 +3283,11 @@ update_action(isc_task_t *task, isc_event_t *event) {
 			}
 		}
 
-		CHECK(rollback_private(db, privatetype, ver, &diff));
+		CHECK(rollback_private(db, privatetype, ver, diff));
 
-		CHECK(add_signing_records(db, privatetype, ver, &diff));
+		CHECK(add_signing_records(db, privatetype, ver, diff));
 
-		CHECK(add_nsec3param_records(client, zone, db, ver, &diff));
+		CHECK(add_nsec3param_records(client, zone, db, ver, diff));
 
 		if (had_dnskey && !has_dnskey) {
 			/*
@@ -3304,7 +3297,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 			 * remove any NSEC chain present will also be removed.
 			 */
 			CHECK(dns_nsec3param_deletechains(db, ver, zone, true,
-							  &diff));
+							  diff));
 		} else if (has_dnskey && isdnssec(db, ver, privatetype)) {
 			dns_update_log_t log;
 			uint32_t interval =
@@ -3313,7 +3306,7 @@ update_action(isc_task_t *task, isc_event_t *event) {
 			log.func = update_log_cb;
 			log.arg = client;
 			result = dns_update_signatures(&log, zone, db, oldver,
-						       ver, &diff, interval);
+						       ver, diff, interval);
 
 			if (result != ISC_R_SUCCESS) {
 				update_log(client, zone, ISC_LOG_ERROR,
@@ -3338,140 +3331,407 @@ update_action(isc_task_t *task, isc_event_t *event) {
 				goto failure;
 			}
 		}
+	}
+	result = ISC_R_SUCCESS;
 
-		journalfile = dns_zone_getjournal(zone);
-		if (journalfile != NULL) {
-			update_log(client, zone, LOGLEVEL_DEBUG,
-				   "writing journal %s", journalfile);
+failure:
+	dns_diff_clear(&temp);
 
-			journal = NULL;
-			result = dns_journal_open(mctx, journalfile,
-						  DNS_JOURNAL_CREATE, &journal);
-			if (result != ISC_R_SUCCESS) {
-				FAILS(result, "journal open failed");
-			}
+	if (rules != NULL) {
+		isc_mem_put(mctx, rules, sizeof(*rules) * ruleslen);
+	}
 
-			result = dns_journal_write_transaction(journal, &diff);
-			if (result != ISC_R_SUCCESS) {
-				dns_journal_destroy(&journal);
-				FAILS(result, "journal write failed");
-			}
+	if (ssutable != NULL) {
+		dns_ssutable_detach(&ssutable);
+	}
+
+	return (result);
+}
+
+/*%
+ * Write the changes in 'diff' to the journal of 'zone' and commit the
+ * open version '*verp' of its database.  On failure the version is left
+ * open for the caller to roll back.
+ */
+static isc_result_t
+update_commit(ns_client_t *client, dns_zone_t *zone, dns_db_t *db,
+	      dns_dbversion_t **verp, dns_diff_t *diff) {
+	isc_result_t result;
+	char *journalfile;
+	dns_journal_t *journal;
+	dns_difftuple_t *tuple;
+	dns_rdata_dnskey_t dnskey;
+	dns_rdatatype_t privatetype = dns_zone_getprivatetype(zone);
+
+	journalfile = dns_zone_getjournal(zone);
+	if (journalfile != NULL) {
+		update_log(client, zone, LOGLEVEL_DEBUG,
+			   "writing journal %s", journalfile);
+
+		journal = NULL;
+		result = dns_journal_open(diff->mctx, journalfile,
+					  DNS_JOURNAL_CREATE, &journal);
+		if (result != ISC_R_SUCCESS) {
+			FAILS(result, "journal open failed");
+		}
 
+		result = dns_journal_write_transaction(journal, diff);
+		if (result != ISC_R_SUCCESS) {
 			dns_journal_destroy(&journal);
+			FAILS(result, "journal write failed");
 		}
 
-		/*
-		 * XXXRTH  Just a note that this committing code will have
-		 *	   to change to handle databases that need two-phase
-		 *	   commit, but this isn't a priority.
-		 */
-		update_log(client, zone, LOGLEVEL_DEBUG,
-			   "committing update transaction");
+		dns_journal_destroy(&journal);
+	}
 
-		dns_db_closeversion(db, &ver, true);
+	/*
+	 * XXXRTH  Just a note that this committing code will have
+	 *	   to change to handle databases that need two-phase
+	 *	   commit, but this isn't a priority.
+	 */
+	update_log(client, zone, LOGLEVEL_DEBUG,
+		   "committing update transaction");
 
-		/*
-		 * Mark the zone as dirty so that it will be written to disk.
-		 */
-		dns_zone_markdirty(zone);
+	dns_db_closeversion(db, verp, true);
 
-		/*
-		 * Notify slaves of the change we just made.
-		 */
-		dns_zone_notify(zone);
+	/*
+	 * Mark the zone as dirty so that it will be written to disk.
+	 */
+	dns_zone_markdirty(zone);
 
-		/*
-		 * Cause the zone to be signed with the key that we
-		 * have just added or have the corresponding signatures
-		 * deleted.
-		 *
-		 * Note: we are already committed to this course of action.
-		 */
-		for (tuple = ISC_LIST_HEAD(diff.tuples); tuple != NULL;
-		     tuple = ISC_LIST_NEXT(tuple, link))
+	/*
+	 * Notify slaves of the change we just made.
+	 */
+	dns_zone_notify(zone);
+
+	/*
+	 * Cause the zone to be signed with the key that we
+	 * have just added or have the corresponding signatures
+	 * deleted.
+	 *
+	 * Note: we are already committed to this course of action.
+	 */
+	for (tuple = ISC_LIST_HEAD(diff->tuples); tuple != NULL;
+	     tuple = ISC_LIST_NEXT(tuple, link))
+	{
+		isc_region_t r;
+		dns_secalg_t algorithm;
+		uint16_t keyid;
+
+		if (tuple->rdata.type != dns_rdatatype_dnskey) {
+			continue;
+		}
+
+		dns_rdata_tostruct(&tuple->rdata, &dnskey, NULL);
+		if ((dnskey.flags &
+		     (DNS_KEYFLAG_OWNERMASK | DNS_KEYTYPE_NOAUTH)) !=
+		    DNS_KEYOWNER_ZONE)
 		{
-			isc_region_t r;
-			dns_secalg_t algorithm;
-			uint16_t keyid;
+			continue;
+		}
 
-			if (tuple->rdata.type != dns_rdatatype_dnskey) {
-				continue;
-			}
+		dns_rdata_toregion(&tuple->rdata, &r);
+		algorithm = dnskey.algorithm;
+		keyid = dst_region_computeid(&r);
 
-			dns_rdata_tostruct(&tuple->rdata, &dnskey, NULL);
-			if ((dnskey.flags &
-			     (DNS_KEYFLAG_OWNERMASK | DNS_KEYTYPE_NOAUTH)) !=
-			    DNS_KEYOWNER_ZONE)
-			{
-				continue;
-			}
+		result = dns_zone_signwithkey(
+			zone, algorithm, keyid,
+			(tuple->op == DNS_DIFFOP_DEL));
+		if (result != ISC_R_SUCCESS) {
+			update_log(client, zone, ISC_LOG_ERROR,
+				   "dns_zone_signwithkey failed: %s",
+				   dns_result_totext(result));
+		}
+	}
 
-			dns_rdata_toregion(&tuple->rdata, &r);
-			algorithm = dnskey.algorithm;
-			keyid = dst_region_computeid(&r);
+	/*
+	 * Cause the zone to add/delete NSEC3 chains for the
+	 * deferred NSEC3PARAM changes.
+	 *
+	 * Note: we are already committed to this course of action.
+	 */
+	for (tuple = ISC_LIST_HEAD(diff->tuples); tuple != NULL;
+	     tuple = ISC_LIST_NEXT(tuple, link))
+	{
+		unsigned char buf[DNS_NSEC3PARAM_BUFFERSIZE];
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+		dns_rdata_nsec3param_t nsec3param;
 
-			result = dns_zone_signwithkey(
-				zone, algorithm, keyid,
-				(tuple->op == DNS_DIFFOP_DEL));
-			if (result != ISC_R_SUCCESS) {
-				update_log(client, zone, ISC_LOG_ERROR,
-					   "dns_zone_signwithkey failed: %s",
-					   dns_result_totext(result));
-			}
+		if (tuple->rdata.type != privatetype ||
+		    tuple->op != DNS_DIFFOP_ADD) {
+			continue;
 		}
 
-		/*
-		 * Cause the zone to add/delete NSEC3 chains for the
-		 * deferred NSEC3PARAM changes.
-		 *
-		 * Note: we are already committed to this course of action.
-		 */
-		for (tuple = ISC_LIST_HEAD(diff.tuples); tuple != NULL;
-		     tuple = ISC_LIST_NEXT(tuple, link))
-		{
-			unsigned char buf[DNS_NSEC3PARAM_BUFFERSIZE];
-			dns_rdata_t rdata = DNS_RDATA_INIT;
-			dns_rdata_nsec3param_t nsec3param;
+		if (!dns_nsec3param_fromprivate(&tuple->rdata, &rdata,
+						buf, sizeof(buf))) {
+			continue;
+		}
+		dns_rdata_tostruct(&rdata, &nsec3param, NULL);
+		if (nsec3param.flags == 0) {
+			continue;
+		}
 
-			if (tuple->rdata.type != privatetype ||
-			    tuple->op != DNS_DIFFOP_ADD) {
-				continue;
+		result = dns_zone_addnsec3chain(zone, &nsec3param);
+		if (result != ISC_R_SUCCESS) {
+			update_log(client, zone, ISC_LOG_ERROR,
+				   "dns_zone_addnsec3chain failed: %s",
+				   dns_result_totext(result));
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+
+failure:
+	return (result);
+}
+
+/*%
+ * Roll back the changes recorded in 'diff' from the open version 'ver',
+ * in reverse order.
+ */
+static isc_result_t
+undo_diff(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *ver) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_difftuple_t *tuple, *inverse;
+	dns_diffop_t op;
+	dns_diff_t undo;
+
+	dns_diff_init(diff->mctx, &undo);
+	for (tuple = ISC_LIST_TAIL(diff->tuples); tuple != NULL;
+	     tuple = ISC_LIST_PREV(tuple, link))
+	{
+		switch (tuple->op) {
+		case DNS_DIFFOP_ADD:
+			op = DNS_DIFFOP_DEL;
+			break;
+		case DNS_DIFFOP_DEL:
+			op = DNS_DIFFOP_ADD;
+			break;
+		case DNS_DIFFOP_ADDRESIGN:
+			op = DNS_DIFFOP_DELRESIGN;
+			break;
+		case DNS_DIFFOP_DELRESIGN:
+			op = DNS_DIFFOP_ADDRESIGN;
+			break;
+		default:
+			INSIST(0);
+			ISC_UNREACHABLE();
+		}
+		inverse = NULL;
+		CHECK(dns_difftuple_create(diff->mctx, op, &tuple->name,
+					   tuple->ttl, &tuple->rdata,
+					   &inverse));
+		dns_diff_append(&undo, &inverse);
+	}
+	result = dns_diff_apply(&undo, db, ver);
+
+failure:
+	dns_diff_clear(&undo);
+	return (result);
+}
+
+/*%
+ * Send the result of an update request back to the client's task.
+ */
+static void
+update_done(update_event_t *uev, isc_result_t result) {
+	ns_client_t *client = (ns_client_t *)uev->ev_arg;
+	isc_event_t *event = (isc_event_t *)uev;
+
+	uev->result = result;
+	uev->ev_type = DNS_EVENT_UPDATEDONE;
+	uev->ev_action = updatedone_action;
+	isc_task_send(client->task, &event);
+}
+
+/*%
+ * Take the update requests for 'zone' that are waiting in the queue of
+ * 'task' and append up to 'max' - 1 of them to 'group', to be committed
+ * together with the request that is being processed.  The rest are put
+ * back in the queue, behind any other events.
+ */
+static void
+update_gather(isc_task_t *task, dns_zone_t *zone, uint32_t max,
+	      isc_eventlist_t *group) {
+	isc_eventlist_t events;
+	isc_event_t *event;
+	isc_task_t *ref;
+	uint32_t count = 1;
+
+	ISC_LIST_INIT(events);
+	(void)isc_task_unsend(task, NULL, DNS_EVENT_UPDATE, zone, &events);
+	while ((event = ISC_LIST_HEAD(events)) != NULL) {
+		ISC_LIST_UNLINK(events, event, ev_link);
+		if (count < max) {
+			ISC_LIST_APPEND(*group, event, ev_link);
+			count++;
+			/*
+			 * Every request was sent with a reference to the
+			 * zone task.
+			 */
+			ref = task;
+			isc_task_detach(&ref);
+		} else {
+			isc_task_send(task, &event);
+		}
+	}
+}
+
+/*%
+ * Apply the update requests at the head of 'group' one after another to
+ * a single new version of the zone database, and commit them with one
+ * journal transaction.  Each request sees the changes made by the ones
+ * before it.  A request that fails has its own changes rolled back and
+ * is answered at once; the others are answered after the commit.
+ *
+ * Updates to signed zones are committed one at a time, because the
+ * DNSSEC maintenance done for an update compares the version it is
+ * applied to with the one it was opened from.  Requests that are not
+ * applied are left in 'group'.
+ */
+static void
+update_group(dns_zone_t *zone, isc_eventlist_t *group) {
+	update_event_t *uev;
+	ns_client_t *client;
+	isc_result_t result, tresult;
+	isc_eventlist_t applied;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *oldver = NULL;
+	dns_dbversion_t *ver = NULL;
+	dns_diff_t diff;  /* Pending updates of the whole group. */
+	dns_diff_t udiff; /* Pending updates of one request. */
+	dns_difftuple_t *tuple;
+	bool secure = false, flag;
+	unsigned int count = 0;
+
+	ISC_LIST_INIT(applied);
+	uev = (update_event_t *)ISC_LIST_HEAD(*group);
+	client = (ns_client_t *)uev->ev_arg;
+	dns_diff_init(client->mctx, &diff);
+
+	result = dns_zone_getdb(zone, &db);
+	if (result == ISC_R_SUCCESS) {
+		dns_db_currentversion(db, &oldver);
+		result = dns_db_newversion(db, &ver);
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = rrset_exists(db, oldver, dns_db_origin(db),
+				      dns_rdatatype_dnskey, 0, &secure);
+	}
+	if (result != ISC_R_SUCCESS) {
+		ISC_LIST_UNLINK(*group, (isc_event_t *)uev, ev_link);
+		update_done(uev, result);
+		goto cleanup;
+	}
+
+	while ((uev = (update_event_t *)ISC_LIST_HEAD(*group)) != NULL) {
+		client = (ns_client_t *)uev->ev_arg;
+
+		if (count > 0) {
+			if (secure) {
+				break;
+			}
+			result = rrset_exists(db, ver, dns_db_origin(db),
+					      dns_rdatatype_dnskey, 0, &flag);
+			if (result != ISC_R_SUCCESS || flag) {
+				break;
 			}
+		}
 
-			if (!dns_nsec3param_fromprivate(&tuple->rdata, &rdata,
-							buf, sizeof(buf))) {
-				continue;
+		ISC_LIST_UNLINK(*group, (isc_event_t *)uev, ev_link);
+		dns_diff_init(client->mctx, &udiff);
+		result = update_apply(client, zone, db, oldver, ver, &udiff);
+		if (result == ISC_R_SUCCESS && count > 0) {
+			result = rrset_exists(db, ver, dns_db_origin(db),
+					      dns_rdatatype_dnskey, 0, &flag);
+			if (result == ISC_R_SUCCESS && flag) {
+				/*
+				 * This request signs the zone; commit it
+				 * on its own.
+				 */
+				result = undo_diff(&udiff, db, ver);
+				dns_diff_clear(&udiff);
+				if (result != ISC_R_SUCCESS) {
+					update_done(uev, result);
+					goto rollback;
+				}
+				ISC_LIST_PREPEND(*group, (isc_event_t *)uev,
+						 ev_link);
+				break;
 			}
-			dns_rdata_tostruct(&rdata, &nsec3param, NULL);
-			if (nsec3param.flags == 0) {
+		}
+
+		if (result != ISC_R_SUCCESS) {
+			/*
+			 * The reason for failure should have been logged
+			 * at this point.
+			 */
+			update_log(client, zone, LOGLEVEL_DEBUG,
+				   "rolling back");
+			if (count == 0) {
+				dns_diff_clear(&udiff);
+				dns_db_closeversion(db, &ver, false);
+				update_done(uev, result);
+				result = dns_db_newversion(db, &ver);
+				if (result != ISC_R_SUCCESS) {
+					goto cleanup;
+				}
 				continue;
 			}
-
-			result = dns_zone_addnsec3chain(zone, &nsec3param);
-			if (result != ISC_R_SUCCESS) {
-				update_log(client, zone, ISC_LOG_ERROR,
-					   "dns_zone_addnsec3chain failed: %s",
-					   dns_result_totext(result));
+			tresult = undo_diff(&udiff, db, ver);
+			dns_diff_clear(&udiff);
+			update_done(uev, result);
+			if (tresult != ISC_R_SUCCESS) {
+				result = tresult;
+				goto rollback;
 			}
+			continue;
+		}
+
+		while ((tuple = ISC_LIST_HEAD(udiff.tuples)) != NULL) {
+			ISC_LIST_UNLINK(udiff.tuples, tuple, link);
+			dns_diff_appendminimal(&diff, &tuple);
 		}
+		dns_diff_clear(&udiff);
+		ISC_LIST_APPEND(applied, (isc_event_t *)uev, ev_link);
+		count++;
+	}
+
+	if (count == 0) {
+		dns_db_closeversion(db, &ver, false);
+		goto cleanup;
+	}
+
+	uev = (update_event_t *)ISC_LIST_HEAD(applied);
+	client = (ns_client_t *)uev->ev_arg;
+	if (count > 1) {
+		update_log(client, zone, LOGLEVEL_DEBUG,
+			   "committing %u updates together", count);
+	}
+	if (!ISC_LIST_EMPTY(diff.tuples)) {
+		result = update_commit(client, zone, db, &ver, &diff);
 	} else {
 		update_log(client, zone, LOGLEVEL_DEBUG, "redundant request");
 		dns_db_closeversion(db, &ver, true);
+		result = ISC_R_SUCCESS;
 	}
-	result = ISC_R_SUCCESS;
-	goto common;
 
-failure:
-	/*
-	 * The reason for failure should have been logged at this point.
-	 */
+rollback:
 	if (ver != NULL) {
-		update_log(client, zone, LOGLEVEL_DEBUG, "rolling back");
+		uev = (update_event_t *)ISC_LIST_HEAD(applied);
+		if (uev != NULL) {
+			client = (ns_client_t *)uev->ev_arg;
+			update_log(client, zone, LOGLEVEL_DEBUG,
+				   "rolling back");
+		}
 		dns_db_closeversion(db, &ver, false);
 	}
+	while ((uev = (update_event_t *)ISC_LIST_HEAD(applied)) != NULL) {
+		ISC_LIST_UNLINK(applied, (isc_event_t *)uev, ev_link);
+		update_done(uev, result);
+	}
 
-common:
-	dns_diff_clear(&temp);
+cleanup:
 	dns_diff_clear(&diff);
 
 	if (oldver != NULL) {
@@ -3482,25 +3742,36 @@ common:
 		dns_db_detach(&db);
 	}
 
-	if (rules != NULL) {
-		isc_mem_put(mctx, rules, sizeof(*rules) * ruleslen);
-	}
+	INSIST(ver == NULL);
+}
 
-	if (ssutable != NULL) {
-		dns_ssutable_detach(&ssutable);
+static void
+update_action(isc_task_t *task, isc_event_t *event) {
+	update_event_t *uev = (update_event_t *)event;
+	dns_zone_t *zone = NULL;
+	isc_eventlist_t group;
+	uint32_t max;
+
+	INSIST(event->ev_type == DNS_EVENT_UPDATE);
+
+	/*
+	 * Each request holds a reference to the zone until it is answered.
+	 */
+	dns_zone_attach(uev->zone, &zone);
+
+	ISC_LIST_INIT(group);
+	ISC_LIST_APPEND(group, event, ev_link);
+	max = dns_zone_getupdategroup(zone);
+	if (max > 1) {
+		update_gather(task, zone, max, &group);
 	}
 
-	isc_task_detach(&task);
-	uev->result = result;
-	if (zone != NULL) {
-		INSIST(uev->zone == zone); /* we use this later */
+	while (!ISC_LIST_EMPTY(group)) {
+		update_group(zone, &group);
 	}
-	uev->ev_type = DNS_EVENT_UPDATEDONE;
-	uev->ev_action = updatedone_action;
-	isc_task_send(client->task, &event);
 
-	INSIST(ver == NULL);
-	INSIST(event == NULL);
+	dns_zone_detach(&zone);
+	isc_task_detach(&task);
 }
 
 static void